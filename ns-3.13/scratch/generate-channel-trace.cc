@@ -0,0 +1,66 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "ns3/scenario-creator-module.h"
+#include "ns3/simulation-singleton.h"
+
+using namespace ns3;
+using namespace std;
+
+/**
+ * Pre-generate the channel realization of a scenario (BEAR SNR series, HMM state timelines or MANUAL FER decisions, according to the
+ * PROPAGATION_LOSS_MODEL key of the configuration file) into a binary channel trace. The trace can be afterwards replayed by setting
+ * PROPAGATION_LOSS_MODEL=TRACE and the [TRACE] FILE key, so that different simulations see exactly the same channel.
+ *
+ * The scenario is only configured (not run). Example:
+ * 		./waf --run "scratch/generate-channel-trace --config=network-coding-scenario --output=channel.trace --samples=100000"
+ * Time-based HMM channels are sampled every --slot microseconds
+ */
+
+int main (int argc, char *argv[])
+{
+	CommandLine cmd;
+	string configuration = "network-coding-scenario";
+	string output = "channel.trace";
+	u_int32_t samples = 100000;
+	u_int32_t slot = 1000;
+	u_int32_t run = 1;
+
+	cmd.AddValue ("config", "Scenario configuration file (raw name, as in test-scenario)", configuration);
+	cmd.AddValue ("output", "Channel trace file", output);
+	cmd.AddValue ("samples", "Number of samples (frames or time slots) per link", samples);
+	cmd.AddValue ("slot", "Sample duration (us) for time-based HMM channels", slot);
+	cmd.AddValue ("run", "Simulation run (random stream)", run);
+	cmd.Parse (argc, argv);
+
+	SeedManager::SetSeed (3);
+	SeedManager::SetRun (run);
+
+	//The channel models are created (and the trace generated) when the scenario is initialized
+	SimulationSingleton <ConfigureScenario>::Get ()->ParseConfigurationFile (configuration);
+	SimulationSingleton <ConfigureScenario>::Get ()->SetAttributes ();
+	SimulationSingleton <ConfigureScenario>::Get ()->SetChannelTraceGeneration (output, samples, MicroSeconds (slot));
+	SimulationSingleton <ConfigureScenario>::Get ()->Init ();
+
+	Simulator::Destroy ();
+
+	return 0;
+} 	//end main
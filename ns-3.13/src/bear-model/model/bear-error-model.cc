@@ -126,13 +126,12 @@ bool BearErrorModel::DoCorrupt(Ptr<Packet> packet)
 	bool rxError = false;
 	packetInfo_t packetInfo;
 
-	//Locate the SNR within the map
-	channelSetIter_t iter = m_channelSetMap->find (ChannelMeshPropagationKey (NodeList::GetNode (m_txIndex)->GetObject<MobilityModel> (),
-			NodeList::GetNode (m_rxIndex)->GetObject<MobilityModel> ()));
-
-	if (iter != m_channelSetMap->end())
+	//Locate the SNR within the link table (directly indexed by the node IDs)
+	Ptr<BearModelEntry> link;
+	if (m_channelSetMap->Contains (m_txIndex, m_rxIndex))
 	{
-		m_snr = iter->second->GetCurrentSnr();
+		link = m_channelSetMap->Get (m_txIndex, m_rxIndex);
+		m_snr = link->GetCurrentSnr();
 	}
 
 	packetInfo = ParsePacket(packet);
@@ -160,16 +159,36 @@ bool BearErrorModel::DoCorrupt(Ptr<Packet> packet)
 	}
 
 	//Tracing and callbacks
-	m_rxTrace (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+	if (link == 0)
+	{
+		return rxError;
+	}
+
+	m_rxTrace (packet, 0, rxError, link->GetCurrentRxPower(), link->GetCurrentSlowFading(), link->GetCurrentFastFading());
 
 	if (!m_rxCallback.IsNull ())
 	{
-		m_rxCallback (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+		m_rxCallback (packet, 0, rxError, link->GetCurrentRxPower(), link->GetCurrentSlowFading(), link->GetCurrentFastFading());
 	}
 
 	return rxError;
 }
 
+bool BearErrorModel::DecideDataFrame (u_int16_t tx, u_int16_t rx)
+{
+	NS_LOG_FUNCTION (tx << rx);
+
+	m_txIndex = tx;
+	m_rxIndex = rx;
+	if (!m_channelSetMap->Contains (m_txIndex, m_rxIndex))
+	{
+		return false;
+	}
+	m_snr = m_channelSetMap->Get (m_txIndex, m_rxIndex)->GetCurrentSnr();
+
+	return CorruptDataFrame (0);
+}
+
 bool BearErrorModel::CorruptDataFrame(Ptr<Packet>)
 {
 	NS_LOG_FUNCTION_NOARGS();
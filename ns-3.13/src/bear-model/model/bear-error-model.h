@@ -44,6 +44,7 @@
 
 #include "bear-model-entry.h"
 #include "ns3/channel-mesh-propagation-handler.h"
+#include "ns3/link-state-table.h"
 
 using namespace std;
 
@@ -111,8 +112,8 @@ class BearErrorModel: public ErrorModel
 public:
 
 	//Parameter definitions
-	typedef std::map <ChannelMeshPropagationKey, Ptr<BearModelEntry> > channelSet_t;
-	typedef std::map <ChannelMeshPropagationKey, Ptr<BearModelEntry> >::const_iterator channelSetIter_t;
+	//Per-link BEAR entries, indexed by the (transmitter, receiver) node IDs
+	typedef LinkStateTable<Ptr<BearModelEntry> > channelSet_t;
 
 	/**
 	 * arg1: packet received successfully
@@ -143,6 +144,13 @@ public:
 	 * \returns True if the packet is corrupted
 	 */
 	bool CorruptDataFrame (Ptr<Packet> packet);
+	/**
+	 * \brief Decide whether a data frame is correct or not, from the current SNR of the link (used to pre-generate channel traces)
+	 * \param tx The Node ID of the transmitter entity
+	 * \param rx The Node ID of the receiver entity
+	 * \returns True if the frame is corrupted
+	 */
+	bool DecideDataFrame (u_int16_t tx, u_int16_t rx);
 	/**
 	 * \brief Apply a logistic function to decide whether an ack (TCP) frame is correct or not
 	 * \param packet The packet received
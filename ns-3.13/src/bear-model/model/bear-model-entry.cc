@@ -49,6 +49,10 @@ NS_LOG_COMPONENT_DEFINE ("BearModelEntry");
 NS_OBJECT_ENSURE_REGISTERED (BearModelEntry);
 
 BearModelEntry::BearModelEntry():
+		m_head (0),
+		m_count (0),
+		m_order (0),
+		m_coherenceTime (0.0),
 		m_currentRxPower (0.0),
 		m_currentSlowFading (0.0),
 		m_currentFastFading (0.0),
@@ -58,6 +62,10 @@ BearModelEntry::BearModelEntry():
 }
 
 BearModelEntry::BearModelEntry(int order, double coherenceTime):
+		m_snrRing (2 * (order > 0 ? order : 0), 0.0),
+		m_timeRing (order > 0 ? order : 0),
+		m_head (0),
+		m_count (0),
 		m_order (order),
 		m_coherenceTime (coherenceTime),
 		m_currentRxPower (0.0),
@@ -77,20 +85,24 @@ void BearModelEntry::UpdateSnr (double snr)
 {
 	NS_LOG_FUNCTION (this);
 
-	struct prevValues_t newSample;
+	int position;
 	double newTimeout;
-	newSample.time = Simulator::Now();
 
-	//If the vector is empty, set the timer with the arrival of the first frame
-	if (!m_previousSnr.size())
+	if (m_order <= 0)
+	{
+		return;
+	}
+
+	//If the buffer is empty, set the timer with the arrival of the first frame
+	if (!m_count)
 	{
 		m_coherenceTimeout = Simulator::Schedule(MilliSeconds(m_coherenceTime), &BearModelEntry::HandleCoherenceTimeout, this);
 		NS_LOG_DEBUG("Timeout established at " << Simulator::Now().GetSeconds() + m_coherenceTime/1e3);
 	}
-	//If the vector is full (already holds AR model order values), we do erase the oldest one (the first one), and push back the newest one
-	//at the end of the vector. It is worth highlighting, that if there is an active timer
-	if(m_previousSnr.size() && m_previousSnr.size() == ((unsigned) m_order)) {
-		m_previousSnr.erase(m_previousSnr.begin());
+	//If the buffer is full (already holds AR model order values), we do erase the oldest one, and push back the newest one
+	//at the end of the window. It is worth highlighting, that if there is an active timer
+	if(m_count == m_order) {
+		PopOldestSnr ();
 		if (m_coherenceTimeout.IsRunning())
 		{
 			m_coherenceTimeout.Cancel();
@@ -105,21 +117,25 @@ void BearModelEntry::UpdateSnr (double snr)
 //			m_coherenceTimeout = Simulator::Schedule(MilliSeconds(newTimeout), &BearModelEntry::HandleCoherenceTimeout, this);
 //		}
 	}
-	newSample.snr = snr;
-	m_previousSnr.push_back(newSample);
+	position = (m_head + m_count) % m_order;
+	m_snrRing[position] = snr;
+	m_snrRing[position + m_order] = snr;
+	m_timeRing[position] = Simulator::Now();
+	m_count++;
 	DisplaySnrQueue();
 }
 
-int BearModelEntry::GetPreviousSnr(vector<double> &previousSnr)
+const double * BearModelEntry::GetPreviousSnr(int &size) const
 {
 	NS_LOG_FUNCTION_NOARGS();
-	int i;
-
-	for(i = 0 ; i < (int) m_previousSnr.size() ; i++) {
-		previousSnr.push_back(m_previousSnr[i].snr);
-	}
+	size = m_count;
+	return m_count ? &m_snrRing[m_head] : 0;
+}
 
-	return ((int) m_previousSnr.size());
+void BearModelEntry::PopOldestSnr ()
+{
+	m_head = (m_head + 1) % m_order;
+	m_count--;
 }
 
 double BearModelEntry::GetNextTimeout()
@@ -127,9 +143,9 @@ double BearModelEntry::GetNextTimeout()
 	NS_LOG_FUNCTION(this);
 	double timeout, currentTime, firstArrival;
 
-	if(m_previousSnr.size())
+	if(m_count)
 	{
-		firstArrival = m_previousSnr[0].time.GetMilliSeconds();
+		firstArrival = m_timeRing[m_head].GetMilliSeconds();
 		currentTime = Simulator::Now().GetMilliSeconds();
 		timeout = m_coherenceTime - (currentTime - firstArrival);
 
@@ -152,9 +168,9 @@ void BearModelEntry::HandleCoherenceTimeout()
 {
 	NS_LOG_FUNCTION(Simulator::Now().GetSeconds());
 
-	if(m_previousSnr.size())
+	if(m_count)
 	{
-		m_previousSnr.erase(m_previousSnr.begin());
+		PopOldestSnr ();
 		m_coherenceTimeout = Simulator::Schedule (MilliSeconds(GetNextTimeout()), &BearModelEntry::HandleCoherenceTimeout, this);
 	}
 	else
@@ -167,9 +183,9 @@ void BearModelEntry::DisplaySnrQueue()
 	u_int8_t i;
 	char message[256];
 
-	for (i=0; i < m_previousSnr.size(); i++)
+	for (i=0; i < m_count; i++)
 	{
-		sprintf(message, "%3d SNR = %2.6f Time = %4.5f", i, m_previousSnr[i].snr, m_previousSnr[i].time.GetSeconds());
+		sprintf(message, "%3d SNR = %2.6f Time = %4.5f", i, m_snrRing[m_head + i], m_timeRing[(m_head + i) % m_order].GetSeconds());
 		NS_LOG_DEBUG(message);
 	}
 }
@@ -44,11 +44,6 @@ namespace ns3 {
 class Packet;
 class BearErrorModel;
 
-struct prevValues_t {
-	double 		snr;
-	Time 		time;
-};
-
 class BearModelEntry: public Object
 {
 public:
@@ -75,10 +70,11 @@ public:
 	 void UpdateSnr (double snr);
 
 	 /**
-	  *  \param previousSnr Vector which will hold the SNR values (window)
-	  *  \returns The size of the input vector
+	  *  \param size It will hold the number of SNR values currently buffered (window)
+	  *  \returns Pointer to the buffered SNR values, contiguous and sorted from the oldest to the newest one (no copy is made; valid until the
+	  *  next update or coherence timeout)
 	  */
-	 int GetPreviousSnr (vector<double> &previousSnr);
+	 const double * GetPreviousSnr (int &size) const;
 
 	 /**
 	  * \param coherenceTime Channel coherence
@@ -129,8 +125,17 @@ public:
 
 private:
 
-	 //Vector that stores the SNR and the timestamp of the overheard packets (Size set by the AR filter order)
-	 vector <struct prevValues_t> m_previousSnr;
+	 /**
+	  * \brief Discard the oldest buffered sample
+	  */
+	 void PopOldestSnr ();
+
+	 //Ring buffer that stores the SNR and the timestamp of the overheard packets (size set by the AR filter order). The SNR values are
+	 //written twice (at i and i + m_order), so the window [m_head, m_head + m_count) is always contiguous
+	 vector <double> m_snrRing;
+	 vector <Time> m_timeRing;
+	 int m_head;					//Position of the oldest sample
+	 int m_count;					//Number of buffered samples
 
 	 //One timer per ChannelEntry object
 	 EventId m_coherenceTimeout;
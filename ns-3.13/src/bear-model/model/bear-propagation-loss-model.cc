@@ -101,7 +101,11 @@ BearPropagationLossModel::BearPropagationLossModel() : m_order (3),
 		m_ffVariance (2.8),
 //		m_ffVariance (1.67),
 		m_stdDevDb (2.6),
-		m_ranvar (UniformVariable (0.0, 1.0))
+		m_ranvar (UniformVariable (0.0, 1.0)),
+		m_arTapsStride (0),
+		m_arNoise (0.0, 1.0),
+		m_arInitialNoise (0.0, 1.0),
+		m_fastFading (0.0, 1.0)
 {
 	NS_LOG_FUNCTION(this);
 	GetCoefficientsFromConfigurationFile("coefsAR.cfg");
@@ -110,8 +114,6 @@ BearPropagationLossModel::BearPropagationLossModel() : m_order (3),
 
 	Ptr<BearModelEntry> channel;
 
-	channelSetIter_t iter;
-
 	//Private variable initialization
 	m_symmetry = true;
 	m_coherenceTime = 10000.0;
@@ -124,16 +126,16 @@ BearPropagationLossModel::BearPropagationLossModel() : m_order (3),
 	Ptr<FriisPropagationLossModel> aux = CreateObject <FriisPropagationLossModel> ();
 	m_propagationLoss = aux;
 
-	//Create the map which contains the nodes' location (ConstantMobilityModel only)
+	//Create the table which contains the nodes' links
+	m_channelSetMap.Resize (NodeList().GetNNodes());
 	for (i = 0; i < (int) NodeList().GetNNodes(); i++) {
 		for (j = 0; j < (int) NodeList().GetNNodes(); j++) {
 			if (i != j) {
 				NS_LOG_DEBUG ("Node " << (int) i << " -> Node " << (int) j);
-				ChannelMeshPropagationKey key ((NodeList().GetNode(i))->GetObject<MobilityModel>(), (NodeList().GetNode(j))->GetObject<MobilityModel>(), i, j) ;
 				Ptr<BearModelEntry> entry = CreateObject <BearModelEntry> (m_order, m_coherenceTime);
 
-				//Insert the element into the map
-				m_channelSetMap.insert (pair<ChannelMeshPropagationKey, Ptr<BearModelEntry> > (key, entry));
+				//Insert the element into the table
+				m_channelSetMap.Set (i, j, entry);
 			}
 		}
 	}
@@ -149,8 +151,7 @@ BearPropagationLossModel::~BearPropagationLossModel ()
 	NS_LOG_FUNCTION(this);
 	if (m_arFilterCoefficientsMap.size() > 0)
 		m_arFilterCoefficientsMap.clear();
-	if (m_channelSetMap.size() > 0)
-		m_channelSetMap.clear();
+	m_channelSetMap.Clear();
 }
 
 void BearPropagationLossModel::SetPropagationLoss (std::string type,
@@ -255,16 +256,33 @@ bool BearPropagationLossModel::GetCoefficientsFromConfigurationFile (string file
 
 	arCoefficientsFile.close();
 
+	LoadArTaps ();
+
 	return true;
 }
 
+void BearPropagationLossModel::LoadArTaps ()
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	int key, j;
+
+	//One row per coefficient set (keys from 0 to the highest one read from the file); missing coefficients are set to 0
+	m_arTapsStride = m_arFilterCoefficientsMap.size() ? m_arFilterCoefficientsMap.rbegin()->first + 1 : 1;
+	m_arTaps.assign (m_arTapsStride * m_arTapsStride, 0.0);
+
+	for (key = 0; key < m_arTapsStride; key++)
+	{
+		for (j = 0; j < m_arTapsStride; j++)
+		{
+			m_arTaps [key * m_arTapsStride + m_arTapsStride - 1 - j] = GetArFilterCoefficient (key, j);
+		}
+	}
+}
+
 double BearPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
 {
 	NS_LOG_FUNCTION(Simulator::Now().GetSeconds() << txPowerDbm << a << b);
 	double rxPowerDbm;
-	double arOutput;
-	double fastFadingRandomValue;
-	NormalVariable fastFading (0.0, m_ffVariance);
 	double snr;
 
 	//The estimation of the received SNR will be composed by three different stages
@@ -272,8 +290,6 @@ double BearPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityM
 	//1- The first contribution will rely on a previously defined propagation loss model that
 	//will calculate the atenuation factor as a function of the distance between the two involved nodes
 	// (we should apply a deterministic propagation loss model).
-	rxPowerDbm = m_propagationLoss->CalcRxPower(txPowerDbm, a, b);
-
 	if (m_receivedSnr.first)  //If true, force the channel to return a fixed SNR value. Since it is already a relative value, we don't need to calculate the final SNR
 	{
 		rxPowerDbm = m_receivedSnr.second;
@@ -285,13 +301,47 @@ double BearPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityM
 		snr = rxPowerDbm - 10 * log10(m_noise);
 	}
 
-	//2 - Calculate the SF contribution; we have to look into the sliding windows searching the previous samples
-	arOutput = GetCurrentArValue (a, b);
+	return AddFading (rxPowerDbm, snr, ChannelMeshPropagationKey::GetNodeId (a), ChannelMeshPropagationKey::GetNodeId (b));
+}
+
+void BearPropagationLossModel::DoCalcRxPowerBatch (Ptr<MobilityModel> a, const vector<Ptr<MobilityModel> > &b, vector<double> &rxPowerDbm) const
+{
+	NS_LOG_FUNCTION (Simulator::Now().GetSeconds() << a << b.size ());
+	u_int32_t i;
+	u_int32_t tx = ChannelMeshPropagationKey::GetNodeId (a);
+	double noiseDbm = 10 * log10 (m_noise);
+
+	//1- Deterministic contribution of the whole batch (see DoCalcRxPower)
+	if (m_receivedSnr.first)
+	{
+		rxPowerDbm.assign (b.size (), m_receivedSnr.second);
+	}
+	else
+	{
+		m_propagationLoss->CalcRxPowerBatch (a, b, rxPowerDbm);
+	}
+
+	//2, 3 - Slow and fast fading, link by link
+	for (i = 0; i < b.size (); i++)
+	{
+		double snr = m_receivedSnr.first ? rxPowerDbm[i] : rxPowerDbm[i] - noiseDbm;
+		rxPowerDbm[i] = AddFading (rxPowerDbm[i], snr, tx, ChannelMeshPropagationKey::GetNodeId (b[i]));
+	}
+}
+
+double BearPropagationLossModel::AddFading (double rxPowerDbm, double snr, u_int32_t tx, u_int32_t rx) const
+{
+	double arOutput;
+	double fastFadingRandomValue;
+
+	//2 - Calculate the SF contribution; we have to look into the sliding windows searching the previous samples (single link lookup per frame)
+	Ptr<BearModelEntry> channel = m_channelSetMap.Contains (tx, rx) ? m_channelSetMap.Get (tx, rx) : 0;
+	arOutput = GetCurrentArValue (channel);
 
 	//3 - The FF contribution will be a raw random value
 	if(m_order)
 	{
-		fastFadingRandomValue = fastFading.GetValue();
+		fastFadingRandomValue = m_fastFading.GetValue() * sqrt (m_ffVariance);
 	}
 	else
 	{
@@ -301,17 +351,16 @@ double BearPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityM
 	NS_LOG_INFO ("Prop.= " << rxPowerDbm << " AR filter = " << arOutput << " Fast Fading " << fastFadingRandomValue);
 
 	//Only for debugging
-	channelSetIter_t iter = m_channelSetMap.find (ChannelMeshPropagationKey (a,b));
-	if (iter != m_channelSetMap.end())
+	if (channel != 0)
 	{
 		//Store the values
-		iter->second->SetCurrentRxPower (snr);
-		iter->second->SetCurrentSlowFading (arOutput);
-		iter->second->SetCurrentFastFading (fastFadingRandomValue);
-		iter->second->SetCurrentSnr (snr + arOutput + fastFadingRandomValue);
+		channel->SetCurrentRxPower (snr);
+		channel->SetCurrentSlowFading (arOutput);
+		channel->SetCurrentFastFading (fastFadingRandomValue);
+		channel->SetCurrentSnr (snr + arOutput + fastFadingRandomValue);
 
-		NS_LOG_DEBUG (Simulator::Now().GetSeconds() << ": Channel found " << iter->first.m_tx << " -> " << iter->first.m_rx << " SNR: " <<
-				rxPowerDbm + arOutput + fastFadingRandomValue << "dB (" << iter->first.m_link.first << " -> " << iter->first.m_link.second << ")" );
+		NS_LOG_DEBUG (Simulator::Now().GetSeconds() << ": Channel found " << tx << " -> " << rx << " SNR: " <<
+				rxPowerDbm + arOutput + fastFadingRandomValue << "dB");
 
 	}
 
@@ -340,91 +389,57 @@ double BearPropagationLossModel::GetArFilterCoefficient(int key, int vectorPosit
 }
 
 
-double BearPropagationLossModel::GetCurrentArValue (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const
+double BearPropagationLossModel::GetCurrentArValue (Ptr<BearModelEntry> channel) const
 {
 	NS_LOG_FUNCTION_NOARGS();
 
-//	bool txFound = false;
-//	bool rxFound = false;
-//	ChannelKey key;
-	channelSetIter_t channelKeyIter;
-	Ptr<BearModelEntry> channel;
-	u_int32_t i;
+	int i, key, first;
 	int currentSize;
 	double currentSnr = 0.0;
-	vector<double> previousSNR;
-	NormalVariable randomArNoise (0.0, pow(m_stdDevDb,2));
-	NormalVariable randomNoise (0.0, m_variance);
-
-	channelKeyIter = m_channelSetMap.find (ChannelMeshPropagationKey (sender, receiver));
-
-	 if (channelKeyIter != m_channelSetMap.end())
-	 {
-		 channel = channelKeyIter->second;
-	 }
-	 else
-	 {
-		 NS_LOG_ERROR ("Channel not found");
-		 channel = 0;
-	 }
+	double arSum;
+	const double *previousSnr;
+	const double *taps;
 
 	 //If there is a channel defined, get the current SNR value
 	 if (channel != 0)
 	 {
-		 currentSize = channel->GetPreviousSnr(previousSNR);
+		 previousSnr = channel->GetPreviousSnr(currentSize);
 		 //If we have any packet buffered, use the Yule-Walker expression
 		 if (currentSize && m_order)
 		 {
-			 currentSnr = randomNoise.GetValue();
-			 #ifdef NS3_LOG_ENABLE
-			 if (g_debug)
+			 //Coefficient set: the one of the current window size, until it reaches the AR filter order
+			 key = currentSize < m_order ? currentSize : m_order;
+			 if (key >= m_arTapsStride)
 			 {
-				 printf("Slow fading: SV[i] = ");
+				 NS_LOG_ERROR ("AR coefficient not found");
+				 key = 0;
 			 }
-			 #endif //NS3_LOG_ENABLE
-			 if (currentSize < m_order)
+			 //Samples older than the highest coefficient of the set would be weighted by 0, so they are skipped
+			 first = currentSize > m_arTapsStride - 1 ? currentSize - (m_arTapsStride - 1) : 0;
+			 previousSnr += first;
+			 taps = &m_arTaps [key * m_arTapsStride + m_arTapsStride - 1 - currentSize + first];
+
+			 //previousSnr[i] (oldest first) is weighted by the coefficient (key, currentSize - first - i)
+			 arSum = 0.0;
+			 for (i = 0; i < currentSize - first; i++)
 			 {
-
-				 for (i=0; i < (unsigned) currentSize; i++)
-				 {
-					currentSnr -= previousSNR[i] * GetArFilterCoefficient(currentSize, currentSize -i);
-					#ifdef NS3_LOG_ENABLE
-					if (g_debug)
-					{
-						printf("a [%d,%d] (%f) * SV [i-%d] (%f) ", currentSize , currentSize - i, GetArFilterCoefficient(currentSize, currentSize -i),    \
-								currentSize - i, previousSNR[i] );
-						if ( i != (unsigned) currentSize - 1)
-							printf("+ ");
-					}
-					#endif //NS3_LOG_ENABLE
-
-				 }
-				 #ifdef NS3_LOG_ENABLE
-				 if (g_debug)
-					 printf(" = %f\n", currentSnr);
-				#endif //NS3_LOG_ENABLE
+				 arSum += previousSnr[i] * taps[i];
 			 }
-			 else
+			 currentSnr = m_arNoise.GetValue() * sqrt (m_variance) - arSum;
+
+			 #ifdef NS3_LOG_ENABLE
+			 if (g_debug)
 			 {
-				 for (i=0; i < (unsigned) currentSize; i++)
+				 printf("Slow fading: SV[i] = ");
+				 for (i = 0; i < currentSize - first; i++)
 				 {
-					 currentSnr -= previousSNR[i] * GetArFilterCoefficient(m_order, currentSize -i);
-					 #ifdef NS3_LOG_ENABLE
-					 if (g_debug)
-					 {
-						 printf("a [%d,%d] (%f) * SV [i-%d] (%f) ", m_order , currentSize - i, GetArFilterCoefficient(m_order, currentSize -i),    \
-								 currentSize - i, previousSNR[i] );
-						 if ( i != (unsigned) currentSize - 1)
-							 printf("+ ");
-					 }
-					 #endif //NS3_LOG_ENABLE
-
+					 printf("a [%d,%d] (%f) * SV [i-%d] (%f) ", key, currentSize - first - i, taps[i], currentSize - first - i, previousSnr[i]);
+					 if (i != currentSize - first - 1)
+						 printf("+ ");
 				 }
-				 #ifdef NS3_LOG_ENABLE
-				 if (g_debug)
-					 printf(" = %f\n", currentSnr);
-				 #endif //NS3_LOG_ENABLE
+				 printf(" = %f\n", currentSnr);
 			 }
+			 #endif //NS3_LOG_ENABLE
 		 }
 
 		 //When we have an empty queue (currentSize == 0) -> We set the Slow Varying value
@@ -432,7 +447,7 @@ double BearPropagationLossModel::GetCurrentArValue (Ptr<MobilityModel> sender, P
 		 //equal to m_stdDevDb
 		 else
 		 {
-			 currentSnr = randomArNoise.GetValue();
+			 currentSnr = m_arInitialNoise.GetValue() * fabs (m_stdDevDb);
 			 if (g_debug)
 				 printf("Slow fading: SV[i] = %f\n", currentSnr);
 		 }
@@ -446,6 +461,34 @@ double BearPropagationLossModel::GetCurrentArValue (Ptr<MobilityModel> sender, P
 	return currentSnr;
 }
 
+void BearPropagationLossModel::GenerateTrace (ChannelTraceWriter &writer, double txPowerDbm, Ptr<PropagationLossModel> preceding)
+{
+	NS_LOG_FUNCTION (this << txPowerDbm);
+	u_int32_t tx, rx, i;
+
+	for (tx = 0; tx < writer.GetNNodes (); tx++)
+	{
+		for (rx = 0; rx < writer.GetNNodes (); rx++)
+		{
+			if (!m_channelSetMap.Contains (tx, rx))
+			{
+				continue;
+			}
+			Ptr<MobilityModel> a = NodeList::GetNode (tx)->GetObject<MobilityModel> ();
+			Ptr<MobilityModel> b = NodeList::GetNode (rx)->GetObject<MobilityModel> ();
+			Ptr<BearModelEntry> channel = m_channelSetMap.Get (tx, rx);
+			double inputPowerDbm = preceding ? preceding->CalcRxPower (txPowerDbm, a, b) : txPowerDbm;
+
+			//Each sample goes through the same stages as a frame sent over the link: SNR estimation and error decision
+			for (i = 0; i < writer.GetNSamples (); i++)
+			{
+				CalcRxPower (inputPowerDbm, a, b);
+				writer.SetSample (tx, rx, i, channel->GetCurrentSnr (), m_errorModel->DecideDataFrame (tx, rx));
+			}
+		}
+	}
+}
+
 void BearPropagationLossModel::SetReceivedSnr(pair<bool, double> receivedSnr)
 {
 	NS_LOG_FUNCTION(this);
@@ -36,6 +36,7 @@
 
 #include "ns3/event-id.h"
 #include "ns3/channel-mesh-propagation-handler.h"
+#include "ns3/channel-trace.h"
 
 //Configuration file
 #include "ns3/configuration-file.h"
@@ -136,11 +137,10 @@ public:
 	double GetArFilterCoefficient (int key, int vectorPosition) const;
 	/**
 	 * \brief
-	 * \param tx Transmitter index
-	 * \param rx Reveiver index
+	 * \param channel Link entry (from the link state table) between the transmitter and the receiver
 	 * \returns Auto Regressive filter obtained value (dB)
 	 */
-	double GetCurrentArValue (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const;
+	double GetCurrentArValue (Ptr<BearModelEntry> channel) const;
 	/**
 	 * \returns the pair which define whether the channel has a fixed FER or not
 	 */
@@ -154,6 +154,15 @@ public:
 	 */
 	void DisableFixedSnr ();
 
+	/**
+	 * Pre-generate the SNR series (and the data frame decisions) of every link into a channel trace (one frame per sample), to be
+	 * later replayed by the ChannelTraceErrorModel
+	 * \param writer Channel trace to fill
+	 * \param txPowerDbm Transmission power
+	 * \param preceding Deterministic propagation loss models placed before this one in the channel chain (if any)
+	 */
+	void GenerateTrace (ChannelTraceWriter &writer, double txPowerDbm, Ptr<PropagationLossModel> preceding = 0);
+
 private:
 
 	/**
@@ -165,6 +174,25 @@ private:
 			Ptr<MobilityModel> a,
 			Ptr<MobilityModel> b) const;
 
+	/**
+	 * Batch version (i.e. broadcast frames): the deterministic loss of all the receivers is computed at once by the inner propagation
+	 * loss model, and then the slow/fast fading of each link is added (in the same order as the scalar version, so that the random
+	 * sequences are not altered)
+	 */
+	virtual void DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+			const vector<Ptr<MobilityModel> > &b,
+			vector<double> &rxPowerDbm) const;
+
+	/**
+	 * Add the slow (AR filter) and fast fading contributions of a link (stages 2 and 3 of DoCalcRxPower) and store them in its entry
+	 * \param rxPowerDbm Received power after the deterministic propagation loss
+	 * \param snr SNR after the deterministic propagation loss
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \return The received signal power
+	 */
+	double AddFading (double rxPowerDbm, double snr, u_int32_t tx, u_int32_t rx) const;
+
 	/* AR mode parameters */
 	int m_order;               /* Order of the AR filter  */
 	double m_variance;         /* Input noise variance    */
@@ -180,9 +208,8 @@ private:
 
 	RandomVariable m_ranvar;
 
-	//Map which will contain
-	typedef std::map <ChannelMeshPropagationKey, Ptr<BearModelEntry> > channelSet_t;
-	typedef std::map <ChannelMeshPropagationKey, Ptr<BearModelEntry> >::const_iterator channelSetIter_t;
+	//Dense table which will contain the entry of every link, indexed by the (transmitter, receiver) node IDs
+	typedef BearErrorModel::channelSet_t channelSet_t;
 	channelSet_t m_channelSetMap;
 
 	/* The coeficients of the AR model */
@@ -190,6 +217,21 @@ private:
 	typedef coefSet_t::const_iterator coefSetIter_t;
 	coefSet_t m_arFilterCoefficientsMap;
 
+	/**
+	 * Copy the AR coefficients into m_arTaps, so that the filter can be evaluated without any map lookup
+	 */
+	void LoadArTaps ();
+
+	/* AR taps, one row (of m_arTapsStride values) per coefficient set, stored in reverse order: position m_arTapsStride - 1 - j of row k holds
+	 * the coefficient (k, j), so that the taps of a window of n samples (oldest first) start at position m_arTapsStride - 1 - n */
+	vector<double> m_arTaps;
+	int m_arTapsStride;
+
+	/* Persistent standard normal generators (scaled by the corresponding deviation when used) */
+	NormalVariable m_arNoise;			/* AR filter input noise */
+	NormalVariable m_arInitialNoise;	/* Slow fading value when there are not previous samples */
+	NormalVariable m_fastFading;		/* Fast fading contribution */
+
 	/*Propagation Loss Model*/
 	Ptr<PropagationLossModel> m_propagationLoss;
 
@@ -1,67 +1,234 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
 
-// Include a header file from your module to test.
-#include "ns3/bear-model.h"
+#include <vector>
+#include <cmath>
 
-// An essential include is test.h
 #include "ns3/test.h"
+#include "ns3/double.h"
+#include "ns3/integer.h"
+#include "ns3/simulator.h"
+#include "ns3/node-container.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/bear-propagation-loss-model.h"
 
-// Do not put your test classes in namespace ns3.  You may find it useful
-// to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
-// This is an example TestCase.
-class Bear-modelTestCase1 : public TestCase
+// Autocorrelation of the AR process x[n] + a[1] x[n-1] + ... + a[p] x[n-p] = e[n]
+// (white e[n]) up to the given lag: rho[1..p] are the solution of the Yule-Walker
+// equations rho[k] + sum_j a[j] rho[|k-j|] = 0 (k = 1..p, rho[0] = 1), and the
+// following lags come from the same recursion
+static std::vector<double>
+ArAutocorrelation (const std::vector<double> &a, u_int32_t maxLag)
+{
+  u_int32_t p = a.size () - 1;
+  std::vector<std::vector<double> > m (p, std::vector<double> (p + 1, 0.0));
+  for (u_int32_t k = 1; k <= p; k++)
+    {
+      m[k - 1][k - 1] += 1.0;
+      for (u_int32_t j = 1; j <= p; j++)
+        {
+          if (j == k)
+            {
+              m[k - 1][p] -= a[j];
+            }
+          else
+            {
+              m[k - 1][(k > j ? k - j : j - k) - 1] += a[j];
+            }
+        }
+    }
+
+  // Gauss-Jordan elimination (partial pivoting) of the p x p system
+  for (u_int32_t c = 0; c < p; c++)
+    {
+      u_int32_t pivot = c;
+      for (u_int32_t r = c + 1; r < p; r++)
+        {
+          if (std::fabs (m[r][c]) > std::fabs (m[pivot][c]))
+            {
+              pivot = r;
+            }
+        }
+      m[c].swap (m[pivot]);
+      for (u_int32_t r = 0; r < p; r++)
+        {
+          if (r != c)
+            {
+              double f = m[r][c] / m[c][c];
+              for (u_int32_t i = c; i <= p; i++)
+                {
+                  m[r][i] -= f * m[c][i];
+                }
+            }
+        }
+    }
+
+  std::vector<double> rho (1, 1.0);
+  for (u_int32_t k = 1; k <= maxLag; k++)
+    {
+      if (k <= p)
+        {
+          rho.push_back (m[k - 1][p] / m[k - 1][k - 1]);
+        }
+      else
+        {
+          double value = 0.0;
+          for (u_int32_t j = 1; j <= p; j++)
+            {
+              value -= a[j] * rho[k - j];
+            }
+          rho.push_back (value);
+        }
+    }
+  return rho;
+}
+
+// ===========================================================================
+// Regression test of the slow fading (AR filter) contribution of the BEAR
+// model: the autocorrelation of the SNR sequence of a static link must match
+// the one of the AR process defined by the coefficient set the model loaded
+// from coefsAR.cfg for its filter order
+// ===========================================================================
+//
+class BearSnrAutocorrelationTestCase : public TestCase
 {
 public:
-  Bear-modelTestCase1 ();
-  virtual ~Bear-modelTestCase1 ();
+  BearSnrAutocorrelationTestCase ();
+  virtual ~BearSnrAutocorrelationTestCase ();
 
 private:
   virtual void DoRun (void);
 };
 
-// Add some help text to this case to describe what it is intended to test
-Bear-modelTestCase1::Bear-modelTestCase1 ()
-  : TestCase ("Bear-model test case (does nothing)")
+BearSnrAutocorrelationTestCase::BearSnrAutocorrelationTestCase ()
+  : TestCase ("Check that the BEAR slow fading keeps the autocorrelation of its AR process")
 {
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-Bear-modelTestCase1::~Bear-modelTestCase1 ()
+BearSnrAutocorrelationTestCase::~BearSnrAutocorrelationTestCase ()
 {
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-Bear-modelTestCase1::DoRun (void)
+BearSnrAutocorrelationTestCase::DoRun (void)
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+  const u_int32_t warmUp = 1000;
+  const u_int32_t samples = 10000;
+  const u_int32_t nLags = 4;
+  const u_int32_t lags[nLags] = {1, 2, 5, 10};
+  // The default coefficients (order 3) leave a pole very close to 1, so the sample
+  // autocorrelation of 10000 samples is biased downwards (the mean is removed over
+  // a window shorter than the memory of the process). 300 runs of the same filter
+  // (same warm-up, noise variance 0.005) gave a bias of 0.0004, 0.0008, 0.0024 and
+  // 0.005 and a standard deviation of 0.0003, 0.0007, 0.0021 and 0.0046 at these
+  // lags; each tolerance is the bias plus 5 standard deviations
+  const double tolerance[nLags] = {0.002, 0.005, 0.014, 0.03};
+  // The Yule-Walker equations also hold for the sample autocorrelation, regardless
+  // of that bias: over the same runs their residual never exceeded 0.002
+  const double ywTolerance = 0.003;
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0.0, 0.0, 0.0));
+  nodes.Get (0)->AggregateObject (a);
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  b->SetPosition (Vector (10.0, 0.0, 0.0));
+  nodes.Get (1)->AggregateObject (b);
+
+  // The links are created from the NodeList, hence the model must be instanced after the nodes.
+  // Without fast fading, the received power is the (constant) deterministic loss plus the AR filter output
+  Ptr<BearPropagationLossModel> model = CreateObject<BearPropagationLossModel> ();
+  model->SetAttribute ("FastFadingVariance", DoubleValue (0.0));
+
+  // Steady state: the coefficient set of the filter order (a[0] = 1)
+  IntegerValue order;
+  model->GetAttribute ("ArFilterOrder", order);
+  std::vector<double> coefficients;
+  for (int64_t j = 0; j <= order.Get (); j++)
+    {
+      coefficients.push_back (model->GetArFilterCoefficient (order.Get (), j));
+    }
+  std::vector<double> expected = ArAutocorrelation (coefficients, lags[nLags - 1]);
+
+  std::vector<double> snr;
+  double mean = 0.0;
+  for (u_int32_t i = 0; i < warmUp + samples; i++)
+    {
+      double rxPower = model->CalcRxPower (16.0206, a, b);
+      if (i >= warmUp)
+        {
+          snr.push_back (rxPower);
+          mean += rxPower;
+        }
+    }
+  mean /= samples;
+
+  double variance = 0.0;
+  for (u_int32_t i = 0; i < samples; i++)
+    {
+      snr[i] -= mean;
+      variance += snr[i] * snr[i];
+    }
+  NS_TEST_ASSERT_MSG_GT (variance, 0.0, "The AR filter does not introduce any slow fading");
+
+  std::vector<double> rho (1, 1.0);
+  for (u_int32_t k = 1; k <= lags[nLags - 1]; k++)
+    {
+      double covariance = 0.0;
+      for (u_int32_t i = k; i < samples; i++)
+        {
+          covariance += snr[i] * snr[i - k];
+        }
+      rho.push_back (covariance / variance);
+    }
+
+  for (u_int32_t l = 0; l < nLags; l++)
+    {
+      NS_TEST_EXPECT_MSG_EQ_TOL (rho[lags[l]], expected[lags[l]], tolerance[l],
+                                 "Wrong SNR autocorrelation at lag " << lags[l]);
+
+      double residual = rho[lags[l]];
+      for (u_int32_t j = 1; j < coefficients.size (); j++)
+        {
+          residual += coefficients[j] * rho[lags[l] > j ? lags[l] - j : j - lags[l]];
+        }
+      NS_TEST_EXPECT_MSG_EQ_TOL (residual, 0.0, ywTolerance,
+                                 "The SNR does not follow the AR recursion at lag " << lags[l]);
+    }
+
+  Simulator::Destroy ();
 }
 
-// The TestSuite class names the TestSuite, identifies what type of TestSuite,
-// and enables the TestCases to be run.  Typically, only the constructor for
-// this class must be defined
-//
-class Bear-modelTestSuite : public TestSuite
+class BearModelTestSuite : public TestSuite
 {
 public:
-  Bear-modelTestSuite ();
+  BearModelTestSuite ();
 };
 
-Bear-modelTestSuite::Bear-modelTestSuite ()
+BearModelTestSuite::BearModelTestSuite ()
   : TestSuite ("bear-model", UNIT)
 {
-  AddTestCase (new Bear-modelTestCase1);
+  AddTestCase (new BearSnrAutocorrelationTestCase);
 }
 
-// Do not forget to allocate an instance of this TestSuite
-static Bear-modelTestSuite bear-modelTestSuite;
-
+static BearModelTestSuite bearModelTestSuite;
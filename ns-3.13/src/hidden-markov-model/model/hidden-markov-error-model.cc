@@ -78,14 +78,12 @@ bool HiddenMarkovErrorModel::DoCorrupt(Ptr<Packet> packet)
 	Ptr<Packet> pktCopy = packet->Copy();
 	pktCopy->RemoveHeader(hdr);
 
-	//Locate the SNR within the map
-	channelSetIter_t iter = m_hmmNetworkMap->find (ChannelMeshPropagationKey (NodeList::GetNode (m_txIndex)->GetObject<MobilityModel> (),
-			NodeList::GetNode (m_rxIndex)->GetObject<MobilityModel> ()));
-
-	if (iter != m_hmmNetworkMap->end())
+	//Locate the link within the table (directly indexed by the node IDs)
+	if (m_hmmNetworkMap->Contains (m_txIndex, m_rxIndex))
 	{
-		m_currentState = iter->second->GetCurrentState();							//Variable needed to access from YansWifiPhy::EndReceive
-		m_decisionValue = iter->second->GetDecisionValue (m_currentState);
+		Ptr<HiddenMarkovModelEntry> link = m_hmmNetworkMap->Get (m_txIndex, m_rxIndex);
+		m_currentState = link->GetCurrentState();							//Variable needed to access from YansWifiPhy::EndReceive
+		m_decisionValue = link->GetDecisionValue (m_currentState);
 	}
 
 	//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
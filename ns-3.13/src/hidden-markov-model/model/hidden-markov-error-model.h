@@ -38,6 +38,7 @@
 
 #include "hidden-markov-model-entry.h"
 #include "ns3/channel-mesh-propagation-handler.h"
+#include "ns3/link-state-table.h"
 
 using namespace std;
 namespace ns3 {
@@ -55,8 +56,8 @@ class Packet;
 class HiddenMarkovErrorModel: public ErrorModel {
 public:
 
-	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > channelSet_t;
-	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> >::const_iterator channelSetIter_t;
+	//Per-link HMM entries, indexed by the (transmitter, receiver) node IDs
+	typedef LinkStateTable<Ptr<HiddenMarkovModelEntry> > channelSet_t;
 	/**
 	 * Attribute handler
 	 */
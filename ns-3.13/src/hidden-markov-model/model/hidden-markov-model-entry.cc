@@ -36,7 +36,11 @@ HiddenMarkovModelEntry::HiddenMarkovModelEntry ()
 	m_currentState = 0;
 	m_eventStarted = false;
 	m_coherenceTime = Seconds (10.0);
+	m_coherenceResets = 0;
 	m_dynamicAverageTime = false;
+	m_lazyEvolution = false;
+	m_ranvar = UniformVariable (0.0, 1.0);
+	m_sojourn = ExponentialVariable (1.0);
 
 	m_debugState = false;
 }
@@ -364,10 +368,9 @@ void HiddenMarkovModelEntry::ChangeState ()
 	double randomSample;
 	// double max;
 	// max = -1;
-	UniformVariable ranvar (0.0, 1.0);
 
 	////New model
-	randomSample = ranvar.GetValue();
+	randomSample = m_ranvar.GetValue();
 	for (i = 0; (int) i < (m_changeStateMatrix [m_currentState]).size(); i++)
 	{
 		if (randomSample < (m_changeStateMatrix [m_currentState])[i])  //Change state condition
@@ -429,38 +432,114 @@ void HiddenMarkovModelEntry::ChangeState ()
 void HiddenMarkovModelEntry::InitializeTimer ()
 {
 	NS_LOG_FUNCTION(this);
-	double nextTimeout;
-	double nextTimeoutMeanValue;
-
 
 	//Set the next timeout
-//	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_fixedTransmissionTime;
-	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_averageInterFrameTime[m_currentState];
-	ExponentialVariable expVar(nextTimeoutMeanValue);
-	nextTimeout = expVar.GetValue();
-
-	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout " << nextTimeoutMeanValue   \
-				<< " --> " << nextTimeout << " (" << m_currentState << ")");
-	m_changeStateTimeout =  Simulator::Schedule(MicroSeconds(nextTimeout), &HiddenMarkovModelEntry::TimerHandler, this);
+	m_changeStateTimeout =  Simulator::Schedule(GetNextSojourn (), &HiddenMarkovModelEntry::TimerHandler, this);
 }
 
 void HiddenMarkovModelEntry::TimerHandler ()
 {
 	NS_LOG_FUNCTION(this << Simulator::Now().GetSeconds());
-	double nextTimeout;
-	double nextTimeoutMeanValue;
+	Time nextTimeout;
 
 	//Once the timeout is reached, check if the states changes
 	//Set the next timeout
+	nextTimeout = GetNextSojourn ();
+
+	ChangeState();
+	m_changeStateTimeout = Simulator::Schedule(nextTimeout,&HiddenMarkovModelEntry::TimerHandler, this);
+}
+
+Time HiddenMarkovModelEntry::GetNextSojourn ()
+{
+	double nextTimeout;
+	double nextTimeoutMeanValue;
+
 //	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_fixedTransmissionTime;
 	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_averageInterFrameTime[m_currentState];
-	ExponentialVariable expVar(nextTimeoutMeanValue);
-	nextTimeout = expVar.GetValue();
+	nextTimeout = nextTimeoutMeanValue * m_sojourn.GetValue();
 
-	ChangeState();
 	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout " << nextTimeoutMeanValue   \
 			<< " --> " << nextTimeout << " (" << (int) m_currentState << ")");
-	m_changeStateTimeout = Simulator::Schedule(MicroSeconds(nextTimeout),&HiddenMarkovModelEntry::TimerHandler, this);
+	return MicroSeconds(nextTimeout);
+}
+
+void HiddenMarkovModelEntry::NotifyFrame ()
+{
+	NS_LOG_FUNCTION (this << Simulator::Now().GetSeconds());
+
+	UpdateState ();
+
+	//First frame after the chain was stopped (or ever): start the state change cycle
+	if (!m_eventStarted)
+	{
+		m_eventStarted = true;
+		m_nextChange = Simulator::Now() + GetNextSojourn ();
+	}
+
+	//Start over the coherence time
+	m_lastFrame = Simulator::Now();
+}
+
+void HiddenMarkovModelEntry::UpdateState ()
+{
+	if (!m_eventStarted)
+	{
+		return;
+	}
+
+	Time now = Simulator::Now();
+	Time expiry = m_lastFrame + m_coherenceTime;
+	Time limit = (expiry < now) ? expiry : now;
+
+	//Replay the timer handler for every sojourn that has elapsed (the next sojourn is drawn before changing the state, as TimerHandler does)
+	while (m_nextChange <= limit)
+	{
+		Time nextTimeout = GetNextSojourn ();
+		ChangeState ();
+		m_nextChange += nextTimeout;
+	}
+
+	//No frames within the coherence time: stop the chain and randomly choose the new current state (as CoherenceTimeoutHandler does)
+	if (expiry <= now)
+	{
+		NS_LOG_DEBUG ("Coherence time expired at " << expiry.GetSeconds());
+		m_eventStarted = false;
+		m_coherenceResets++;
+		m_currentState = m_ranvar.GetInteger(0, m_transitionMatrix.size() - 1);
+	}
+}
+
+void HiddenMarkovModelEntry::GenerateStates (u_int32_t samples, Time slot, vector<u_int8_t> &states)
+{
+	NS_LOG_FUNCTION (this << samples << slot);
+	u_int32_t i;
+	Time nextChange;
+
+	states.resize (samples);
+
+	if (m_mode == HMM_FRAME_BASED_SIMULATION)
+	{
+		for (i = 0; i < samples; i++)
+		{
+			ChangeState ();
+			states[i] = m_currentState;
+		}
+		return;
+	}
+
+	NS_ASSERT_MSG (slot.IsStrictlyPositive (), "Time-based HMM traces need a positive time slot");
+	nextChange = GetNextSojourn ();
+	for (i = 0; i < samples; i++)
+	{
+		while (nextChange <= slot * i)
+		{
+			Time nextTimeout = GetNextSojourn ();
+			ChangeState ();
+			nextChange += nextTimeout;
+		}
+		states[i] = m_currentState;
+	}
 }
 
 void HiddenMarkovModelEntry::CoherenceTimeoutHandler ()
@@ -472,6 +551,7 @@ void HiddenMarkovModelEntry::CoherenceTimeoutHandler ()
 	{
 		m_changeStateTimeout.Cancel ();
 		m_eventStarted = false;
+		m_coherenceResets++;
 
 		//Randomly choose the new current state
 		m_currentState = ranvar.GetInteger(0, m_transitionMatrix.size() - 1);
@@ -535,6 +615,10 @@ void HiddenMarkovModelEntry::PrintMatrices ()
 
 u_int8_t HiddenMarkovModelEntry::GetCurrentState ()
 {
+	if (m_lazyEvolution && m_mode == HMM_TIME_BASED_SIMULATION)
+	{
+		UpdateState ();
+	}
 	return m_currentState;
 }
 
@@ -135,7 +135,22 @@ public:
 	void CoherenceTimeoutHandler (void);
 
 	/**
-	 *	Obtain the state in which the model is allocated at a time t
+	 * Lazy evolution (time-based simulations only): called upon each frame sent over the link, instead of handling the timers. It brings
+	 * the chain up to date, starts its evolution if it was stopped and restarts the coherence time
+	 */
+	void NotifyFrame (void);
+
+	/**
+	 * Pre-generate the state sequence of the chain (used to create channel traces). Frame-based simulations: one state change draw per
+	 * sample (frame); time-based simulations: state at each time slot, with the sojourns drawn as the timers do (the chain never stops)
+	 * \param samples Number of samples
+	 * \param slot Duration of each sample (time-based simulations only)
+	 * \param states It will hold the state of the chain at each sample
+	 */
+	void GenerateStates (u_int32_t samples, Time slot, vector<u_int8_t> &states);
+
+	/**
+	 *	Obtain the state in which the model is allocated at a time t (with the lazy evolution, the chain is brought up to date first)
 	 */
 	u_int8_t GetCurrentState ();
 
@@ -146,6 +161,11 @@ public:
 	 */
 	double GetDecisionValue (u_int8_t currentState);
 
+	/**
+	 * \returns Number of times the chain has been stopped since no frames were sent during the coherence time
+	 */
+	inline u_int32_t GetCoherenceResets () const {return m_coherenceResets;}
+
 
 private:
 	bool m_eventStarted;							//Flag enabled upon the first packet reception at a particular link
@@ -174,6 +194,25 @@ private:
 	//time without receiving a frame; after that timeout, we will cancel any event regarding the HMP state shift
 	Time m_coherenceTime;
 	EventId m_coherenceTimeout;
+	u_int32_t m_coherenceResets;
+
+	/**
+	 * \returns The duration of the next sojourn, drawn from an exponential distribution whose mean is the average time of the current state
+	 */
+	Time GetNextSojourn (void);
+
+	/**
+	 * Lazy evolution: apply every state change elapsed since the last update, in a single step (no events are scheduled). The sojourns are
+	 * drawn exactly as the timers would do, and the chain stops (random state) if the coherence time has elapsed since the last frame
+	 */
+	void UpdateState (void);
+
+	bool m_lazyEvolution;							//Advance the chain only when it is queried, instead of scheduling the state changes
+	Time m_nextChange;								//Lazy evolution: instant of the next state change
+	Time m_lastFrame;								//Lazy evolution: instant of the last frame (coherence time reference)
+
+	UniformVariable m_ranvar;						//State change draws
+	ExponentialVariable m_sojourn;					//Sojourn duration draws (mean 1, scaled by the average time of the state)
 
 protected:
 	/**
@@ -38,8 +38,9 @@ HiddenMarkovPropagationLossModel::HiddenMarkovPropagationLossModel()
 	NS_LOG_FUNCTION (this);
 
 	m_dynamicAverageTime = false;
+	m_lazyEvolution = false;
 
-	//Create the error model and share the map
+	//Create the error model and share the link table
 	m_error = CreateObject<HiddenMarkovErrorModel> ();
 	m_error->SetChannelMap (&m_hmmNetworkMap);
 
@@ -49,7 +50,7 @@ HiddenMarkovPropagationLossModel::~HiddenMarkovPropagationLossModel()
 {
 	NS_LOG_FUNCTION (this);
 
-	m_hmmNetworkMap.clear();
+	m_hmmNetworkMap.Clear();
 }
 
 TypeId
@@ -73,6 +74,11 @@ HiddenMarkovPropagationLossModel::GetTypeId(void) {
 	       MakeEnumAccessor (&HiddenMarkovPropagationLossModel::m_mode),
 	       MakeEnumChecker (HMM_TIME_BASED_SIMULATION, "HMM_TIME_BASED_SIMULATION",
 	                        HMM_FRAME_BASED_SIMULATION, "HMM_FRAME_BASED_SIMULATION"))
+	.AddAttribute ("LazyEvolution",
+			"Time-based simulations: advance the chain of each link only when its state is queried, instead of scheduling every state change",
+			BooleanValue (false),
+			MakeBooleanAccessor (&HiddenMarkovPropagationLossModel::m_lazyEvolution),
+			MakeBooleanChecker ())
 //	.AddAttribute("DynamicTimeBasedAnalysis",
 //			"Use (or not) of the inter frame space model for each state",
 //			BooleanValue (true),
@@ -94,6 +100,7 @@ void HiddenMarkovPropagationLossModel::InitFromFile (string transitionMatrixFile
 	UniformVariable ranvar (0.0, (double) transitionMatrixFileName.size() - 1 );
 
 	// Instance the links from NodeList call --> There will be considered as the same link between nodes, although there might be from different interfaces
+	m_hmmNetworkMap.Resize (NodeList().GetNNodes());
 	for (i = 0; i < (int) NodeList().GetNNodes(); i++)
 	{
 		for (j = 0; j < (int) NodeList().GetNNodes(); j++)
@@ -101,20 +108,20 @@ void HiddenMarkovPropagationLossModel::InitFromFile (string transitionMatrixFile
 			if (i != j)
 			{
 				NS_LOG_DEBUG ("Node " << (int) i << " -> Node " << (int) j);
-				ChannelMeshPropagationKey key ((NodeList().GetNode(i))->GetObject<MobilityModel>(), (NodeList().GetNode(j))->GetObject<MobilityModel>(), i, j) ;
 				Ptr<HiddenMarkovModelEntry> entry = CreateObject <HiddenMarkovModelEntry> ();
 
 
 				entry->m_mode = m_mode;
 				entry->m_dynamicAverageTime = m_dynamicAverageTime;
+				entry->m_lazyEvolution = m_lazyEvolution;
 				entry->GetCoefficients (transitionMatrixFileName, emissionMatrixFileName);
 
 				//Randomly choose the initial state
 				UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
 				entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
 
-				//Insert the element into the map
-				m_hmmNetworkMap.insert (pair<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > (key, entry));
+				//Insert the element into the table
+				m_hmmNetworkMap.Set (i, j, entry);
 			}
 		}
 	}
@@ -126,6 +133,7 @@ void HiddenMarkovPropagationLossModel::InitFromFer (std::map<int, vector <u_int8
 	u_int16_t i,j;
 
 	// Instance the links from NodeList call --> There will be considered as the same link between nodes, although there might be from different interfaces
+	m_hmmNetworkMap.Resize (NodeList().GetNNodes());
 	for (i = 0; i < (int) NodeList().GetNNodes(); i++)
 	{
 		for (j = 0; j < (int) NodeList().GetNNodes(); j++)
@@ -133,10 +141,10 @@ void HiddenMarkovPropagationLossModel::InitFromFer (std::map<int, vector <u_int8
 			if (i != j)
 			{
 				NS_LOG_DEBUG ("Node " << (int) i << " -> Node " << (int) j);
-				ChannelMeshPropagationKey key ((NodeList().GetNode(i))->GetObject<MobilityModel>(), (NodeList().GetNode(j))->GetObject<MobilityModel>(), i, j) ;
 				Ptr<HiddenMarkovModelEntry> entry = CreateObject <HiddenMarkovModelEntry> ();
 				entry->m_mode = m_mode;
 				entry->m_dynamicAverageTime = m_dynamicAverageTime;
+				entry->m_lazyEvolution = m_lazyEvolution;
 
 				//Read the FER values from the FER map
 				switch (ferMap.find(i)->second[j])
@@ -161,14 +169,14 @@ void HiddenMarkovPropagationLossModel::InitFromFer (std::map<int, vector <u_int8
 
 				///Debug zone
 //				entry->PrintMatrices();
-				if (!m_hmmNetworkMap.size())
+				if (i == 0 && j == 1)
 				{
 //					entry->m_debugState = true;
 				}
 				////
 
-				//Insert the element into the map
-				m_hmmNetworkMap.insert (pair<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > (key, entry));
+				//Insert the element into the table
+				m_hmmNetworkMap.Set (i, j, entry);
 
 			}
 		}
@@ -181,6 +189,7 @@ void HiddenMarkovPropagationLossModel::InitFromDistance ()
 	u_int16_t i,j;
 
 	// Instance the links from NodeList call --> There will be considered as the same link between nodes, although there might be from different interfaces
+	m_hmmNetworkMap.Resize (NodeList().GetNNodes());
 	for (i = 0; i < (int) NodeList().GetNNodes(); i++)
 	{
 		for (j = 0; j < (int) NodeList().GetNNodes(); j++)
@@ -190,61 +199,70 @@ void HiddenMarkovPropagationLossModel::InitFromDistance ()
 				Ptr <MobilityModel> tx = (NodeList().GetNode(i))->GetObject<MobilityModel>();
 				Ptr <MobilityModel> rx = (NodeList().GetNode(j))->GetObject<MobilityModel>();
 				NS_LOG_DEBUG ("Node " << (int) i << " -> Node " << (int) j);
-				ChannelMeshPropagationKey key (tx, rx, i, j);
 
 				Ptr<HiddenMarkovModelEntry> entry = CreateObject <HiddenMarkovModelEntry> ();
 				entry->MapDistanceValue (tx->GetDistanceFrom(rx));
 				entry->m_mode = m_mode;
 				entry->m_dynamicAverageTime = m_dynamicAverageTime;
+				entry->m_lazyEvolution = m_lazyEvolution;
 
 				//Randomly choose the initial state
 				UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
 				entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
 
-				//Insert the element into the map
-				m_hmmNetworkMap.insert (pair<ChannelMeshPropagationKey, Ptr <HiddenMarkovModelEntry> > (key, entry));
+				//Insert the element into the table
+				m_hmmNetworkMap.Set (i, j, entry);
 			}
 		}
 	}
 }
 
-double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+Ptr<HiddenMarkovModelEntry> HiddenMarkovPropagationLossModel::GetLink (u_int32_t tx, u_int32_t rx) const
 {
-	NS_LOG_FUNCTION (a << b << Simulator::Now().GetSeconds());
+	return m_hmmNetworkMap.Contains (tx, rx) ? m_hmmNetworkMap.Get (tx, rx) : 0;
+}
 
-	//1 - Search the corresponding link into the map
-	channelSetIter_t iter = m_hmmNetworkMap.find (ChannelMeshPropagationKey (a,b));
+void HiddenMarkovPropagationLossModel::GenerateTrace (ChannelTraceWriter &writer)
+{
+	NS_LOG_FUNCTION (this);
+	u_int32_t tx, rx, i;
+	vector<u_int8_t> states;
+	UniformVariable ranvar (0.0, 1.0);
 
-	if (iter != m_hmmNetworkMap.end())
+	for (tx = 0; tx < writer.GetNNodes (); tx++)
 	{
-		NS_LOG_DEBUG (Simulator::Now().GetSeconds() << ": Channel found " << iter->first.m_tx << " -> " << iter->first.m_rx << " State: " <<
-				(int) iter->second->m_currentState << " (" << iter->first.m_link.first << " -> " << iter->first.m_link.second << ")" );
-
-		//2 - If the simulation is based on the time characterization, we will trigger the state-change timing operation
-		if (!(iter->second->m_eventStarted) && (m_mode == HMM_TIME_BASED_SIMULATION))
+		for (rx = 0; rx < writer.GetNNodes (); rx++)
 		{
-			NS_LOG_DEBUG (Simulator::Now().GetSeconds() <<  " - Timer initialized " << iter->second);
-			iter->second->m_eventStarted = true;
-			iter->second->InitializeTimer();
-			//Initialize the coherence timeout
-			iter->second->m_coherenceTimeout = Simulator::Schedule (iter->second->m_coherenceTime, &HiddenMarkovModelEntry::CoherenceTimeoutHandler, iter->second);
-		}
+			if (!m_hmmNetworkMap.Contains (tx, rx))
+			{
+				continue;
+			}
+			Ptr<HiddenMarkovModelEntry> link = m_hmmNetworkMap.Get (tx, rx);
+			link->GenerateStates (writer.GetNSamples (), writer.GetSlot (), states);
 
-		//3- Start over the coherence timeout
-		if (iter->second->m_coherenceTimeout.IsRunning())
-		{
-			iter->second->m_coherenceTimeout.Cancel();
-			iter->second->m_coherenceTimeout = Simulator::Schedule (iter->second->m_coherenceTime, &HiddenMarkovModelEntry::CoherenceTimeoutHandler, iter->second);
+			//Same criterion as HiddenMarkovErrorModel::Decide --> First column in emission matrix (error probability of the state)
+			for (i = 0; i < writer.GetNSamples (); i++)
+			{
+				writer.SetSample (tx, rx, i, (float) states[i], ranvar.GetValue () < link->GetDecisionValue (states[i]));
+			}
 		}
+	}
+}
 
-		//We need to connect the results calculated herein to the error model, hence it must be present an instance of the HiddenMarkovErrorModel
-		NS_ASSERT_MSG (m_error, "HiddenMarkovErrorModel not instanced, cannot continue");
+double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION (a << b << Simulator::Now().GetSeconds());
 
-		//If the simulation is time-based, the chain is prone to change its current state after the reception of each frame
-		if (m_mode == HMM_FRAME_BASED_SIMULATION)
-		{
-			iter->second->ChangeState ();
-		}
+	//1 - Search the corresponding link into the table
+	u_int32_t tx = ChannelMeshPropagationKey::GetNodeId (a);
+	u_int32_t rx = ChannelMeshPropagationKey::GetNodeId (b);
+
+	if (m_hmmNetworkMap.Contains (tx, rx))
+	{
+		Ptr<HiddenMarkovModelEntry> link = m_hmmNetworkMap.Get (tx, rx);
+		NS_LOG_DEBUG (Simulator::Now().GetSeconds() << ": Channel found " << tx << " -> " << rx << " State: " <<
+				(int) link->m_currentState << " (" << a << " -> " << b << ")" );
+		UpdateLink (link);
 	}
 	else
 	{
@@ -253,3 +271,53 @@ double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<M
 
 	return txPowerDbm;
 }
+
+void HiddenMarkovPropagationLossModel::DoCalcRxPowerBatch (Ptr<MobilityModel> a, const vector<Ptr<MobilityModel> > &b, vector<double> &rxPowerDbm) const
+{
+	NS_LOG_FUNCTION (a << b.size () << Simulator::Now().GetSeconds());
+	u_int32_t i;
+	u_int32_t tx = ChannelMeshPropagationKey::GetNodeId (a);
+
+	for (i = 0; i < b.size (); i++)
+	{
+		u_int32_t rx = ChannelMeshPropagationKey::GetNodeId (b[i]);
+		if (m_hmmNetworkMap.Contains (tx, rx))
+		{
+			UpdateLink (m_hmmNetworkMap.Get (tx, rx));
+		}
+	}
+}
+
+void HiddenMarkovPropagationLossModel::UpdateLink (Ptr<HiddenMarkovModelEntry> link) const
+{
+	//2 - If the simulation is based on the time characterization, we will trigger the state-change timing operation (with the lazy
+	//evolution, the chain is only brought up to date when queried, hence no timers are needed)
+	if (m_lazyEvolution && (m_mode == HMM_TIME_BASED_SIMULATION))
+	{
+		link->NotifyFrame();
+	}
+	else if (!(link->m_eventStarted) && (m_mode == HMM_TIME_BASED_SIMULATION))
+	{
+		NS_LOG_DEBUG (Simulator::Now().GetSeconds() <<  " - Timer initialized " << link);
+		link->m_eventStarted = true;
+		link->InitializeTimer();
+		//Initialize the coherence timeout
+		link->m_coherenceTimeout = Simulator::Schedule (link->m_coherenceTime, &HiddenMarkovModelEntry::CoherenceTimeoutHandler, link);
+	}
+
+	//3- Start over the coherence timeout
+	if (link->m_coherenceTimeout.IsRunning())
+	{
+		link->m_coherenceTimeout.Cancel();
+		link->m_coherenceTimeout = Simulator::Schedule (link->m_coherenceTime, &HiddenMarkovModelEntry::CoherenceTimeoutHandler, link);
+	}
+
+	//We need to connect the results calculated herein to the error model, hence it must be present an instance of the HiddenMarkovErrorModel
+	NS_ASSERT_MSG (m_error, "HiddenMarkovErrorModel not instanced, cannot continue");
+
+	//If the simulation is time-based, the chain is prone to change its current state after the reception of each frame
+	if (m_mode == HMM_FRAME_BASED_SIMULATION)
+	{
+		link->ChangeState ();
+	}
+}
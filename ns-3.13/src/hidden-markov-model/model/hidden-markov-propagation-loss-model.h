@@ -34,6 +34,7 @@
 #include "hidden-markov-model-entry.h"
 #include "hidden-markov-error-model.h"
 #include "ns3/channel-mesh-propagation-handler.h"
+#include "ns3/channel-trace.h"
 
 using namespace ns3;
 using namespace std;
@@ -64,6 +65,9 @@ public:
 	inline void SetDynamicAverageTime (bool flag) {m_dynamicAverageTime = flag;}
 	inline bool GetDynamicAverageTime () {return m_dynamicAverageTime;}
 
+	inline void SetLazyEvolution (bool flag) {m_lazyEvolution = flag;}
+	inline bool GetLazyEvolution () {return m_lazyEvolution;}
+
 	inline void SetErrorModel (Ptr<HiddenMarkovErrorModel> error) {m_error = error;}
 	inline Ptr<HiddenMarkovErrorModel> GetErrorModel () {return m_error;}
 
@@ -82,6 +86,18 @@ public:
 	 */
 	void InitFromDistance ();
 
+	/**
+	 * \returns The entry of the link between both nodes, or a null pointer if it does not exist
+	 */
+	Ptr<HiddenMarkovModelEntry> GetLink (u_int32_t tx, u_int32_t rx) const;
+
+	/**
+	 * Pre-generate the state timeline (and the data frame decisions) of every link into a channel trace, to be later replayed by the
+	 * ChannelTraceErrorModel. Frame-based simulations use one sample per frame, time-based ones one sample per trace slot
+	 * \param writer Channel trace to fill (the sample value is the state of the chain)
+	 */
+	void GenerateTrace (ChannelTraceWriter &writer);
+
 	/**
 	 * Function inherited from the base class Propagation loss model. It is called at YansWifiPhy::StartReceive.
 	 * It is worth highlighting that this model does not aim at the characterization of the propagation loss, it is only a link between a propagation
@@ -95,10 +111,26 @@ public:
 			Ptr<MobilityModel> a,
 			Ptr<MobilityModel> b) const;
 
+	/**
+	 * Batch version (i.e. broadcast frames): the transmitter is only resolved once, and each link is then updated as in DoCalcRxPower.
+	 * The received powers are not modified
+	 * \param a Transmitter node's mobility model
+	 * \param b Receiver nodes' mobility models
+	 * \param rxPowerDbm Transmission (and received) power towards each receiver
+	 */
+	virtual void DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+			const vector<Ptr<MobilityModel> > &b,
+			vector<double> &rxPowerDbm) const;
+
 private:
+	/**
+	 * Frame sent over a link: timers (time-based simulations) or state change (frame-based ones)
+	 * \param link Entry of the link
+	 */
+	void UpdateLink (Ptr<HiddenMarkovModelEntry> link) const;
+
 	//New mesh-compatible HMM model parameters
-	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > channelSet_t;
-	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> >::const_iterator channelSetIter_t;
+	typedef HiddenMarkovErrorModel::channelSet_t channelSet_t;
 	channelSet_t m_hmmNetworkMap;
 
 	//FER value to "map" the transition and emission files (this is configured and called from the ConfigureScenario class)
@@ -107,6 +139,7 @@ private:
 	//Type of simulation
 	HiddenMarkovSimulationMode m_mode;
 	bool m_dynamicAverageTime;
+	bool m_lazyEvolution;				//Advance the chains only when queried (time-based simulations), no timers are scheduled
 
 	//Important: Due to the architecture defined by default, the propagation and the error models are completely independent and invoked. However,
 	//we need to set a tightly linked dependency between the two models, since the results provided by the propagation loss model will be the input
@@ -1,67 +1,175 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
 
-// Include a header file from your module to test.
-#include "ns3/hidden-markov-model.h"
+#include <vector>
 
-// An essential include is test.h
 #include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/random-variable.h"
+#include "ns3/node-container.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/hidden-markov-propagation-loss-model.h"
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
 
-// This is an example TestCase.
-class Hidden-markov-modelTestCase1 : public TestCase
+// ===========================================================================
+// Drive a single link of a time-based HMM with the lazy evolution and with
+// the timers, over many frames sent in bursts separated by idle periods,
+// and compare the state occupancy and the number of coherence time resets
+// ===========================================================================
+class HiddenMarkovModelLazyEvolutionTestCase : public TestCase
 {
 public:
-  Hidden-markov-modelTestCase1 ();
-  virtual ~Hidden-markov-modelTestCase1 ();
+  HiddenMarkovModelLazyEvolutionTestCase ();
+  virtual ~HiddenMarkovModelLazyEvolutionTestCase ();
 
 private:
   virtual void DoRun (void);
+
+  /**
+   * Send the frames of both modes over the same schedule
+   * \param lazy Lazy evolution (true) or timers (false)
+   * \param occupancy It will hold the fraction of frames sent within each state
+   * \returns The number of coherence time resets
+   */
+  uint32_t Drive (bool lazy, std::vector<double> &occupancy);
+  void SendFrame (void);
+  void Sample (void);
+
+  Ptr<HiddenMarkovPropagationLossModel> m_model;
+  Ptr<MobilityModel> m_tx;
+  Ptr<MobilityModel> m_rx;
+  std::vector<uint32_t> m_frames;
 };
 
-// Add some help text to this case to describe what it is intended to test
-Hidden-markov-modelTestCase1::Hidden-markov-modelTestCase1 ()
-  : TestCase ("Hidden-markov-model test case (does nothing)")
+static const uint32_t BURSTS = 40;
+
+HiddenMarkovModelLazyEvolutionTestCase::HiddenMarkovModelLazyEvolutionTestCase ()
+  : TestCase ("Check that the lazy evolution keeps the statistics of the timer-driven HMM")
+{
+}
+
+HiddenMarkovModelLazyEvolutionTestCase::~HiddenMarkovModelLazyEvolutionTestCase ()
 {
 }
 
-// This destructor does nothing but we include it as a reminder that
-// the test case should clean up after itself
-Hidden-markov-modelTestCase1::~Hidden-markov-modelTestCase1 ()
+void
+HiddenMarkovModelLazyEvolutionTestCase::SendFrame (void)
 {
+  m_model->CalcRxPower (16.0, m_tx, m_rx);
+  m_frames[m_model->GetLink (0, 1)->GetCurrentState ()]++;
 }
 
-//
-// This method is the pure virtual method from class TestCase that every
-// TestCase must implement
-//
 void
-Hidden-markov-modelTestCase1::DoRun (void)
+HiddenMarkovModelLazyEvolutionTestCase::Sample (void)
 {
-  // A wide variety of test macros are available in src/core/test.h
-  NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
-  // Use this one for floating point comparisons
-  NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
+  // Without frames, the lazy chain is only brought up to date when it is queried
+  m_model->GetLink (0, 1)->GetCurrentState ();
 }
 
-// The TestSuite class names the TestSuite, identifies what type of TestSuite,
-// and enables the TestCases to be run.  Typically, only the constructor for
-// this class must be defined
-//
-class Hidden-markov-modelTestSuite : public TestSuite
+uint32_t
+HiddenMarkovModelLazyEvolutionTestCase::Drive (bool lazy, std::vector<double> &occupancy)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  m_tx = CreateObject<ConstantPositionMobilityModel> ();
+  m_rx = CreateObject<ConstantPositionMobilityModel> ();
+  nodes.Get (0)->AggregateObject (m_tx);
+  nodes.Get (1)->AggregateObject (m_rx);
+
+  m_model = CreateObject<HiddenMarkovPropagationLossModel> ();
+  m_model->SetMode (HMM_TIME_BASED_SIMULATION);
+  m_model->SetLazyEvolution (lazy);
+  m_model->InitFromFile ("HMM_4states/HMM_09_TR_3.txt", "HMM_4states/HMM_09_EMIS_3.txt");
+  NS_ASSERT (m_model->GetLink (0, 1));
+
+  // Idle periods alternate below (3 s) and beyond (12 s) the coherence time (10 s), so half of them stop the chain
+  Time start = Seconds (0);
+  for (uint32_t burst = 0; burst < BURSTS; burst++)
+    {
+      for (Time t = start; t < start + Seconds (5); t += MilliSeconds (2))
+        {
+          Simulator::Schedule (t, &HiddenMarkovModelLazyEvolutionTestCase::SendFrame, this);
+        }
+      start += Seconds (5) + ((burst % 2) ? Seconds (12) : Seconds (3));
+    }
+  // Beyond the coherence time of the last frame
+  Simulator::Schedule (start + Seconds (20), &HiddenMarkovModelLazyEvolutionTestCase::Sample, this);
+
+  m_frames.assign (4, 0);
+  Simulator::Run ();
+  uint32_t resets = m_model->GetLink (0, 1)->GetCoherenceResets ();
+  Simulator::Destroy ();
+
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < m_frames.size (); i++)
+    {
+      total += m_frames[i];
+    }
+  occupancy.resize (m_frames.size ());
+  for (uint32_t i = 0; i < m_frames.size (); i++)
+    {
+      occupancy[i] = (double) m_frames[i] / total;
+    }
+
+  m_model = 0;
+  m_tx = 0;
+  m_rx = 0;
+  return resets;
+}
+
+void
+HiddenMarkovModelLazyEvolutionTestCase::DoRun (void)
+{
+  std::vector<double> timers;
+  std::vector<double> lazy;
+
+  SeedManager::SetSeed (1);
+  SeedManager::SetRun (1);
+  uint32_t timerResets = Drive (false, timers);
+  uint32_t lazyResets = Drive (true, lazy);
+
+  // One reset per long idle period (the last one follows the last frame)
+  NS_TEST_EXPECT_MSG_EQ (timerResets, BURSTS / 2, "Wrong number of coherence time resets (timers)");
+  NS_TEST_EXPECT_MSG_EQ (lazyResets, timerResets, "The lazy evolution should stop the chain as the timers do");
+
+  for (uint32_t i = 0; i < timers.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ_TOL (lazy[i], timers[i], 0.05, "Different occupancy of state " << i);
+    }
+}
+
+class HiddenMarkovModelTestSuite : public TestSuite
 {
 public:
-  Hidden-markov-modelTestSuite ();
+  HiddenMarkovModelTestSuite ();
 };
 
-Hidden-markov-modelTestSuite::Hidden-markov-modelTestSuite ()
+HiddenMarkovModelTestSuite::HiddenMarkovModelTestSuite ()
   : TestSuite ("hidden-markov-model", UNIT)
 {
-  AddTestCase (new Hidden-markov-modelTestCase1);
+  AddTestCase (new HiddenMarkovModelLazyEvolutionTestCase);
 }
 
 // Do not forget to allocate an instance of this TestSuite
-static Hidden-markov-modelTestSuite hidden-markov-modelTestSuite;
-
+static HiddenMarkovModelTestSuite hiddenMarkovModelTestSuite;
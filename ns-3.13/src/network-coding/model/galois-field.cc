@@ -0,0 +1,331 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "galois-field.h"
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+//The SIMD kernels are compiled through function attributes, so that the module does not need any special compilation flag;
+//the one to be used is picked at runtime, according to the CPU capabilities
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define GALOIS_FIELD_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+NS_LOG_COMPONENT_DEFINE ("GaloisField");
+
+namespace ns3 {
+
+//Primitive polynomials used to build GF(2^q), indexed by q (bit q is the x^q term)
+static const u_int16_t g_primitivePolynomial [9] = {0x000, 0x003, 0x007, 0x00B, 0x013, 0x025, 0x043, 0x089, 0x11D};
+
+struct GaloisFieldTables
+{
+	GaloisFieldTables ();
+
+	u_int8_t exp [9][512];
+	u_int8_t log [9][256];
+};
+
+GaloisFieldTables::GaloisFieldTables ()
+{
+	for (u_int8_t q = 1; q <= 8; q++)
+	{
+		u_int16_t order = 1 << q;
+		u_int16_t value = 1;
+
+		log [q][0] = 0;				//Never used (log(0) is not defined)
+		for (u_int16_t i = 0; i < order - 1; i++)
+		{
+			exp [q][i] = (u_int8_t) value;
+			exp [q][i + order - 1] = (u_int8_t) value;
+			log [q][value] = (u_int8_t) i;
+
+			value <<= 1;
+			if (value & order)
+			{
+				value ^= g_primitivePolynomial [q];
+			}
+		}
+	}
+}
+
+//The tables are shared by all the GaloisField objects, and they are filled upon the first use
+static const GaloisFieldTables & GetGaloisFieldTables ()
+{
+	static GaloisFieldTables tables;
+	return tables;
+}
+
+/*
+ * Region kernels. All of them compute dst [i] ^= T (src [i]), where T is a GF(2)-linear map over bytes (i.e. the product by a
+ * constant), hence T (x) = T (x & 0x0F) ^ T (x & 0xF0) and it can be described by two 16-entry tables (split nibbles):
+ * lo [n] = T (n), hi [n] = T (n << 4). Those tables are exactly the operands of the SSSE3/AVX2 byte shuffles
+ */
+typedef void (*MultiplyAddKernel) (u_int8_t *dst, const u_int8_t *src, const u_int8_t *lo, const u_int8_t *hi, u_int32_t size);
+typedef void (*XorKernel) (u_int8_t *dst, const u_int8_t *src, u_int32_t size);
+
+static void MultiplyAddScalar (u_int8_t *dst, const u_int8_t *src, const u_int8_t *lo, const u_int8_t *hi, u_int32_t size)
+{
+	for (u_int32_t i = 0; i < size; i++)
+	{
+		dst [i] ^= lo [src [i] & 0x0F] ^ hi [src [i] >> 4];
+	}
+}
+
+static void XorScalar (u_int8_t *dst, const u_int8_t *src, u_int32_t size)
+{
+	u_int32_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		u_int64_t a, b;
+		memcpy (&a, dst + i, 8);
+		memcpy (&b, src + i, 8);
+		a ^= b;
+		memcpy (dst + i, &a, 8);
+	}
+	for (; i < size; i++)
+	{
+		dst [i] ^= src [i];
+	}
+}
+
+#ifdef GALOIS_FIELD_X86_KERNELS
+__attribute__ ((target ("ssse3")))
+static void MultiplyAddSsse3 (u_int8_t *dst, const u_int8_t *src, const u_int8_t *lo, const u_int8_t *hi, u_int32_t size)
+{
+	const __m128i tableLo = _mm_loadu_si128 ((const __m128i *) lo);
+	const __m128i tableHi = _mm_loadu_si128 ((const __m128i *) hi);
+	const __m128i mask = _mm_set1_epi8 (0x0F);
+
+	u_int32_t i = 0;
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + i));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dst + i));
+		__m128i productLo = _mm_shuffle_epi8 (tableLo, _mm_and_si128 (s, mask));
+		__m128i productHi = _mm_shuffle_epi8 (tableHi, _mm_and_si128 (_mm_srli_epi64 (s, 4), mask));
+		_mm_storeu_si128 ((__m128i *) (dst + i), _mm_xor_si128 (d, _mm_xor_si128 (productLo, productHi)));
+	}
+	MultiplyAddScalar (dst + i, src + i, lo, hi, size - i);
+}
+
+__attribute__ ((target ("ssse3")))
+static void XorSsse3 (u_int8_t *dst, const u_int8_t *src, u_int32_t size)
+{
+	u_int32_t i = 0;
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + i));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dst + i));
+		_mm_storeu_si128 ((__m128i *) (dst + i), _mm_xor_si128 (d, s));
+	}
+	XorScalar (dst + i, src + i, size - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void MultiplyAddAvx2 (u_int8_t *dst, const u_int8_t *src, const u_int8_t *lo, const u_int8_t *hi, u_int32_t size)
+{
+	const __m256i tableLo = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) lo));
+	const __m256i tableHi = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) hi));
+	const __m256i mask = _mm256_set1_epi8 (0x0F);
+
+	u_int32_t i = 0;
+	for (; i + 32 <= size; i += 32)
+	{
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + i));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dst + i));
+		__m256i productLo = _mm256_shuffle_epi8 (tableLo, _mm256_and_si256 (s, mask));
+		__m256i productHi = _mm256_shuffle_epi8 (tableHi, _mm256_and_si256 (_mm256_srli_epi64 (s, 4), mask));
+		_mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_xor_si256 (d, _mm256_xor_si256 (productLo, productHi)));
+	}
+	MultiplyAddScalar (dst + i, src + i, lo, hi, size - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void XorAvx2 (u_int8_t *dst, const u_int8_t *src, u_int32_t size)
+{
+	u_int32_t i = 0;
+	for (; i + 32 <= size; i += 32)
+	{
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + i));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dst + i));
+		_mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_xor_si256 (d, s));
+	}
+	XorScalar (dst + i, src + i, size - i);
+}
+#endif
+
+struct GaloisFieldKernels
+{
+	GaloisFieldKernels ();
+
+	MultiplyAddKernel multiplyAdd;
+	XorKernel xor_;
+	std::string name;
+};
+
+GaloisFieldKernels::GaloisFieldKernels () :
+		multiplyAdd (&MultiplyAddScalar),
+		xor_ (&XorScalar),
+		name ("scalar")
+{
+	//The NS_GALOIS_FIELD_KERNEL environment variable (scalar/ssse3/avx2) allows to force a less capable kernel (i.e. benchmarking)
+	const char *forced = getenv ("NS_GALOIS_FIELD_KERNEL");
+	std::string limit = forced ? forced : "avx2";
+
+#ifdef GALOIS_FIELD_X86_KERNELS
+	__builtin_cpu_init ();
+	if (limit == "avx2" && __builtin_cpu_supports ("avx2"))
+	{
+		multiplyAdd = &MultiplyAddAvx2;
+		xor_ = &XorAvx2;
+		name = "avx2";
+	}
+	else if ((limit == "avx2" || limit == "ssse3") && __builtin_cpu_supports ("ssse3"))
+	{
+		multiplyAdd = &MultiplyAddSsse3;
+		xor_ = &XorSsse3;
+		name = "ssse3";
+	}
+#endif
+	NS_LOG_INFO ("GF(2^q) region kernel: " << name);
+}
+
+static const GaloisFieldKernels & GetGaloisFieldKernels ()
+{
+	static GaloisFieldKernels kernels;
+	return kernels;
+}
+
+GaloisField::GaloisField (u_int8_t q)
+{
+	SetQ (q);
+}
+
+void GaloisField::SetQ (u_int8_t q)
+{
+	NS_ASSERT_MSG (q >= 1 && q <= 8, "GF(2^q) is only supported for 1 <= q <= 8");
+	m_q = q;
+	m_exp = GetGaloisFieldTables ().exp [q];
+	m_log = GetGaloisFieldTables ().log [q];
+}
+
+const std::string & GaloisField::GetKernelName ()
+{
+	return GetGaloisFieldKernels ().name;
+}
+
+u_int8_t GaloisField::MulPacked (u_int8_t c, u_int8_t x) const
+{
+	u_int8_t mask = GetOrder () - 1;
+	u_int8_t product = 0;
+
+	for (u_int8_t shift = 0; shift < 8; shift += m_q)
+	{
+		product |= Mul (c, (x >> shift) & mask) << shift;
+	}
+	return product;
+}
+
+void GaloisField::MultiplyAdd (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int32_t size) const
+{
+	if (c == 0)
+	{
+		return;
+	}
+	else if (c == 1)
+	{
+		GetGaloisFieldKernels ().xor_ (dst, src, size);
+		return;
+	}
+
+	//Since the elements are lower than 2^q, the entries which exceed the field are never accessed
+	u_int8_t lo [16], hi [16];
+	for (u_int8_t n = 0; n < 16; n++)
+	{
+		lo [n] = (n < GetOrder ()) ? Mul (c, n) : 0;
+		hi [n] = ((n << 4) < GetOrder ()) ? Mul (c, n << 4) : 0;
+	}
+	GetGaloisFieldKernels ().multiplyAdd (dst, src, lo, hi, size);
+}
+
+void GaloisField::MultiplyAddRegion (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int32_t size) const
+{
+	if (c == 0)
+	{
+		return;
+	}
+	else if (c == 1)
+	{
+		GetGaloisFieldKernels ().xor_ (dst, src, size);
+		return;
+	}
+
+	if (8 % m_q == 0)
+	{
+		//Every byte holds 8/q whole symbols (q = 1, 2, 4, 8), so the split-nibble kernels can be used straight away
+		u_int8_t lo [16], hi [16];
+		for (u_int8_t n = 0; n < 16; n++)
+		{
+			lo [n] = MulPacked (c, n);
+			hi [n] = MulPacked (c, n << 4);
+		}
+		GetGaloisFieldKernels ().multiplyAdd (dst, src, lo, hi, size);
+	}
+	else
+	{
+		//Blocks of q bytes (8 symbols), the symbols straddle the byte boundaries --> Portable path
+		u_int8_t mask = GetOrder () - 1;
+		u_int8_t table [256];
+		for (u_int16_t x = 0; x < GetOrder (); x++)
+		{
+			table [x] = Mul (c, x);
+		}
+
+		for (u_int32_t block = 0; block < size; block += m_q)
+		{
+			u_int8_t length = (size - block < m_q) ? size - block : m_q;
+			u_int64_t word = 0;
+			u_int64_t product = 0;
+
+			for (u_int8_t j = 0; j < length; j++)
+			{
+				word |= (u_int64_t) src [block + j] << (8 * j);
+			}
+			for (u_int8_t shift = 0; shift < 8 * m_q; shift += m_q)
+			{
+				product |= (u_int64_t) table [(word >> shift) & mask] << shift;
+			}
+			for (u_int8_t j = 0; j < length; j++)
+			{
+				dst [block + j] ^= (u_int8_t) (product >> (8 * j));
+			}
+		}
+	}
+}
+
+}	//End namespace ns3
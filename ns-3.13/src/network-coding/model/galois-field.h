@@ -0,0 +1,142 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef GALOIS_FIELD_H_
+#define GALOIS_FIELD_H_
+
+#include <sys/types.h>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Element-wise arithmetic over the extension field GF(2^q), 1 <= q <= 8. Every element is held in a single byte (polynomial
+ * basis), the addition is a plain XOR and the multiplication goes through a pair of log/antilog tables built (once for all the
+ * instances) from a primitive polynomial of degree q.
+ * NOTE: Unlike FFPACK::Modular<int> (arithmetic modulo 2^q), this is a proper field for every q, hence each non-null element
+ * has a multiplicative inverse
+ * The region operations (multiply-accumulate over whole buffers, i.e. payloads) rely on split-nibble table lookups, which are
+ * carried out with SSSE3/AVX2 byte shuffles whenever the CPU supports them (the kernel is selected at runtime, falling back to
+ * a portable scalar one)
+ */
+class GaloisField
+{
+public:
+	/**
+	 * Default constructor
+	 * \param q Field exponent, GF(2^q)
+	 */
+	GaloisField (u_int8_t q = 1);
+
+	/**
+	 * \param q New field exponent, GF(2^q)
+	 */
+	void SetQ (u_int8_t q);
+
+	/**
+	 * \returns The field exponent q
+	 */
+	inline u_int8_t GetQ () const {return m_q;}
+
+	/**
+	 * \returns The number of elements of the field (2^q)
+	 */
+	inline u_int16_t GetOrder () const {return (1 << m_q);}
+
+	/**
+	 * \returns a + b (and a - b, since the characteristic is 2)
+	 */
+	inline u_int8_t Add (u_int8_t a, u_int8_t b) const {return a ^ b;}
+
+	/**
+	 * \returns a * b
+	 */
+	inline u_int8_t Mul (u_int8_t a, u_int8_t b) const
+	{
+		return (a && b) ? m_exp [m_log [a] + m_log [b]] : 0;
+	}
+
+	/**
+	 * \returns a / b (b must not be null)
+	 */
+	inline u_int8_t Div (u_int8_t a, u_int8_t b) const
+	{
+		return a ? m_exp [m_log [a] + (GetOrder () - 1) - m_log [b]] : 0;
+	}
+
+	/**
+	 * \returns The multiplicative inverse of a (a must not be null)
+	 */
+	inline u_int8_t Inv (u_int8_t a) const
+	{
+		return m_exp [(GetOrder () - 1) - m_log [a]];
+	}
+
+	/**
+	 * Element-wise operation over arrays holding one field element per byte (i.e. coefficient vectors),
+	 * dst [i] += c * src [i] for every i in [0, size)
+	 * \param dst Destination (accumulation) array
+	 * \param src Source array
+	 * \param c Multiplying coefficient
+	 * \param size Number of elements of both arrays
+	 */
+	void MultiplyAdd (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int32_t size) const;
+
+	/**
+	 * Region operation over packed data (i.e. packet payloads), which are seen as a stream of q-bit symbols: every block of q bytes
+	 * (little endian) holds 8 consecutive symbols, symbol i taking bits [i*q, (i+1)*q). Hence, when q divides 8 each byte
+	 * holds 8/q whole symbols, and the region can have any length; otherwise, it must be a multiple of q bytes (the symbols
+	 * truncated by a shorter tail are lost)
+	 * \param dst Destination (accumulation) region
+	 * \param src Source region
+	 * \param c Multiplying coefficient
+	 * \param size Number of bytes of both regions
+	 */
+	void MultiplyAddRegion (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int32_t size) const;
+
+	/**
+	 * \returns The name of the region kernel picked at runtime (scalar, ssse3 or avx2)
+	 */
+	static const std::string & GetKernelName ();
+
+	/**
+	 * \param size Length of a region (bytes)
+	 * \returns The smallest valid region length (according to the above constraint) which is not shorter than "size"
+	 */
+	inline u_int32_t GetRegionSize (u_int32_t size) const
+	{
+		return (8 % m_q) ? ((size + m_q - 1) / m_q) * m_q : size;
+	}
+
+private:
+	/**
+	 * \returns The product of c by each of the 8/q symbols packed into the byte x (only valid when q divides 8)
+	 */
+	u_int8_t MulPacked (u_int8_t c, u_int8_t x) const;
+
+	u_int8_t m_q;
+	const u_int8_t *m_exp;			//Antilog table (2*(2^q - 1) entries, so that the sum of two logs does not need to be reduced)
+	const u_int8_t *m_log;			//Log table (2^q entries)
+};
+
+}	//End namespace ns3
+
+#endif /* GALOIS_FIELD_H_ */
@@ -0,0 +1,291 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "gf2-matrix.h"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("GF2Matrix");
+
+namespace ns3 {
+
+GF2Matrix::GF2Matrix () :
+		m_field (1),
+		m_k (0),
+		m_rank (0),
+		m_words (0),
+		m_payloadSize (0)
+{
+}
+
+void GF2Matrix::Reset (u_int16_t k)
+{
+	NS_LOG_FUNCTION (this << k);
+
+	m_k = k;
+	m_rank = 0;
+	m_words = (k + 63) / 64;
+
+	m_rows.assign ((size_t) k * m_words, 0);
+	m_pivot.assign (k, false);
+	m_unit.assign (k, false);
+	m_unitMask.assign (m_words, 0);
+	m_pending.reserve (k);
+	m_scratch.assign (m_words, 0);
+	m_combination.assign (m_words, 0);
+
+	m_payloadSize = 0;
+	m_payloads.resize (k);
+	for (u_int16_t i = 0; i < k; i++)
+	{
+		m_payloads [i].clear ();
+	}
+	m_scratchPayload.clear ();
+}
+
+u_int64_t GF2Matrix::GetMemoryUsage () const
+{
+	u_int64_t bytes = (m_rows.capacity () + m_scratch.capacity () + m_combination.capacity () + m_unitMask.capacity ()) * sizeof (u_int64_t) +
+			(m_pivot.capacity () + m_unit.capacity ()) / 8 + m_pending.capacity () * sizeof (u_int16_t) + m_scratchPayload.capacity ();
+	for (u_int16_t i = 0; i < m_payloads.size (); i++)
+	{
+		bytes += m_payloads [i].capacity ();
+	}
+	return bytes;
+}
+
+void GF2Matrix::GrowPayloads (u_int32_t size)
+{
+	if (size <= m_payloadSize)
+	{
+		return;
+	}
+
+	m_payloadSize = size;
+	for (u_int16_t i = 0; i < m_k; i++)
+	{
+		if (m_pivot [i])
+		{
+			m_payloads [i].resize (size, 0);
+		}
+	}
+	m_scratchPayload.resize (size, 0);
+}
+
+bool GF2Matrix::IsUnitRow (u_int16_t column) const
+{
+	const u_int64_t *row = GetRow (column);
+	u_int16_t weight = 0;
+	for (u_int16_t w = column >> 6; w < m_words; w++)
+	{
+		weight += __builtin_popcountll (row [w]);
+	}
+	return weight == 1;
+}
+
+void GF2Matrix::SetUnit (u_int16_t column, bool unit)
+{
+	m_unit [column] = unit;
+	if (unit)
+	{
+		m_unitMask [column >> 6] |= (u_int64_t) 1 << (column & 63);
+	}
+	else
+	{
+		m_unitMask [column >> 6] &= ~((u_int64_t) 1 << (column & 63));
+	}
+}
+
+void GF2Matrix::AddRow (u_int64_t *dst, const u_int64_t *src, u_int16_t from) const
+{
+	for (u_int16_t w = from; w < m_words; w++)
+	{
+		dst [w] ^= src [w];
+	}
+}
+
+bool GF2Matrix::AddVector (const std::vector<u_int8_t> &vector, const u_int8_t *payload, u_int32_t size)
+{
+	NS_LOG_FUNCTION (this);
+
+	if (m_rank == m_k)
+	{
+		return false;
+	}
+
+	//Pack the vector (one bit per byte in the header) into the working row
+	u_int16_t length = std::min ((u_int16_t) vector.size (), m_k);
+	u_int64_t *v = &m_scratch [0];
+
+	std::fill (m_scratch.begin (), m_scratch.end (), 0);
+	for (u_int16_t i = 0; i < length; i++)
+	{
+		v [i >> 6] |= (u_int64_t) (vector [i] & 1) << (i & 63);
+	}
+
+	if (!m_payloadSize && !size)		//Nothing to carry along with the coefficients
+	{
+		payload = 0;
+	}
+
+	if (payload)
+	{
+		GrowPayloads (size);
+		std::copy (payload, payload + size, m_scratchPayload.begin ());
+		std::fill (m_scratchPayload.begin () + size, m_scratchPayload.end (), 0);
+	}
+
+	//Forward elimination: the lowest non-null column is cancelled with the row whose pivot is located there (which only
+	//modifies the higher columns); the first one without a pivot will become the pivot of the new row
+	for (u_int16_t w = 0; w < m_words; w++)
+	{
+		while (v [w])
+		{
+			u_int16_t column = (w << 6) + __builtin_ctzll (v [w]);
+
+			if (m_pivot [column])
+			{
+				if (payload)
+				{
+					m_field.MultiplyAddRegion (&m_scratchPayload [0], &m_payloads [column][0], 1, m_payloadSize);
+				}
+				AddRow (v, GetRow (column), w);
+			}
+			else
+			{
+				std::copy (v, v + m_words, GetRow (column));
+				if (payload)
+				{
+					m_payloads [column] = m_scratchPayload;
+				}
+
+				m_pivot [column] = true;
+				SetUnit (column, IsUnitRow (column));
+				m_rank++;
+				return true;
+			}
+		}
+	}
+
+	//The vector has been reduced to zero --> Linearly dependent
+	return false;
+}
+
+void GF2Matrix::Solve ()
+{
+	NS_LOG_FUNCTION (this);
+
+	m_pending.clear ();
+	for (u_int16_t column = 0; column < m_k; column++)
+	{
+		if (m_pivot [column] && !m_unit [column])
+		{
+			m_pending.push_back (column);
+		}
+	}
+
+	//Cancel the entries at the columns of the unit rows, which are left untouched
+	for (u_int16_t i = 0; i < m_pending.size (); i++)
+	{
+		u_int64_t *current = GetRow (m_pending [i]);
+		for (u_int16_t w = m_pending [i] >> 6; w < m_words; w++)
+		{
+			u_int64_t bits = current [w] & m_unitMask [w];
+			current [w] ^= bits;
+			while (m_payloadSize && bits)
+			{
+				u_int16_t column = (w << 6) + __builtin_ctzll (bits);
+				m_field.MultiplyAddRegion (&m_payloads [m_pending [i]][0], &m_payloads [column][0], 1, m_payloadSize);
+				bits &= bits - 1;
+			}
+		}
+	}
+
+	//Backwards substitution among the remaining rows: remove the entries above every pivot, starting from the last one
+	for (int j = (int) m_pending.size () - 1; j > 0; j--)
+	{
+		u_int16_t column = m_pending [j];
+		const u_int64_t *pivotRow = GetRow (column);
+
+		for (int i = j - 1; i >= 0; i--)
+		{
+			u_int64_t *current = GetRow (m_pending [i]);
+			if (GetBit (current, column))
+			{
+				if (m_payloadSize)
+				{
+					m_field.MultiplyAddRegion (&m_payloads [m_pending [i]][0], &m_payloads [column][0], 1, m_payloadSize);
+				}
+				AddRow (current, pivotRow, column >> 6);
+			}
+		}
+	}
+
+	for (u_int16_t i = 0; i < m_pending.size (); i++)
+	{
+		SetUnit (m_pending [i], IsUnitRow (m_pending [i]));
+	}
+}
+
+void GF2Matrix::CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result) const
+{
+	NS_LOG_FUNCTION (this);
+
+	u_int64_t *combination = &m_combination [0];
+	std::fill (m_combination.begin (), m_combination.end (), 0);
+
+	u_int16_t length = std::min ((u_int16_t) coefficients.size (), m_k);
+	for (u_int16_t column = 0; column < length; column++)
+	{
+		if (m_pivot [column] && (coefficients [column] & 1))
+		{
+			AddRow (combination, GetRow (column), column >> 6);
+		}
+	}
+
+	result.resize (m_k);
+	for (u_int16_t i = 0; i < m_k; i++)
+	{
+		result [i] = GetBit (combination, i);
+	}
+}
+
+void GF2Matrix::CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result, std::vector<u_int8_t> &payload) const
+{
+	NS_LOG_FUNCTION (this);
+
+	CombineRows (coefficients, result);
+	payload.assign (m_payloadSize, 0);
+
+	u_int16_t length = std::min ((u_int16_t) coefficients.size (), m_k);
+	for (u_int16_t column = 0; column < length && m_payloadSize; column++)
+	{
+		if (m_pivot [column] && (coefficients [column] & 1))
+		{
+			m_field.MultiplyAddRegion (&payload [0], &m_payloads [column][0], 1, m_payloadSize);
+		}
+	}
+}
+
+}	//End namespace ns3
@@ -0,0 +1,169 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#ifndef GF2_MATRIX_H_
+#define GF2_MATRIX_H_
+
+#include <sys/types.h>
+#include <vector>
+
+#include "galois-field.h"
+
+namespace ns3 {
+
+/**
+ * Bit-packed K x K matrix over GF(2), kept in row echelon form as the vectors arrive. This is the binary counterpart of the
+ * IntraFlowNetworkCodingDecoder (with the very same interface), which replaces the IT++ GF2mat when q=1 (BitPackedGf2 attribute of the protocol):
+ *  - Every row is held as ceil(K/64) 64-bit words, hence the reduction of an incoming vector is a sequence of word-wise XORs,
+ *  where the next column to be cancelled is found by counting the trailing zeros
+ *  - The recoding (vector x matrix product) is the XOR of the rows selected by the random vector, so no transpose is needed
+ * The rows are indexed by their pivot column, i.e. row i (if present) has a 1 at position i and 0 in the previous ones
+ */
+class GF2Matrix
+{
+public:
+	/**
+	 * Default constructor
+	 */
+	GF2Matrix ();
+
+	/**
+	 * Start over the elimination (i.e. upon the reception of a new fragment)
+	 * \param k Fragment size (number of columns of the coefficient matrix)
+	 */
+	void Reset (u_int16_t k);
+
+	/**
+	 * Reduce a coefficient vector (one bit per byte) against the rows already stored; if it is linearly independent from them, it is added to the matrix
+	 * \param vector Coefficient vector (as extracted from the IntraFlowNetworkCodingHeader)
+	 * \param payload Coded payload carried along with the vector. Null in the coefficients-only mode
+	 * \param size Length of the coded payload (bytes)
+	 * \returns True if the vector is innovative (the rank has been increased); false otherwise
+	 */
+	bool AddVector (const std::vector<u_int8_t> &vector, const u_int8_t *payload = 0, u_int32_t size = 0);
+
+	/**
+	 * Back-substitution, to take the matrix from the row echelon form to the reduced one (i.e. the identity, when it is full-rank).
+	 * As in IntraFlowNetworkCodingDecoder::Solve, the unit rows (natives) are left untouched and only the rest are eliminated
+	 */
+	void Solve ();
+
+	/**
+	 * Linear combination (vector x matrix) of the rows held by the matrix
+	 * \param coefficients One coefficient (0/1) for each of the K possible rows (the ones associated to empty rows are ignored)
+	 * \param result Reference of the vector in which the combination will be stored (K elements, one bit per byte)
+	 */
+	void CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result) const;
+
+	/**
+	 * Same as above, but combining the payloads associated to the rows as well
+	 * \param coefficients One coefficient (0/1) for each of the K possible rows (the ones associated to empty rows are ignored)
+	 * \param result Reference of the vector in which the combination will be stored (K elements, one bit per byte)
+	 * \param payload Reference of the vector in which the combination of the payloads will be stored
+	 */
+	void CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result, std::vector<u_int8_t> &payload) const;
+
+	/**
+	 * \returns The current rank of the matrix
+	 */
+	inline u_int16_t GetRank () const {return m_rank;}
+
+	/**
+	 * \returns The number of columns with which the matrix has been initialized
+	 */
+	inline u_int16_t GetK () const {return m_k;}
+
+	/**
+	 * \returns True if the matrix is full-rank
+	 */
+	inline bool IsFull () const {return m_rank == m_k;}
+
+	/**
+	 * \param column Pivot column
+	 * \returns True if there is a row whose pivot is located at the given column
+	 */
+	inline bool HasPivot (u_int16_t column) const {return m_pivot [column];}
+
+	/**
+	 * \param column Pivot column
+	 * \returns The payload associated to the row whose pivot is located at the given column
+	 */
+	inline const std::vector<u_int8_t> &GetPayload (u_int16_t column) const {return m_payloads [column];}
+
+	/**
+	 * \returns The number of bytes currently allocated by the matrix (rows, payloads and working copies)
+	 */
+	u_int64_t GetMemoryUsage () const;
+
+private:
+	/**
+	 * \returns Pointer to the first word of the row whose pivot is located at the given column
+	 */
+	inline u_int64_t *GetRow (u_int16_t column) {return &m_rows [column * m_words];}
+	inline const u_int64_t *GetRow (u_int16_t column) const {return &m_rows [column * m_words];}
+
+	/**
+	 * \returns The value (0/1) of the given column of a packed row
+	 */
+	inline bool GetBit (const u_int64_t *row, u_int16_t column) const {return (row [column >> 6] >> (column & 63)) & 1;}
+
+	/**
+	 * dst [from..m_words) ^= src [from..m_words)
+	 */
+	void AddRow (u_int64_t *dst, const u_int64_t *src, u_int16_t from) const;
+
+	/**
+	 * Make every stored payload (and the working copy) at least "size" bytes long, padding them with zeros
+	 */
+	void GrowPayloads (u_int32_t size);
+
+	/**
+	 * \returns True if the row whose pivot is located at the given column has no other entry (unit vector)
+	 */
+	bool IsUnitRow (u_int16_t column) const;
+
+	/**
+	 * Keep m_unit and m_unitMask in sync
+	 */
+	void SetUnit (u_int16_t column, bool unit);
+
+	GaloisField m_field;						//GF(2), only used for its (vectorized) XOR region kernel
+	u_int16_t m_k;
+	u_int16_t m_rank;
+	u_int16_t m_words;							//64-bit words per row
+
+	std::vector<u_int64_t> m_rows;				//K x ceil(K/64) words, row i holds the vector whose pivot is at column i
+	std::vector<bool> m_pivot;					//m_pivot [i] is true if row i is in use
+	std::vector<bool> m_unit;					//m_unit [i] is true if row i is a unit vector (it is already solved)
+	std::vector<u_int64_t> m_unitMask;			//Same as m_unit, packed as a row, so that Solve can pick the unit columns word by word
+	std::vector<u_int16_t> m_pending;			//Pivots of the rows which are not unit vectors (working list of Solve)
+	std::vector<u_int64_t> m_scratch;			//Working copy of the incoming vector
+	mutable std::vector<u_int64_t> m_combination;	//Working row of CombineRows (sized upon Reset, so that recoding does not allocate)
+
+	u_int32_t m_payloadSize;							//Length of the (zero-padded) coded payloads
+	std::vector<std::vector<u_int8_t> > m_payloads;		//Payload associated to each row (empty in the coefficients-only mode)
+	std::vector<u_int8_t> m_scratchPayload;				//Working copy of the incoming payload
+};
+
+}	//End namespace ns3
+
+#endif /* GF2_MATRIX_H_ */
@@ -23,7 +23,6 @@
 #include <assert.h>
 #include "inter-flow-network-coding-buffer.h"
 #include "ns3/hash-id.h"
-//#include <openssl/md5.h> //Open SSL library --> Needed for hashing
 
 using namespace std;
 
@@ -33,6 +32,9 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (InterFlowNetworkCodingBuffer);
 
+//Maximum length of a packet at the Network Coding layer (IP MTU minus the IP header and the lower layer overheads), used to bound the ACK encapsulation
+const u_int16_t InterFlowNetworkCodingBuffer::MAX_PACKET_SIZE = 1476;
+
 #undef NS_LOG_APPEND_CONTEXT
 #define NS_LOG_APPEND_CONTEXT                                   \
   if (m_node) { std::clog << Simulator::Now ().GetSeconds () << " [node " << m_node->GetId () << "] "; }
@@ -124,6 +126,16 @@ InterFlowNetworkCodingBuffer::GetTypeId (void) {
 			MakeTimeAccessor (&InterFlowNetworkCodingBuffer::SetAckBufferStoreTime,
 							  &InterFlowNetworkCodingBuffer::GetAckBufferStoreTime),
 			MakeTimeChecker())
+	.AddAttribute ("ReceptionReports",
+			"Piggy-back reception reports and only code packets which all their destinations are able to decode",
+			BooleanValue (false),
+			MakeBooleanAccessor (&InterFlowNetworkCodingBuffer::m_receptionReports),
+			MakeBooleanChecker ())
+	.AddAttribute ("MaxReceptionReports",
+			"Maximum number of reception reports appended to a packet",
+			UintegerValue (4),
+			MakeUintegerAccessor (&InterFlowNetworkCodingBuffer::m_maxReceptionReports),
+			MakeUintegerChecker <u_int8_t> (0, InterFlowNetworkCodingHeader::MAX_RECEPTION_REPORTS))
 	;
   return tid;
 }
@@ -171,7 +183,15 @@ InterFlowNetworkCodingBuffer::~InterFlowNetworkCodingBuffer ()
 
 	//Decoding buffer
 	if (! m_decodingBuffer.size())
+	{
 		m_decodingBuffer.clear();
+		m_decodingBufferIndex.clear();
+	}
+
+	//Reception reports
+	m_neighbourStateQueue.clear();
+	m_neighbourState.clear();
+	m_reportStates.clear();
 
 	//Ack buffer
 	if (! m_ackBuffer.size())
@@ -269,14 +289,28 @@ bool InterFlowNetworkCodingBuffer::UpdateDecodingBuffer (Ptr<Packet> packet, Ipv
 	packet->PeekHeader (header);
 	hash = HashID (source, destination, header.GetSourcePort(), header.GetDestinationPort());
 
-	DecodingBufferIterator i = m_decodingBuffer.find (make_pair (hash, header.GetSequenceNumber().GetValue()));
+	DecodingKey key (hash, header.GetSequenceNumber().GetValue());
 
-	if (i == m_decodingBuffer.end())
+	if (m_decodingBufferIndex.find (key) == m_decodingBufferIndex.end())
 	{
 		//Save a copy of the original packet
 		//	Ptr<Packet> packetCopy = packet->Copy ();
-		m_decodingBuffer.insert (pair <decodingKey, struct NetworkCodingItem> (make_pair(hash, header.GetSequenceNumber().GetValue()), NetworkCodingItem (packet, source, destination, protocol,
-				hash, Simulator::Now())));
+		m_decodingBuffer.push_back (make_pair (key, NetworkCodingItem (packet, source, destination, protocol, hash, Simulator::Now())));
+		m_decodingBufferIndex.insert (make_pair (key, --m_decodingBuffer.end ()));
+
+		//Keep track of the newest native packet of the flow, so that it can be reported
+		u_int16_t step = packet->GetSize () - header.GetSerializedSize ();
+		if (m_receptionReports && step)
+		{
+			ReportState &state = m_reportStates [FlowKey (source, destination, header.GetSourcePort(), header.GetDestinationPort(), protocol)];
+			state.hash = hash;
+			if (!state.step || header.GetSequenceNumber () > SequenceNumber32 (state.seqNum))
+			{
+				state.seqNum = header.GetSequenceNumber ().GetValue ();
+				state.step = step;
+			}
+			state.pending = true;
+		}
 		return true;
 	}
 	else
@@ -292,10 +326,11 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 
 	assert (ncHeader.GetCodedPackets() == 1); 			//Native packet received
 
-	u_int32_t key;
+	u_int16_t hash;
 	TcpHeader header;
 	packet->PeekHeader (header);
-	key = HashID (source, destination, header.GetSourcePort(), header.GetDestinationPort());
+	hash = HashID (source, destination, header.GetSourcePort(), header.GetDestinationPort());
+	FlowKey key (source, destination, header.GetSourcePort(), header.GetDestinationPort(), protocol);
 
 	//Lookup into the flow id-defined buffer
 	InputPacketPoolIterator iter = m_input.find (key);
@@ -308,11 +343,11 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 		//No flow id buffer: Create the element and update the timer
 		if (iter == m_input.end())
 		{
-			NS_LOG_INFO (" ====> Empty buffer " << std::hex << key << std::dec << ". Inserting packet " << header);
+			NS_LOG_INFO (" ====> Empty buffer " << key << ". Inserting packet " << header);
 			InputBuffer buffer;
 			buffer.push_back (NetworkCodingItem (packet, source, destination, protocol,
-					key, Simulator::Now()));
-			m_input.insert (pair<u_int32_t, InputBuffer> (key, buffer));
+					hash, Simulator::Now()));
+			m_input.insert (make_pair (key, buffer));
 			UpdateInputPacketPoolTimeouts (key, INSERT_ELEMENT);
 		}
 		else		//The buffer already exists, check the size (in order not to overflow it)
@@ -320,7 +355,7 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 			if (iter->second.size() == m_maxBufferSize)		//Buffer full --> Send the oldest packet downwards
 			{
 				std::vector <struct NetworkCodingItem> out;
-				NS_LOG_INFO (" =====> Buffer full ("  << std::hex << key << std::dec << "). Sent down the oldest native packet "
+				NS_LOG_INFO (" =====> Buffer full ("  << key << "). Sent down the oldest native packet "
 						<< " Elements " << iter->second.size());
 
 				out.push_back(*(iter->second.begin()));
@@ -329,7 +364,7 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 				//Send down the element located in the current flow-id input buffer
 				iter->second.pop_front();
 				//Insert the new element at the end of the buffer
-				iter->second.push_back (NetworkCodingItem (packet, source, destination, protocol, key, Simulator::Now()));
+				iter->second.push_back (NetworkCodingItem (packet, source, destination, protocol, hash, Simulator::Now()));
 
 
 				//As we have changed the first element at the input packet queue, we need to update the buffer timeout
@@ -341,8 +376,8 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 			}
 			else		//Buffer not full. Just store the packet into it (No timeout update needed)
 			{
-				iter->second.push_back (NetworkCodingItem (packet, source, destination, protocol, key, Simulator::Now()));
-				NS_LOG_INFO (" ====> Inserting packet (" << std::hex << key << std::dec
+				iter->second.push_back (NetworkCodingItem (packet, source, destination, protocol, hash, Simulator::Now()));
+				NS_LOG_INFO (" ====> Inserting packet (" << key
 						 << ")" << " Elements " << iter->second.size() << " Packet " << header);
 			}
 		}
@@ -353,7 +388,7 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 	{
 		std::vector <struct NetworkCodingItem> output;
 		output.push_back (NetworkCodingItem (packet, source, destination, protocol,
-				key, Simulator::Now()));
+				hash, Simulator::Now()));
 		m_output.push_front (output);
 
 		//	Connect and send
@@ -366,7 +401,7 @@ bool InterFlowNetworkCodingBuffer:: UpdateInputPacketPool (Ptr <Packet> packet,
 	}
 }
 
-void InterFlowNetworkCodingBuffer::UpdateInputPacketPoolTimeouts (u_int16_t hash, BufferTimeoutState_t state)
+void InterFlowNetworkCodingBuffer::UpdateInputPacketPoolTimeouts (const FlowKey &flow, BufferTimeoutState_t state)
 {
 	NS_LOG_FUNCTION (m_node->GetObject<Ipv4>()->GetAddress(1,0).GetLocal());
 	Cleanup ();
@@ -374,34 +409,34 @@ void InterFlowNetworkCodingBuffer::UpdateInputPacketPoolTimeouts (u_int16_t hash
 	{
 	case INSERT_ELEMENT:   //New packet arrival
 	{
-		InputPacketPoolTimeoutIterator i = m_inputTimeouts.find (hash);
+		InputPacketPoolTimeoutIterator i = m_inputTimeouts.find (flow);
 		if (i == m_inputTimeouts.end())    //No timer in the searched buffer; therefore, we just insert the new timeout
 		{
-			m_inputTimeouts.insert (pair <u_int16_t, EventId> (hash, Simulator::Schedule (m_ncBufferTimeout, &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, hash)));
-			NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout created (Input packet pool) --> " << std::hex << hash << std::dec << " in " << m_ncBufferTimeout.GetMilliSeconds()
+			m_inputTimeouts.insert (make_pair (flow, Simulator::Schedule (m_ncBufferTimeout, &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, flow)));
+			NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout created (Input packet pool) --> " << flow << " in " << m_ncBufferTimeout.GetMilliSeconds()
 					<< " milliseconds");
 		}
 		else //If after a new insertion, the buffer is full, we need to remove the timeout and replace it by the new one
 		{
-			InputPacketPoolIterator element = m_input.find (hash);
+			InputPacketPoolIterator element = m_input.find (flow);
 //			if (element->second.size() == m_maxBufferSize)
 			{
 				//Extract the oldest element, update the timer and insert the new packet
 				if (i->second.IsRunning())
 					i->second.Cancel();
-				NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout replaced (Input packet pool) --> " << std::hex << hash << std::dec << " in " <<
+				NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout replaced (Input packet pool) --> " << flow << " in " <<
 										(Simulator::Now() - element->second.begin()->tstamp).GetMilliSeconds()	<< " milliseconds");
 
 				assert ((Simulator::Now() - element->second.begin()->tstamp) < m_ncBufferTimeout);
-				i->second = Simulator::Schedule ((m_ncBufferTimeout - (Simulator::Now() - element->second.begin()->tstamp)), &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, hash);
+				i->second = Simulator::Schedule ((m_ncBufferTimeout - (Simulator::Now() - element->second.begin()->tstamp)), &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, flow);
 			}
 		}
 		break;
 	}
 	case EJECT_ELEMENT:   //When a packet goes down the stack, we need to handle this event and cancel its corresponding timer
 	{
-		InputPacketPoolIterator element = m_input.find (hash);
-		InputPacketPoolTimeoutIterator i = m_inputTimeouts.find (hash);
+		InputPacketPoolIterator element = m_input.find (flow);
+		InputPacketPoolTimeoutIterator i = m_inputTimeouts.find (flow);
 
 		//It is impossible not to find an element
 		assert (i != m_inputTimeouts.end());
@@ -409,17 +444,17 @@ void InterFlowNetworkCodingBuffer::UpdateInputPacketPoolTimeouts (u_int16_t hash
 			i->second.Cancel();
 
 		//If there are any other packets remaining in the flow-id buffer, update the new timeout
-		if (element == m_input.end()) 	//No packets stored --> Remove the hash entry
+		if (element == m_input.end()) 	//No packets stored --> Remove the flow entry
 		{
-			m_inputTimeouts.erase (hash);
+			m_inputTimeouts.erase (flow);
 		}
 		else	//Update with the "new" first element
 		{
-			NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout replaced (Input packet pool) --> " << std::hex << hash << std::dec << " in " <<
+			NS_LOG_INFO (Simulator::Now().GetMilliSeconds() << ": Timeout replaced (Input packet pool) --> " << flow << " in " <<
 					(m_ncBufferTimeout - (Simulator::Now() - element->second.begin()->tstamp)).GetMilliSeconds()	<< " milliseconds");
 
 			assert ((Simulator::Now() - element->second.begin()->tstamp) <= m_ncBufferTimeout);
-			i->second = Simulator::Schedule ((m_ncBufferTimeout - (Simulator::Now() - element->second.begin()->tstamp)), &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, hash);
+			i->second = Simulator::Schedule ((m_ncBufferTimeout - (Simulator::Now() - element->second.begin()->tstamp)), &InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout, this, flow);
 		}
 		break;
 	}
@@ -428,35 +463,35 @@ void InterFlowNetworkCodingBuffer::UpdateInputPacketPoolTimeouts (u_int16_t hash
 	}
 }
 
-NetworkCodingItem InterFlowNetworkCodingBuffer::InputPacketPoolExtraction (u_int16_t hash)
+NetworkCodingItem InterFlowNetworkCodingBuffer::InputPacketPoolExtraction (const FlowKey &flow)
 {
 	NS_LOG_FUNCTION (this);
-	NetworkCodingItem item = (*(m_input.find(hash)->second.begin()));
+	NetworkCodingItem item = (*(m_input.find(flow)->second.begin()));
 
-	if (m_input.find(hash)->second.size () == 1)
+	if (m_input.find(flow)->second.size () == 1)
 	{
-		m_input.find (hash)->second.clear();
-		m_input.erase (hash);
+		m_input.find (flow)->second.clear();
+		m_input.erase (flow);
 	}
 	else
 	{
-		m_input.find (hash)->second.pop_front();
+		m_input.find (flow)->second.pop_front();
 	}
 
-	UpdateInputPacketPoolTimeouts (hash, EJECT_ELEMENT);
+	UpdateInputPacketPoolTimeouts (flow, EJECT_ELEMENT);
 
 	return item;
 }
 
-void InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout (u_int16_t hash)
+void InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout (FlowKey flow)
 {
 	NS_LOG_FUNCTION (m_node->GetObject<Ipv4>()->GetAddress(1,0).GetLocal() << ")" << " Elements " << m_input.size());
 
-	NS_LOG_INFO ("Timeout triggered (input packet pool) --> " << std::hex << hash << std::dec);
+	NS_LOG_INFO ("Timeout triggered (input packet pool) --> " << flow);
 	//Compose the outgoing packet vector (the NetworkCodingL4Protocol will be in charge of making the headers and sending the packet)
 	std::vector <struct NetworkCodingItem> out;
 
-	InputPacketPoolIterator i = m_input.find (hash);
+	InputPacketPoolIterator i = m_input.find (flow);
 
 	//Prepare the native packet to send, thus deleting it from its corresponding InputPacketPool
 	if (i != m_input.end())
@@ -466,22 +501,22 @@ void InterFlowNetworkCodingBuffer::HandleInputPacketPoolTimeout (u_int16_t hash)
 
 		UpdateOutbutBufferTimeout ();
 		//If the flow-id input packet buffer has only 1 element, delete the whole buffer (and the timeout); otherwise, remove the element and update the timer
-//		InputPacketPoolTimeoutIterator time = m_inputTimeouts.find (hash);
-		assert (m_inputTimeouts.find (hash) != m_inputTimeouts.end());
+//		InputPacketPoolTimeoutIterator time = m_inputTimeouts.find (flow);
+		assert (m_inputTimeouts.find (flow) != m_inputTimeouts.end());
 	}
 
 	//Update the input packet pool (Delete the outgoing packet and update the timer)
 	if (i->second.size() == 1)		//Only one packet at the queue --> Delete the whole flow-id buffer
 	{
 		i->second.clear();
-		m_input.erase (hash);
+		m_input.erase (flow);
 	}
 	else							//More than one packet --> Pop the oldest element
 	{
 		i->second.pop_front();
 	}
 
-	UpdateInputPacketPoolTimeouts (hash, EJECT_ELEMENT);
+	UpdateInputPacketPoolTimeouts (flow, EJECT_ELEMENT);
 
 	//Connect and send
 	if (! m_sendDownCallback.IsNull())
@@ -513,53 +548,59 @@ std::vector<NetworkCodingItem> InterFlowNetworkCodingBuffer::OutputBufferExtract
         return output;
 }
 
-bool InterFlowNetworkCodingBuffer::SearchForCodingOpportunity(u_int16_t hash)
+bool InterFlowNetworkCodingBuffer::SearchForCodingOpportunity(const FlowKey &flow)
 {
 	NS_LOG_FUNCTION (this);
 	Cleanup();
 	//If the input packet pool has more than one packet stored (in two different queues), will trigger a coding opportunity
-	u_int8_t codedPacketCounter = 1;
-	Time timeout; 			//We need to get the oldest packet timestamp so that we can set the optimal timeout
-
-	InputBuffer base = m_input.find(hash)->second ;
 	std::vector <struct NetworkCodingItem> temp;
+	std::vector <FlowKey> selected;
+	std::vector <CodedNative> combination;
 
-	//The first step consist in checking whether there is a coding opportunity into the output buffer
-	if (m_input.size() == 1)
+	if (m_input.size() == 1 || m_input.find (flow) == m_input.end())
 	{
 		NS_LOG_DEBUG ("Cannot find a coding opportunity");
 		return false;
 	}
-        
-	//First, we need to search into the output buffer for a coding opportunity
-	temp.push_back (InputPacketPoolExtraction (hash));
-	timeout = temp[0].tstamp;
 
-	//Second, if the first step does not yield any result, look into the input packet pool in order to find an available packet to be coded with
-	for (InputPacketPoolIterator iter = m_input.begin(); iter != m_input.end(); iter++)
+	//Only the heads of the flow queues are considered (they are the oldest packets of each flow, and the search is bounded by the number of flows).
+	//The packets are not extracted till the combination is closed, since the extraction modifies the input packet pool
+	temp.push_back (*(m_input.find (flow)->second.begin()));
+	selected.push_back (flow);
+	combination.push_back (Describe (temp[0]));
+
+	for (InputPacketPoolIterator iter = m_input.begin(); (iter != m_input.end()) && (temp.size() < m_maxCodedPackets); iter++)
 	{
-		if ((hash != iter->first) && (codedPacketCounter <= m_maxCodedPackets))
+		if (flow != iter->first)
 		{
-			NetworkCodingItem item = InputPacketPoolExtraction (iter->first);
-			temp.push_back (item);
-
-			if (item.tstamp < timeout)
-				timeout = item.tstamp;
-			codedPacketCounter ++;
-
-			if (codedPacketCounter == m_maxCodedPackets)   //We have reached the maximum number of "codeable" packets; therefore we notify the NetworkCodingL4Protocol
+			const NetworkCodingItem &candidate = *(iter->second.begin());
+			CodedNative native = Describe (candidate);
+			if (!m_receptionReports || IsDecodable (combination, native))
 			{
-				m_output.push_front (temp);
-				if (! m_sendDownCallback.IsNull())
-					m_sendDownCallback ();
-				return true;
+				temp.push_back (candidate);
+				selected.push_back (iter->first);
+				combination.push_back (native);
 			}
 		}
 	}
 
+	if (temp.size() == 1)		//No decodable combination --> The packet waits at the input packet pool (it will be sent as a native one upon its timeout)
+	{
+		NS_LOG_DEBUG ("Cannot find a decodable combination");
+		return false;
+	}
+
+	for (u_int8_t i = 0; i < selected.size(); i++)
+	{
+		InputPacketPoolExtraction (selected[i]);
+	}
+
 	//If after these search we can still encode more packets together, we hold the provisional vector of packets to be coded together with during a time before
 	//it is sent to the Network Coding delivery member (Pending work)
-	m_output.push_back (temp);
+	if (temp.size() == m_maxCodedPackets)
+		m_output.push_front (temp);
+	else
+		m_output.push_back (temp);
 
 	if (! m_sendDownCallback.IsNull())
 		m_sendDownCallback ();
@@ -567,16 +608,187 @@ bool InterFlowNetworkCodingBuffer::SearchForCodingOpportunity(u_int16_t hash)
 	return true;
 }
 
+InterFlowNetworkCodingBuffer::CodedNative InterFlowNetworkCodingBuffer::Describe (const NetworkCodingItem &item)
+{
+	TcpHeader header;
+	item.packet->PeekHeader (header);
+
+	return CodedNative (item.source, item.destination, item.hash, header.GetSequenceNumber ().GetValue ());
+}
+
+bool InterFlowNetworkCodingBuffer::NeighbourHolds (Ipv4Address neighbour, const CodedNative &native)
+{
+	if (native.source == neighbour)
+	{
+		return true;
+	}
+
+	return m_neighbourState.find (NeighbourKey (neighbour, native.hash, native.seqNum)) != m_neighbourState.end ();
+}
+
+bool InterFlowNetworkCodingBuffer::IsDecodable (const std::vector <CodedNative> &combination, const CodedNative &candidate)
+{
+	//The combination already fulfills the condition, so we only need to check the new packet against each of the previous ones
+	for (u_int8_t i = 0; i < combination.size(); i++)
+	{
+		if (combination[i].destination == candidate.destination)		//The same node cannot decode two packets
+		{
+			return false;
+		}
+		if (!NeighbourHolds (candidate.destination, combination[i]) || !NeighbourHolds (combination[i].destination, candidate))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool InterFlowNetworkCodingBuffer::ExtendCombination (InterFlowNetworkCodingHeader &ncHeader, std::vector <struct NetworkCodingItem> &added)
+{
+	NS_LOG_FUNCTION (this);
+	Cleanup();
+
+	//Without the reception reports, nothing is known about what the destinations of the forwarded natives hold
+	if (!m_receptionReports || ncHeader.m_packetVector.size() >= m_maxCodedPackets || m_input.empty())
+	{
+		return false;
+	}
+
+	//Natives already coded together (their source is only known if the packet is also stored at the decoding buffer)
+	std::vector <CodedNative> combination;
+	for (u_int8_t i = 0; i < ncHeader.m_packetVector.size(); i++)
+	{
+		const InterFlowNetworkCodingHeader::Item &item = ncHeader.m_packetVector[i];
+		DecodingBufferIndex::iterator stored = m_decodingBufferIndex.find (DecodingKey (item.hash, item.seqNum.GetValue ()));
+
+		combination.push_back (CodedNative (stored != m_decodingBufferIndex.end() ? stored->second->second.source : Ipv4Address (),
+				item.destination, item.hash, item.seqNum.GetValue ()));
+	}
+
+	std::vector <FlowKey> selected;
+	for (InputPacketPoolIterator iter = m_input.begin(); (iter != m_input.end()) && (combination.size() < m_maxCodedPackets); iter++)
+	{
+		//The header only carries the flow-id and the destination of each native packet
+		const NetworkCodingItem &head = *(iter->second.begin());
+		bool coded = false;
+		for (u_int8_t i = 0; i < ncHeader.m_packetVector.size() && !coded; i++)
+		{
+			coded = (ncHeader.m_packetVector[i].hash == head.hash && ncHeader.m_packetVector[i].destination == head.destination);
+		}
+		if (coded)
+		{
+			continue;
+		}
+
+		//Every destination (the node the packet is forwarded to and the ones overhearing it) must be able to decode its own native
+		CodedNative native = Describe (head);
+		if (IsDecodable (combination, native))
+		{
+			selected.push_back (iter->first);
+			combination.push_back (native);
+		}
+	}
+
+	//Extract the chosen packets (once the input packet pool is not being traversed) and update the header bookkeeping
+	for (u_int8_t i = 0; i < selected.size(); i++)
+	{
+		NetworkCodingItem item = InputPacketPoolExtraction (selected[i]);
+		TcpHeader header;
+		item.packet->PeekHeader (header);
+
+		ncHeader.m_packetVector.push_back (InterFlowNetworkCodingHeader::Item (item.destination, header.GetSequenceNumber (), item.hash, item.packet->GetSize ()));
+		added.push_back (item);
+	}
+	ncHeader.SetCodedPackets (ncHeader.m_packetVector.size());
+
+	return !selected.empty();
+}
+
+void InterFlowNetworkCodingBuffer::UpdateNeighbourState (Ipv4Address neighbour, u_int16_t hash, u_int32_t seqNum)
+{
+	if (!m_receptionReports)
+	{
+		return;
+	}
+
+	NeighbourKey key (neighbour, hash, seqNum);
+	Time now = Simulator::Now ();
+
+	m_neighbourState [key] = now;
+	m_neighbourStateQueue.push_back (make_pair (key, now));
+}
+
+void InterFlowNetworkCodingBuffer::UpdateNeighbourState (const InterFlowNetworkCodingHeader &ncHeader)
+{
+	NS_LOG_FUNCTION (this);
+	if (!m_receptionReports)
+	{
+		return;
+	}
+
+	Cleanup ();
+	for (u_int8_t i = 0; i < ncHeader.m_receptionReports.size(); i++)
+	{
+		const InterFlowNetworkCodingHeader::ReceptionReport &report = ncHeader.m_receptionReports[i];
+
+		UpdateNeighbourState (ncHeader.m_reporter, report.hash, report.seqNum);
+		for (u_int8_t k = 0; k < 16; k++)
+		{
+			if (report.bitmap & (1 << k))
+			{
+				UpdateNeighbourState (ncHeader.m_reporter, report.hash, report.seqNum - (k + 1) * (u_int32_t) report.step);
+			}
+		}
+	}
+}
+
+void InterFlowNetworkCodingBuffer::AddReceptionReports (InterFlowNetworkCodingHeader &ncHeader, Ipv4Address reporter)
+{
+	NS_LOG_FUNCTION (this);
+	if (!m_receptionReports)
+	{
+		return;
+	}
+
+	Cleanup ();
+	for (ReportStates::iterator iter = m_reportStates.begin(); (iter != m_reportStates.end()) && (ncHeader.m_receptionReports.size() < m_maxReceptionReports); iter++)
+	{
+		if (!iter->second.pending)
+		{
+			continue;
+		}
+
+		//The bitmap covers the 16 segments prior to the newest one
+		u_int16_t bitmap = 0;
+		for (u_int8_t k = 0; k < 16; k++)
+		{
+			DecodingKey key (iter->second.hash, iter->second.seqNum - (k + 1) * (u_int32_t) iter->second.step);
+			if (m_decodingBufferIndex.find (key) != m_decodingBufferIndex.end())
+			{
+				bitmap |= (1 << k);
+			}
+		}
+
+		ncHeader.m_receptionReports.push_back (InterFlowNetworkCodingHeader::ReceptionReport (iter->second.hash, iter->second.seqNum, iter->second.step, bitmap));
+		iter->second.pending = false;
+	}
+
+	if (ncHeader.m_receptionReports.size())
+	{
+		ncHeader.m_reporter = reporter;
+	}
+}
+
 Ptr<Packet> InterFlowNetworkCodingBuffer::SearchIntoDecodingBuffer (u_int16_t hash, u_int32_t seqNum)
 {
 	NS_LOG_FUNCTION (std::hex << hash << std::dec << seqNum);
 	Cleanup();
 
-	DecodingBufferIterator iter = m_decodingBuffer.find (make_pair <u_int16_t, u_int32_t> (hash, seqNum));
+	DecodingBufferIndex::iterator iter = m_decodingBufferIndex.find (DecodingKey (hash, seqNum));
 
-	if (iter != m_decodingBuffer.end())
+	if (iter != m_decodingBufferIndex.end())
 	{
-		return iter->second.packet;
+		return iter->second->second.packet;
 	}
 	else
 	{
@@ -600,31 +812,33 @@ bool InterFlowNetworkCodingBuffer::EncapsulateTcpAckSegments (InterFlowNetworkCo
 {
 	NS_LOG_FUNCTION (this);
 	Cleanup();
-	u_int16_t outputPacketSize = 0;
-	bool moreAcks = true;
 	u_int8_t embeddedAcks = 0;
 
 	if (! m_ackBuffer.size())   //No ACK segments stored
 	{
 		return false;
 	}
-	else
-	{
-		outputPacketSize = packetLength + ncHeader.GetSerializedSize ();
-		while ((outputPacketSize < 1476) && (moreAcks))
-		{
-			TcpAckItem item = AckBufferExtraction();
-			UpdateAckBufferTimeout ();
 
-			ncHeader.m_tcpAckVector.push_back(InterFlowNetworkCodingHeader::AckInfo (item.destination, item.header));
-			embeddedAcks ++;
+	//Fill the packet up to the MTU: the oldest ACK is only extracted if the resulting header still fits (the compact ACK encoding makes
+	//the cost of each ACK variable, so the header size is checked after each addition)
+	while (m_ackBuffer.size() && embeddedAcks < 255)
+	{
+		const TcpAckItem &item = *m_ackBuffer.begin();
+		ncHeader.AddTcpAck (InterFlowNetworkCodingHeader::AckInfo (item.destination, item.header));
 
-			if (! m_ackBuffer.size())
-				moreAcks = false;
+		if (packetLength + ncHeader.GetSerializedSize () > MAX_PACKET_SIZE && embeddedAcks)
+		{
+			ncHeader.RemoveLastTcpAck ();
+			break;
 		}
-		ncHeader.SetEmbeddedAcks (embeddedAcks);
+
+		AckBufferExtraction();
+		UpdateAckBufferTimeout ();
+		embeddedAcks ++;
 	}
-	return false;
+	ncHeader.SetEmbeddedAcks (embeddedAcks);
+
+	return embeddedAcks > 0;
 }
 
 bool InterFlowNetworkCodingBuffer::UpdateAckBuffer (Ptr <Packet> packet, Ipv4Address source, Ipv4Address destination)
@@ -701,16 +915,28 @@ void
 InterFlowNetworkCodingBuffer::Cleanup (void)
 {
 	NS_LOG_FUNCTION_NOARGS();
-	if (m_decodingBuffer.empty ())
+	if (m_decodingBuffer.empty () && m_neighbourStateQueue.empty ())
 	{
 		return;
 	}
 
+	//The packets are stored in arrival order, so the expired ones are always at the head of the queue
 	Time now = Simulator::Now ();
-	for (DecodingBufferIterator i = m_decodingBuffer.begin(); i != m_decodingBuffer.end();i++)
+	while (!m_decodingBuffer.empty () && m_decodingBuffer.front ().second.tstamp + m_decodingBufferStoreTime < now)
+	{
+		m_decodingBufferIndex.erase (m_decodingBuffer.front ().first);
+		m_decodingBuffer.pop_front ();
+	}
+
+	//Same for the reception reports (the index is only cleared if the entry has not been refreshed afterwards)
+	while (!m_neighbourStateQueue.empty () && m_neighbourStateQueue.front ().second + m_decodingBufferStoreTime < now)
 	{
-		if (i->second.tstamp + m_decodingBufferStoreTime < now)
-			m_decodingBuffer.erase (i);
+		NeighbourState::iterator iter = m_neighbourState.find (m_neighbourStateQueue.front ().first);
+		if (iter != m_neighbourState.end () && iter->second == m_neighbourStateQueue.front ().second)
+		{
+			m_neighbourState.erase (iter);
+		}
+		m_neighbourStateQueue.pop_front ();
 	}
 }
 
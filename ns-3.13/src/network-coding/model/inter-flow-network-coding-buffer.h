@@ -27,6 +27,7 @@
 #include "ns3/internet-module.h"
 
 #include "inter-flow-network-coding-header.h"
+#include "ns3/flow-table.h"
 
 namespace ns3 {
 
@@ -80,6 +81,7 @@ public:
 	 * Attribute handler
 	 */
 	static TypeId GetTypeId (void);
+	static const u_int16_t MAX_PACKET_SIZE;
 	/**
 	 * Default constructor
 	 */
@@ -138,16 +140,16 @@ public:
 
 	/**
 	 * \brief Update the input packet pool flow buffer timeout
-	 * \param hash 32-bit value to locate the input packet element
+	 * \param flow Flow which locates the input packet element
 	 * \param override True if the i.e. the buffer is full and we need to change the old timeout by the second packet in the list.
 	 */
-	void UpdateInputPacketPoolTimeouts (u_int16_t hash, BufferTimeoutState_t state = INSERT_ELEMENT);
+	void UpdateInputPacketPoolTimeouts (const FlowKey &flow, BufferTimeoutState_t state = INSERT_ELEMENT);
 
 	/**
 	 * \brief Once a timeout is triggered, we need to extract the corresponding packet from the input packet pool and send it downwards
 	 *
 	 */
-	void HandleInputPacketPoolTimeout (u_int16_t hash);
+	void HandleInputPacketPoolTimeout (FlowKey flow);
 
 	/**
 	 * \brief After a new coding opportunity, if the resulting packet can include more segments (i.e. it has not reached the maximum number of packets which can be coded together with), the combined
@@ -165,16 +167,53 @@ public:
 	std::vector<NetworkCodingItem> OutputBufferExtraction ();
 
 	/**
-	 * Extract the first element of the input packet pool flow-id entry (defined by the hash); besides, extract and update the timeouts
-	 * \param hash Input packet pool key entry
-	 * \returns The first element of the entry defined by the hash
+	 * Extract the first element of the input packet pool flow-id entry (defined by the flow); besides, extract and update the timeouts
+	 * \param flow Input packet pool key entry
+	 * \returns The first element of the entry defined by the flow
 	 */
-	NetworkCodingItem InputPacketPoolExtraction (u_int16_t hash);
+	NetworkCodingItem InputPacketPoolExtraction (const FlowKey &flow);
 
 	/**
-	 * After a new packet is added to the input packet pool
+	 * After a new packet is added to the input packet pool, combine the head of its flow with the heads of the other flows (only the heads
+	 * are visited, hence the search is bounded by the number of flows). If the reception reports are enabled, a packet is only added when
+	 * every destination of the resulting combination holds all the other natives (COPE-like decodability check); otherwise, the heads are
+	 * blindly combined
+	 * \param flow Flow of the new packet
+	 * \returns True if a combination (or a native packet) has been passed to the output buffer
 	 */
-	bool SearchForCodingOpportunity (u_int16_t hash);
+	bool SearchForCodingOpportunity (const FlowKey &flow);
+
+	/**
+	 * Re-encoding at relays: add the heads of the input packet pool flows which are not yet part of a coded packet being forwarded (up to
+	 * MaxCodedPackets natives overall), as long as every destination of the resulting combination is able to decode its own native (see
+	 * IsDecodable). Hence, it requires the reception reports; without them, the coded packets are never extended. The chosen packets are
+	 * extracted from the input packet pool and appended to the header bookkeeping
+	 * \param ncHeader The Network Coding header of the coded packet
+	 * \param added Where the chosen native packets are stored (the caller codes them with the packet)
+	 * \returns True if any native packet has been added
+	 */
+	bool ExtendCombination (InterFlowNetworkCodingHeader &ncHeader, std::vector <struct NetworkCodingItem> &added);
+
+	/**
+	 * A native packet sent by a neighbour (its IP source) is obviously held by it. Only used if the reception reports are enabled
+	 * \param neighbour IP address of the node which holds the native packet
+	 * \param hash Flow-id
+	 * \param seqNum TCP Sequence Number of the native packet
+	 */
+	void UpdateNeighbourState (Ipv4Address neighbour, u_int16_t hash, u_int32_t seqNum);
+
+	/**
+	 * Parse the reception reports piggy-backed by a neighbour
+	 * \param ncHeader The Network Coding header of the received (or overheard) packet
+	 */
+	void UpdateNeighbourState (const InterFlowNetworkCodingHeader &ncHeader);
+
+	/**
+	 * Append the reception reports of the flows which have got new native packets since the last report (up to MaxReceptionReports)
+	 * \param ncHeader The Network Coding header of the packet which is about to be sent
+	 * \param reporter IP address of this node
+	 */
+	void AddReceptionReports (InterFlowNetworkCodingHeader &ncHeader, Ipv4Address reporter);
 
 	/**
 	 * Look for a concrete native packet into the decoding buffer
@@ -227,7 +266,8 @@ public:
 	 * When a data packet is about to be delivered, check whether we can embed any ACK segment. If so, modify the header in order to encapsulate as much ACKs as possible
 	 * \param ncHeader The Network Coding header of the packet will be sent down to the lower layer
 	 * \param packetLength Length (in bytes) of the packet
-	 * \returns True if it could be possible to add an ACK (or more than just one); false otherwise
+	 * \returns True if it could be possible to add an ACK (or more than just one); false otherwise. The ACKs are added while the packet
+	 * (plus its Network Coding header) fits into MAX_PACKET_SIZE; at least one is added, regardless of its size
 	 */
 	bool EncapsulateTcpAckSegments (InterFlowNetworkCodingHeader &ncHeader, u_int16_t packetLength);
 
@@ -237,14 +277,15 @@ public:
 	 * Append a data packet to the end of the buffer
 	 *
 	 * \param p The packet to be appended to the Tx buffer
-	 * \param hash 16-bit MD5 hash of the tuple <IP source address, IP destination address, TCP/UDP source port, TCP/UDP destination port>
+	 * \param hash 16-bit hash (see HashID) of the tuple <IP source address, IP destination address, TCP/UDP source port, TCP/UDP destination port>
 	 * \return Boolean to indicate success
 	 */
 	bool Add (Ptr<Packet> p, u_int16_t hash);
 
 
 	/**
-	 * Cleaning member (it will take care of handling the buffer which do not explicitly implement timeout handlers)
+	 * Cleaning member (it will take care of handling the buffer which do not explicitly implement timeout handlers). Since the
+	 * decoding buffer is kept in arrival order, only the expired packets at its head are visited (amortized O(1))
 	 */
 	void Cleanup (void);
 
@@ -253,6 +294,35 @@ public:
 	 */
 	void TcpSequenceNumber (std::string context, SequenceNumber32 seqNum);
 
+	/**
+	 * Key of the decoding buffer index: EndPoints hash + TCP Sequence Number. Since the flows usually share the same sequence
+	 * numbers (i.e. the TCP ISN is always 0), both fields go through the whole finalizer, so that the flows do not share the
+	 * lowest bits (the ones picking the FlowTable slot)
+	 */
+	struct DecodingKey
+	{
+		DecodingKey () : hash (0), seqNum (0) {}
+		DecodingKey (u_int16_t hash, u_int32_t seqNum) : hash (hash), seqNum (seqNum) {}
+		u_int32_t Hash () const {return FlowTableHash (((u_int64_t) hash << 32) | seqNum);}
+		bool operator == (const DecodingKey &other) const {return hash == other.hash && seqNum == other.seqNum;}
+		u_int16_t hash;
+		u_int32_t seqNum;
+	};
+
+	/**
+	 * Key of the reception state of the neighbours: neighbour address + EndPoints hash + TCP Sequence Number
+	 */
+	struct NeighbourKey
+	{
+		NeighbourKey () : neighbour (0), hash (0), seqNum (0) {}
+		NeighbourKey (Ipv4Address neighbour, u_int16_t hash, u_int32_t seqNum) : neighbour (neighbour.Get ()), hash (hash), seqNum (seqNum) {}
+		u_int32_t Hash () const {return FlowTableHash ((((u_int64_t) neighbour << 32) | seqNum) + FlowTableHash (hash));}
+		bool operator == (const NeighbourKey &other) const {return neighbour == other.neighbour && hash == other.hash && seqNum == other.seqNum;}
+		u_int32_t neighbour;
+		u_int16_t hash;
+		u_int32_t seqNum;
+	};
+
 private:
 	//Node in which the buffer is instanced
 	Ptr<Node> m_node;				//Pointer to the node which holds the buffer. It is initialized (by default) at SimpleNetworkCoding::SimpleNetworkCoding
@@ -265,13 +335,15 @@ private:
 	u_int8_t m_maxCodedPackets;							//Maximum number of packets that can be coded together with
 	u_int32_t m_maxBufferSize;							//Input packet pool size (in packets)
 	u_int8_t m_ackBufferSize;							//Maximum number of packets held by the ACK buffer
+	bool m_receptionReports;							//Reception reports (and decodability-aware coding) enabled
+	u_int8_t m_maxReceptionReports;						//Maximum number of reception reports appended to a packet
 
 	//Input packet pool --> Recall that it will be instanced a buffer for each flow overheard by the node
 	typedef std::list <struct NetworkCodingItem> InputBuffer;								//FIFO queue of the packets to be forwarded
-	typedef std::map <u_int16_t, InputBuffer> InputPacketPool;
-	typedef std::map <u_int16_t, InputBuffer>::iterator InputPacketPoolIterator;
-	typedef std::map <u_int16_t, EventId> InputPacketPoolTimeouts;		//Each flow buffer is tightly linked to a timeout
-	typedef std::map <u_int16_t, EventId>::iterator InputPacketPoolTimeoutIterator;
+	typedef FlowTable <InputBuffer> InputPacketPool;
+	typedef InputPacketPool::iterator InputPacketPoolIterator;
+	typedef FlowTable <EventId> InputPacketPoolTimeouts;				//Each flow buffer is tightly linked to a timeout
+	typedef InputPacketPoolTimeouts::iterator InputPacketPoolTimeoutIterator;
 	InputPacketPool m_input;
 	InputPacketPoolTimeouts m_inputTimeouts;
 
@@ -284,11 +356,53 @@ private:
 	OutputBufferTimeouts m_outputTimeouts;
 
 	//Decoding buffer --> We will temporary store all the native packets so as to retrieve the original information from the coded ones
-	//Key element --> EndPoints hash + TCP Sequence Number => Each packet can be individually found at the decoding buffer
-	typedef std::pair<u_int32_t, u_int32_t> decodingKey;
-	typedef std::map<decodingKey, struct NetworkCodingItem> DecodingBuffer;
-	typedef std::map<decodingKey, struct NetworkCodingItem>::iterator DecodingBufferIterator;
+	//The packets are kept in a FIFO queue (they are inserted in timestamp order, so they expire from its head), and indexed by
+	//EndPoints hash + TCP Sequence Number => Each packet can be individually found at the decoding buffer
+	typedef std::list <std::pair <DecodingKey, struct NetworkCodingItem> > DecodingBuffer;
+	typedef DecodingBuffer::iterator DecodingBufferIterator;
+	typedef FlowTable <DecodingBufferIterator, DecodingKey> DecodingBufferIndex;
 	DecodingBuffer m_decodingBuffer;
+	DecodingBufferIndex m_decodingBufferIndex;
+
+	//Reception reports --> Native packets held by each neighbour, learnt from the natives it sends and from the reports it piggy-backs on its
+	//transmissions. They expire as the decoding buffer entries (a refreshed entry is kept in the queue twice; only the newest one is valid)
+	typedef std::list <std::pair <NeighbourKey, Time> > NeighbourStateQueue;
+	typedef FlowTable <Time, NeighbourKey> NeighbourState;					//Key --> Last time the native packet was reported
+	NeighbourStateQueue m_neighbourStateQueue;
+	NeighbourState m_neighbourState;
+
+	//Own reception state, per flow: newest native packet stored at the decoding buffer and whether it has been reported yet
+	struct ReportState
+	{
+		ReportState () : hash (0), seqNum (0), step (0), pending (false) {}
+		u_int16_t hash;					//Flow-id carried by the reports
+		u_int32_t seqNum;
+		u_int16_t step;
+		bool pending;
+	};
+	typedef FlowTable <ReportState> ReportStates;
+	ReportStates m_reportStates;
+
+	//Native packet within a combination, as seen by the decodability check
+	struct CodedNative
+	{
+		CodedNative (Ipv4Address source, Ipv4Address destination, u_int16_t hash, u_int32_t seqNum) :
+			source (source), destination (destination), hash (hash), seqNum (seqNum) {}
+		Ipv4Address source;				//Unknown (any) if the packet has only been seen coded
+		Ipv4Address destination;
+		u_int16_t hash;
+		u_int32_t seqNum;
+	};
+	static CodedNative Describe (const NetworkCodingItem &item);
+
+	/**
+	 * \returns True if the neighbour holds the native packet (it is its source, or it has been reported)
+	 */
+	bool NeighbourHolds (Ipv4Address neighbour, const CodedNative &native);
+	/**
+	 * \returns True if the candidate can be added to the combination, i.e. each destination will be able to decode its own packet
+	 */
+	bool IsDecodable (const std::vector <CodedNative> &combination, const CodedNative &candidate);
 
 	//ACK buffer --> In order to handle the new TCP ACK encapsulation, we will handle another buffer (namely, a FIFO queue) which will take care of the overheard ACKs
 	typedef std::list <struct TcpAckItem > AckBuffer;
@@ -31,6 +31,8 @@ NS_LOG_COMPONENT_DEFINE ("InterFlowNetworkCodingHeader");
 
 NS_OBJECT_ENSURE_REGISTERED (InterFlowNetworkCodingHeader);
 
+const u_int8_t InterFlowNetworkCodingHeader::MAX_RECEPTION_REPORTS;
+
 InterFlowNetworkCodingHeader::Item::Item (const Ipv4Address destination,
 		const SequenceNumber32 seqNum,
 		const u_int16_t hash,
@@ -49,6 +51,69 @@ InterFlowNetworkCodingHeader::AckInfo::AckInfo (const Ipv4Address destination,
 {
 }
 
+InterFlowNetworkCodingHeader::ReceptionReport::ReceptionReport (const u_int16_t hash,
+		const u_int32_t seqNum,
+		const u_int16_t step,
+		const u_int16_t bitmap):
+			hash (hash),
+			seqNum (seqNum),
+			step (step),
+			bitmap (bitmap)
+{
+}
+
+//Variable-length integers (7 bits per byte, least significant group first) and zigzag mapping of the signed deltas
+static void
+WriteVarint (std::vector <u_int8_t> &out, u_int32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back ((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	out.push_back (value);
+}
+
+static u_int32_t
+GetVarintSize (u_int32_t value)
+{
+	u_int32_t size = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+static u_int32_t
+ReadVarint (Buffer::Iterator &i)
+{
+	u_int32_t value = 0;
+	u_int8_t shift = 0;
+	u_int8_t byte;
+	do
+	{
+		byte = i.ReadU8 ();
+		value |= (u_int32_t) (byte & 0x7F) << shift;
+		shift += 7;
+	} while ((byte & 0x80) && shift < 35);
+	return value;
+}
+
+static u_int32_t
+ZigZag (u_int32_t current, u_int32_t previous)
+{
+	int32_t delta = (int32_t) (current - previous);
+	return ((u_int32_t) delta << 1) ^ (u_int32_t) (delta >> 31);
+}
+
+static u_int32_t
+UnZigZag (u_int32_t value, u_int32_t previous)
+{
+	return previous + ((value >> 1) ^ (0 - (value & 1)));
+}
+
 InterFlowNetworkCodingHeader::InterFlowNetworkCodingHeader()
 {
 	NS_LOG_FUNCTION(this);
@@ -56,6 +121,7 @@ InterFlowNetworkCodingHeader::InterFlowNetworkCodingHeader()
 	m_type = 0;
 	m_codedPackets = 0;
 	m_embeddedAcks = 0;
+	m_ackLength = 0;
 }
 
 InterFlowNetworkCodingHeader::~InterFlowNetworkCodingHeader()
@@ -124,10 +190,18 @@ u_int8_t InterFlowNetworkCodingHeader::GetPacketType() const
 uint32_t InterFlowNetworkCodingHeader::GetSerializedSize (void) const
 {
 	NS_LOG_FUNCTION (this);
+	u_int32_t reports = m_receptionReports.size() ? 4 + 10 * m_receptionReports.size() : 0;
+	u_int32_t acks = 0;
+
+	if (m_tcpAckVector.size())
+	{
+		acks = GetVarintSize (m_ackFlows.size()) + 8 * m_ackFlows.size() + m_ackLength;
+	}
+
 	if (m_packetVector.size() == 1)
-		return 4 + 24 * m_tcpAckVector.size();
+		return 4 + acks + reports;
 	else
-		return 4 + 12 * m_packetVector.size() + 24 * m_tcpAckVector.size();
+		return 4 + 12 * m_packetVector.size() + acks + reports;
 
 }
 void InterFlowNetworkCodingHeader::Serialize (Buffer::Iterator start) const
@@ -139,8 +213,9 @@ void InterFlowNetworkCodingHeader::Serialize (Buffer::Iterator start) const
 	Buffer::Iterator i =start;
 
 	//Fixed header
+	NS_ASSERT (m_receptionReports.size() <= MAX_RECEPTION_REPORTS);
 	i.WriteU8 (m_protocol);
-	i.WriteU8 (m_type);
+	i.WriteU8 ((m_receptionReports.size() << 3) | (m_type & 0x07));		//Type (3 bits) + Number of reception reports (5 bits)
 	i.WriteU8 (m_packetVector.size());
 	i.WriteU8 (m_tcpAckVector.size());
 
@@ -161,15 +236,25 @@ void InterFlowNetworkCodingHeader::Serialize (Buffer::Iterator start) const
 		}
 	}
 
-	if (m_embeddedAcks)
+	if (m_tcpAckVector.size())
+	{
+		std::vector <u_int8_t> encoded;
+		EncodeAcks (encoded);
+		i.Write (&encoded[0], encoded.size());
+	}
+
+	//Reception reports (they go at the end, so the legacy fields keep their offsets)
+	if (m_receptionReports.size())
 	{
-		for (count=0; count < m_tcpAckVector.size(); count ++)
+		i.WriteHtonU32 (m_reporter.Get());
+		for (count=0; count < m_receptionReports.size(); count ++)
 		{
-			i.WriteHtonU32 (m_tcpAckVector[count].destination.Get());
-			i.Write ((unsigned char *) & m_tcpAckVector[count].tcpHeader, 20);
+			i.WriteHtonU16 (m_receptionReports[count].hash);
+			i.WriteHtonU32 (m_receptionReports[count].seqNum);
+			i.WriteHtonU16 (m_receptionReports[count].step);
+			i.WriteHtonU16 (m_receptionReports[count].bitmap);
 		}
 	}
-
 }
 
 
@@ -178,9 +263,12 @@ uint32_t InterFlowNetworkCodingHeader::Deserialize (Buffer::Iterator start)
 	NS_LOG_FUNCTION (this);
 	Buffer::Iterator i = start;
 	u_int8_t count;
+	u_int8_t reports;
 
 	m_protocol = i.ReadU8 ();
 	m_type = i.ReadU8 ();
+	reports = m_type >> 3;
+	m_type &= 0x07;
 	m_codedPackets = i.ReadU8 ();
 	m_embeddedAcks = i.ReadU8 ();
 
@@ -200,26 +288,183 @@ uint32_t InterFlowNetworkCodingHeader::Deserialize (Buffer::Iterator start)
 		}
 	}
 
-	//Deserialize the embedded-ACK TCP header
+	//Deserialize the embedded ACKs: flow table + delta-coded ACKs
 	if (m_embeddedAcks)
 	{
-		for (count=0; count < m_embeddedAcks; count++)
+		std::vector <AckInfo> flows;
+		u_int32_t flowNumber = ReadVarint (i);
+		for (u_int32_t f = 0; f < flowNumber; f++)
 		{
 			Ipv4Address destination;
 			TcpHeader tcpHeader;
-			unsigned char *temp = (unsigned char *) malloc (20);
 			destination.Set (i.ReadNtohU32());
-			i.Read (temp, 20);
-			memcpy ((unsigned char *) &tcpHeader, temp, 20);
+			tcpHeader.SetSourcePort (i.ReadNtohU16());
+			tcpHeader.SetDestinationPort (i.ReadNtohU16());
+			tcpHeader.SetFlags (TcpHeader::ACK);
+			tcpHeader.SetSequenceNumber (SequenceNumber32 (0));
+			tcpHeader.SetAckNumber (SequenceNumber32 (0));
+			tcpHeader.SetWindowSize (0);			//Not the TcpHeader default (0xffff), since the encoder starts from zero
+			flows.push_back (AckInfo (destination, tcpHeader));		//Its numbers hold the last ACK of the flow (initially zero)
+		}
+
+		for (count=0; count < m_embeddedAcks; count++)
+		{
+			u_int32_t index = ReadVarint (i);
+			NS_ASSERT (index < flows.size());
+			TcpHeader &last = flows[index].tcpHeader;
+
+			last.SetSequenceNumber (SequenceNumber32 (UnZigZag (ReadVarint (i), last.GetSequenceNumber().GetValue())));
+			last.SetAckNumber (SequenceNumber32 (UnZigZag (ReadVarint (i), last.GetAckNumber().GetValue())));
+			last.SetWindowSize (UnZigZag (ReadVarint (i), last.GetWindowSize()));
+
+			AddTcpAck (flows[index]);
+		}
+	}
+
+	//Deserialize the reception reports (the header might be reused, so the previous ones are discarded)
+	m_receptionReports.clear ();
+	if (reports)
+	{
+		m_reporter.Set (i.ReadNtohU32());
+		for (count=0; count < reports; count++)
+		{
+			u_int16_t hash = i.ReadNtohU16();
+			u_int32_t seqNum = i.ReadNtohU32();
+			u_int16_t step = i.ReadNtohU16();
+			u_int16_t bitmap = i.ReadNtohU16();
 
-			m_tcpAckVector.push_back (AckInfo (destination, tcpHeader));
-			free (temp);
+			m_receptionReports.push_back (ReceptionReport (hash, seqNum, step, bitmap));
 		}
 	}
 
 	return GetSerializedSize ();
 }
 
+void InterFlowNetworkCodingHeader::AddTcpAck (const AckInfo &ack)
+{
+	u_int32_t f;
+	for (f = 0; f < m_ackFlows.size(); f++)
+	{
+		if (m_ackFlows[f].destination == ack.destination && m_ackFlows[f].tcpHeader.GetSourcePort() == ack.tcpHeader.GetSourcePort() &&
+				m_ackFlows[f].tcpHeader.GetDestinationPort() == ack.tcpHeader.GetDestinationPort())
+		{
+			break;
+		}
+	}
+	if (f == m_ackFlows.size())
+	{
+		TcpHeader reference;
+		reference.SetSourcePort (ack.tcpHeader.GetSourcePort());
+		reference.SetDestinationPort (ack.tcpHeader.GetDestinationPort());
+		reference.SetSequenceNumber (SequenceNumber32 (0));
+		reference.SetAckNumber (SequenceNumber32 (0));
+		reference.SetWindowSize (0);
+		m_ackFlows.push_back (AckInfo (ack.destination, reference));
+	}
+
+	//Same fields as EncodeAcks
+	TcpHeader &last = m_ackFlows[f].tcpHeader;
+	m_ackLength += GetVarintSize (f);
+	m_ackLength += GetVarintSize (ZigZag (ack.tcpHeader.GetSequenceNumber().GetValue(), last.GetSequenceNumber().GetValue()));
+	m_ackLength += GetVarintSize (ZigZag (ack.tcpHeader.GetAckNumber().GetValue(), last.GetAckNumber().GetValue()));
+	m_ackLength += GetVarintSize (ZigZag (ack.tcpHeader.GetWindowSize(), last.GetWindowSize()));
+
+	last.SetSequenceNumber (ack.tcpHeader.GetSequenceNumber());
+	last.SetAckNumber (ack.tcpHeader.GetAckNumber());
+	last.SetWindowSize (ack.tcpHeader.GetWindowSize());
+
+	m_tcpAckVector.push_back (ack);
+}
+
+void InterFlowNetworkCodingHeader::RemoveLastTcpAck ()
+{
+	NS_ASSERT (m_tcpAckVector.size());
+
+	//The deltas of the flow have to be rolled back, so the remaining ACKs are accounted again (only done once the packet is full)
+	std::vector <AckInfo> acks (m_tcpAckVector.begin(), m_tcpAckVector.end() - 1);
+	ClearTcpAcks ();
+	for (u_int32_t count = 0; count < acks.size(); count++)
+	{
+		AddTcpAck (acks[count]);
+	}
+}
+
+void InterFlowNetworkCodingHeader::ClearTcpAcks ()
+{
+	m_tcpAckVector.clear ();
+	m_ackFlows.clear ();
+	m_ackLength = 0;
+}
+
+const std::vector <InterFlowNetworkCodingHeader::AckInfo> & InterFlowNetworkCodingHeader::GetTcpAcks () const
+{
+	return m_tcpAckVector;
+}
+
+void InterFlowNetworkCodingHeader::EncodeAcks (std::vector <u_int8_t> &out) const
+{
+	//Flow table (in order of appearance); each entry keeps the last ACK of the flow, the reference of the next delta
+	std::vector <AckInfo> flows;
+	std::vector <u_int32_t> indexes;
+
+	for (u_int32_t count = 0; count < m_tcpAckVector.size(); count++)
+	{
+		const AckInfo &ack = m_tcpAckVector[count];
+		u_int32_t f;
+		for (f = 0; f < flows.size(); f++)
+		{
+			if (flows[f].destination == ack.destination && flows[f].tcpHeader.GetSourcePort() == ack.tcpHeader.GetSourcePort() &&
+					flows[f].tcpHeader.GetDestinationPort() == ack.tcpHeader.GetDestinationPort())
+			{
+				break;
+			}
+		}
+		if (f == flows.size())
+		{
+			TcpHeader reference;
+			reference.SetSourcePort (ack.tcpHeader.GetSourcePort());
+			reference.SetDestinationPort (ack.tcpHeader.GetDestinationPort());
+			reference.SetSequenceNumber (SequenceNumber32 (0));
+			reference.SetAckNumber (SequenceNumber32 (0));
+			reference.SetWindowSize (0);
+			flows.push_back (AckInfo (ack.destination, reference));
+		}
+		indexes.push_back (f);
+	}
+
+	WriteVarint (out, flows.size());
+	for (u_int32_t f = 0; f < flows.size(); f++)
+	{
+		u_int32_t address = flows[f].destination.Get();
+		u_int16_t sourcePort = flows[f].tcpHeader.GetSourcePort();
+		u_int16_t destinationPort = flows[f].tcpHeader.GetDestinationPort();
+
+		out.push_back (address >> 24);
+		out.push_back (address >> 16);
+		out.push_back (address >> 8);
+		out.push_back (address);
+		out.push_back (sourcePort >> 8);
+		out.push_back (sourcePort);
+		out.push_back (destinationPort >> 8);
+		out.push_back (destinationPort);
+	}
+
+	for (u_int32_t count = 0; count < m_tcpAckVector.size(); count++)
+	{
+		const TcpHeader &ack = m_tcpAckVector[count].tcpHeader;
+		TcpHeader &last = flows[indexes[count]].tcpHeader;
+
+		WriteVarint (out, indexes[count]);
+		WriteVarint (out, ZigZag (ack.GetSequenceNumber().GetValue(), last.GetSequenceNumber().GetValue()));
+		WriteVarint (out, ZigZag (ack.GetAckNumber().GetValue(), last.GetAckNumber().GetValue()));
+		WriteVarint (out, ZigZag (ack.GetWindowSize(), last.GetWindowSize()));
+
+		last.SetSequenceNumber (ack.GetSequenceNumber());
+		last.SetAckNumber (ack.GetAckNumber());
+		last.SetWindowSize (ack.GetWindowSize());
+	}
+}
+
 void InterFlowNetworkCodingHeader::Print (std::ostream &os) const
 {
 	u_int8_t i;
@@ -241,6 +486,15 @@ void InterFlowNetworkCodingHeader::Print (std::ostream &os) const
 			os << endl << " ACK Segment - " << (int) i << " Destination IP address " << m_tcpAckVector[i].destination << " TCP Header " << m_tcpAckVector[i].tcpHeader;
 		}
 	}
+	if (m_receptionReports.size())
+	{
+		os << endl << " Reception reports from " << m_reporter;
+		for (i=0; i < m_receptionReports.size(); i++)
+		{
+			os << endl << " Report " << (int) i << ": Hash: 0x" << std::hex << m_receptionReports[i].hash << std::dec << " Sequence Number: "
+					<< m_receptionReports[i].seqNum << " Step " << m_receptionReports[i].step << " Bitmap 0x" << std::hex << m_receptionReports[i].bitmap << std::dec;
+		}
+	}
 
 
 }
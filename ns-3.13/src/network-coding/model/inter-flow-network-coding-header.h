@@ -86,7 +86,13 @@ public:
 		u_int16_t payloadLength;
 	};
 
-	//Encapsulated ACK transmitted information
+	//Encapsulated ACK transmitted information. On the wire, the ACKs refer to a table of the flows they belong to (destination + ports), and
+	//their sequence/ACK numbers and windows are varint-coded as deltas from the previous ACK of the same flow within the header (the first one
+	//of each flow is relative to zero), hence the header does not depend on any state kept across packets.
+	//Limitation: the flow table (8 bytes per flow) is sent again in every header, and the first ACK of each flow carries its absolute
+	//numbers, so the savings come from the flows with several ACKs in the same header; a single ACK per flow takes around 21 bytes
+	//(24 bytes before). Deltas across packets (per neighbour) would be shorter, but a single lost or unheard frame would break the
+	//references of the following ones, since the embedded ACKs are neither acknowledged nor retransmitted at this layer
 	struct AckInfo {
 		AckInfo (const Ipv4Address destination,
 				const TcpHeader tcpHeader);
@@ -94,10 +100,48 @@ public:
 		TcpHeader tcpHeader;
 	};
 
+	//Reception report (COPE-like): the reporter announces the native packets of a flow it holds at its decoding buffer, i.e. the newest sequence
+	//number and a bitmap of the previous segments (bit k set --> seqNum - (k + 1) * step is also held), being step the TCP segment length
+	struct ReceptionReport {
+		ReceptionReport (const u_int16_t hash,
+				const u_int32_t seqNum,
+				const u_int16_t step,
+				const u_int16_t bitmap);
+		u_int16_t hash;
+		u_int32_t seqNum;
+		u_int16_t step;
+		u_int16_t bitmap;
+	};
+
+	/**
+	 * Append an ACK to the embedded ones. The length of its wire format is accounted on the fly, so checking the header size after each
+	 * addition (see InterFlowNetworkCodingBuffer::EncapsulateTcpAckSegments) does not need to encode the previous ACKs again
+	 * \param ack The ACK to embed
+	 */
+	void AddTcpAck (const AckInfo &ack);
+	/**
+	 * Remove the last embedded ACK
+	 */
+	void RemoveLastTcpAck ();
+	void ClearTcpAcks ();
+	const std::vector <struct AckInfo> & GetTcpAcks () const;
+
 	std::vector <struct Item>  m_packetVector; 		//Information relative to each native packet coded together
-	std::vector <struct AckInfo> m_tcpAckVector;  //TCP Acknowledgement information (used for ACK embedding issues)
+	Ipv4Address m_reporter;							//Node which has appended the reception reports (only meaningful if there is any)
+	std::vector <struct ReceptionReport> m_receptionReports;	//Piggy-backed reception reports (up to MAX_RECEPTION_REPORTS)
+
+	static const u_int8_t MAX_RECEPTION_REPORTS = 31;	//The number of reports is carried by the 5 most significant bits of the Type field
 
 private:
+	/**
+	 * Wire format of the embedded ACKs (see AckInfo)
+	 * \param out Where the bytes are appended
+	 */
+	void EncodeAcks (std::vector <u_int8_t> &out) const;
+
+	std::vector <struct AckInfo> m_tcpAckVector;  //TCP Acknowledgement information (used for ACK embedding issues)
+	std::vector <struct AckInfo> m_ackFlows;	//Last embedded ACK of each flow (the reference of its next delta), in order of appearance
+	u_int32_t m_ackLength;						//Length of the delta-coded ACKs (the flow table is not included)
 
 	u_int8_t m_protocol;						//Upper layer protocol
 	u_int8_t m_type;							//Will use 3 bits, hence we have 7 possible Types
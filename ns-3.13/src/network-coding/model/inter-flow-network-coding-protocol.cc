@@ -28,6 +28,10 @@
 #include "ns3/hash-id.h"
 
 #include "inter-flow-network-coding-protocol.h"
+#include "galois-field.h"
+
+#include <stdlib.h>
+#include <algorithm>
 
 
 using namespace ns3;
@@ -47,6 +51,15 @@ const u_int8_t InterFlowNetworkCodingProtocol::PROT_NUMBER = 99;
 //In order to avoid the coding of non-desired upper-layer PDUs (i.e. TCP ACKs)
 const u_int16_t InterFlowNetworkCodingProtocol::MIN_CODING_LENGTH = 750;
 
+//The addition over GF(2) is a plain XOR, hence the region kernels of the binary field are used to code the packets together
+static const GaloisField g_xorField (1);
+
+NetworkCodingEndPoint::NetworkCodingEndPoint() :
+		sourcePort(0),
+		destinationPort(0)
+{
+}
+
 NetworkCodingEndPoint::NetworkCodingEndPoint(Ipv4Address source,
 		Ipv4Address destination,
 		u_int16_t sourcePort,
@@ -65,6 +78,10 @@ InterFlowNetworkCodingProtocol::InterFlowNetworkCodingProtocol()
 	//We need to manually assign the functionalities (WIP - Automate the process for random scenarios)
 	m_codingNode = false;
 	m_embeddedAcks = false;
+	m_codingScratch = 0;
+	m_codingScratchSize = 0;
+	m_routingHooked = false;
+	m_routeCacheEnabled = false;
 
 	m_ncBuffer = CreateObject <InterFlowNetworkCodingBuffer> ();
 
@@ -78,6 +95,8 @@ InterFlowNetworkCodingProtocol::~InterFlowNetworkCodingProtocol()
 {
 	NS_LOG_FUNCTION_NOARGS();
 	m_endPointTable.clear();
+	m_endPointHashes.clear();
+	free (m_codingScratch);
 }
 
 TypeId InterFlowNetworkCodingProtocol::GetTypeId(void)
@@ -85,6 +104,17 @@ TypeId InterFlowNetworkCodingProtocol::GetTypeId(void)
     static TypeId tid = TypeId("ns3::InterFlowNetworkCodingProtocol")
             .SetParent<Ipv4L4Protocol > ()
             .AddConstructor<InterFlowNetworkCodingProtocol > ()
+            .AddAttribute ("RouteCacheSize",
+                    "Maximum number of <source, destination> routes cached by the Network Coding layer",
+                    UintegerValue (64),
+                    MakeUintegerAccessor (&InterFlowNetworkCodingProtocol::m_routeCacheSize),
+                    MakeUintegerChecker<u_int32_t> (1))
+            .AddAttribute ("Reencoding",
+                    "Coding nodes remove the natives they hold from the forwarded coded packets, and code them together with their own queued "
+                    "natives (up to MaxCodedPackets, and only if InterFlowNetworkCodingBuffer::ReceptionReports is enabled)",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&InterFlowNetworkCodingProtocol::m_reencoding),
+                    MakeBooleanChecker ())
             ;
     return tid;
 }
@@ -163,83 +193,56 @@ Ptr<Node> InterFlowNetworkCodingProtocol::GetNode()
 
 Ptr<Packet> InterFlowNetworkCodingProtocol::Encode(Ptr<Packet> pkt1, Ptr<Packet> pkt2)
 {
-    u_int8_t *buffer1, *buffer2, *outputBuffer;
-    u_int32_t i, max;
-    Ptr<Packet> codedPkt;
-
-    //Zero padding with the shortest packet
-    if (pkt1->GetSize() > pkt2->GetSize())
-        max = pkt1->GetSize();
-    else
-        max = pkt2->GetSize();
-
-    //Get the payload of both packets
-    buffer1 = (u_int8_t *) malloc (max);
-    buffer2 = (u_int8_t *) malloc (max);
-    outputBuffer = (u_int8_t *) malloc (max);
-    memset (buffer1, 0, max);
-    memset (buffer2, 0, max);
-    memset (outputBuffer, 0, max);
-    pkt1 -> CopyData (buffer1, (signed) pkt1->GetSize());
-    pkt2 -> CopyData (buffer2, (signed) pkt2->GetSize());
-    DBG_DUMP ("ENC1", buffer1, (signed) max);
-    DBG_DUMP ("ENC2", buffer2, (signed) max);
-
-    //XOR operation
-    for (i = 0; i < max; i++)
-    {
-        outputBuffer [i] = buffer1[i] ^ buffer2 [i];
-    }
-
-    DBG_DUMP("OUT", outputBuffer, (signed) max);
-    codedPkt = Create<Packet > (outputBuffer, max);
-
-    free (buffer1);
-    free (buffer2);
-    free (outputBuffer);
-
-    return codedPkt;
+    std::vector<Ptr<Packet> > packets;
+    packets.push_back (pkt1);
+    packets.push_back (pkt2);
+    return EncodeMany (packets);
 }
 
 Ptr<Packet> InterFlowNetworkCodingProtocol::Decode(Ptr<Packet> codedPkt, Ptr<Packet> nativePkt)
 {
-    u_int8_t *buffer1, *buffer2, *outputBuffer;
-    u_int32_t i, max;
-    Ptr<Packet> outputPkt;
-
-    // Zero padding with the shortest packet
     // NOTE: Theoretically, a decodable native packet will never be longer than a coded packet
-    if (codedPkt->GetSize() > nativePkt->GetSize())
-        max = codedPkt->GetSize();
-    else
-        max = nativePkt->GetSize();
-
-    //Get the payload of both packets
-    buffer1 = (u_int8_t *) malloc(max);
-    buffer2 = (u_int8_t *) malloc(max);
-    outputBuffer = (u_int8_t *) malloc(max);
-    memset(buffer1, 0, max);
-    memset(buffer2, 0, max);
-    memset(outputBuffer, 0, max);
-    codedPkt->CopyData(buffer1, (signed) codedPkt->GetSize());
-    nativePkt->CopyData(buffer2, (signed) nativePkt->GetSize());
-    DBG_DUMP("DEC1", buffer1, (signed) max);
-    DBG_DUMP("DEC2", buffer2, (signed) max);
-
-    //XOR operation
-    for (i = 0; i < max; i++)
+    std::vector<Ptr<Packet> > packets;
+    packets.push_back (codedPkt);
+    packets.push_back (nativePkt);
+    return EncodeMany (packets);
+}
+
+Ptr<Packet> InterFlowNetworkCodingProtocol::EncodeMany(const std::vector<Ptr<Packet> > &packets)
+{
+    NS_ASSERT (!packets.empty ());
+    u_int32_t i, max = 0;
+
+    //Zero padding up to the longest packet
+    for (i = 0; i < packets.size (); i++)
     {
-        outputBuffer [i] = buffer1 [i] ^ buffer2 [i];
+        max = std::max (max, packets[i]->GetSize ());
     }
 
-    DBG_DUMP("OUT", outputBuffer, (signed) max);
-    outputPkt = Create<Packet> (outputBuffer, max);
+    //The scratch area holds the accumulator and the staging buffer (the latter is needed since the packets do not expose their bytes)
+    u_int32_t stride = (max + 31) & ~31U;
+    if (2 * stride > m_codingScratchSize)
+    {
+        void *memory;
+        free (m_codingScratch);
+        NS_ABORT_MSG_IF (posix_memalign (&memory, 32, 2 * stride), "Cannot allocate the coding scratch area");
+        m_codingScratch = (u_int8_t *) memory;
+        m_codingScratchSize = 2 * stride;
+    }
+    u_int8_t *accumulator = m_codingScratch;
+    u_int8_t *staging = m_codingScratch + stride;
 
-    free (buffer1);
-    free (buffer2);
-    free (outputBuffer);
+    //The first packet is copied straight into the accumulator, the rest of them are XORed with word/SIMD-wide operations
+    u_int32_t size = packets[0]->CopyData (accumulator, max);
+    memset (accumulator + size, 0, max - size);
+    for (i = 1; i < packets.size (); i++)
+    {
+        size = packets[i]->CopyData (staging, max);
+        g_xorField.MultiplyAddRegion (accumulator, staging, 1, size);
+    }
 
-    return outputPkt;
+    DBG_DUMP("OUT", accumulator, (signed) max);
+    return Create<Packet> (accumulator, max);
 }
 
 void InterFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet, Ipv4Address source, Ipv4Address destination, uint8_t protocol, Ptr<Ipv4Route> route)
@@ -248,9 +251,8 @@ void InterFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet,
 
 	NS_LOG_INFO("Received a native packet from the upper layer " << packet);
 
-	//Update the route list
-	if (m_routes.find(route) == m_routes.end())
-		m_routes.insert(route);
+	//Update the route cache (the upper layer always hands down the current route)
+	CacheRoute (route);
 
 	//Parse the received packet and act accordingly
 	switch (protocol)
@@ -285,6 +287,8 @@ void InterFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet,
 			m_ncBuffer->UpdateDecodingBuffer(packet, source, destination, TcpL4Protocol::PROT_NUMBER);
 		}
 
+		m_ncBuffer->AddReceptionReports (ncHeader, m_node->GetObject<Ipv4>()->GetAddress(1,0).GetLocal());
+
 		packet->AddHeader (ncHeader);
 		m_downTarget (packet, source, destination, InterFlowNetworkCodingProtocol::PROT_NUMBER, route);
 
@@ -362,25 +366,18 @@ void InterFlowNetworkCodingProtocol::SendDown ()
     //	Code the packet (if necessary; if not, just send the packet)
     if (outgoingPacketVector.size() > 1) {
         std::vector <TcpHeader> tcpVector;
-        //Get the maximum packet size (in order to code them together (At this point, we are including the TCP headers)
-        u_int32_t maximum = 0;
-        for (i = 0; i < outgoingPacketVector.size (); i++)
-        {
-            if (outgoingPacketVector[i].packet->GetSize () > maximum)
-                maximum = outgoingPacketVector[i].packet->GetSize ();
-        }
-
-        outputPacket = Create <Packet > (maximum); //We must include the TCP header
+        std::vector <Ptr<Packet> > packets;
         for (i = 0; i < outgoingPacketVector.size (); i++)
-
         {
             TcpHeader temp;
             outgoingPacketVector[i].packet->PeekHeader (temp);
             tcpVector.push_back(temp);
-
-            outputPacket = Encode (outputPacket, outgoingPacketVector[i].packet);
+            packets.push_back (outgoingPacketVector[i].packet);
         }
 
+        //Code all of them at once (the result is as long as the longest packet, TCP header included)
+        outputPacket = EncodeMany (packets);
+
         NS_LOG_INFO("\t-> Send a coded packet downwards");
 
         for (i = 0; i < tcpVector.size(); i++)
@@ -398,22 +395,12 @@ void InterFlowNetworkCodingProtocol::SendDown ()
     }
 
     //Get the route (if available)
-    if (!m_routes.empty()) {
-    	for (RoutesIterator iter = m_routes.begin(); iter != m_routes.end(); iter++)
-    	{
-    		route = *iter;
-    		if ((route->GetDestination() == destination) && (route->GetSource() == source))
-    		{
-    			NS_LOG_LOGIC("Route found " << route->GetSource() << "  " << route->GetDestination());
-    			break;
-    		}
-    	}
-    }
-    else
-        route = 0;
+    route = LookupRoute (source, destination);
 
     //After the creation of the packet (coded or not), we will search whether we can encapsulate an ACK within the NC header. If so, we will include as many packets as possible
     // (i.e. in order to deal with this challenge, we have to compare the size of the resulting packet with the NC layer MSS). NOTE: Only for coding nodes
+    m_ncBuffer->AddReceptionReports (header, m_node->GetObject<Ipv4>()->GetAddress(1,0).GetLocal());
+
     if (m_codingNode)
     {
     	m_ncBuffer->EncapsulateTcpAckSegments (header, outputPacket->GetSize ());
@@ -455,37 +442,21 @@ void InterFlowNetworkCodingProtocol::SendDownTcpAck ()  		//Send Down a raw TCP
 	ncHeader.SetCodedPackets (0);			//Raw ACK transmission
 	ncHeader.SetEmbeddedAcks (0);
 
+	m_ncBuffer->AddReceptionReports (ncHeader, m_node->GetObject<Ipv4>()->GetAddress(1,0).GetLocal());
 	m_ncBuffer->EncapsulateTcpAckSegments (ncHeader, outputPacket->GetSize ());
 
-	destination = ncHeader.m_tcpAckVector[0].destination;
-
-	//Get the route (if available)
-	if (!m_routes.empty())
-	{
-		for (RoutesIterator iter = m_routes.begin(); iter != m_routes.end(); iter++)
-		{
-			route = *iter;
-			if ((route->GetDestination() == destination) && (route->GetSource() == source))
-			{
-				NS_LOG_LOGIC("Route found " << route->GetSource() << "  " << route->GetDestination());
-				break;
-			}
-		}
-	}
-	else
-	{
-		route = 0;
-	}
+	destination = ncHeader.GetTcpAcks ()[0].destination;
 
 	//Search into the EndPoint table the source IP address which sent the packet
-	for (EndPointIterator j = m_endPointTable.begin(); j != m_endPointTable.end(); j++)
+	FlowTable<Ipv4Address, AddressKey>::iterator endPoint = m_endPointIndex.find (AddressKey (destination));
+	if (endPoint != m_endPointIndex.end())
 	{
-		if (j->second.source == destination)	// Flow found --> Forward up
-		{
-			source =  j->second.destination;
-		}
+		source = endPoint->second;
 	}
 
+	//Get the route (if available)
+	route = LookupRoute (source, destination);
+
 	outputPacket->AddHeader (ncHeader);
 
 	//Trace the results
@@ -609,6 +580,9 @@ bool InterFlowNetworkCodingProtocol::ReceivePromiscuous (Ptr<NetDevice> device,
 			InterFlowNetworkCodingHeader networkCodingHeader;
 			packetCopy->RemoveHeader (networkCodingHeader);
 
+			//Neighbour state (reception reports piggy-backed by the transmitter)
+			m_ncBuffer->UpdateNeighbourState (networkCodingHeader);
+
 			if (networkCodingHeader.GetProtocolNumber() == TcpL4Protocol::PROT_NUMBER)
 			{
 				//Overhearing a native packet, headed to any node --> Store in the decoding buffer
@@ -635,6 +609,10 @@ bool InterFlowNetworkCodingProtocol::ReceivePromiscuous (Ptr<NetDevice> device,
 					if (packetCopy->GetSize() > MIN_CODING_LENGTH)
 					{
 						m_ncBuffer->UpdateDecodingBuffer(packetCopy, ipHeader.GetSource(), ipHeader.GetDestination(), 6);
+
+						//The source of the native packet holds it
+						m_ncBuffer->UpdateNeighbourState (ipHeader.GetSource(), HashID (ipHeader.GetSource(), ipHeader.GetDestination(),
+								tcpHeader.GetSourcePort(), tcpHeader.GetDestinationPort()), tcpHeader.GetSequenceNumber().GetValue());
 					}
 
 					// 3 - Trace the native reception (trace only if not the intended receiver)
@@ -712,12 +690,12 @@ bool InterFlowNetworkCodingProtocol::ReceivePromiscuous (Ptr<NetDevice> device,
 				if (networkCodingHeader.GetEmbeddedAcks())
 				{
 
-					for (i = 0; i < networkCodingHeader.m_tcpAckVector.size(); i++)
+					for (i = 0; i < networkCodingHeader.GetTcpAcks ().size(); i++)
 					{
-						if (AmIDestination (networkCodingHeader.m_tcpAckVector[i].destination))
+						if (AmIDestination (networkCodingHeader.GetTcpAcks ()[i].destination))
 						{
 
-							ipHeader.SetDestination (networkCodingHeader.m_tcpAckVector[i].destination);
+							ipHeader.SetDestination (networkCodingHeader.GetTcpAcks ()[i].destination);
 							ipHeader.SetSource (Ipv4Address ("0.0.0.0"));
 							ipHeader.SetProtocol (6);   //  TCP
 
@@ -727,12 +705,13 @@ bool InterFlowNetworkCodingProtocol::ReceivePromiscuous (Ptr<NetDevice> device,
 
 							for (EndPointIterator j = m_endPointTable.begin(); j != m_endPointTable.end(); j++)
 							{
-								if (j->second.source == networkCodingHeader.m_tcpAckVector[i].destination)	// Flow found --> Forward up
+								if (j->second.source == networkCodingHeader.GetTcpAcks ()[i].destination)	// Flow found --> Forward up
 								{
 									Ptr<Packet> newPacket = Create <Packet> ();
-									networkCodingHeader.m_tcpAckVector[i].tcpHeader.SetFlags (0x10);
+									TcpHeader tcpAck = networkCodingHeader.GetTcpAcks ()[i].tcpHeader;
+									tcpAck.SetFlags (0x10);
 
-									newPacket->AddHeader (networkCodingHeader.m_tcpAckVector[i].tcpHeader);
+									newPacket->AddHeader (tcpAck);
 									ipHeader.SetSource (j->second.destination);
 
 //									NS_LOG_UNCOND (Simulator::Now().GetSeconds() << ": (" << (int) m_node->GetId() << ") *-*-*-*  ACK retrieved " << ipHeader.GetSource() << " >> " << ipHeader.GetDestination() <<
@@ -744,13 +723,13 @@ bool InterFlowNetworkCodingProtocol::ReceivePromiscuous (Ptr<NetDevice> device,
 										InterFlowNetworkCodingHeader temp;
 										temp = networkCodingHeader;
 										temp.m_packetVector.clear ();
-										temp.m_tcpAckVector.clear ();
-										temp.m_tcpAckVector.push_back (networkCodingHeader.m_tcpAckVector[i]);
+										temp.ClearTcpAcks ();
+										temp.AddTcpAck (networkCodingHeader.GetTcpAcks ()[i]);
 
 										tracedPacket->AddHeader (temp);
 
 										m_interFlowNetworkCodingCallback(tracedPacket, 5, m_node->GetId(), ipHeader.GetSource(), ipHeader.GetDestination(), temp.m_packetVector.size(),
-												temp.m_tcpAckVector.size(), true);
+												temp.GetTcpAcks ().size(), true);
 									}
 
 									ForwardUp (newPacket, ipHeader, 0);
@@ -792,12 +771,12 @@ void InterFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
     	if (networkCodingHeader.GetCodedPackets() == 1 && (packetCopy->GetSize() > MIN_CODING_LENGTH))
     		//Native packet --> Search for a coding opportunity (it has to fulfill the coding requirements; in this case, the packet has to be longer than the coding threshold
     	{
-    		u_int16_t hash = HashID (header.GetSource(), header.GetDestination(), tcpHeader.GetSourcePort(), tcpHeader.GetDestinationPort());
+    		FlowKey flow (header.GetSource(), header.GetDestination(), tcpHeader.GetSourcePort(), tcpHeader.GetDestinationPort(), TcpL4Protocol::PROT_NUMBER);
 
     		// If the overheard packet fulfills the coding requirements (i.e. minimum packet length), it will be used to update the input packet pool
     		if (m_ncBuffer->UpdateInputPacketPool(packetCopy, networkCodingHeader, header.GetSource(), header.GetDestination(), 6))
     		{
-    			m_ncBuffer->SearchForCodingOpportunity(hash);
+    			m_ncBuffer->SearchForCodingOpportunity(flow);
     		}
     	}
 
@@ -832,7 +811,12 @@ void InterFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 //        	}
         }
 
-        else 		//Coded packets --> Just forward (by the moment) --> in the near future, we can smartly re-encode previously coded packets, thus increasing the overall performance
+        else if (m_reencoding && m_codingNode && networkCodingHeader.GetCodedPackets() > 1)
+        {
+        	ReencodeAndForward (rtentry, packetCopy, networkCodingHeader, header);
+        }
+
+        else 		//Coded packets --> Just forward (unless they are re-encoded, see above)
         {
 
             //Forward the packet
@@ -914,6 +898,7 @@ Ptr<Packet> InterFlowNetworkCodingProtocol::DecodeAttempt(Ptr<Packet> packet, In
 {
     u_int8_t nativePacketsFound = 0;
     u_int16_t searchedHash = 0;
+    Ipv4Address searchedDestination;
     std::vector <Ptr <Packet> > nativePool;
     std::vector <pair <u_int16_t, u_int32_t>  > nativeFoundKeyVector;
 
@@ -930,23 +915,23 @@ Ptr<Packet> InterFlowNetworkCodingProtocol::DecodeAttempt(Ptr<Packet> packet, In
         else
         {
             searchedHash = header.m_packetVector[i].hash;
+            searchedDestination = header.m_packetVector[i].destination;
         }
     }
 
     //Decode success (we have stored N - 1 native packets from the received batch of N coded packets
     if (nativePacketsFound == header.m_packetVector.size() - 1)
     {
+        //Remove all the native packets at once
         Ptr <Packet> output = packet;
-
-        for (u_int8_t i = 0; i < nativePool.size(); i++)
+        if (!nativePool.empty ())
         {
-            TcpHeader tcpHeader;
-            nativePool[i]->PeekHeader(tcpHeader);
-            output = Decode(output, nativePool[i]);
+            nativePool.insert (nativePool.begin (), packet);
+            output = EncodeMany (nativePool);
         }
 
         //Search the source IP address into the EndPoints hash table
-        EndPointIterator iter = m_endPointTable.find (searchedHash);
+        EndPointIterator iter = LookupEndPoint (searchedHash, searchedDestination);
         if (iter != m_endPointTable.end())
         {
             ipHeader.SetSource(iter->second.source);
@@ -996,12 +981,108 @@ Ptr<Packet> InterFlowNetworkCodingProtocol::DecodeAttempt(Ptr<Packet> packet, In
 
 
 
+void InterFlowNetworkCodingProtocol::ReencodeAndForward (Ptr<Ipv4Route> rtentry, Ptr<Packet> packet, InterFlowNetworkCodingHeader ncHeader, const Ipv4Header &header)
+{
+	NS_LOG_FUNCTION (this);
+	std::vector <Ptr <Packet> > packets;
+	std::vector <Ptr <Packet> > stripped;
+	std::vector <InterFlowNetworkCodingHeader::Item> kept;
+	u_int8_t missing = 0;
+	u_int8_t i;
+
+	// 1 - Look for the natives at the decoding buffer. Those held by this node are XORed out of the combination, except the ones towards the
+	// IP destination of the packet (the node it is forwarded to); the rest of their destinations have already overheard the coded packet
+	packets.push_back (packet);
+	stripped.push_back (packet);
+	for (i = 0; i < ncHeader.m_packetVector.size(); i++)
+	{
+		const InterFlowNetworkCodingHeader::Item &item = ncHeader.m_packetVector[i];
+		Ptr<Packet> native = m_ncBuffer->SearchIntoDecodingBuffer (item.hash, item.seqNum.GetValue());
+		if (native)
+		{
+			packets.push_back (native);
+		}
+		else
+		{
+			missing = i;
+		}
+
+		if (native && item.destination != header.GetDestination ())
+		{
+			stripped.push_back (native);
+		}
+		else
+		{
+			kept.push_back (item);
+		}
+	}
+
+	// If only one native is unknown, recover it (trimmed to its original length) from the held ones and store it
+	if (packets.size() == ncHeader.m_packetVector.size())
+	{
+		EndPointIterator endPoint = LookupEndPoint (ncHeader.m_packetVector[missing].hash, ncHeader.m_packetVector[missing].destination);
+		if (endPoint != m_endPointTable.end())
+		{
+			Ptr<Packet> decoded = EncodeMany (packets)->CreateFragment (0, ncHeader.m_packetVector[missing].payloadLength);
+			m_ncBuffer->UpdateDecodingBuffer (decoded, endPoint->second.source, endPoint->second.destination, TcpL4Protocol::PROT_NUMBER);
+		}
+	}
+
+	// The remaining combination is as long as its longest native (the bytes beyond it are zero once the others are removed)
+	if (stripped.size() > 1 && !kept.empty())
+	{
+		u_int16_t length = 0;
+		for (i = 0; i < kept.size(); i++)
+		{
+			length = std::max (length, kept[i].payloadLength);
+		}
+		packet = EncodeMany (stripped)->CreateFragment (0, std::min ((u_int32_t) length, packet->GetSize ()));
+		ncHeader.m_packetVector = kept;
+		ncHeader.SetCodedPackets (kept.size());
+		NS_LOG_INFO ("\t-> Removed " << stripped.size() - 1 << " held natives from a coded packet " << ncHeader);
+	}
+
+	// 2 - Code the packet together with the local natives
+	std::vector <struct NetworkCodingItem> added;
+	Ptr<Packet> outputPacket;
+
+	if (m_ncBuffer->ExtendCombination (ncHeader, added))
+	{
+		packets.clear ();
+		packets.push_back (packet);
+		for (i = 0; i < added.size(); i++)
+		{
+			packets.push_back (added[i].packet);
+		}
+		outputPacket = EncodeMany (packets);
+
+		m_ncStatistics.codedPacketTx ++;
+		NS_LOG_INFO ("\t-> Re-encoded a coded packet " << ncHeader);
+	}
+	else
+	{
+		outputPacket = packet->Copy ();
+	}
+
+	outputPacket->AddHeader (ncHeader);
+
+	// 3 - Forward the packet
+	Ptr<Ipv4L3Protocol> ipv4 = m_node->GetObject <Ipv4L3Protocol > ();
+	if (ipv4)
+	{
+		Ipv4Header ipHeader = header;
+		ipHeader.SetPayloadSize (outputPacket->GetSize ());
+		ipv4->SendRealOutHook (rtentry, outputPacket, ipHeader);
+	}
+}
+
 void InterFlowNetworkCodingProtocol::UpdateEndPointTable(struct NetworkCodingEndPoint entry)
 {
     NS_LOG_FUNCTION(this);
     u_int16_t hash = HashID (entry.source, entry.destination, entry.sourcePort, entry.destinationPort);
+    FlowKey flow (entry.source, entry.destination, entry.sourcePort, entry.destinationPort, TcpL4Protocol::PROT_NUMBER);
 
-    if (m_endPointTable.find (hash) == m_endPointTable.end())
+    if (m_endPointTable.find (flow) == m_endPointTable.end())
     {
 
 //    	//Search and attach the socket corresponding to the flow
@@ -1021,7 +1102,9 @@ void InterFlowNetworkCodingProtocol::UpdateEndPointTable(struct NetworkCodingEnd
 //    		}
 //    	}
 
-    	m_endPointTable.insert(pair<u_int16_t, struct NetworkCodingEndPoint > (hash, entry));
+    	m_endPointTable.insert (make_pair (flow, entry));
+    	m_endPointHashes.insert (make_pair (hash, flow));
+    	m_endPointIndex [AddressKey (entry.source)] = entry.destination;
     }
 
     NS_LOG_DEBUG ("(" << (int) m_node->GetId() << ") EndPointTable updated: " << std::hex << hash << std::dec << " "
@@ -1029,6 +1112,20 @@ void InterFlowNetworkCodingProtocol::UpdateEndPointTable(struct NetworkCodingEnd
     		")");
 }
 
+InterFlowNetworkCodingProtocol::EndPointIterator InterFlowNetworkCodingProtocol::LookupEndPoint (u_int16_t hash, Ipv4Address destination)
+{
+	std::pair <std::multimap <u_int16_t, FlowKey>::iterator, std::multimap <u_int16_t, FlowKey>::iterator> range = m_endPointHashes.equal_range (hash);
+
+	for (std::multimap <u_int16_t, FlowKey>::iterator iter = range.first; iter != range.second; iter++)
+	{
+		if (iter->second.destination == destination)
+		{
+			return m_endPointTable.find (iter->second);
+		}
+	}
+	return m_endPointTable.end ();
+}
+
 void InterFlowNetworkCodingProtocol::SetNetworkCodingBufferParameters(Time bufferTimeout, u_int32_t bufferSize, u_int8_t maxCodedPackets)
 {
 	NS_LOG_FUNCTION_NOARGS ();
@@ -1044,6 +1141,143 @@ void InterFlowNetworkCodingProtocol::SetEncapsulationAckBufferParameters (Time b
 	m_ncBuffer->SetAckBufferSize (bufferSize);
 }
 
+Ptr<Ipv4Route> InterFlowNetworkCodingProtocol::LookupRoute (Ipv4Address source, Ipv4Address destination)
+{
+	if (m_routeCache.empty ())
+	{
+		return 0;
+	}
+	if (RoutingStateChanged ())
+	{
+		RoutingTableChanged (m_routeCache.size ());
+		return 0;
+	}
+
+	RouteCache::iterator iter = m_routeCache.find (FlowKey (source, destination, 0, 0));
+	if (iter != m_routeCache.end())
+	{
+		NS_LOG_LOGIC("Route found " << source << "  " << destination);
+		return iter->second;
+	}
+	return 0;
+}
+
+void InterFlowNetworkCodingProtocol::CacheRoute (Ptr<Ipv4Route> route)
+{
+	if (!route)
+	{
+		return;
+	}
+	if (!m_routingHooked)
+	{
+		HookRoutingProtocol ();
+	}
+	if (!m_routeCacheEnabled)
+	{
+		return;
+	}
+	if (m_routeCache.empty ())
+	{
+		//The routes are cached against the current routing state
+		RoutingStateChanged ();
+	}
+
+	FlowKey key (route->GetSource(), route->GetDestination(), 0, 0);
+	RouteCache::iterator iter = m_routeCache.find (key);
+	if (iter != m_routeCache.end())
+	{
+		iter->second = route;
+		return;
+	}
+
+	//Evict the oldest entry if the cache is full
+	if (m_routeCache.size() >= m_routeCacheSize)
+	{
+		m_routeCache.erase (m_routeCacheOrder.front());
+		m_routeCacheOrder.pop_front();
+	}
+	m_routeCache.insert (make_pair (key, route));
+	m_routeCacheOrder.push_back (key);
+}
+
+void InterFlowNetworkCodingProtocol::HookRoutingProtocol ()
+{
+	NS_LOG_FUNCTION (this);
+	m_routingHooked = true;
+
+	Ptr<Ipv4RoutingProtocol> routing = m_node->GetObject<Ipv4> ()->GetRoutingProtocol ();
+	Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (routing);
+	m_routeCacheEnabled = (routing != 0);
+	if (list)
+	{
+		for (u_int32_t i = 0; i < list->GetNRoutingProtocols (); i++)
+		{
+			int16_t priority;
+			HookRoutingProtocol (list->GetRoutingProtocol (i, priority));
+		}
+	}
+	else if (routing)
+	{
+		HookRoutingProtocol (routing);
+	}
+	NS_LOG_LOGIC ("Route cache " << (m_routeCacheEnabled ? "enabled" : "bypassed (routing changes cannot be noticed)"));
+}
+
+void InterFlowNetworkCodingProtocol::HookRoutingProtocol (Ptr<Ipv4RoutingProtocol> routing)
+{
+	if (routing->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&InterFlowNetworkCodingProtocol::RoutingTableChanged, this)))
+	{
+		return;
+	}
+
+	Ptr<Ipv4StaticRouting> staticRouting = DynamicCast<Ipv4StaticRouting> (routing);
+	Ptr<Ipv4GlobalRouting> globalRouting = DynamicCast<Ipv4GlobalRouting> (routing);
+	if (staticRouting)
+	{
+		m_staticRouting.push_back (staticRouting);
+	}
+	else if (globalRouting)
+	{
+		m_globalRouting.push_back (globalRouting);
+	}
+	else
+	{
+		m_routeCacheEnabled = false;
+	}
+}
+
+bool InterFlowNetworkCodingProtocol::RoutingStateChanged ()
+{
+	Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4> ();
+	m_routingStateScratch.clear ();
+	for (u_int32_t i = 0; i < ipv4->GetNInterfaces (); i++)
+	{
+		m_routingStateScratch.push_back (ipv4->IsUp (i));
+	}
+	for (u_int32_t i = 0; i < m_staticRouting.size (); i++)
+	{
+		m_routingStateScratch.push_back (m_staticRouting [i]->GetNRoutes ());
+	}
+	for (u_int32_t i = 0; i < m_globalRouting.size (); i++)
+	{
+		m_routingStateScratch.push_back (m_globalRouting [i]->GetNRoutes ());
+	}
+
+	if (m_routingStateScratch == m_routingState)
+	{
+		return false;
+	}
+	m_routingState.swap (m_routingStateScratch);
+	return true;
+}
+
+void InterFlowNetworkCodingProtocol::RoutingTableChanged (uint32_t size)
+{
+	NS_LOG_FUNCTION (this << size);
+	m_routeCache.clear();
+	m_routeCacheOrder.clear();
+}
+
 int InterFlowNetworkCodingProtocol::GetProtocolNumber() const
 {
     return PROT_NUMBER;
@@ -1060,7 +1294,16 @@ void InterFlowNetworkCodingProtocol::DoDispose()
     NS_LOG_FUNCTION_NOARGS();
 
     m_endPointTable.clear();
-    m_routes.clear();
+    m_endPointHashes.clear();
+    m_endPointIndex.clear();
+    m_routeCache.clear();
+    m_routeCacheOrder.clear();
+    m_staticRouting.clear();
+    m_globalRouting.clear();
+
+    free (m_codingScratch);
+    m_codingScratch = 0;
+    m_codingScratchSize = 0;
 
     m_node = 0;
     GetDownTarget().Nullify();
@@ -40,6 +40,7 @@ namespace ns3 {
 
 	//Map that store all the EndPoints that involve the node (that is to say, the destination IP corresponds to the node's IP), hence we can retrieve the source IP address from the packet
 	struct NetworkCodingEndPoint{
+		NetworkCodingEndPoint ();
 		NetworkCodingEndPoint (Ipv4Address source, Ipv4Address destination, u_int16_t sourcePort, u_int16_t destinationPort);
 		Ipv4Address source;
 		Ipv4Address destination;
@@ -122,6 +123,14 @@ public:
 	 */
 	Ptr<Packet> Encode (Ptr<Packet> pkt1, Ptr<Packet> pkt2);				//Future version --> Compose the Network Coding Header
 
+	/**
+	 * \brief XOR of a whole set of packets (zero padded up to the longest one). Every packet is read only once, the result is
+	 * accumulated over a scratch area which is kept between calls (no allocations) and the output packet is built at the end
+	 * \param packets Packets (native or coded) to combine
+	 * \returns The XORed packet (as long as the longest input)
+	 */
+	Ptr<Packet> EncodeMany (const std::vector<Ptr<Packet> > &packets);
+
 	/**
 	 * \param codedPkt The coded packet that we want to decode (only data)
 	 * \param nativePkt Native packet to XOR with the coded one
@@ -219,6 +228,18 @@ public:
 	 */
 	Ptr<Packet> DecodeAttempt (Ptr <Packet> packet, InterFlowNetworkCodingHeader header, Ipv4Header &ipHeader);
 
+	/**
+	 * Re-encoding at a relay: the natives of the coded packet which are found at the decoding buffer are used to recover the remaining one
+	 * (if there is only one), which is stored for further decoding, and they are XORed out of the forwarded packet (but the ones towards its IP
+	 * destination, which still needs them). Then, the remaining combination is coded together with the heads of the local input packet pool
+	 * (see InterFlowNetworkCodingBuffer::ExtendCombination) and forwarded
+	 * \param rtentry Route of the forwarded packet
+	 * \param packet The coded packet (without the Network Coding header)
+	 * \param ncHeader Its Network Coding header
+	 * \param header Its IP header
+	 */
+	void ReencodeAndForward (Ptr<Ipv4Route> rtentry, Ptr<Packet> packet, InterFlowNetworkCodingHeader ncHeader, const Ipv4Header &header);
+
 	/**
 	 * Store all the node-dependent streams (used to further decoding issues)
 	 * \param entry The endpoint of the received native Packet
@@ -275,19 +296,77 @@ private:
     //Enable/disable ACK encapsulation
     bool m_embeddedAcks;
 
+    //Enable/disable the re-encoding of the coded packets forwarded by a coding node
+    bool m_reencoding;
+
 	//Callback hooks
 	UpTargetCallback m_upNscTcpTarget;									//Forward up to the Network Simulator Cradle TCP stack (NscTcpL4Protocol::Receive)
 	UpTargetCallback m_upTcpTarget;										//Forward up to the TCP stack (TcpL4Protocol::Receive)
 	UpTargetCallback m_upUdpTarget;						   				//Forward up to the UDP stack (UdpL4Protocol::Receive)
 	InterFlowNetworkCodingCallback m_interFlowNetworkCodingCallback;	//Callback used to trace the main results achieved
 
-	//We need to store all the Network Coding Interfaces for further use (in a future version, we might have more than one Network Coding interface per node)
-	std::set<Ptr <Ipv4Route> > m_routes;
-	typedef std::set<Ptr <Ipv4Route> >::iterator RoutesIterator;
+	//Route cache: <IP source, IP destination> --> Last route handed down by the upper layer. Its size is bounded (the oldest entries are
+	//evicted first) and it is flushed whenever the routing protocol notifies a routing table change. Static and global routing do not
+	//notify them, so it is also flushed when the state of the interfaces or their number of routes change; the cache is bypassed if any
+	//other routing protocol cannot notify its changes
+	typedef FlowTable <Ptr<Ipv4Route> > RouteCache;
+	RouteCache m_routeCache;
+	std::list <FlowKey> m_routeCacheOrder;
+	u_int32_t m_routeCacheSize;
+	bool m_routingHooked;
+	bool m_routeCacheEnabled;
+	std::vector <Ptr<Ipv4StaticRouting> > m_staticRouting;
+	std::vector <Ptr<Ipv4GlobalRouting> > m_globalRouting;
+	std::vector <u_int32_t> m_routingState;			//Interfaces up/down + number of static/global routes, when the cache was filled
+	std::vector <u_int32_t> m_routingStateScratch;
+
+	/**
+	 * \returns The cached route between both addresses, or a null pointer (the IP layer will then look for it)
+	 */
+	Ptr<Ipv4Route> LookupRoute (Ipv4Address source, Ipv4Address destination);
+	void CacheRoute (Ptr<Ipv4Route> route);
+	/**
+	 * Connect to the "RoutingTableChanged" trace source of the routing protocols (e.g. OLSR); the route cache is only enabled if every
+	 * routing protocol of the node provides it, or it is a static/global one (see RoutingStateChanged)
+	 */
+	void HookRoutingProtocol ();
+	void HookRoutingProtocol (Ptr<Ipv4RoutingProtocol> routing);
+	/**
+	 * \returns true if any interface has been brought up/down, or the number of static/global routes has changed, since the last call
+	 */
+	bool RoutingStateChanged ();
+	void RoutingTableChanged (uint32_t size);
+
+	//Hash table that stores all the overheard endpoints. The coded packets only carry the 16-bit flow-id (HashID) of each native,
+	//so a secondary index maps it to the flows which share it (they are told apart by the destination of the native)
+	typedef FlowTable <NetworkCodingEndPoint> EndPointTable;
+	typedef EndPointTable::iterator EndPointIterator;
+	EndPointTable m_endPointTable;
+	std::multimap <u_int16_t, FlowKey> m_endPointHashes;
+
+	/**
+	 * \param hash Flow-id carried by the Network Coding header
+	 * \param destination IP destination address of the native packet
+	 * \returns The endpoint of the flow, or m_endPointTable.end () if it is unknown
+	 */
+	EndPointIterator LookupEndPoint (u_int16_t hash, Ipv4Address destination);
+
+	/**
+	 * FlowTable key which holds an IPv4 address
+	 */
+	struct AddressKey
+	{
+		AddressKey () : address (0) {}
+		AddressKey (Ipv4Address address) : address (address.Get ()) {}
+		u_int32_t Hash () const {return FlowTableHash (address);}
+		bool operator == (const AddressKey &other) const {return address == other.address;}
+		u_int32_t address;
+	};
+	FlowTable <Ipv4Address, AddressKey> m_endPointIndex;		//IP source address of an endpoint --> IP destination address (last registered one)
 
-	//Hash table that stores all the overheard endpoints
-	std::map <u_int16_t, NetworkCodingEndPoint> m_endPointTable;
-	typedef std::map <u_int16_t, NetworkCodingEndPoint>::iterator EndPointIterator;
+	//Scratch area used by EncodeMany (accumulator + staging of the packet being read), aligned to 32 bytes and only grown
+	u_int8_t *m_codingScratch;
+	u_int32_t m_codingScratchSize;
 
 //	InterFlowNetworkCodingStatistics m_stats;
 
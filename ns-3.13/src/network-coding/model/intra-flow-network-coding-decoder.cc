@@ -0,0 +1,375 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "intra-flow-network-coding-decoder.h"
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("IntraFlowNetworkCodingDecoder");
+
+namespace ns3 {
+
+IntraFlowNetworkCodingDecoder::IntraFlowNetworkCodingDecoder () :
+		m_binary (false),
+		m_field (1),
+		m_k (0),
+		m_rank (0),
+		m_offset (0),
+		m_stride (0),
+		m_payloadSize (0)
+{
+}
+
+void IntraFlowNetworkCodingDecoder::Reset (u_int16_t k, u_int8_t q, bool binary)
+{
+	NS_LOG_FUNCTION (this << k << (int) q << binary);
+
+	m_binary = binary && q == 1;
+	if (m_binary)
+	{
+		m_binaryMatrix.Reset (k);
+		k = 0;				//The byte-per-element rows are not needed
+	}
+
+	m_field.SetQ (q);
+	m_k = k;
+	m_rank = 0;
+
+	//The storage is only reallocated when K grows, hence consecutive fragments reuse the same memory
+	m_stride = ((k + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT;
+	size_t size = (size_t) k * m_stride;
+	if (m_storage.size () < size + CACHE_LINE)
+	{
+		m_storage.resize (size + CACHE_LINE);
+	}
+	m_offset = (CACHE_LINE - ((size_t) &m_storage [0] % CACHE_LINE)) % CACHE_LINE;
+	std::fill (m_storage.begin () + m_offset, m_storage.begin () + m_offset + size, 0);
+	m_pivot.assign (k, false);
+	m_unit.assign (k, false);
+	m_pending.reserve (k);
+	m_scratch.assign (k, 0);
+
+	m_payloadSize = 0;
+	m_payloads.resize (k);
+	for (u_int16_t i = 0; i < k; i++)
+	{
+		m_payloads [i].clear ();
+	}
+	m_scratchPayload.clear ();
+}
+
+u_int64_t IntraFlowNetworkCodingDecoder::GetMemoryUsage () const
+{
+	u_int64_t bytes = m_storage.capacity () + m_scratch.capacity () + (m_pivot.capacity () + m_unit.capacity ()) / 8 +
+			m_pending.capacity () * sizeof (u_int16_t) + m_scratchPayload.capacity ();
+	for (u_int16_t i = 0; i < m_payloads.size (); i++)
+	{
+		bytes += m_payloads [i].capacity ();
+	}
+	return bytes + m_binaryMatrix.GetMemoryUsage ();
+}
+
+void IntraFlowNetworkCodingDecoder::GrowPayloads (u_int32_t size)
+{
+	if (size <= m_payloadSize)
+	{
+		return;
+	}
+
+	m_payloadSize = size;
+	for (u_int16_t i = 0; i < m_k; i++)
+	{
+		if (m_pivot [i])
+		{
+			m_payloads [i].resize (size, 0);
+		}
+	}
+	m_scratchPayload.resize (size, 0);
+}
+
+bool IntraFlowNetworkCodingDecoder::IsUnitRow (u_int16_t column) const
+{
+	const u_int8_t *row = GetRow (column);
+	for (u_int16_t i = column + 1; i < m_k; i++)
+	{
+		if (row [i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void IntraFlowNetworkCodingDecoder::AddScaledRow (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int16_t from) const
+{
+	m_field.MultiplyAdd (dst + from, src + from, c, m_k - from);
+}
+
+bool IntraFlowNetworkCodingDecoder::AddVector (const std::vector<u_int8_t> &vector, const u_int8_t *payload, u_int32_t size)
+{
+	NS_LOG_FUNCTION (this);
+
+	if (m_binary)
+	{
+		return m_binaryMatrix.AddVector (vector, payload, size);
+	}
+
+	if (m_rank == m_k)
+	{
+		return false;
+	}
+
+	u_int16_t length = std::min ((u_int16_t) vector.size (), m_k);
+	u_int8_t *v = &m_scratch [0];
+
+	std::copy (vector.begin (), vector.begin () + length, m_scratch.begin ());
+	std::fill (m_scratch.begin () + length, m_scratch.end (), 0);
+
+	if (!m_payloadSize && !size)		//Nothing to carry along with the coefficients
+	{
+		payload = 0;
+	}
+
+	if (payload)
+	{
+		GrowPayloads (size);
+		std::copy (payload, payload + size, m_scratchPayload.begin ());
+		std::fill (m_scratchPayload.begin () + size, m_scratchPayload.end (), 0);
+	}
+
+	//Forward elimination: cancel the vector entries at the columns where there is already a pivot. The first
+	//non-null entry without a pivot will become the pivot of the new row
+	for (u_int16_t column = 0; column < m_k; column++)
+	{
+		if (!v [column])
+		{
+			continue;
+		}
+
+		if (m_pivot [column])
+		{
+			if (payload)
+			{
+				m_field.MultiplyAddRegion (&m_scratchPayload [0], &m_payloads [column][0], v [column], m_payloadSize);
+			}
+			AddScaledRow (v, GetRow (column), v [column], column);
+		}
+		else
+		{
+			//Normalize, so that the pivot is equal to 1
+			u_int8_t inverse = m_field.Inv (v [column]);
+			u_int8_t *row = MutableRow (column);
+
+			std::fill (row, row + column, 0);
+			for (u_int16_t i = column; i < m_k; i++)
+			{
+				row [i] = m_field.Mul (inverse, v [i]);
+			}
+
+			if (payload)
+			{
+				m_payloads [column].assign (m_payloadSize, 0);
+				m_field.MultiplyAddRegion (&m_payloads [column][0], &m_scratchPayload [0], inverse, m_payloadSize);
+			}
+
+			m_pivot [column] = true;
+			m_unit [column] = IsUnitRow (column);
+			m_rank++;
+			return true;
+		}
+	}
+
+	//The vector has been reduced to zero --> Linearly dependent
+	return false;
+}
+
+void IntraFlowNetworkCodingDecoder::Solve ()
+{
+	NS_LOG_FUNCTION (this);
+
+	if (m_binary)
+	{
+		m_binaryMatrix.Solve ();
+		return;
+	}
+
+	m_pending.clear ();
+	for (u_int16_t column = 0; column < m_k; column++)
+	{
+		if (m_pivot [column] && !m_unit [column])
+		{
+			m_pending.push_back (column);
+		}
+	}
+
+	//Cancel the entries at the columns of the unit rows, which are left untouched
+	for (u_int16_t i = 0; i < m_pending.size (); i++)
+	{
+		u_int8_t *current = MutableRow (m_pending [i]);
+		for (u_int16_t column = m_pending [i] + 1; column < m_k; column++)
+		{
+			if (current [column] && m_unit [column])
+			{
+				if (m_payloadSize)
+				{
+					m_field.MultiplyAddRegion (&m_payloads [m_pending [i]][0], &m_payloads [column][0], current [column], m_payloadSize);
+				}
+				current [column] = 0;
+			}
+		}
+	}
+
+	//Backwards substitution among the remaining rows: remove the entries above every pivot, starting from the last one
+	for (int j = (int) m_pending.size () - 1; j > 0; j--)
+	{
+		u_int16_t column = m_pending [j];
+		const u_int8_t *pivotRow = GetRow (column);
+
+		for (int i = j - 1; i >= 0; i--)
+		{
+			u_int8_t *current = MutableRow (m_pending [i]);
+			if (current [column])
+			{
+				if (m_payloadSize)
+				{
+					m_field.MultiplyAddRegion (&m_payloads [m_pending [i]][0], &m_payloads [column][0], current [column], m_payloadSize);
+				}
+				AddScaledRow (current, pivotRow, current [column], column);
+			}
+		}
+	}
+
+	for (u_int16_t i = 0; i < m_pending.size (); i++)
+	{
+		m_unit [m_pending [i]] = IsUnitRow (m_pending [i]);
+	}
+}
+
+u_int16_t IntraFlowNetworkCodingDecoder::GetDecodedPrefix () const
+{
+	NS_ASSERT_MSG (!m_binary, "The decodable prefix is not available with the bit-packed GF(2) matrix");
+
+	//After Solve, the row of a recovered symbol has no entry beyond its pivot
+	for (u_int16_t column = 0; column < m_k; column++)
+	{
+		if (!m_pivot [column] || !m_unit [column])
+		{
+			return column;
+		}
+	}
+	return m_k;
+}
+
+void IntraFlowNetworkCodingDecoder::Shift (u_int16_t count)
+{
+	NS_LOG_FUNCTION (this << count);
+	NS_ASSERT_MSG (!m_binary, "The window cannot slide with the bit-packed GF(2) matrix");
+
+	count = std::min (count, m_k);
+	m_rank = 0;
+	for (u_int16_t column = 0; column < m_k; column++)
+	{
+		u_int8_t *row = MutableRow (column);
+		if (column + count < m_k && m_pivot [column + count])
+		{
+			const u_int8_t *source = GetRow (column + count);
+			std::copy (source + count, source + m_k, row);
+			std::fill (row + m_k - count, row + m_k, 0);
+			m_payloads [column].swap (m_payloads [column + count]);
+			m_pivot [column] = true;
+			m_unit [column] = m_unit [column + count];
+			m_rank++;
+		}
+		else
+		{
+			std::fill (row, row + m_k, 0);
+			m_payloads [column].clear ();
+			m_pivot [column] = false;
+			m_unit [column] = false;
+		}
+	}
+}
+
+void IntraFlowNetworkCodingDecoder::CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result) const
+{
+	NS_LOG_FUNCTION (this);
+
+	if (m_binary)
+	{
+		m_binaryMatrix.CombineRows (coefficients, result);
+		return;
+	}
+
+	result.assign (m_k, 0);
+
+	u_int16_t length = std::min ((u_int16_t) coefficients.size (), m_k);
+	for (u_int16_t column = 0; column < length; column++)
+	{
+		if (m_pivot [column] && coefficients [column])
+		{
+			AddScaledRow (&result [0], GetRow (column), coefficients [column], column);
+		}
+	}
+}
+
+void IntraFlowNetworkCodingDecoder::CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result, std::vector<u_int8_t> &payload) const
+{
+	NS_LOG_FUNCTION (this);
+
+	if (m_binary)
+	{
+		m_binaryMatrix.CombineRows (coefficients, result, payload);
+		return;
+	}
+
+	CombineRows (coefficients, result);
+	payload.assign (m_payloadSize, 0);
+
+	u_int16_t length = std::min ((u_int16_t) coefficients.size (), m_k);
+	for (u_int16_t column = 0; column < length && m_payloadSize; column++)
+	{
+		if (m_pivot [column] && coefficients [column])
+		{
+			m_field.MultiplyAddRegion (&payload [0], &m_payloads [column][0], coefficients [column], m_payloadSize);
+		}
+	}
+}
+
+std::vector<u_int8_t> &IntraFlowNetworkCodingScratchPool::Get (Slot slot, u_int32_t size)
+{
+	m_buffers [slot].assign (size, 0);
+	return m_buffers [slot];
+}
+
+u_int64_t IntraFlowNetworkCodingScratchPool::GetMemoryUsage () const
+{
+	u_int64_t bytes = 0;
+	for (u_int8_t i = 0; i < SLOTS; i++)
+	{
+		bytes += m_buffers [i].capacity ();
+	}
+	return bytes;
+}
+
+}	//End namespace ns3
@@ -0,0 +1,231 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef INTRA_FLOW_NETWORK_CODING_DECODER_H_
+#define INTRA_FLOW_NETWORK_CODING_DECODER_H_
+
+#include <sys/types.h>
+#include <vector>
+
+#include "galois-field.h"
+#include "gf2-matrix.h"
+
+namespace ns3 {
+
+/**
+ * Incremental Gaussian elimination over GF(2^q), used by the IntraFlowNetworkCodingProtocol to keep track of the rank of the
+ * coefficient matrix of each flow. Instead of storing the raw vectors and recomputing the rank of the whole K x K matrix upon
+ * each reception (O(K^3) per packet), every incoming vector is reduced against the rows already held, which are kept in row
+ * echelon form. Hence:
+ *  - Checking whether a vector is innovative (and storing it) costs O(K^2)
+ *  - Once the matrix is full, the decoding just needs a back-substitution (no explicit inversion is required)
+ * The rows are indexed by their pivot column, i.e. row i (if present) has a 1 at position i and 0 in the previous ones
+ * For q=1, the operations can be delegated to a bit-packed GF2Matrix (see Reset)
+ */
+class IntraFlowNetworkCodingDecoder
+{
+public:
+	/**
+	 * Default constructor
+	 */
+	IntraFlowNetworkCodingDecoder ();
+
+	/**
+	 * Start over the elimination (i.e. upon the reception of a new fragment)
+	 * \param k Fragment size (number of columns of the coefficient matrix)
+	 * \param q Field exponent, GF(2^q)
+	 * \param binary If true (and q=1), the bit-packed GF2Matrix is used instead of the byte-per-element rows
+	 */
+	void Reset (u_int16_t k, u_int8_t q, bool binary = false);
+
+	/**
+	 * Reduce a coefficient vector against the rows already stored; if it is linearly independent from them, it is added to the matrix
+	 * \param vector Coefficient vector (as extracted from the IntraFlowNetworkCodingHeader)
+	 * \param payload Coded payload carried along with the vector (it will undergo the same row operations). Null in the
+	 * coefficients-only mode
+	 * \param size Length of the coded payload (bytes)
+	 * \returns True if the vector is innovative (the rank has been increased); false otherwise
+	 */
+	bool AddVector (const std::vector<u_int8_t> &vector, const u_int8_t *payload = 0, u_int32_t size = 0);
+
+	/**
+	 * Back-substitution, to take the matrix from the row echelon form to the reduced one (i.e. the identity, when it is full-rank).
+	 * The unit rows (i.e. the natives of the systematic phase) are already solved, so only the rest of them are visited: their
+	 * entries at the unit columns are cancelled first, and then they are back-substituted among themselves. Hence, the cost only
+	 * depends on the number of missing natives
+	 */
+	void Solve ();
+
+	/**
+	 * Number of leading source symbols that can already be recovered, i.e. the columns 0..n-1 have a pivot and their rows do not
+	 * depend on any other column (not available in the binary mode). It is meant to be called after Solve, when the matrix is
+	 * not full yet (sliding window operation)
+	 * \returns The length of the decodable prefix
+	 */
+	u_int16_t GetDecodedPrefix () const;
+
+	/**
+	 * Drop the first "count" columns (along with their rows), moving the remaining ones towards the beginning of the matrix, so that
+	 * the decoding window slides forward without starting over the elimination (not available in the binary mode). The rows whose
+	 * pivot is beyond the dropped columns have zeros there (row echelon form), hence nothing is lost
+	 * \param count Number of columns to drop
+	 */
+	void Shift (u_int16_t count);
+
+	/**
+	 * Linear combination of the rows held by the decoder (used by the relay nodes to recode the information)
+	 * \param coefficients One coefficient for each of the K possible rows (the ones associated to empty rows are ignored)
+	 * \param result Reference of the vector in which the combination will be stored (K elements)
+	 */
+	void CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result) const;
+
+	/**
+	 * Same as above, but combining the payloads associated to the rows as well
+	 * \param coefficients One coefficient for each of the K possible rows (the ones associated to empty rows are ignored)
+	 * \param result Reference of the vector in which the combination will be stored (K elements)
+	 * \param payload Reference of the vector in which the combination of the payloads will be stored
+	 */
+	void CombineRows (const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &result, std::vector<u_int8_t> &payload) const;
+
+	/**
+	 * \returns The current rank of the coefficient matrix
+	 */
+	inline u_int16_t GetRank () const {return m_binary ? m_binaryMatrix.GetRank () : m_rank;}
+
+	/**
+	 * \returns The fragment size with which the decoder has been initialized
+	 */
+	inline u_int16_t GetK () const {return m_binary ? m_binaryMatrix.GetK () : m_k;}
+
+	/**
+	 * \returns True if the coefficient matrix is full-rank
+	 */
+	inline bool IsFull () const {return m_binary ? m_binaryMatrix.IsFull () : m_rank == m_k;}
+
+	/**
+	 * \param column Pivot column
+	 * \returns True if there is a row whose pivot is located at the given column
+	 */
+	inline bool HasPivot (u_int16_t column) const {return m_binary ? m_binaryMatrix.HasPivot (column) : m_pivot [column];}
+
+	/**
+	 * \param column Pivot column
+	 * \returns Pointer to the first element of the row whose pivot is located at the given column (not available in the binary mode)
+	 */
+	inline const u_int8_t *GetRow (u_int16_t column) const {return &m_storage [m_offset + column * m_stride];}
+
+	/**
+	 * \param column Pivot column
+	 * \returns The payload associated to the row whose pivot is located at the given column (after Solve, the source symbol
+	 * number "column")
+	 */
+	inline const std::vector<u_int8_t> &GetPayload (u_int16_t column) const
+	{
+		return m_binary ? m_binaryMatrix.GetPayload (column) : m_payloads [column];
+	}
+
+	/**
+	 * \returns The number of bytes currently allocated by the decoder (coefficient rows, payloads and working copies)
+	 */
+	u_int64_t GetMemoryUsage () const;
+
+private:
+	/**
+	 * \param column Pivot column
+	 * \returns Pointer to the first element of the row whose pivot is located at the given column
+	 */
+	inline u_int8_t *MutableRow (u_int16_t column) {return &m_storage [m_offset + column * m_stride];}
+
+	/**
+	 * dst [from..m_k) += c * src [from..m_k)
+	 */
+	void AddScaledRow (u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int16_t from) const;
+
+	/**
+	 * Make every stored payload (and the working copy) at least "size" bytes long, padding them with zeros
+	 */
+	void GrowPayloads (u_int32_t size);
+
+	/**
+	 * \returns True if the row whose pivot is located at the given column has no other entry (unit vector)
+	 */
+	bool IsUnitRow (u_int16_t column) const;
+
+	bool m_binary;							//Delegate to m_binaryMatrix (q=1)
+	GF2Matrix m_binaryMatrix;
+
+	GaloisField m_field;
+	u_int16_t m_k;
+	u_int16_t m_rank;
+
+	//K x K matrix (row-major), row i holds the vector whose pivot is at column i. The storage is owned by the decoder and reused
+	//across the fragments of the flow (it is only reallocated when K grows); the first row starts at a cache line boundary and
+	//the rest are padded, so that the region kernels always work on aligned rows
+	static const u_int32_t CACHE_LINE = 64;
+	static const u_int16_t ROW_ALIGNMENT = 16;
+	std::vector<u_int8_t> m_storage;
+	u_int32_t m_offset;						//Position of the first (aligned) row within m_storage
+	u_int16_t m_stride;						//Distance between consecutive rows (K, rounded up to ROW_ALIGNMENT)
+	std::vector<bool> m_pivot;				//m_pivot [i] is true if row i is in use
+	std::vector<bool> m_unit;				//m_unit [i] is true if row i is a unit vector (it is already solved)
+	std::vector<u_int16_t> m_pending;		//Pivots of the rows which are not unit vectors (working list of Solve)
+	std::vector<u_int8_t> m_scratch;		//Working copy of the incoming vector
+
+	u_int32_t m_payloadSize;							//Length of the (zero-padded) coded payloads
+	std::vector<std::vector<u_int8_t> > m_payloads;		//Payload associated to each row (empty in the coefficients-only mode)
+	std::vector<u_int8_t> m_scratchPayload;				//Working copy of the incoming payload
+};
+
+/**
+ * Node-wide scratch buffers of the IntraFlowNetworkCodingProtocol (coded payloads and coefficient vectors built or extracted
+ * while processing a packet). They are only needed during a single call, hence all the flows share them, and they keep their
+ * capacity, so that the per-packet processing does not allocate memory once the largest size has been seen
+ */
+class IntraFlowNetworkCodingScratchPool
+{
+public:
+	enum Slot
+	{
+		PAYLOAD = 0,			//Coded payload (encoding, recoding or reception)
+		SYMBOL,					//Source symbol
+		VECTOR,					//Coefficient vector
+		SLOTS
+	};
+
+	/**
+	 * \param slot Buffer to use (two nested operations must never use the same one)
+	 * \param size Required length
+	 * \returns The buffer, resized to "size" and filled with zeros
+	 */
+	std::vector<u_int8_t> &Get (Slot slot, u_int32_t size);
+
+	/**
+	 * \returns The number of bytes currently allocated by the pool
+	 */
+	u_int64_t GetMemoryUsage () const;
+
+private:
+	std::vector<u_int8_t> m_buffers [SLOTS];
+};
+
+}	//End namespace ns3
+
+#endif /* INTRA_FLOW_NETWORK_CODING_DECODER_H_ */
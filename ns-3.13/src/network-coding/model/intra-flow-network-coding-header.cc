@@ -30,7 +30,7 @@
 
 #include <cstdlib>
 #include <iostream>       // std::cout
-#include <bitset>         // std::bitset
+#include <algorithm>
 
 #include <ctime>
 #include <math.h>
@@ -43,6 +43,9 @@ using namespace std;
 NS_LOG_COMPONENT_DEFINE ("IntraFlowNetworkCodingHeader");
 NS_OBJECT_ENSURE_REGISTERED (IntraFlowNetworkCodingHeader);
 
+//Since Q <= 8, the most significant bit of the Q field is used to signal the seeded vectors
+static const u_int8_t SEEDED_VECTOR_FLAG = 0x80;
+
 IntraFlowNetworkCodingHeader::IntraFlowNetworkCodingHeader()
 {
 	NS_LOG_FUNCTION(this);
@@ -52,6 +55,8 @@ IntraFlowNetworkCodingHeader::IntraFlowNetworkCodingHeader()
     m_tx = 0;
     m_sourcePort = 0;
     m_destinationPort = 0;
+    m_seeded = false;
+    m_seed = 0;
 }
 
 IntraFlowNetworkCodingHeader::~IntraFlowNetworkCodingHeader()
@@ -79,7 +84,11 @@ uint32_t IntraFlowNetworkCodingHeader::GetSerializedSize (void) const
 	NS_LOG_FUNCTION (this);
 
 		//New header
-		return (9 + (u_int8_t) ceil ((double) (m_k * m_q) / 8.0));
+		if (m_k && m_seeded)
+		{
+			return 9 + 4;
+		}
+		return 9 + (m_k * m_q + 7) / 8;
 }
 
  u_int16_t IntraFlowNetworkCodingHeader::GetK() const
@@ -152,6 +161,44 @@ const std::vector<u_int8_t>& IntraFlowNetworkCodingHeader::GetVector() const
 void IntraFlowNetworkCodingHeader::SetVector(const std::vector<u_int8_t>& vector)
 {
 	m_vector = vector;
+	m_seeded = false;
+}
+
+void IntraFlowNetworkCodingHeader::SetSeed (u_int32_t seed)
+{
+	m_seed = seed;
+	m_seeded = true;
+	GenerateVector (m_seed, m_k, m_q, m_vector);
+}
+
+u_int32_t IntraFlowNetworkCodingHeader::GetSeed () const
+{
+	return m_seed;
+}
+
+bool IntraFlowNetworkCodingHeader::IsSeeded () const
+{
+	return m_seeded;
+}
+
+void IntraFlowNetworkCodingHeader::GenerateVector (u_int32_t seed, u_int16_t k, u_int8_t q, std::vector<u_int8_t>& vector)
+{
+	//Xorshift32 generator (Marsaglia), seeded through a multiplicative hash, so that consecutive seeds do not yield correlated
+	//vectors; the coefficients are taken from the most significant bits. It only relies on 32-bit unsigned arithmetic
+	u_int32_t state = (seed ^ 0x5BD1E995) * 2654435761U;
+	if (!state)
+	{
+		state = 0x9E3779B9;			//The null state is a fixed point
+	}
+
+	vector.resize (k);
+	for (u_int16_t i = 0; i < k; i++)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		vector [i] = state >> (32 - q);
+	}
 }
 
 void IntraFlowNetworkCodingHeader::Serialize (Buffer::Iterator start) const
@@ -161,32 +208,66 @@ void IntraFlowNetworkCodingHeader::Serialize (Buffer::Iterator start) const
 
 	//Fixed-size header
 	i.WriteU8 (m_k);
-	i.WriteU8 (m_q);
+	i.WriteU8 (m_seeded ? m_q | SEEDED_VECTOR_FLAG : m_q);
 	i.WriteU16 (m_nfrag);
 	i.WriteU8 (m_tx);
 	i.WriteU16 (m_sourcePort);
 	i.WriteU16 (m_destinationPort);
 
-    std::bitset <8160> binaryVector;
-    for (u_int32_t i=0; i<m_k; i++)
-    {
-        std::bitset<8160> temp (m_vector[i]);
-        temp <<= i*m_q;
-        binaryVector |= temp;
-    }
-	std::bitset <8160> maskHeader (255);
-	std::vector <u_int8_t> headerVector;
-	for (u_int32_t i=0; i < ceil((float) (m_k*m_q)/8); i++)
+	if (m_k && m_seeded)
 	{
-		headerVector.push_back((binaryVector & maskHeader).to_ulong());
-		binaryVector >>= 8;
+		i.WriteHtonU32 (m_seed);
+		return;
 	}
-	if (m_k)
+
+	//Coefficient i takes bits [i*q, (i+1)*q) of the vector field, which is written LSB first
+	u_int8_t mask = (1 << m_q) - 1;
+	u_int16_t length = std::min ((u_int16_t) m_vector.size (), m_k);		//Missing coefficients are sent as zeros
+	u_int16_t k = 0;
+
+	switch (m_q)
 	{
-		for (u_int8_t count = 0; count < headerVector.size(); count ++)
+	case 8:
+		for (; k < length; k++)
+		{
+			i.WriteU8 (m_vector [k]);
+		}
+		break;
+	case 4:
+		for (; k + 2 <= length; k += 2)
 		{
-			i.WriteU8 (headerVector [count]);
+			i.WriteU8 ((m_vector [k] & 0x0F) | (m_vector [k + 1] << 4));
 		}
+		break;
+	case 1:
+		for (; k + 8 <= length; k += 8)
+		{
+			const u_int8_t *v = &m_vector [k];
+			i.WriteU8 ((v [0] & 1) | (v [1] & 1) << 1 | (v [2] & 1) << 2 | (v [3] & 1) << 3 |
+					(v [4] & 1) << 4 | (v [5] & 1) << 5 | (v [6] & 1) << 6 | (v [7] & 1) << 7);
+		}
+		break;
+	default:
+		break;
+	}
+
+	//Generic path (and tail of the fast ones, which always stop at a byte boundary)
+	u_int32_t accumulator = 0;
+	u_int8_t bits = 0;
+	for (; k < m_k; k++)
+	{
+		accumulator |= (u_int32_t) ((k < length) ? m_vector [k] & mask : 0) << bits;
+		bits += m_q;
+		while (bits >= 8)
+		{
+			i.WriteU8 (accumulator & 0xFF);
+			accumulator >>= 8;
+			bits -= 8;
+		}
+	}
+	if (bits)
+	{
+		i.WriteU8 (accumulator & 0xFF);
 	}
 }
 
@@ -201,30 +282,62 @@ u_int32_t IntraFlowNetworkCodingHeader::Deserialize (Buffer::Iterator start)
 	m_tx = i.ReadU8 ();
 	m_sourcePort = i.ReadU16();
 	m_destinationPort = i.ReadU16();
-	std::vector <u_int8_t> headerVector;
 
-	if (m_k)
+	m_seeded = m_q & SEEDED_VECTOR_FLAG;
+	m_q &= ~SEEDED_VECTOR_FLAG;
+	if (m_k && m_seeded)
 	{
-		vector<u_int8_t> codedVector;
-		for( int j=0; j<ceil((float) (m_k*m_q)/8); j++)
-		{
-			u_int8_t temp = i.ReadU8();
-			headerVector.push_back(temp);
-		}
+		SetSeed (i.ReadNtohU32 ());
+		return GetSerializedSize ();
 	}
 
-	std::bitset <8160> deserializedVector;
-	 std::bitset <8160> mask (pow(2,m_q)-1);
-	for (u_int32_t i=0; i<headerVector.size(); i++)
+	u_int8_t mask = (1 << m_q) - 1;
+	u_int16_t k = 0;
+	m_vector.resize (m_k);
+
+	switch (m_q)
 	{
-		std::bitset<8160> temp (headerVector[i]);
-		temp <<= i*8;
-		deserializedVector |= temp;
+	case 8:
+		for (; k < m_k; k++)
+		{
+			m_vector [k] = i.ReadU8 ();
+		}
+		break;
+	case 4:
+		for (; k + 2 <= m_k; k += 2)
+		{
+			u_int8_t byte = i.ReadU8 ();
+			m_vector [k] = byte & 0x0F;
+			m_vector [k + 1] = byte >> 4;
+		}
+		break;
+	case 1:
+		for (; k + 8 <= m_k; k += 8)
+		{
+			u_int8_t byte = i.ReadU8 ();
+			for (u_int8_t b = 0; b < 8; b++)
+			{
+				m_vector [k + b] = (byte >> b) & 1;
+			}
+		}
+		break;
+	default:
+		break;
 	}
-	for (u_int8_t i=0; i< m_k; i++)
+
+	//Generic path (and tail of the fast ones)
+	u_int32_t accumulator = 0;
+	u_int8_t bits = 0;
+	for (; k < m_k; k++)
 	{
-		m_vector.push_back ((deserializedVector & mask).to_ulong());
-		deserializedVector >>= m_q;
+		if (bits < m_q)
+		{
+			accumulator |= (u_int32_t) i.ReadU8 () << bits;
+			bits += 8;
+		}
+		m_vector [k] = accumulator & mask;
+		accumulator >>= m_q;
+		bits -= m_q;
 	}
 
 	return GetSerializedSize ();
@@ -233,6 +346,10 @@ u_int32_t IntraFlowNetworkCodingHeader::Deserialize (Buffer::Iterator start)
  void IntraFlowNetworkCodingHeader::Print (std::ostream &os) const
 {
 	os << " Tx= " << (int) m_tx << " k= " << (int) m_k << " q= " << (int)m_q << " Source Port " << m_sourcePort << " Destination Port " << m_destinationPort << " Nº Fragmento= " << (int) m_nfrag;
+	if (m_seeded)
+	{
+		os << " Seed " << m_seed;
+	}
 	os << " Vector ";
 
 	for (u_int8_t i = 0; i < m_vector.size(); i++)
@@ -36,9 +36,6 @@
 #include <stdio.h>
 #include <iostream>
 
-
-#include <openssl/md5.h> //Open SSL library --> Needed for hashing
-
 namespace ns3 {
 
 class IntraFlowNetworkCodingHeader:  public Header
@@ -75,6 +72,27 @@ public:
 	virtual const std::vector<u_int8_t>& GetVector() const;
 	void SetVector(const std::vector<u_int8_t>& vector);
 
+	/**
+	 * Compact form of the coefficient vector: only a 32-bit seed is sent, and the receivers regenerate the vector out of it
+	 * (see GenerateVector). K and Q must have been set beforehand
+	 * \param seed Seed of the coefficient generator
+	 */
+	void SetSeed (u_int32_t seed);
+	u_int32_t GetSeed () const;
+	/**
+	 * \returns True if the coefficient vector is carried as a seed; false if it is explicitly sent (i.e. recoded packets)
+	 */
+	bool IsSeeded () const;
+
+	/**
+	 * Deterministic (and platform independent) coefficient generator, shared by the sources and the receivers of seeded headers
+	 * \param seed Seed of the generator
+	 * \param k Number of coefficients
+	 * \param q Field exponent, GF(2^q)
+	 * \param vector Reference of the vector in which the coefficients will be stored
+	 */
+	static void GenerateVector (u_int32_t seed, u_int16_t k, u_int8_t q, std::vector<u_int8_t>& vector);
+
 	//Inherited methods from base class "Header" (pure virtual)
 	virtual uint32_t GetSerializedSize (void) const;
 	virtual void Serialize (Buffer::Iterator start) const;
@@ -91,6 +109,8 @@ private:
 	u_int16_t m_destinationPort;
 
 	std::vector <u_int8_t> m_vector;       // Coefficients vector
+	bool m_seeded;							// The vector is sent as a seed (flagged with the MSB of the Q field)
+	u_int32_t m_seed;
 };
 
 
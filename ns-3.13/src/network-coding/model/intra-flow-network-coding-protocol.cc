@@ -40,15 +40,15 @@
 #include <cstdlib>
 #include <iostream>
 #include <bitset>
+#include <algorithm>
 
 #include <vector>
 #include <cmath>
 
-#include "ns3/hash-id.h"
+#include "ns3/network-coding-flow-tag.h"
 
 using namespace ns3;
 using namespace std;
-using namespace itpp;
 
 NS_LOG_COMPONENT_DEFINE ("IntraFlowNetworkCodingProtocol");
 NS_OBJECT_ENSURE_REGISTERED (IntraFlowNetworkCodingProtocol);
@@ -68,7 +68,7 @@ IntraFlowNetworkCodingBufferItem::IntraFlowNetworkCodingBufferItem ()
 	destinationPort=0;
 }
 
-IntraFlowNetworkCodingStatistics::IntraFlowNetworkCodingStatistics():  txNumber(0), rxNumber(0), downNumber(0), upNumber(0)
+IntraFlowNetworkCodingStatistics::IntraFlowNetworkCodingStatistics():  txNumber(0), rxNumber(0), downNumber(0), upNumber(0), headerBytes(0), memoryBytes(0)
 {
 	timestamp.clear();
 	rankTime.clear();
@@ -90,7 +90,10 @@ IntraFlowNetworkCodingMapParameters::IntraFlowNetworkCodingMapParameters ()
 	m_rank=0;
 	m_fragmentNumber=0;
 	m_txCounter = 0;
+	m_systematicOffset = 0;
 	m_forwardingNode = false;
+	m_generationStarted = false;
+	m_generation = 0;
 }
 
 IntraFlowNetworkCodingMapParameters::~IntraFlowNetworkCodingMapParameters ()
@@ -120,16 +123,37 @@ TypeId IntraFlowNetworkCodingProtocol::GetTypeId (void)
 				BooleanValue (false),
 				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_recode),
 				MakeBooleanChecker ())
-	.AddAttribute ("Itpp",
-				"Enable/disable the use of the IT++ library to operate with GF(2) ",
+	.AddAttribute ("BitPackedGf2",
+				"Enable/disable the bit-packed GF(2) matrix (instead of the byte-per-element decoder) when Q=1",
 				BooleanValue (true),
-				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_itpp),
+				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_bitPackedGf2),
 				MakeBooleanChecker ())
 	.AddAttribute ("BufferTimeout",
 				"Time during which the protocol will wait until the buffer has at least K packets",
 				TimeValue (MilliSeconds(1000)),
 				MakeTimeAccessor (&IntraFlowNetworkCodingProtocol::m_bufferTimeout),
 				MakeTimeChecker())
+	.AddAttribute ("CodePayload",
+				"Actually combine the payloads (true) or just send the coefficient vectors within empty packets (false, cheaper for large sweeps)",
+				BooleanValue (false),
+				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_codePayload),
+				MakeBooleanChecker ())
+	.AddAttribute ("SeededVectors",
+				"Send a 32-bit seed instead of the whole coefficient vector in the packets coded at the source (recoded ones always carry the explicit vector)",
+				BooleanValue (false),
+				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_seededVectors),
+				MakeBooleanChecker ())
+	.AddAttribute ("Scheme",
+				"Generation-based coding (Block) or coding over a sliding window of at most K unacknowledged packets, delivered in order (SlidingWindow, relays do not recode)",
+				EnumValue (IntraFlowNetworkCodingProtocol::BLOCK_CODING),
+				MakeEnumAccessor (&IntraFlowNetworkCodingProtocol::m_scheme),
+				MakeEnumChecker (IntraFlowNetworkCodingProtocol::BLOCK_CODING, "Block",
+						IntraFlowNetworkCodingProtocol::SLIDING_WINDOW, "SlidingWindow"))
+	.AddAttribute ("Systematic",
+				"Send the packets of each fragment (or window) uncoded before the random combinations, so that the sinks can deliver them straight away",
+				BooleanValue (false),
+				MakeBooleanAccessor (&IntraFlowNetworkCodingProtocol::m_systematic),
+				MakeBooleanChecker ())
 				;
 	return tid;
 }
@@ -208,7 +232,7 @@ void IntraFlowNetworkCodingProtocol::NotifyNewAggregate()
 void IntraFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet, Ipv4Address source, Ipv4Address destination, uint8_t protocol, Ptr<Ipv4Route> route)
 {
 	UdpHeader udpHeader;
-	u_int16_t flowId;
+	FlowKey flowId;
 	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters;
 
 	IntraFlowMapIterator it;
@@ -216,7 +240,7 @@ void IntraFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet,
 	if (packet-> GetSize() >250)
 	{
 		packet->PeekHeader (udpHeader);
-		flowId= HashID (source, destination, udpHeader.GetSourcePort(), udpHeader.GetDestinationPort());
+		flowId= FlowKey (source, destination, udpHeader.GetSourcePort(), udpHeader.GetDestinationPort());
 
 		it=m_mapParameters.find(flowId);
 		if (it==m_mapParameters.end())
@@ -227,7 +251,7 @@ void IntraFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet,
 			aux->m_fragmentNumber = 0;
 			aux->m_txCounter = 0;
 			aux->m_forwardingNode = false;
-			m_mapParameters.insert(pair<u_int16_t, Ptr<IntraFlowNetworkCodingMapParameters> >(make_pair(flowId, aux)));
+			m_mapParameters.insert (make_pair (flowId, aux));
 		}
 
 		it=m_mapParameters.find(flowId);
@@ -235,12 +259,13 @@ void IntraFlowNetworkCodingProtocol::ReceiveFromUpperLayer (Ptr<Packet> packet,
 
 		mapParameters->m_txBuffer.push_back(IntraFlowNetworkCodingBufferItem(packet, source, destination, udpHeader.GetSourcePort(), udpHeader.GetDestinationPort()));
 
-		if (mapParameters->m_txBuffer.size() < mapParameters->m_k)
+		if (m_scheme == SLIDING_WINDOW)		// No need to wait for K packets, the new one is straight included within the window
 		{
-			if (!m_reduceBufferEvent.IsRunning())  // Used for the timer of ReduceBuffer() method which is created when there are less than k packets left
-			{
-				m_reduceBufferEvent = Simulator::Schedule (m_bufferTimeout, &IntraFlowNetworkCodingProtocol::ReduceBuffer, this, flowId);
-			}
+			Encode(flowId);
+		}
+		else if (mapParameters->m_txBuffer.size() < mapParameters->m_k)
+		{
+			StartBufferTimer (flowId);  // Used for the timer of ReduceBuffer() method which is created when there are less than k packets left
 		}
 		else // In case there are not enough packets to encode
 		{
@@ -274,6 +299,8 @@ void IntraFlowNetworkCodingProtocol::SendToLowerLayer(Ptr<Ipv4Route> rtentry, Pt
 void IntraFlowNetworkCodingProtocol::DoDispose (void)
 {
 	NS_LOG_FUNCTION_NOARGS();
+	m_timerEvent.Cancel();
+	m_timerQueue.clear();
 }
 
 int IntraFlowNetworkCodingProtocol::GetProtocolNumber (void) const
@@ -282,7 +309,7 @@ int IntraFlowNetworkCodingProtocol::GetProtocolNumber (void) const
 	return PROT_NUMBER;
 }
 
-void IntraFlowNetworkCodingProtocol::Encode (u_int16_t flowId)
+void IntraFlowNetworkCodingProtocol::Encode (FlowKey flowId)
 {
 	NS_LOG_FUNCTION (Simulator::Now().GetSeconds() << this );
 
@@ -296,20 +323,22 @@ void IntraFlowNetworkCodingProtocol::Encode (u_int16_t flowId)
 	it=m_mapParameters.find(flowId);
 	mapParameters=it->second;
 
-	if ((mapParameters->m_txBuffer.size() >= mapParameters->m_k) && (mapParameters->m_txCounter <= 5) && (!mapParameters->m_forwardingNode))
+	//Number of packets combined: a whole fragment, or the current window (up to K unacknowledged packets)
+	u_int16_t count = mapParameters->m_k;
+	if (m_scheme == SLIDING_WINDOW)
 	{
-		if (m_reduceBufferEvent.IsRunning())
-		{
-			m_reduceBufferEvent.Cancel();
-		}
+		count = std::min ((size_t) mapParameters->m_k, mapParameters->m_txBuffer.size());
+	}
+
+	if (count && (mapParameters->m_txBuffer.size() >= count) && (mapParameters->m_txCounter <= 5) && (!mapParameters->m_forwardingNode))
+	{
+		StopBufferTimer (mapParameters);
 
 //		if(mapParameters->m_txBuffer.size()>0)	// This is because sometimes the MORE buffer is empty
 		{
-			codedPacket = Create <Packet> (mapParameters->m_txBuffer[0].packet->GetSize()); // Packet creation with the buffer packet size
-
-			ncHeader.SetK (mapParameters->m_k);
+			ncHeader.SetK (count);
 			ncHeader.SetQ (m_q);
-			ncHeader.SetNfrag (mapParameters->m_fragmentNumber);
+			ncHeader.SetNfrag (mapParameters->m_fragmentNumber);		// Fragment number or window head
 			ncHeader.SetTx (0);
 
 
@@ -317,9 +346,48 @@ void IntraFlowNetworkCodingProtocol::Encode (u_int16_t flowId)
 			ncHeader.SetSourcePort (mapParameters->m_txBuffer[0].sourcePort);
 			ncHeader.SetDestinationPort (mapParameters->m_txBuffer[0].destinationPort);
 
-			GenerateRandomVector(mapParameters->m_k, randomVector);
+			u_int32_t seed = 0;
+			bool native = m_systematic && mapParameters->m_systematicOffset < count;
+			if (native)
+			{
+				//Unit vector (it cannot be regenerated from a seed, hence it is always sent explicitly)
+				randomVector.assign (count, 0);
+				randomVector[mapParameters->m_systematicOffset] = 1;
+			}
+			else if (m_seededVectors)
+			{
+				//Draw seeds until the regenerated vector is not null
+				UniformVariable random (0, 4294967296.0);
+				do
+				{
+					seed = (u_int32_t) random.GetValue();
+					IntraFlowNetworkCodingHeader::GenerateVector (seed, count, m_q, randomVector);
+				} while (std::count (randomVector.begin(), randomVector.end(), 0) == (int) randomVector.size());
+			}
+			else
+			{
+				GenerateRandomVector(count, randomVector);
+			}
 
-			ncHeader.SetVector(randomVector);
+			if (m_codePayload)
+			{
+				std::vector<u_int8_t> &payload = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::PAYLOAD, 0);
+				EncodePayload (mapParameters, randomVector, payload);
+				codedPacket = Create <Packet> (&payload[0], payload.size());
+			}
+			else
+			{
+				codedPacket = Create <Packet> (mapParameters->m_txBuffer[0].packet->GetSize()); // Packet creation with the buffer packet size
+			}
+
+			if (m_seededVectors && !native)
+			{
+				ncHeader.SetSeed (seed);
+			}
+			else
+			{
+				ncHeader.SetVector(randomVector);
+			}
 			randomVector.clear (); // Erasure of the random vector
 			codedPacket->AddHeader (ncHeader); // Adding the MORE header to the packet
 
@@ -328,16 +396,56 @@ void IntraFlowNetworkCodingProtocol::Encode (u_int16_t flowId)
 				m_ncCallback(codedPacket, 0, m_node->GetId(),mapParameters->m_txBuffer[0].source,mapParameters->m_txBuffer[0].destination);
 			}
 
+			//Flow identifier, so that the WiFi queue can flush the packet without parsing it
+			codedPacket->AddPacketTag (NetworkCodingFlowTag (FlowKey (mapParameters->m_txBuffer[0].source, mapParameters->m_txBuffer[0].destination,
+					ncHeader.GetSourcePort(), ncHeader.GetDestinationPort())));
+
 			Ipv4L4Protocol::DownTargetCallback downTarget = GetDownTarget();
 			downTarget (codedPacket, mapParameters->m_txBuffer[0].source,mapParameters->m_txBuffer[0].destination, IntraFlowNetworkCodingProtocol::PROT_NUMBER, 0); // The node 0 is taken because there are only 2 nodes
 
 			//Increase the transmission counter (Wifi buffer counter)
 			mapParameters->m_txCounter++;
+			if (native)
+			{
+				mapParameters->m_systematicOffset++;
+			}
 		}
 	}
 }
 
-void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
+void IntraFlowNetworkCodingProtocol::EncodePayload (Ptr<IntraFlowNetworkCodingMapParameters> mapParameters, const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &payload)
+{
+	NS_LOG_FUNCTION (this);
+
+	GaloisField field (m_q);
+	u_int32_t size = 0;
+
+	//Every source symbol is made of the length of the datagram (2 bytes) plus its content, padded with zeros up to the longest one
+	for (u_int16_t i = 0; i < coefficients.size(); i++)
+	{
+		size = std::max (size, mapParameters->m_txBuffer[i].packet->GetSize() + 2);
+	}
+	size = field.GetRegionSize (size);
+
+	payload.assign (size, 0);
+	std::vector<u_int8_t> &symbol = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::SYMBOL, size);
+
+	for (u_int16_t i = 0; i < coefficients.size(); i++)
+	{
+		if (coefficients[i])
+		{
+			u_int16_t length = mapParameters->m_txBuffer[i].packet->GetSize();
+			symbol[0] = length >> 8;
+			symbol[1] = length & 0xFF;
+			mapParameters->m_txBuffer[i].packet->CopyData (&symbol[2], length);
+
+			field.MultiplyAddRegion (&payload[0], &symbol[0], coefficients[i], field.GetRegionSize (length + 2));
+			std::fill (symbol.begin(), symbol.begin() + length + 2, 0);
+		}
+	}
+}
+
+void IntraFlowNetworkCodingProtocol::Recode (FlowKey flowId)
 {
 	IntraFlowMapIterator it;
 	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters;
@@ -347,9 +455,6 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 	std::vector<u_int8_t> recodedVector;
 	bool exit = false;
 
-	int gf=pow(2,m_q);
-	Field GF(gf);
-
 	it=m_mapParameters.find (flowId);
 	mapParameters=it->second;
 
@@ -357,14 +462,11 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 	NS_LOG_FUNCTION (Simulator::Now().GetSeconds() << this );
 	if(mapParameters->m_txCounter <= 1 && mapParameters->m_rank >= 2)
 	{
-		if (m_reduceBufferEvent.IsRunning())
-		{
-			m_reduceBufferEvent.Cancel();
-		}
+		StopBufferTimer (mapParameters);
 
 		if(mapParameters->m_txBuffer.size()>0)	// This is because sometimes the MORE buffer is empty
 		{
-			codedPacket = Create <Packet> (mapParameters->m_txBuffer[0].packet->GetSize()); // Packet creation with the buffer packet size
+			std::vector<u_int8_t> &payload = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::PAYLOAD, 0);
 			//moreHeader.SetProtocolNumber (17); // The number of protocol is established
 
 			ncHeader.SetK (mapParameters->m_k);
@@ -379,45 +481,14 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 			while(!exit)
 			{
 				GenerateRandomVector(mapParameters->m_k, randomVector);
-				if(m_q==1 && m_itpp==1)
+				//Random combination of the rows held by the decoder (they span the same subspace as the received vectors)
+				if (m_codePayload)
 				{
-					itpp::bvec recodedVectorItpp;
-					itpp::bvec randomVectorItpp;
-
-					for(u_int8_t i = 0; i < randomVector.size(); i++)
-					{
-						int valuen= randomVector [i];
-						randomVectorItpp.ins (i,valuen);
-					}
-
-					recodedVectorItpp = mapParameters->m_vectorMatrix.transpose() * randomVectorItpp; // We use the transpose because itpp only has the operator to do "matrix*vector" and not "vector*matrix"
-					for(u_int8_t i = 0; i < randomVector.size(); i++)
-					{
-						int value = (int)recodedVectorItpp [i];
-						recodedVector.push_back(value);
-					}
+					mapParameters->m_decoder.CombineRows (randomVector, recodedVector, payload);
 				}
 				else
 				{
-					Field::Element *randomVectorGf=(Field::Element *) calloc(m_k, sizeof (Field::Element));
-					Field::Element *recodedVectorGf=(Field::Element *) calloc(m_k, sizeof (Field::Element));
-
-					for(u_int8_t i = 0; i < randomVector.size(); i++)
-					{
-						int valuen= randomVector [i];
-						GF.init (randomVectorGf[i], valuen);
-					}
-					FFLAS::fgemm (GF, FflasNoTrans, FflasNoTrans, 1, mapParameters->m_k, mapParameters->m_k, 1,
-							randomVectorGf, mapParameters->m_k, mapParameters->m_vectorMatrixGf,
-							mapParameters->m_k, 0, recodedVectorGf, mapParameters->m_k);
-
-					for(u_int8_t i = 0; i < randomVector.size(); i++)
-					{
-						int value = (int) recodedVectorGf [i];
-						recodedVector.push_back (value);
-					}
-					free (randomVectorGf);
-					free (recodedVectorGf);
+					mapParameters->m_decoder.CombineRows (randomVector, recodedVector);
 				}
 				if (recodedVector == zeros)
 				{
@@ -430,6 +501,15 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 				}
 			}
 
+			if (m_codePayload)
+			{
+				codedPacket = Create <Packet> (&payload[0], payload.size());
+			}
+			else
+			{
+				codedPacket = Create <Packet> (mapParameters->m_txBuffer[0].packet->GetSize()); // Packet creation with the buffer packet size
+			}
+
 			ncHeader.SetVector(recodedVector);
 			randomVector.clear (); // Erasure of the random vector
 			recodedVector.clear ();
@@ -441,6 +521,10 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 
 			codedPacket->AddHeader (ncHeader); // Adding the MORE header to the packet
 
+			//Flow identifier, so that the WiFi queue can flush the packet without parsing it
+			codedPacket->AddPacketTag (NetworkCodingFlowTag (FlowKey (mapParameters->m_txBuffer[0].source, mapParameters->m_txBuffer[0].destination,
+					ncHeader.GetSourcePort(), ncHeader.GetDestinationPort())));
+
 			Ipv4L4Protocol::DownTargetCallback downTarget = GetDownTarget();
 			downTarget (codedPacket, mapParameters->m_txBuffer[0].source,mapParameters->m_txBuffer[0].destination, IntraFlowNetworkCodingProtocol::PROT_NUMBER, 0); // The node 0 is taken because there are only 2 nodes
 
@@ -450,21 +534,12 @@ void IntraFlowNetworkCodingProtocol::Recode (u_int16_t flowId)
 	}
 }
 
-void IntraFlowNetworkCodingProtocol::Decode(Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, u_int16_t flowId)
+void IntraFlowNetworkCodingProtocol::Decode(Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, FlowKey flowId)
 {
 	NS_LOG_FUNCTION_NOARGS();
 
 	//Specific variable definition
-	Field::Element *vectorMatrix_inverse=(Field::Element *) calloc(m_k * m_k, sizeof (Field::Element));
-	Field::Element *vectorMatrixGf_copy=(Field::Element *) calloc(m_k * m_k, sizeof (Field::Element));
-	Field::Element *zeroMatrix=(Field::Element *) calloc(m_k * m_k, sizeof (Field::Element));
-	Field::Element *eye=(Field::Element *) calloc(m_k * m_k,  sizeof (Field::Element));
-	int nullity;
-	int gf=pow(2, m_q);
-	Field GF(gf);
-
 	struct timeval startTime, endTime;
-	IntraFlowNetworkCodingBufferItem item;
 
 	u_int16_t sourcePort=0;
 	u_int16_t destinationPort=0;
@@ -475,57 +550,29 @@ void IntraFlowNetworkCodingProtocol::Decode(Ipv4Header const &header, Ptr<Ipv4In
 	it=m_mapParameters.find(flowId);
 	mapParameters=it->second;
 
-	if(m_q==1 && m_itpp==true)
+	//The coefficient matrix is already in row echelon form, so a back-substitution is enough (no need to invert it). If all the
+	//natives have been received, everything has already been delivered
+	gettimeofday(&startTime, NULL);
+	if (std::count (mapParameters->m_nativeDelivered.begin(), mapParameters->m_nativeDelivered.end(), false))
 	{
-		gettimeofday(&startTime, NULL);
-		GF2mat inverse = mapParameters->m_vectorMatrix.inverse();
-		gettimeofday(&endTime, NULL);
+		mapParameters->m_decoder.Solve ();
 	}
-	else
-	{
+	gettimeofday(&endTime, NULL);
 
-		FFLAS::fzero(GF, mapParameters->m_k, mapParameters->m_k, zeroMatrix, mapParameters->m_k);
-		FFLAS::fadd(GF, mapParameters->m_k, mapParameters->m_k, mapParameters->m_vectorMatrixGf, mapParameters->m_k, zeroMatrix, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-		gettimeofday(&startTime, NULL);
-		FFPACK::Invert(GF,mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k, vectorMatrix_inverse, mapParameters->m_k, nullity);
-		gettimeofday(&endTime, NULL);
-		//FFLAS::fgemm(GF, FflasNoTrans, FflasNoTrans, mapParameters->m_k, mapParameters->m_k, mapParameters->m_k, 1, mapParameters->m_vectorMatrixGf, mapParameters->m_k, vectorMatrix_inverse, mapParameters->m_k, 0, eye, mapParameters->m_k);
-
-		free (eye);
-		free(vectorMatrixGf_copy);
-		free(vectorMatrix_inverse);
-		free(zeroMatrix);
-	}
 	m_stats.inverseTime.push_back(1000*timeval_diff(&endTime, &startTime)); 	// Inverse times in ms
 	m_stats.timestamp.push_back(Simulator::Now().GetSeconds()); 				// The end time is the last one
 
 
 	for (u_int8_t r=0; r < mapParameters->m_rxBuffer.size(); r++)					// Sending the packet to the upper layers
 	{
-		Ptr<Packet> copy = mapParameters->m_rxBuffer[r].packet->Copy(); 			// Copy of the packet with the MORE header
-
-		IntraFlowNetworkCodingHeader ncHeader;
-
-		mapParameters->m_rxBuffer[r].packet->RemoveHeader(ncHeader); 				// Remove the MORE header to send it to the upper layers
-
 		sourcePort= mapParameters->m_rxBuffer[r].sourcePort;
 		destinationPort= mapParameters->m_rxBuffer[r].destinationPort;
 
-		UdpHeader udpHeader;
-		mapParameters->m_rxBuffer[r].packet->RemoveHeader(udpHeader); 				// Remove the UDP header
-		udpHeader.SetSourcePort(ncHeader.GetSourcePort());
-		udpHeader.SetDestinationPort(ncHeader.GetDestinationPort());
-
-		mapParameters->m_rxBuffer[r].packet->AddHeader(udpHeader);
-		item =  mapParameters->m_rxBuffer[r];
-		if (!m_ncCallback.IsNull())
+		//After the back-substitution, the r-th payload held by the decoder is the r-th source symbol (length + datagram)
+		if (r >= mapParameters->m_nativeDelivered.size() || !mapParameters->m_nativeDelivered[r])
 		{
-			m_ncCallback(copy, 4, m_node->GetId(), header.GetSource(), header.GetDestination());
+			ForwardUp (mapParameters->m_rxBuffer[r], mapParameters->m_decoder.GetPayload(r), header, incomingInterface);
 		}
-		m_upUdpTarget (item.packet,header,incomingInterface);
-
-		//Increase the number of received packets
-		m_stats.upNumber ++;
 	}
 
 	// Increase the ACK count
@@ -538,7 +585,220 @@ void IntraFlowNetworkCodingProtocol::Decode(Ipv4Header const &header, Ptr<Ipv4In
 	}
 }
 
-void IntraFlowNetworkCodingProtocol::ReduceBuffer (u_int16_t flowId)
+void IntraFlowNetworkCodingProtocol::ForwardUp (IntraFlowNetworkCodingBufferItem item, const std::vector<u_int8_t> &symbol, Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface)
+{
+	Ptr<Packet> copy = item.packet->Copy(); 			// Copy of the packet with the MORE header
+
+	IntraFlowNetworkCodingHeader ncHeader;
+	item.packet->RemoveHeader(ncHeader); 				// Remove the MORE header to send it to the upper layers
+
+	UdpHeader udpHeader;
+	item.packet->RemoveHeader(udpHeader); 				// Remove the UDP header
+	udpHeader.SetSourcePort(ncHeader.GetSourcePort());
+	udpHeader.SetDestinationPort(ncHeader.GetDestinationPort());
+	item.packet->AddHeader(udpHeader);
+
+	if (m_codePayload)
+	{
+		u_int16_t length = (symbol[0] << 8) | symbol[1];
+		NS_ASSERT (length + 2u <= symbol.size());
+		item.packet = Create<Packet> (&symbol[2], length);
+	}
+	if (!m_ncCallback.IsNull())
+	{
+		m_ncCallback(copy, 4, m_node->GetId(), header.GetSource(), header.GetDestination());
+	}
+	m_upUdpTarget (item.packet,header,incomingInterface);
+
+	//Increase the number of received packets
+	m_stats.upNumber ++;
+}
+
+void IntraFlowNetworkCodingProtocol::ReceiveWindow (Ptr<Packet> packet, const IntraFlowNetworkCodingHeader &ncHeader, Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, FlowKey flowId)
+{
+	NS_LOG_FUNCTION (this);
+
+	struct timeval startTime, endTime;
+	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters = m_mapParameters.find(flowId)->second;
+
+	//The window is always held by the byte-per-element rows, since the bit-packed matrix cannot slide
+	if (mapParameters->m_k != m_k || mapParameters->m_decoder.GetK() != m_k)
+	{
+		mapParameters->m_k = m_k;
+		mapParameters->m_decoder.Reset (m_k, m_q, false);
+		mapParameters->m_rank = 0;
+	}
+
+	u_int32_t base = mapParameters->m_fragmentNumber;				// Next packet to deliver (first column of the decoder)
+	u_int32_t head = UnwrapIndex (ncHeader.GetNfrag(), base);
+	const std::vector<u_int8_t> &coefficients = ncHeader.GetVector();
+
+	std::vector<u_int8_t> &vector = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::VECTOR, m_k);
+	std::vector<u_int8_t> &payload = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::PAYLOAD, 0);
+	if (m_codePayload)
+	{
+		IntraFlowNetworkCodingHeader auxHeader;
+		Ptr<Packet> copy = packet->Copy();
+		copy->RemoveHeader (auxHeader);
+		payload.resize (copy->GetSize());
+		copy->CopyData (&payload[0], payload.size());
+	}
+
+	//Move the coefficients to the decoder columns. Those of the packets already delivered are cancelled out, by subtracting
+	//the stored source symbols (if the packet combines anything older, or beyond the window, it is useless)
+	bool useful = head + ncHeader.GetK() > base;
+	for (u_int16_t i = 0; i < ncHeader.GetK() && useful; i++)
+	{
+		u_int32_t index = head + i;
+		if (!coefficients[i])
+		{
+			continue;
+		}
+		if (index >= base + m_k)
+		{
+			useful = false;
+		}
+		else if (index >= base)
+		{
+			vector[index - base] = coefficients[i];
+		}
+		else if (m_codePayload)
+		{
+			if (base - index > mapParameters->m_deliveredSymbols.size())
+			{
+				useful = false;
+				break;
+			}
+			GaloisField field (m_q);
+			const std::vector<u_int8_t> &symbol = mapParameters->m_deliveredSymbols[mapParameters->m_deliveredSymbols.size() - (base - index)];
+			payload.resize (std::max (payload.size(), symbol.size()), 0);
+			field.MultiplyAddRegion (&payload[0], &symbol[0], coefficients[i], symbol.size());
+		}
+	}
+
+	if (!useful || std::count (vector.begin(), vector.end(), 0) == (int) vector.size())
+	{
+		//Out-of-window packet, the source has to be warned about the current delivery point
+		if (!m_ncCallback.IsNull())
+		{
+			m_ncCallback(packet->Copy(), 9, m_node->GetId(), header.GetSource(), header.GetDestination());
+		}
+		SendAck (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort(), false);
+		return;
+	}
+
+	m_stats.rxNumber ++;
+
+	gettimeofday(&startTime, NULL);
+	bool innovative = m_codePayload ? mapParameters->m_decoder.AddVector (vector, &payload[0], payload.size()) :
+			mapParameters->m_decoder.AddVector (vector);
+	gettimeofday(&endTime, NULL);
+	m_stats.rankTime.push_back(timeval_diff(&endTime, &startTime) * 1000);
+
+	if (!m_ncCallback.IsNull())
+	{
+		m_ncCallback(packet->Copy(), 2, m_node->GetId(), header.GetSource(), header.GetDestination());
+	}
+
+	if (!innovative)
+	{
+		return;
+	}
+	mapParameters->m_rank++;
+	mapParameters->m_rxBuffer.push_back (IntraFlowNetworkCodingBufferItem(packet, header.GetSource(),header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort()));
+
+	//The leading packets can only be recovered if the first column has a pivot
+	if (!mapParameters->m_decoder.HasPivot (0))
+	{
+		return;
+	}
+
+	gettimeofday(&startTime, NULL);
+	mapParameters->m_decoder.Solve ();
+	u_int16_t decoded = mapParameters->m_decoder.GetDecodedPrefix ();
+	gettimeofday(&endTime, NULL);
+
+	if (!decoded)
+	{
+		return;
+	}
+
+	m_stats.inverseTime.push_back(1000*timeval_diff(&endTime, &startTime));
+	m_stats.timestamp.push_back(Simulator::Now().GetSeconds());
+
+	for (u_int16_t r = 0; r < decoded; r++)
+	{
+		const std::vector<u_int8_t> &symbol = mapParameters->m_decoder.GetPayload(r);
+		ForwardUp (mapParameters->m_rxBuffer[r], symbol, header, incomingInterface);
+
+		if (m_codePayload)
+		{
+			//Keep the whole region (see GaloisField::GetRegionSize), as it will be subtracted from the coded payloads
+			u_int32_t size = std::min ((u_int32_t) symbol.size(), GaloisField (m_q).GetRegionSize (((symbol[0] << 8) | symbol[1]) + 2));
+			mapParameters->m_deliveredSymbols.push_back (std::vector<u_int8_t> (symbol.begin(), symbol.begin() + size));
+			if (mapParameters->m_deliveredSymbols.size() > m_k)
+			{
+				mapParameters->m_deliveredSymbols.pop_front();
+			}
+		}
+	}
+
+	//Slide the window: the decoded columns are dropped and the cumulative ACK points to the next packet
+	mapParameters->m_rxBuffer.erase (mapParameters->m_rxBuffer.begin(), mapParameters->m_rxBuffer.begin() + decoded);
+	mapParameters->m_decoder.Shift (decoded);
+	mapParameters->m_rank = mapParameters->m_decoder.GetRank();
+	mapParameters->m_fragmentNumber += decoded;
+
+	SendAck (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort(), true);
+}
+
+void IntraFlowNetworkCodingProtocol::AdvanceWindow (u_int16_t ack, FlowKey flowId)
+{
+	NS_LOG_FUNCTION (this << ack);
+
+	IntraFlowMapIterator it = m_mapParameters.find(flowId);
+	if (it == m_mapParameters.end())
+	{
+		return;
+	}
+
+	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters = it->second;
+	u_int32_t next = UnwrapIndex (ack, mapParameters->m_fragmentNumber);
+
+	if (next > mapParameters->m_fragmentNumber)
+	{
+		u_int32_t count = std::min ((size_t) (next - mapParameters->m_fragmentNumber), mapParameters->m_txBuffer.size());
+		mapParameters->m_txBuffer.erase (mapParameters->m_txBuffer.begin(), mapParameters->m_txBuffer.begin() + count);
+		mapParameters->m_fragmentNumber += count;
+		mapParameters->m_systematicOffset -= std::min ((u_int32_t) mapParameters->m_systematicOffset, count);
+
+		//The queued combinations still refer to the acknowledged packets
+		mapParameters->m_txCounter = 0;
+		SelectiveFlushWifiBuffer(flowId);
+	}
+}
+
+bool IntraFlowNetworkCodingProtocol::IsNative (const std::vector<u_int8_t> &vector, u_int16_t &position)
+{
+	u_int16_t nonNull = 0;
+	for (u_int16_t i = 0; i < vector.size() && nonNull < 2; i++)
+	{
+		if (vector[i])
+		{
+			position = i;
+			nonNull++;
+		}
+	}
+	return nonNull == 1 && vector[position] == 1;
+}
+
+u_int32_t IntraFlowNetworkCodingProtocol::UnwrapIndex (u_int16_t index, u_int32_t reference)
+{
+	int32_t distance = (int16_t) (index - (u_int16_t) reference);
+	return (distance < 0 && (u_int32_t) -distance > reference) ? 0 : reference + distance;
+}
+
+void IntraFlowNetworkCodingProtocol::ReduceBuffer (FlowKey flowId)
 {
 	IntraFlowMapIterator it;
 
@@ -551,6 +811,54 @@ void IntraFlowNetworkCodingProtocol::ReduceBuffer (u_int16_t flowId)
 	}
 }
 
+void IntraFlowNetworkCodingProtocol::StartBufferTimer (FlowKey flowId)
+{
+	IntraFlowMapIterator it = m_mapParameters.find(flowId);
+
+	if (it == m_mapParameters.end() || !it->second->m_timerExpiry.IsZero())
+	{
+		return;
+	}
+
+	it->second->m_timerExpiry = Simulator::Now() + m_bufferTimeout;
+	m_timerQueue.push_back (make_pair (flowId, it->second->m_timerExpiry));
+
+	if (!m_timerEvent.IsRunning())
+	{
+		m_timerEvent = Simulator::Schedule (m_bufferTimeout, &IntraFlowNetworkCodingProtocol::ExpireBufferTimers, this);
+	}
+}
+
+void IntraFlowNetworkCodingProtocol::StopBufferTimer (Ptr<IntraFlowNetworkCodingMapParameters> mapParameters)
+{
+	mapParameters->m_timerExpiry = Time ();
+}
+
+void IntraFlowNetworkCodingProtocol::ExpireBufferTimers ()
+{
+	NS_LOG_FUNCTION (this);
+	Time now = Simulator::Now();
+
+	while (!m_timerQueue.empty() && m_timerQueue.front().second <= now)
+	{
+		std::pair <FlowKey, Time> timer = m_timerQueue.front();
+		m_timerQueue.pop_front();
+
+		//Discard the entries of the timers which have been stopped (or restarted) since they were queued
+		IntraFlowMapIterator it = m_mapParameters.find(timer.first);
+		if (it != m_mapParameters.end() && it->second->m_timerExpiry == timer.second)
+		{
+			it->second->m_timerExpiry = Time ();
+			ReduceBuffer (timer.first);
+		}
+	}
+
+	if (!m_timerQueue.empty() && !m_timerEvent.IsRunning())
+	{
+		m_timerEvent = Simulator::Schedule (m_timerQueue.front().second - now, &IntraFlowNetworkCodingProtocol::ExpireBufferTimers, this);
+	}
+}
+
 void IntraFlowNetworkCodingProtocol::GenerateRandomVector (u_int16_t K, std::vector<u_int8_t>& randomVector)
 {
 	NS_LOG_FUNCTION_NOARGS();
@@ -585,7 +893,7 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 	NS_LOG_FUNCTION (this);
 	struct timeval startTime, endTime;
 	IntraFlowNetworkCodingHeader ncHeader; 			   // Once we have the header of the arriving packet, it is necessary to insert the random vector in the matrix
-	u_int16_t flowId;
+	FlowKey flowId;
 
 	IntraFlowMapIterator it;
 	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters;
@@ -593,7 +901,7 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 	Ptr<Packet> copy = packet->Copy(); // Copy of the arriving packet
 	copy->RemoveHeader(ncHeader);    // Taking the MORE header of the packet
 
-	flowId= HashID (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
+	flowId= FlowKey (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
 
 	it = m_mapParameters.find (flowId);
 
@@ -607,84 +915,44 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 		aux->m_rank = 0;
 		aux->m_fragmentNumber = 0;
 
-		ResetMatrices (flowId);
-
-		m_mapParameters.insert(pair<u_int16_t, Ptr<IntraFlowNetworkCodingMapParameters> >(make_pair(flowId, aux)));
+		m_mapParameters.insert (make_pair (flowId, aux));
 	}
 
 	it = m_mapParameters.find(flowId);
 	mapParameters = it->second;
 
+	// Reception of a Data packet (sliding window)
+	if (ncHeader.GetTx() == 0 && m_scheme == SLIDING_WINDOW)
+	{
+		ReceiveWindow (packet, ncHeader, header, incomingInterface, flowId);
+	}
 	// Reception of a Data packet
-	if ( ncHeader.GetTx() == 0)
+	else if ( ncHeader.GetTx() == 0)
 	{
 		//Variable definition
-		Field::Element *headerVectorGf=(Field::Element *) calloc(m_k, sizeof (Field::Element));
-		Field::Element *vectorMatrixGf_copy=(Field::Element *) calloc(m_k*m_k, sizeof (Field::Element));
-		Field::Element *zeroMatrix=(Field::Element *) calloc(m_k*m_k, sizeof (Field::Element));
-		int gf=pow(2,m_q);
-		Field GF(gf);
 		double secs;
 		u_int8_t actualRank;
-		itpp::bvec headerVector;
-		headerVector.zeros();
 
 		if(ncHeader.GetNfrag() >= mapParameters->m_fragmentNumber)
 		{
 			m_stats.rxNumber ++;
-			std::vector <u_int8_t> randomVector;
-			randomVector = ncHeader.GetVector(); // Get the vector in the header read in "deserialized"
-
-			if(m_q==1 && m_itpp==true)				//IT++ library
-			{
-				for(u_int8_t i = 0; i < randomVector.size(); i++)
-				{
-					int valuen= randomVector[i];
-					headerVector.ins (i,valuen);
-				}
 
-				if (mapParameters->m_vectorMatrix.row_rank() == mapParameters->m_k) // In case there are several fragments
-				{
-					mapParameters->m_k=ncHeader.GetK();
-					mapParameters->m_vectorMatrix=GF2mat(mapParameters->m_k, mapParameters->m_k); 	// Overwriting with a new matrix of size mapParameters->m_k*mapParameters->m_k
-					mapParameters->m_rank = 0; // Zeroing the matrix rank
-				}
+			StartGeneration (flowId, ncHeader);
 
-				mapParameters->m_vectorMatrix.set_row(mapParameters->m_rank, headerVector); // Once we have the packet header, the random vector is inserted in the matrix
-
-				gettimeofday(&startTime, NULL);
-				actualRank=mapParameters->m_vectorMatrix.row_rank();
-				gettimeofday(&endTime, NULL);
+			// Once we have the packet header, the random vector is reduced against the rows already stored (O(K^2))
+			gettimeofday(&startTime, NULL);
+			if (m_codePayload)
+			{
+				std::vector<u_int8_t> &payload = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::PAYLOAD, copy->GetSize());
+				copy->CopyData (&payload[0], payload.size());
+				mapParameters->m_decoder.AddVector (ncHeader.GetVector(), &payload[0], payload.size());
 			}
-			else									//FFLAS-FFPACK library
+			else
 			{
-				FFLAS::fzero(GF, mapParameters->m_k, mapParameters->m_k, zeroMatrix, mapParameters->m_k);
-
-				for(u_int8_t i = 0; i < randomVector.size(); i++)
-				{
-					int valuen= randomVector[i];
-					GF.init(headerVectorGf[i], valuen);
-				}
-
-				FFLAS::fadd(GF, mapParameters->m_k, mapParameters->m_k, mapParameters->m_vectorMatrixGf,
-						mapParameters->m_k, zeroMatrix, mapParameters->m_k, vectorMatrixGf_copy,
-						mapParameters->m_k);
-				if (FFPACK::Rank(GF, mapParameters->m_k, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k) == mapParameters->m_k) // In case there are several fragments
-				{
-					mapParameters->m_k=ncHeader.GetK();
-					mapParameters->m_vectorMatrixGf=(Field::Element *) calloc (mapParameters->m_k * mapParameters->m_k, sizeof (Field::Element));
-					mapParameters->m_rank = 0; // Zeroing the matrix rank
-				}
-
-				InsertRow(GF, mapParameters->m_vectorMatrixGf, headerVectorGf, mapParameters->m_rank, 1, mapParameters->m_k);
-				free (headerVectorGf);
-
-				FFLAS::fadd(GF, mapParameters->m_k, mapParameters->m_k, mapParameters->m_vectorMatrixGf,
-						mapParameters->m_k, zeroMatrix, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-				gettimeofday (&startTime, NULL);
-				actualRank=FFPACK::Rank(GF, mapParameters->m_k, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-				gettimeofday (&endTime, NULL);
+				mapParameters->m_decoder.AddVector (ncHeader.GetVector());
 			}
+			actualRank = mapParameters->m_decoder.GetRank();
+			gettimeofday(&endTime, NULL);
 
 			if (!m_ncCallback.IsNull())
 			{
@@ -697,6 +965,21 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 			{
 				mapParameters->m_rank++; // If it is linear independent the row is incremented to fill the next one
 				mapParameters->m_rxBuffer.push_back (IntraFlowNetworkCodingBufferItem(packet, header.GetSource(),header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort() ));
+
+				//Systematic phase: a native packet is delivered straight away, without waiting for the whole fragment
+				u_int16_t position;
+				if (IsNative (ncHeader.GetVector(), position) && position < mapParameters->m_nativeDelivered.size() && !mapParameters->m_nativeDelivered[position])
+				{
+					std::vector<u_int8_t> &symbol = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::SYMBOL, m_codePayload ? copy->GetSize() : 0);
+					if (m_codePayload)
+					{
+						copy->CopyData (&symbol[0], symbol.size());
+					}
+					ForwardUp (IntraFlowNetworkCodingBufferItem (packet->Copy(), header.GetSource(),header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort()),
+							symbol, header, incomingInterface);
+					mapParameters->m_nativeDelivered[position] = true;
+				}
+
 				if (actualRank == mapParameters->m_k)
 				{
 					Decode (header, incomingInterface, flowId); // The matrix is full and the inverse is made by the function Decode
@@ -715,9 +998,6 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 			//Previously commented
 			SendAck (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort(), false);
 		}
-
-		free(vectorMatrixGf_copy);
-		free(zeroMatrix);
 	}
 	//Reception of an ACK
 	else // If Tx=1,2, the packet is an ACK sent by the Rx
@@ -730,9 +1010,13 @@ enum Ipv4L4Protocol::RxStatus IntraFlowNetworkCodingProtocol::Receive (Ptr<Packe
 		if (ncHeader.GetTx() == 1  || ncHeader.GetTx() == 2)		//Upon the reception of a normal ACK, we will remove the corresponding fragment from the TX buffer
 		{
 			//Since the ACK comes backwards, we must invert the endpoints in order to get to correct hash
-			flowId= HashID (header.GetDestination(), header.GetSource(), ncHeader.GetDestinationPort(), ncHeader.GetSourcePort());
+			flowId= FlowKey (header.GetDestination(), header.GetSource(), ncHeader.GetDestinationPort(), ncHeader.GetSourcePort());
 
-			if(ncHeader.GetNfrag() > mapParameters->m_fragmentNumber)
+			if (m_scheme == SLIDING_WINDOW)
+			{
+				AdvanceWindow (ncHeader.GetNfrag(), flowId);
+			}
+			else if(ncHeader.GetNfrag() > mapParameters->m_fragmentNumber)
 			{
 				ChangeFragment (ncHeader.GetNfrag(), flowId, false);
 			}
@@ -750,8 +1034,7 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 	IntraFlowNetworkCodingHeader ncHeader;
 	Ptr<Packet> copy= packet->Copy();
 
-	u_int16_t flowId;
-	itpp::bvec headerVector;
+	FlowKey flowId;
 	u_int8_t actualRank;
 
 	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters;
@@ -760,8 +1043,7 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 	std::vector <u_int8_t> vectr;
 
 	copy->RemoveHeader (ncHeader);
-	headerVector.zeros ();
-	flowId = HashID (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
+	flowId = FlowKey (header.GetSource(), header.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
 
 	// Map creation of a new flow ID
 	it = m_mapParameters.find (flowId);
@@ -774,10 +1056,10 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 		aux->m_fragmentNumber = 0;
 		aux->m_txCounter = 0;
 		aux->m_forwardingNode = true;
-		m_mapParameters.insert (pair<u_int16_t, Ptr<IntraFlowNetworkCodingMapParameters> >(make_pair(flowId, aux)));
+		m_mapParameters.insert (make_pair (flowId, aux));
 
 		//Initialize the matrices
-		if (m_recode)
+		if (m_recode && m_scheme == BLOCK_CODING)
 		{
 			ResetMatrices (flowId);
 		}
@@ -790,66 +1072,26 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 
 	if(ncHeader.GetTx() == 0)	// Data packet
 	{
-		if(m_recode)
+		if(m_recode && m_scheme == BLOCK_CODING)
 		{
 			if(ncHeader.GetNfrag() >= mapParameters->m_fragmentNumber)
 			{
 				vectr = ncHeader.GetVector(); // Get the vector in the header read in "deserialized"
 
-				if(m_q==1 && m_itpp==true)		//IT++ library
-				{
-					//Compose the random vector
-					for(u_int8_t i=0; i < vectr.size(); i++)
-					{
-						int valuen= vectr[i];
-						headerVector.ins(i,valuen);
-					}
-
-					if (mapParameters->m_vectorMatrix.row_rank() == mapParameters->m_k) // In case there are several fragments
-					{
-						mapParameters->m_k=ncHeader.GetK();
-						mapParameters->m_vectorMatrix = GF2mat(mapParameters->m_k, mapParameters->m_k); 	// Overwriting with a new matrix of size mapParameters->m_k*mapParameters->m_k
-						mapParameters->m_rank = 0; // Zeroing the matrix rank
-					}
-
-					mapParameters->m_vectorMatrix.set_row (mapParameters->m_rank, headerVector); // Once we have the packet header, the random vector is inserted in the matrix
+				StartGeneration (flowId, ncHeader);
 
-					actualRank=mapParameters->m_vectorMatrix.row_rank();
+				if (m_codePayload)
+				{
+					std::vector<u_int8_t> &payload = m_scratchPool.Get (IntraFlowNetworkCodingScratchPool::PAYLOAD, copy->GetSize());
+					copy->CopyData (&payload[0], payload.size());
+					mapParameters->m_decoder.AddVector (vectr, &payload[0], payload.size());
 				}
-				else							//FFLAS-FFPACK library
+				else
 				{
-					//Variable definition
-					int gf=pow(2,m_q);
-					Field GF(gf);
-					Field::Element *headerVectorGf=(Field::Element *) calloc (m_k, sizeof (Field::Element));
-					Field::Element *vectorMatrixGf_copy=(Field::Element *) calloc (m_k*m_k, sizeof (Field::Element));
-					Field::Element *zeroMatrix=(Field::Element *) calloc (m_k*m_k, sizeof (Field::Element));
-					FFLAS::fzero(GF, mapParameters->m_k, mapParameters->m_k, zeroMatrix, mapParameters->m_k);
-
-					//Compose the random vector
-					for(u_int8_t d=0; d < vectr.size(); d++)
-					{
-						int valuen= vectr[d];
-						GF.init(headerVectorGf[d], valuen);
-					}
-
-					FFLAS::fadd(GF, mapParameters->m_k, mapParameters->m_k, mapParameters->m_vectorMatrixGf, mapParameters->m_k, zeroMatrix, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-					if (FFPACK::Rank(GF, mapParameters->m_k, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k) == mapParameters->m_k) // In case there are several fragments
-					{
-						mapParameters->m_k = ncHeader.GetK();
-						mapParameters->m_vectorMatrixGf = (Field::Element *) calloc(mapParameters->m_k * mapParameters->m_k, sizeof (Field::Element));
-						mapParameters->m_rank = 0; // Zeroing the matrix rank
-					}
-
-					InsertRow(GF, mapParameters->m_vectorMatrixGf, headerVectorGf, mapParameters->m_rank, 1, mapParameters->m_k);
-					free(headerVectorGf);
-
-					FFLAS::fadd (GF, mapParameters->m_k, mapParameters->m_k, mapParameters->m_vectorMatrixGf, mapParameters->m_k, zeroMatrix, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-					actualRank=FFPACK::Rank(GF, mapParameters->m_k, mapParameters->m_k, vectorMatrixGf_copy, mapParameters->m_k);
-
-					free (vectorMatrixGf_copy);
-					free (zeroMatrix);
+					mapParameters->m_decoder.AddVector (vectr);
 				}
+				actualRank = mapParameters->m_decoder.GetRank();
+
 				if (actualRank > mapParameters->m_rank && actualRank < mapParameters->m_k)  // Check the linear independence of the vector and the matrix using the rank
 				{
 					mapParameters->m_rank++; // If it is linear independent the row is incremented to fill the next one
@@ -894,10 +1136,10 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 	}
 	else // ACK
 	{
- 		flowId = HashID (header.GetDestination(), header.GetSource(), ncHeader.GetDestinationPort(), ncHeader.GetSourcePort());
+ 		flowId = FlowKey (header.GetDestination(), header.GetSource(), ncHeader.GetDestinationPort(), ncHeader.GetSourcePort());
  		it = m_mapParameters.find(flowId);
 
-		if(ncHeader.GetNfrag() > it->second->m_fragmentNumber)
+		if(m_scheme == BLOCK_CODING && it != m_mapParameters.end() && ncHeader.GetNfrag() > it->second->m_fragmentNumber)
 		{
 			ChangeFragment (ncHeader.GetNfrag(), flowId, true);
 		}
@@ -912,7 +1154,7 @@ void IntraFlowNetworkCodingProtocol::ParseForwardingReception (Ptr<Ipv4Route> rt
 //	cout << Simulator::Now().GetSeconds() << " --> ParseForwardingReception::OUT " << (int) packet->GetSize() << endl;
 }
 
-void IntraFlowNetworkCodingProtocol::ChangeFragment (u_int16_t nFrag, u_int16_t flowId, bool forwardingNode)
+void IntraFlowNetworkCodingProtocol::ChangeFragment (u_int16_t nFrag, FlowKey flowId, bool forwardingNode)
 {
 	NS_LOG_FUNCTION (this);
 
@@ -965,7 +1207,9 @@ void IntraFlowNetworkCodingProtocol::ChangeFragment (u_int16_t nFrag, u_int16_t
 			{
 				mapParameters->m_fragmentNumber = nFrag; 	// It is necessary to refresh the number of fragment
 				//mapParameters->m_fragmentNumber++;
-				m_reduceBufferEvent = Simulator::Schedule (m_bufferTimeout, &IntraFlowNetworkCodingProtocol::ReduceBuffer, this, flowId); // It is necessary to include a timer to send the rest of the packets in case there are less than mapParameters->m_k. There is a specific function for that purpose.
+				// It is necessary to include a timer to send the rest of the packets in case there are less than mapParameters->m_k. There is a specific function for that purpose.
+				StopBufferTimer (mapParameters);
+				StartBufferTimer (flowId);
 			}
 			else
 			{
@@ -976,6 +1220,7 @@ void IntraFlowNetworkCodingProtocol::ChangeFragment (u_int16_t nFrag, u_int16_t
 		//Restore the legacy value of K (if had changed before by a ReduceBuffer call)
 		mapParameters->m_k = atoi (IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(1).initialValue->SerializeToString (MakeUintegerChecker<u_int16_t> ()).c_str());
 		mapParameters->m_txCounter = 0;
+		mapParameters->m_systematicOffset = 0;
 		SelectiveFlushWifiBuffer(flowId);
 		Encode (flowId);
 	}
@@ -992,7 +1237,7 @@ void IntraFlowNetworkCodingProtocol::SendAck (Ipv4Address source, Ipv4Address de
 	packet = Create <Packet> (0);
 	IntraFlowNetworkCodingHeader ncHeader;
 	IntraFlowNetworkCodingBufferItem item;
-	u_int16_t flowId;
+	FlowKey flowId;
 
 	IntraFlowMapIterator it;
 	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters;
@@ -1000,7 +1245,7 @@ void IntraFlowNetworkCodingProtocol::SendAck (Ipv4Address source, Ipv4Address de
 	//Different value according to the type of message
 	// 1- Normal ACK
 	// 2- Backward request (this message is triggered when the TX fragment number overlaps the receiver's one.
-	flowId = HashID (source, destination, sourcePort, destinationPort);
+	flowId = FlowKey (source, destination, sourcePort, destinationPort);
 
 	it=m_mapParameters.find(flowId);
 	mapParameters=it->second;
@@ -1083,7 +1328,7 @@ void IntraFlowNetworkCodingProtocol::FlushWifiBuffer ()
 	m_flushCallback ();
 }
 
-void IntraFlowNetworkCodingProtocol::SelectiveFlushWifiBuffer (u_int16_t flowId)
+void IntraFlowNetworkCodingProtocol::SelectiveFlushWifiBuffer (FlowKey flowId)
 {
 	m_selectiveFlushCallback (flowId);
 	Encode (flowId);
@@ -1097,7 +1342,7 @@ void IntraFlowNetworkCodingProtocol::WifiBufferEvent (Ptr<const Packet> packet)
 	IntraFlowNetworkCodingHeader ncHeader;
 	UdpHeader udpHeader;
 
-	u_int16_t flowId;
+	FlowKey flowId;
 
 	Ptr<Packet> copy = packet->Copy();
 
@@ -1125,7 +1370,7 @@ void IntraFlowNetworkCodingProtocol::WifiBufferEvent (Ptr<const Packet> packet)
 				if (ncHeader.GetTx() == 0)        //Data packets
 				{
 					//Look up if the output packet is already stored into any of the buffers
-					flowId = HashID (ipHeader.GetSource(), ipHeader.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
+					flowId = FlowKey (ipHeader.GetSource(), ipHeader.GetDestination(), ncHeader.GetSourcePort(), ncHeader.GetDestinationPort());
 					IntraFlowMapIterator iter = m_mapParameters.find(flowId);
 
 					if (iter != m_mapParameters.end())
@@ -1145,6 +1390,7 @@ void IntraFlowNetworkCodingProtocol::WifiBufferEvent (Ptr<const Packet> packet)
 						}
 						//Increase the statistics counter (tracing purposes)
 						m_stats.txNumber ++;
+						m_stats.headerBytes += ncHeader.GetSerializedSize();
 					}
 				}
 
@@ -1160,28 +1406,44 @@ void IntraFlowNetworkCodingProtocol::WifiBufferEvent (Ptr<const Packet> packet)
 	}
 }
 
-void IntraFlowNetworkCodingProtocol::ResetMatrices (u_int16_t flowId)
+IntraFlowNetworkCodingStatistics IntraFlowNetworkCodingProtocol::GetStats ()
+{
+	m_stats.memoryBytes = m_scratchPool.GetMemoryUsage();
+	for (IntraFlowMapIterator it = m_mapParameters.begin(); it != m_mapParameters.end(); ++it)
+	{
+		m_stats.memoryBytes += it->second->m_decoder.GetMemoryUsage();
+	}
+	return m_stats;
+}
+
+void IntraFlowNetworkCodingProtocol::ResetMatrices (FlowKey flowId)
 {
 	IntraFlowMapIterator iter = m_mapParameters.find (flowId);
 
 	if (iter != m_mapParameters.end())
 	{
-		if(m_q==1 && m_itpp==true)						// Overwriting with the new matrix
-		{
-			iter->second->m_vectorMatrix = GF2mat (iter->second->m_k, iter->second->m_k);
-		}
-		else
-		{
-//			if (iter->second->m_vectorMatrixGf)
-//			{
-//				free (iter->second->m_vectorMatrixGf);
-//			}
-			iter->second->m_vectorMatrixGf = (Field::Element *) calloc(iter->second->m_k * iter->second->m_k, sizeof (Field::Element));
-		}
-
+		iter->second->m_decoder.Reset (iter->second->m_k, m_q, m_bitPackedGf2);		//Bit-packed GF(2) matrix if q=1
+		iter->second->m_nativeDelivered.assign (iter->second->m_k, false);
 		iter->second->m_rank = 0;
 	}
 
 }
 
+void IntraFlowNetworkCodingProtocol::StartGeneration (FlowKey flowId, const IntraFlowNetworkCodingHeader &ncHeader)
+{
+	Ptr <IntraFlowNetworkCodingMapParameters> mapParameters = m_mapParameters.find (flowId)->second;
+
+	if (mapParameters->m_generationStarted && mapParameters->m_generation == ncHeader.GetNfrag())
+	{
+		return;
+	}
+
+	NS_LOG_DEBUG ("Flow " << flowId << ": generation " << ncHeader.GetNfrag() << " (K=" << ncHeader.GetK() << ")");
+	mapParameters->m_generationStarted = true;
+	mapParameters->m_generation = ncHeader.GetNfrag();
+	mapParameters->m_k = ncHeader.GetK();
+	mapParameters->m_rxBuffer.clear();			//Leftovers of an unfinished generation (sink nodes)
+	ResetMatrices (flowId);
+}
+
 
@@ -32,83 +32,16 @@
 
 #include <iostream>
 #include <list>
+#include <deque>
 #include <vector>
 
-//IT++ finite field operations
-#include <itpp/base/gf2mat.h>
-#include <itpp/base/vec.h>
-
-//Tweak to avoid the legacy fflas/ffpack bug (recall to modify the "fflas-ffpack/utils/debug.h"
-//by adding the anonymous namespace
-#define INT64_MAX std::numeric_limits<int64_t>::max()
-#define UINT64_MAX std::numeric_limits<uint64_t>::max()
-#define INT32_MAX std::numeric_limits<int32_t>::max()
-#define UINT32_MAX std::numeric_limits<uint32_t>::max()
-#define INT16_MAX std::numeric_limits<int16_t>::max()
-#define UINT16_MAX std::numeric_limits<uint16_t>::max()
-#define INT8_MAX std::numeric_limits<int8_t>::max()
-#define UINT8_MAX std::numeric_limits<uint8_t>::max()
-
-//FFLAS-FFPACK finite field operations
-#include "fflas-ffpack/field/modular-balanced.h"
-#include "fflas-ffpack/field/modular-int32.h"
-#include "fflas-ffpack/ffpack/ffpack.h"
-#include "fflas-ffpack/field/field-general.h"
-#include "fflas-ffpack/utils/debug.h"
-#include "fflas-ffpack/config-blas.h"
-
 #include "network-coding-l4-protocol.h"
 #include "intra-flow-network-coding-header.h"
+#include "intra-flow-network-coding-decoder.h"
+
+#include "ns3/flow-table.h"
 
-using namespace itpp;
 using namespace std;
-using namespace FFLAS;
-using namespace FFPACK;
-
-typedef FFPACK::Modular<int> Field;
-typedef Field::Element Element;
-
-template<class T>
-std::ostream& printvect(std::ostream& o, vector<T>& vect) {
-    for (size_t i = 0; i < vect.size(); ++i)
-        o << vect[i] << " ";
-    return o << std::endl;
-}
-
-template <class Field>
-	typename Field::Element *InsertRow (Field GF, typename Field::Element *C,
-	        typename Field::Element *vector, int rowNumber, int rows, int columns)
-	{
-	    for (u_int16_t i=0; i < columns; i++)
-	    {
-	        GF.assign (C[rowNumber * columns + i], vector[i]);
-	    }
-	    return C;
-	}
-
-template <class Field>
-typename Field::Element *GenerateRandomMatrix (Field GF,
-		typename Field::Element *C, int fieldOrder, int rows, int cols)
-{
-	ns3::UniformVariable ranvar (0, fieldOrder);
-	for (u_int32_t i = 0; i < (size_t) rows * cols; i++)
-	{
-		//        GF.init(C[i], RandInt(0, (int) fieldOrder));
-		GF.init (C[i], ranvar.GetInteger ((u_int32_t) 0, (u_int32_t) fieldOrder));
-	}
-	return C;
-}
-
-template <class Field>
-typename Field::Element *DelRow (Field GF, typename Field::Element *C,
-        int rowNumber, int rows, int columns)
-{
-    for (u_int16_t i=0; i < columns; i++)
-    {
-        GF.assign (C[rowNumber * columns + i], 0);
-    }
-    return C;
-}
 
 namespace ns3 {
 
@@ -120,6 +53,8 @@ struct IntraFlowNetworkCodingStatistics
 	u_int32_t rxNumber;
 	u_int32_t downNumber;			//Number of packets which are received from the upper layer (source nodes)
 	u_int32_t upNumber; 			//Number of packets which are delivered to the upper layer (destination nodes)
+	u_int64_t headerBytes;			//Overall length of the coding headers of the transmitted data packets (overhead)
+	u_int64_t memoryBytes;			//Memory allocated by the decoders of all the flows and the scratch pool (refreshed by GetStats)
 
 	std::vector<double> timestamp;
 	std::vector<double> rankTime;
@@ -174,7 +109,22 @@ public:
 	/**
 	 * Through this callback we will invoke the forced erasure of a packet of the intrinsic Wifi buffer of each node (allocated at the object RegularWifiMac)
 	 */
-	typedef Callback<void, u_int16_t > SelectiveFlushWifiBufferCallback;
+	typedef Callback<void, const FlowKey & > SelectiveFlushWifiBufferCallback;
+
+	/**
+	 * Coding scheme (Scheme attribute)
+	 *  - BLOCK_CODING -> The flow is split into generations of K packets; the sink delivers a generation once it gets K
+	 *    innovative vectors, and its ACK moves the source towards the next one
+	 *  - SLIDING_WINDOW -> The coefficients span a window of (at most) K unacknowledged packets, [head, tail]. The sink
+	 *    delivers the packets in order as soon as the leading sub-matrix can be solved, and its cumulative ACKs make the
+	 *    window slide forward at the source. The header carries the window head within the fragment number field and its
+	 *    width within the K one. Relays just forward the packets (no recoding)
+	 */
+	enum CodingScheme
+	{
+		BLOCK_CODING = 0,
+		SLIDING_WINDOW
+	};
 
 	static const uint8_t PROT_NUMBER;
 	/**
@@ -272,7 +222,7 @@ public:
 	/**
 	 * Manually remove one flow of data in the Wifi Buffer (namely, after the reception of an IntraFlowNetworkCodingProtocol ACK)
 	 */
-	void SelectiveFlushWifiBuffer (u_int16_t);
+	void SelectiveFlushWifiBuffer (FlowKey flowId);
 
 	/**
 	 * This method allows a caller to set the current down target callback set for this L4 protocol
@@ -289,9 +239,19 @@ public:
 	void GenerateRandomVector (u_int16_t K, std::vector<u_int8_t>& randomVector);
 
 	/**
-	 *  Choose a random vector (of size K) and combine it with the K first stored packets within the buffer
+	 *  Choose a random vector (of size K) and combine it with the K first stored packets within the buffer. With the Systematic
+	 *  attribute, the packets of each fragment (or window) are first sent uncoded, i.e. with a unit vector
+	 */
+	void Encode (FlowKey flowId);
+
+	/**
+	 * Linear combination over GF(2^q) of the first packets stored within the transmission buffer, one per coefficient (only used when the CodePayload attribute is set)
+	 * \param mapParameters Flow information
+	 * \param coefficients Coding vector
+	 * \param payload Reference of the vector in which the coded payload will be stored. Each source symbol is made of the length of the datagram (2 bytes) and its
+	 * content, padded with zeros up to the longest one
 	 */
-	void Encode (u_int16_t flowId);
+	void EncodePayload (Ptr<IntraFlowNetworkCodingMapParameters> mapParameters, const std::vector<u_int8_t> &coefficients, std::vector<u_int8_t> &payload);
 
 	/*
 	 * \param header IP header of the packet that triggers the decoding process
@@ -299,31 +259,67 @@ public:
 	 * \param flowId Hash ID
 	 *
 	 */
-	void Decode (Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, u_int16_t flowId);
+	void Decode (Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, FlowKey flowId);
+
+	/**
+	 * Sink operation of the sliding window scheme: the coefficients of the packets already delivered are cancelled, the vector is
+	 * reduced against the window and the leading packets are delivered (and acknowledged) as soon as they can be decoded
+	 * \param packet Received packet (including the coding header)
+	 * \param ncHeader Coding header of the packet
+	 * \param header IP header of the packet
+	 * \param incomingInterface Interface from which the packet has been received
+	 * \param flowId Flow identifier
+	 */
+	void ReceiveWindow (Ptr<Packet> packet, const IntraFlowNetworkCodingHeader &ncHeader, Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface, FlowKey flowId);
+
+	/**
+	 * Source operation of the sliding window scheme: the acknowledged packets are removed from the transmission buffer, so that
+	 * the window head moves forward
+	 * \param ack Index of the next packet expected by the sink (as carried by the ACK, i.e. its 16 least significant bits)
+	 * \param flowId Flow identifier
+	 */
+	void AdvanceWindow (u_int16_t ack, FlowKey flowId);
 
 	/*
 	 * When the RLNC scheme is enabled, intermediate relay nodes will be able to recombine the information
 	 * belonging to the packets
 	 * \param flowId Hash of the corresponding flow
 	 */
-	void Recode (u_int16_t flowId);
+	void Recode (FlowKey flowId);
 
 	/**
 	 *
 	 */
-	void ForwardPacket (u_int16_t flowId, int d);
+	void ForwardPacket (FlowKey flowId, int d);
 
 	/**
 	 * In case the buffer has not stored at least K packets to combine them,
 	 */
-	void ReduceBuffer (u_int16_t flowId);
+	void ReduceBuffer (FlowKey flowId);
+
+	/**
+	 * Arm the ReduceBuffer timer of a flow (nothing is done if it is already running)
+	 * \param flowId Flow identifier
+	 */
+	void StartBufferTimer (FlowKey flowId);
+
+	/**
+	 * Disarm the ReduceBuffer timer of a flow (its entry is lazily removed from the timer queue)
+	 * \param mapParameters Flow information
+	 */
+	void StopBufferTimer (Ptr<IntraFlowNetworkCodingMapParameters> mapParameters);
+
+	/**
+	 * Handler of the timer queue event: call ReduceBuffer for every flow whose timer has expired, and schedule the next one
+	 */
+	void ExpireBufferTimers ();
 
 	/*
 	 * \param nFrag New fragment number (received from the IntraFlowNetworkCodingHeader)
 	 * \flowId Hash of the corresponding flow
 	 * \forwardingNode Flag to determine whether the node is acting as a forwarding entity or not
 	 */
-	void ChangeFragment(u_int16_t nFrag, u_int16_t flowId, bool forwardingNode);
+	void ChangeFragment(u_int16_t nFrag, FlowKey flowId, bool forwardingNode);
 
 	//Callback hooks
 	/*
@@ -351,7 +347,7 @@ public:
 	/*
 	 * \returns The container that holds the gathered statistics
 	 */
-	inline IntraFlowNetworkCodingStatistics GetStats () {return m_stats;}
+	IntraFlowNetworkCodingStatistics GetStats ();
 
 protected:
 	/**
@@ -373,20 +369,54 @@ protected:
 	 * After a successful reception process, forwarding and sink nodes must reset their reception matrices,
 	 * in order to be ready to receive a potential new fragment
 	 */
-	void ResetMatrices (u_int16_t flowId);
+	void ResetMatrices (FlowKey flowId);
+	/**
+	 * Block coding: start over the reception matrices when a packet of a new generation (fragment number) arrives, taking its size
+	 * from the header. Nothing is done while the packets belong to the generation being decoded
+	 * \param flowId Flow of the packet
+	 * \param ncHeader Its Network Coding header
+	 */
+	void StartGeneration (FlowKey flowId, const IntraFlowNetworkCodingHeader &ncHeader);
+	/**
+	 * Deliver a decoded packet to the UDP layer
+	 * \param item Buffer item of the received packet (its coding header is removed)
+	 * \param symbol Decoded source symbol (length + datagram), which replaces the packet content when the CodePayload attribute is set
+	 * \param header IP header of the packet that triggers the decoding process
+	 * \param incomingInterface Interface from which the packet has been received
+	 */
+	void ForwardUp (IntraFlowNetworkCodingBufferItem item, const std::vector<u_int8_t> &symbol, Ipv4Header const &header, Ptr<Ipv4Interface> incomingInterface);
+	/**
+	 * \param index 16 least significant bits of a packet index (as carried by the coding header)
+	 * \param reference Full index close to the one that has to be recovered
+	 * \returns The full index nearest to the reference
+	 */
+	static u_int32_t UnwrapIndex (u_int16_t index, u_int32_t reference);
+	/**
+	 * \param vector Coefficient vector
+	 * \param position Where the position of the only non-null coefficient is stored (only valid if true is returned)
+	 * \returns True if the vector is a unit one, i.e. the packet carries a native (uncoded) datagram
+	 */
+	static bool IsNative (const std::vector<u_int8_t> &vector, u_int16_t &position);
 private:
 	//Attributes
 	u_int8_t m_q;									// GF(2^q)
 	u_int16_t m_k;									// Fragment size
 	bool m_recode;									//True = RLNC; False = RLSC
-	bool m_itpp;
+	bool m_bitPackedGf2;							//Bit-packed GF(2) matrix when q=1
 	Time m_bufferTimeout;							//Time during which the protocol will wait until the buffer has at least K packets
+	bool m_codePayload;								//True = Real payload coding; False = Coefficients-only (empty packets)
+	bool m_seededVectors;							//True = The sources send the seed of the coefficient vector
+	CodingScheme m_scheme;							//Generation-based or sliding window coding
+	bool m_systematic;								//True = The natives are sent before the random combinations
 
 	//Info map container
-	std::map <u_int16_t, Ptr <IntraFlowNetworkCodingMapParameters> > m_mapParameters;
-	typedef std::map <u_int16_t, Ptr <IntraFlowNetworkCodingMapParameters> >::iterator IntraFlowMapIterator;
+	FlowTable <Ptr <IntraFlowNetworkCodingMapParameters> > m_mapParameters;		//Indexed by the whole tuple (two flows never share their state)
+	typedef FlowTable <Ptr <IntraFlowNetworkCodingMapParameters> >::iterator IntraFlowMapIterator;
 
-	EventId m_reduceBufferEvent;
+	//ReduceBuffer timers. Since all of them last BufferTimeout, the expiration times are sorted by insertion order; a single
+	//event, scheduled for the queue head, is kept (the entries of the flows whose timer is stopped or restarted are just skipped)
+	std::deque <std::pair <FlowKey, Time> > m_timerQueue;
+	EventId m_timerEvent;
 
 	//Different-purpose callbacks
 	IntraFlowNetworkCodingCallback m_ncCallback;		// Callback used to trace the main results achieved
@@ -398,6 +428,9 @@ private:
 
 	//Stats container
 	IntraFlowNetworkCodingStatistics m_stats;
+
+	//Scratch buffers shared by all the flows
+	IntraFlowNetworkCodingScratchPool m_scratchPool;
 };
 
 
@@ -423,17 +456,22 @@ private:
 
 	u_int16_t m_k;
 	u_int8_t m_rank;
-	u_int32_t m_fragmentNumber;
+	u_int32_t m_fragmentNumber;				//Sliding window: index of the window head (source) or of the next packet to deliver (sink)
+	bool m_generationStarted;				//Block coding: the reception matrices hold the vectors of m_generation
+	u_int32_t m_generation;					//Block coding: fragment number of the generation being decoded (or recoded)
 
 	int m_txCounter;						//IMPORTANT: parameter used to dynamically inject traffic to the lower layer
+	u_int16_t m_systematicOffset;			//Position (within the transmission buffer) of the next packet to be sent uncoded
+	Time m_timerExpiry;						//Expiration time of the ReduceBuffer timer (zero if it is not running)
 
-	//Reception matrices (only one per time, depending on the value of q)
-	itpp::GF2mat m_vectorMatrix;
-	Field::Element *m_vectorMatrixGf;
+	//Reception matrices
+	IntraFlowNetworkCodingDecoder m_decoder;	//Incremental elimination (rank tracking and decoding)
+	std::vector<bool> m_nativeDelivered;		//Packets of the current fragment already delivered upon the reception of their native version
 
 	//Transmission and reception buffers
 	std::vector <IntraFlowNetworkCodingBufferItem> m_txBuffer;			//"Infinite" buffer -> Source nodes (source coding)
 	std::vector <IntraFlowNetworkCodingBufferItem> m_rxBuffer;			//Buffer of size "K" -> Forwarding (only with RLNC) and sink nodes
+	std::deque <std::vector <u_int8_t> > m_deliveredSymbols;			//Sliding window: last (up to K) delivered source symbols, used to cancel them out from the late combinations
 };
 
 }  	// End namespace
@@ -0,0 +1,167 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/random-variable.h"
+#include "ns3/galois-field.h"
+
+#include <vector>
+
+using namespace ns3;
+
+//Bytes left untouched before and after the regions, so that the kernels are fed with unaligned pointers and overruns are caught
+static const u_int32_t GUARD = 35;
+static const u_int8_t GUARD_VALUE = 0xA5;
+
+/**
+ * Symbol by symbol reference of GaloisField::MultiplyAddRegion, built upon the scalar Mul: the region is read as a little endian
+ * bit stream, symbol i taking bits [i*q, (i+1)*q)
+ */
+static void ReferenceMultiplyAddRegion (const GaloisField &field, u_int8_t *dst, const u_int8_t *src, u_int8_t c, u_int32_t size)
+{
+	u_int8_t q = field.GetQ ();
+	for (u_int32_t bit = 0; bit + q <= 8 * size; bit += q)
+	{
+		u_int8_t symbol = 0;
+		for (u_int8_t j = 0; j < q; j++)
+		{
+			symbol |= ((src [(bit + j) / 8] >> ((bit + j) % 8)) & 1) << j;
+		}
+		u_int8_t product = field.Mul (c, symbol);
+		for (u_int8_t j = 0; j < q; j++)
+		{
+			dst [(bit + j) / 8] ^= ((product >> j) & 1) << ((bit + j) % 8);
+		}
+	}
+}
+
+/**
+ * The region kernels (scalar, SSSE3 or AVX2 split nibbles, whichever is picked at runtime) against the scalar Mul, for every q,
+ * every coefficient (a sample of them for the largest fields), unaligned pointers and lengths which leave tail bytes after the
+ * SIMD blocks
+ */
+class GaloisFieldRegionTestCase : public TestCase
+{
+public:
+	GaloisFieldRegionTestCase ();
+	virtual ~GaloisFieldRegionTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * Run both region operations over a single length and alignment, comparing them with the reference
+	 */
+	void CheckRegion (UniformVariable &random, const GaloisField &field, u_int8_t c, u_int32_t size, u_int32_t srcOffset, u_int32_t dstOffset);
+};
+
+GaloisFieldRegionTestCase::GaloisFieldRegionTestCase ()
+	: TestCase ("GF(2^q) region kernels against the scalar arithmetic")
+{
+}
+
+GaloisFieldRegionTestCase::~GaloisFieldRegionTestCase ()
+{
+}
+
+void GaloisFieldRegionTestCase::CheckRegion (UniformVariable &random, const GaloisField &field, u_int8_t c, u_int32_t size,
+		u_int32_t srcOffset, u_int32_t dstOffset)
+{
+	u_int8_t q = field.GetQ ();
+	std::vector<u_int8_t> src (size + 2 * GUARD, GUARD_VALUE);
+	std::vector<u_int8_t> dst (size + 2 * GUARD, GUARD_VALUE);
+	std::vector<u_int8_t> expected;
+
+	//Element-wise (coefficient vectors): one element per byte
+	for (u_int32_t i = 0; i < size; i++)
+	{
+		src [srcOffset + i] = random.GetInteger (0, (1 << q) - 1);
+		dst [dstOffset + i] = random.GetInteger (0, (1 << q) - 1);
+	}
+	expected = dst;
+	for (u_int32_t i = 0; i < size; i++)
+	{
+		expected [dstOffset + i] ^= field.Mul (c, src [srcOffset + i]);
+	}
+	field.MultiplyAdd (&dst [dstOffset], &src [srcOffset], c, size);
+	NS_TEST_ASSERT_MSG_EQ ((dst == expected), true, "MultiplyAdd mismatch (" << GaloisField::GetKernelName () << ", Q=" << (int) q
+			<< ", c=" << (int) c << ", size=" << size << ", offsets=" << srcOffset << "/" << dstOffset << ")");
+
+	//Packed symbols (payloads)
+	for (u_int32_t i = 0; i < size; i++)
+	{
+		src [srcOffset + i] = random.GetInteger (0, 255);
+		dst [dstOffset + i] = random.GetInteger (0, 255);
+	}
+	expected = dst;
+	ReferenceMultiplyAddRegion (field, &expected [dstOffset], &src [srcOffset], c, size);
+	field.MultiplyAddRegion (&dst [dstOffset], &src [srcOffset], c, size);
+	NS_TEST_ASSERT_MSG_EQ ((dst == expected), true, "MultiplyAddRegion mismatch (" << GaloisField::GetKernelName () << ", Q=" << (int) q
+			<< ", c=" << (int) c << ", size=" << size << ", offsets=" << srcOffset << "/" << dstOffset << ")");
+}
+
+void GaloisFieldRegionTestCase::DoRun (void)
+{
+	UniformVariable random;
+	//Around the SSSE3 (16 bytes) and AVX2 (32 bytes) blocks, plus a payload-like length with a tail
+	u_int32_t sizes [] = {0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 24, 31, 32, 33, 47, 48, 63, 64, 65, 95, 96, 97, 1000, 1463};
+	u_int32_t offsets [][2] = {{0, 0}, {1, 1}, {1, 3}, {7, 0}, {0, 13}};
+
+	for (u_int8_t q = 1; q <= 8; q++)
+	{
+		GaloisField field (q);
+		std::vector<u_int8_t> coefficients;
+		for (u_int16_t c = 0; c < field.GetOrder (); c++)
+		{
+			if (field.GetOrder () <= 32 || c <= 2 || c == field.GetOrder () - 1 || random.GetInteger (0, 15) == 0)
+			{
+				coefficients.push_back (c);
+			}
+		}
+
+		for (u_int32_t i = 0; i < coefficients.size (); i++)
+		{
+			for (u_int32_t j = 0; j < sizeof (sizes) / sizeof (sizes [0]); j++)
+			{
+				//Unless q divides 8, the regions are made of whole blocks of q bytes
+				u_int32_t size = field.GetRegionSize (sizes [j]);
+				for (u_int32_t k = 0; k < sizeof (offsets) / sizeof (offsets [0]); k++)
+				{
+					CheckRegion (random, field, coefficients [i], size, GUARD - offsets [k][0], GUARD + offsets [k][1]);
+				}
+			}
+		}
+	}
+}
+
+class GaloisFieldTestSuite : public TestSuite
+{
+public:
+	GaloisFieldTestSuite ();
+};
+
+GaloisFieldTestSuite::GaloisFieldTestSuite ()
+	: TestSuite ("galois-field", UNIT)
+{
+	AddTestCase (new GaloisFieldRegionTestCase);
+}
+
+static GaloisFieldTestSuite galoisFieldTestSuite;
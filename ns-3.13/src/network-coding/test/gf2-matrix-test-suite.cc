@@ -0,0 +1,230 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/random-variable.h"
+#include "ns3/gf2-matrix.h"
+#include "ns3/intra-flow-network-coding-decoder.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * The bit-packed GF2Matrix against the byte-per-element IntraFlowNetworkCodingDecoder (q=1): both are fed with the same coded
+ * packets (random binary combinations of K source symbols), and they must agree on the innovative vectors, the rank, the rows
+ * (read through CombineRows), the recoded vectors and payloads, and the symbols recovered after Solve
+ */
+class GF2MatrixTestCase : public TestCase
+{
+public:
+	GF2MatrixTestCase ();
+	virtual ~GF2MatrixTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * Decode a single fragment, comparing both matrices as the coded packets arrive
+	 * \param density Probability of every coefficient being 1 (the sparser the vectors, the more dependent ones)
+	 */
+	void CheckFragment (UniformVariable &random, u_int16_t k, u_int32_t size, double density);
+	/**
+	 * Compare every row held by both matrices
+	 */
+	void CheckRows (const GF2Matrix &matrix, const IntraFlowNetworkCodingDecoder &decoder);
+};
+
+GF2MatrixTestCase::GF2MatrixTestCase ()
+	: TestCase ("GF(2) bit-packed matrix against the byte-per-element decoder")
+{
+}
+
+GF2MatrixTestCase::~GF2MatrixTestCase ()
+{
+}
+
+void GF2MatrixTestCase::CheckRows (const GF2Matrix &matrix, const IntraFlowNetworkCodingDecoder &decoder)
+{
+	u_int16_t k = matrix.GetK ();
+	std::vector<u_int8_t> unit (k, 0);
+	std::vector<u_int8_t> row;
+
+	NS_TEST_ASSERT_MSG_EQ (matrix.GetRank (), decoder.GetRank (), "Different rank (K=" << k << ")");
+	NS_TEST_ASSERT_MSG_EQ (matrix.IsFull (), decoder.IsFull (), "Different full-rank condition (K=" << k << ")");
+	for (u_int16_t column = 0; column < k; column++)
+	{
+		NS_TEST_ASSERT_MSG_EQ (matrix.HasPivot (column), decoder.HasPivot (column), "Different pivots (K=" << k << ", column " << column << ")");
+		if (!matrix.HasPivot (column))
+		{
+			continue;
+		}
+
+		//The combination with a unit vector is the row itself
+		unit [column] = 1;
+		matrix.CombineRows (unit, row);
+		unit [column] = 0;
+		NS_TEST_ASSERT_MSG_EQ ((row == std::vector<u_int8_t> (decoder.GetRow (column), decoder.GetRow (column) + k)), true,
+				"Different row (K=" << k << ", column " << column << ")");
+		NS_TEST_ASSERT_MSG_EQ ((matrix.GetPayload (column) == decoder.GetPayload (column)), true,
+				"Different payload (K=" << k << ", column " << column << ")");
+	}
+}
+
+void GF2MatrixTestCase::CheckFragment (UniformVariable &random, u_int16_t k, u_int32_t size, double density)
+{
+	GF2Matrix matrix;
+	IntraFlowNetworkCodingDecoder decoder;
+	matrix.Reset (k);
+	decoder.Reset (k, 1);
+
+	GaloisField field (1);
+	std::vector<std::vector<u_int8_t> > symbols (k, std::vector<u_int8_t> (size));
+	for (u_int16_t i = 0; i < k; i++)
+	{
+		for (u_int32_t j = 0; j < size; j++)
+		{
+			symbols [i][j] = random.GetInteger (0, 255);
+		}
+	}
+
+	std::vector<u_int8_t> vector (k);
+	std::vector<u_int8_t> payload (size);
+	u_int32_t received = 0;
+	while (!matrix.IsFull () && received < 20 * k)
+	{
+		std::fill (payload.begin (), payload.end (), 0);
+		for (u_int16_t i = 0; i < k; i++)
+		{
+			vector [i] = (random.GetValue () < density) ? 1 : 0;
+			field.MultiplyAddRegion (&payload [0], &symbols [i][0], vector [i], size);
+		}
+		received++;
+
+		bool innovative = matrix.AddVector (vector, &payload [0], size);
+		NS_TEST_ASSERT_MSG_EQ (innovative, decoder.AddVector (vector, &payload [0], size),
+				"Different innovative decision (K=" << k << ", packet " << received << ")");
+		NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (vector, &payload [0], size), false, "A repeated vector cannot be innovative (K=" << k << ")");
+		decoder.AddVector (vector, &payload [0], size);
+
+		if (received % 7 == 0 || matrix.IsFull ())
+		{
+			CheckRows (matrix, decoder);
+
+			//Recoding
+			std::vector<u_int8_t> coefficients (k);
+			std::vector<u_int8_t> matrixVector, matrixPayload, decoderVector, decoderPayload;
+			for (u_int16_t i = 0; i < k; i++)
+			{
+				coefficients [i] = random.GetInteger (0, 1);
+			}
+			matrix.CombineRows (coefficients, matrixVector, matrixPayload);
+			decoder.CombineRows (coefficients, decoderVector, decoderPayload);
+			NS_TEST_ASSERT_MSG_EQ ((matrixVector == decoderVector), true, "Different recoded vector (K=" << k << ")");
+			NS_TEST_ASSERT_MSG_EQ ((matrixPayload == decoderPayload), true, "Different recoded payload (K=" << k << ")");
+		}
+	}
+	NS_TEST_ASSERT_MSG_EQ (matrix.IsFull (), true, "The fragment has not been completed (K=" << k << ")");
+
+	matrix.Solve ();
+	decoder.Solve ();
+	CheckRows (matrix, decoder);
+	for (u_int16_t i = 0; i < k; i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ ((matrix.GetPayload (i) == symbols [i]), true, "Wrong decoded symbol (K=" << k << ", symbol " << i << ")");
+	}
+}
+
+void GF2MatrixTestCase::DoRun (void)
+{
+	UniformVariable random;
+	//Around the 64-bit word boundaries
+	u_int16_t k [] = {1, 2, 8, 63, 64, 65, 127, 128, 129, 200, 255};
+	double density [] = {0.5, 0.1};
+
+	for (u_int32_t i = 0; i < sizeof (k) / sizeof (k [0]); i++)
+	{
+		for (u_int32_t j = 0; j < sizeof (density) / sizeof (density [0]); j++)
+		{
+			CheckFragment (random, k [i], random.GetInteger (1, 100), density [j]);
+		}
+	}
+
+	//Coefficients-only mode and vectors shorter than K (the missing coefficients are null)
+	GF2Matrix matrix;
+	matrix.Reset (70);
+	NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (std::vector<u_int8_t> (3, 1)), true, "The first non-null vector is innovative");
+	NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (std::vector<u_int8_t> (70, 0)), false, "A null vector cannot be innovative");
+	NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (std::vector<u_int8_t> (2, 1)), true, "Independent vector");
+	NS_TEST_ASSERT_MSG_EQ (matrix.GetRank (), 2, "Wrong rank");
+	std::vector<u_int8_t> vector (70, 0);
+	vector [2] = 1;
+	NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (vector), false, "Sum of the previous vectors");
+	NS_TEST_ASSERT_MSG_EQ (matrix.GetPayload (0).size (), 0, "No payload should be kept in the coefficients-only mode");
+
+	//Systematic phase: every native but one (across a word boundary), plus a single coded packet
+	u_int16_t systematicK = 100;
+	u_int32_t size = 37;
+	u_int16_t lost = 70;
+	std::vector<std::vector<u_int8_t> > symbols (systematicK, std::vector<u_int8_t> (size));
+	std::vector<u_int8_t> payload (size, 0);
+	GaloisField field (1);
+	matrix.Reset (systematicK);
+	for (u_int16_t i = 0; i < systematicK; i++)
+	{
+		for (u_int32_t j = 0; j < size; j++)
+		{
+			symbols [i][j] = random.GetInteger (0, 255);
+		}
+		if (i != lost)
+		{
+			vector.assign (systematicK, 0);
+			vector [i] = 1;
+			matrix.AddVector (vector, &symbols [i][0], size);
+		}
+	}
+	for (u_int16_t i = 0; i < systematicK; i++)
+	{
+		vector [i] = (i == lost) ? 1 : random.GetInteger (0, 1);
+		field.MultiplyAddRegion (&payload [0], &symbols [i][0], vector [i], size);
+	}
+	NS_TEST_ASSERT_MSG_EQ (matrix.AddVector (vector, &payload [0], size), true, "The coded packet is innovative");
+	NS_TEST_ASSERT_MSG_EQ (matrix.IsFull (), true, "A single coded packet completes the matrix");
+	matrix.Solve ();
+	for (u_int16_t i = 0; i < systematicK; i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ ((matrix.GetPayload (i) == symbols [i]), true, "Wrong decoded symbol " << i << " (lost native)");
+	}
+}
+
+class GF2MatrixTestSuite : public TestSuite
+{
+public:
+	GF2MatrixTestSuite ();
+};
+
+GF2MatrixTestSuite::GF2MatrixTestSuite ()
+	: TestSuite ("gf2-matrix", UNIT)
+{
+	AddTestCase (new GF2MatrixTestCase);
+}
+
+static GF2MatrixTestSuite gf2MatrixTestSuite;
@@ -0,0 +1,250 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/flow-table.h"
+#include "ns3/hash-id.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/inter-flow-network-coding-buffer.h"
+
+#include <set>
+#include <vector>
+
+using namespace ns3;
+
+//Number of flows sharing the same sequence numbers and slots of the tables they are inserted into
+static const u_int16_t FLOWS = 32;
+static const u_int32_t SLOTS = 128;
+
+/**
+ * Keys of the decoding buffer and neighbour state tables: several flows with identical sequence numbers (every TCP flow starts at
+ * ISN 0) must be spread over the FlowTable slots, and they must still be told apart on lookup
+ */
+class InterFlowNetworkCodingBufferKeyTestCase : public TestCase
+{
+public:
+	InterFlowNetworkCodingBufferKeyTestCase ();
+	virtual ~InterFlowNetworkCodingBufferKeyTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * Insert FLOWS keys into a table and check the number of different home slots (hash & mask) and the lookups
+	 */
+	template <typename Key>
+	void CheckKeys (const std::vector<Key> &keys, const std::string &name);
+};
+
+InterFlowNetworkCodingBufferKeyTestCase::InterFlowNetworkCodingBufferKeyTestCase ()
+	: TestCase ("Inter-flow network coding buffer keys with identical sequence numbers")
+{
+}
+
+InterFlowNetworkCodingBufferKeyTestCase::~InterFlowNetworkCodingBufferKeyTestCase ()
+{
+}
+
+template <typename Key>
+void InterFlowNetworkCodingBufferKeyTestCase::CheckKeys (const std::vector<Key> &keys, const std::string &name)
+{
+	FlowTable<u_int32_t, Key> table (SLOTS);
+	std::set<u_int32_t> homes;
+	for (u_int32_t i = 0; i < keys.size (); i++)
+	{
+		table [keys [i]] = i;
+		homes.insert (keys [i].Hash () & (SLOTS - 1));
+	}
+
+	//Uniform hashing would leave around 28 different home slots; the flows used to share a single one
+	NS_TEST_ASSERT_MSG_GT (homes.size (), keys.size () / 2, name << ": the flows collide on the same slots");
+	NS_TEST_ASSERT_MSG_EQ (table.size (), keys.size (), name << ": different flows sharing an entry");
+	for (u_int32_t i = 0; i < keys.size (); i++)
+	{
+		typename FlowTable<u_int32_t, Key>::iterator it = table.find (keys [i]);
+		NS_TEST_ASSERT_MSG_EQ ((it != table.end ()), true, name << ": flow " << i << " not found");
+		NS_TEST_ASSERT_MSG_EQ (it->second, i, name << ": wrong entry for flow " << i);
+	}
+}
+
+void InterFlowNetworkCodingBufferKeyTestCase::DoRun (void)
+{
+	u_int32_t seqNums [] = {0, 1, 537, 65536};
+	for (u_int32_t i = 0; i < sizeof (seqNums) / sizeof (seqNums [0]); i++)
+	{
+		std::vector<InterFlowNetworkCodingBuffer::DecodingKey> decodingKeys;
+		std::vector<InterFlowNetworkCodingBuffer::NeighbourKey> neighbourKeys;
+		for (u_int16_t flow = 0; flow < FLOWS; flow++)
+		{
+			decodingKeys.push_back (InterFlowNetworkCodingBuffer::DecodingKey (flow + 1, seqNums [i]));
+			//Same neighbour, different flows
+			neighbourKeys.push_back (InterFlowNetworkCodingBuffer::NeighbourKey (Ipv4Address ("10.0.0.1"), flow + 1, seqNums [i]));
+		}
+		CheckKeys (decodingKeys, "DecodingKey");
+		CheckKeys (neighbourKeys, "NeighbourKey");
+
+		//Same flow, different neighbours (consecutive addresses)
+		neighbourKeys.clear ();
+		for (u_int16_t neighbour = 0; neighbour < FLOWS; neighbour++)
+		{
+			neighbourKeys.push_back (InterFlowNetworkCodingBuffer::NeighbourKey (Ipv4Address (0x0a000001 + neighbour), 1, seqNums [i]));
+		}
+		CheckKeys (neighbourKeys, "NeighbourKey (neighbours)");
+	}
+}
+
+/**
+ * Re-encoding at a relay (InterFlowNetworkCodingBuffer::ExtendCombination): a coded packet carrying two natives is only extended with the
+ * heads of the input packet pool which every destination can decode, up to MaxCodedPackets, and never without the reception reports
+ */
+class InterFlowNetworkCodingBufferReencodingTestCase : public TestCase
+{
+public:
+	InterFlowNetworkCodingBufferReencodingTestCase ();
+	virtual ~InterFlowNetworkCodingBufferReencodingTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * \returns A buffer holding the natives of the flows 2 and 3 at its input packet pool, and the reception state of its neighbours
+	 */
+	Ptr<InterFlowNetworkCodingBuffer> CreateBuffer (bool receptionReports, u_int8_t maxCodedPackets);
+	/**
+	 * \returns A coded packet header which carries the natives of the flows 0 and 1
+	 */
+	InterFlowNetworkCodingHeader CreateHeader ();
+
+	static const u_int8_t NATIVES = 4;
+	Ipv4Address m_source [NATIVES];
+	Ipv4Address m_destination [NATIVES];
+	u_int16_t m_hash [NATIVES];
+};
+
+InterFlowNetworkCodingBufferReencodingTestCase::InterFlowNetworkCodingBufferReencodingTestCase ()
+	: TestCase ("Inter-flow network coding re-encoding of forwarded coded packets")
+{
+	for (u_int8_t i = 0; i < NATIVES; i++)
+	{
+		m_source [i] = Ipv4Address (0x0a000001 + i);
+		m_destination [i] = Ipv4Address (0x0a000011 + i);
+		m_hash [i] = HashID (m_source [i], m_destination [i], 49153, 50000);
+	}
+}
+
+InterFlowNetworkCodingBufferReencodingTestCase::~InterFlowNetworkCodingBufferReencodingTestCase ()
+{
+}
+
+Ptr<InterFlowNetworkCodingBuffer> InterFlowNetworkCodingBufferReencodingTestCase::CreateBuffer (bool receptionReports, u_int8_t maxCodedPackets)
+{
+	Ptr<InterFlowNetworkCodingBuffer> buffer = CreateObject<InterFlowNetworkCodingBuffer> ();
+	buffer->SetAttribute ("ReceptionReports", BooleanValue (receptionReports));
+	buffer->SetMaxCodedPackets (maxCodedPackets);
+	buffer->SetBufferSize (10);
+
+	//Heads of the input packet pool: the natives 2 and 3 (sequence number = index)
+	for (u_int8_t i = 2; i < NATIVES; i++)
+	{
+		TcpHeader tcpHeader;
+		tcpHeader.SetSourcePort (49153);
+		tcpHeader.SetDestinationPort (50000);
+		tcpHeader.SetSequenceNumber (SequenceNumber32 (i));
+		Ptr<Packet> packet = Create<Packet> (100 + i);
+		packet->AddHeader (tcpHeader);
+
+		InterFlowNetworkCodingHeader ncHeader;
+		ncHeader.SetCodedPackets (1);
+		buffer->UpdateInputPacketPool (packet, ncHeader, m_source [i], m_destination [i], 6);
+	}
+
+	//The destination of the native 2 holds the coded ones (0 and 1), and their destinations hold the native 2; nobody holds the native 3
+	for (u_int8_t i = 0; i < 2; i++)
+	{
+		buffer->UpdateNeighbourState (m_destination [2], m_hash [i], i);
+		buffer->UpdateNeighbourState (m_destination [i], m_hash [2], 2);
+	}
+	return buffer;
+}
+
+InterFlowNetworkCodingHeader InterFlowNetworkCodingBufferReencodingTestCase::CreateHeader ()
+{
+	InterFlowNetworkCodingHeader ncHeader;
+	for (u_int8_t i = 0; i < 2; i++)
+	{
+		ncHeader.m_packetVector.push_back (InterFlowNetworkCodingHeader::Item (m_destination [i], SequenceNumber32 (i), m_hash [i], 120));
+	}
+	ncHeader.SetCodedPackets (2);
+	return ncHeader;
+}
+
+void InterFlowNetworkCodingBufferReencodingTestCase::DoRun (void)
+{
+	std::vector <struct NetworkCodingItem> added;
+
+	//Only the decodable native (2) is added
+	Ptr<InterFlowNetworkCodingBuffer> buffer = CreateBuffer (true, 4);
+	InterFlowNetworkCodingHeader ncHeader = CreateHeader ();
+	NS_TEST_ASSERT_MSG_EQ (buffer->ExtendCombination (ncHeader, added), true, "The decodable native has not been added");
+	NS_TEST_ASSERT_MSG_EQ (added.size (), 1, "Wrong number of added natives");
+	NS_TEST_ASSERT_MSG_EQ (added [0].destination, m_destination [2], "The added native is not decodable by every destination");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.GetCodedPackets (), 3, "Wrong number of coded packets");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.m_packetVector.size (), 3, "Wrong header bookkeeping");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.m_packetVector [2].destination, m_destination [2], "Wrong destination of the added native");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.m_packetVector [2].seqNum, SequenceNumber32 (2), "Wrong sequence number of the added native");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.m_packetVector [2].payloadLength, added [0].packet->GetSize (), "Wrong length of the added native");
+
+	//The native left at the input packet pool cannot be added either
+	added.clear ();
+	NS_TEST_ASSERT_MSG_EQ (buffer->ExtendCombination (ncHeader, added), false, "An undecodable native has been added");
+
+	//MaxCodedPackets already reached
+	added.clear ();
+	buffer = CreateBuffer (true, 2);
+	ncHeader = CreateHeader ();
+	NS_TEST_ASSERT_MSG_EQ (buffer->ExtendCombination (ncHeader, added), false, "MaxCodedPackets exceeded");
+	NS_TEST_ASSERT_MSG_EQ (ncHeader.GetCodedPackets (), 2, "The header has been modified");
+
+	//Without the reception reports, nothing is known about the destinations, hence the coded packets are never extended
+	buffer = CreateBuffer (false, 4);
+	ncHeader = CreateHeader ();
+	NS_TEST_ASSERT_MSG_EQ (buffer->ExtendCombination (ncHeader, added), false, "Natives blindly added without the reception reports");
+	NS_TEST_ASSERT_MSG_EQ (added.size (), 0, "Natives blindly added without the reception reports");
+
+	buffer = 0;
+	Simulator::Destroy ();
+}
+
+class InterFlowNetworkCodingBufferTestSuite : public TestSuite
+{
+public:
+	InterFlowNetworkCodingBufferTestSuite ();
+};
+
+InterFlowNetworkCodingBufferTestSuite::InterFlowNetworkCodingBufferTestSuite ()
+	: TestSuite ("inter-flow-network-coding-buffer", UNIT)
+{
+	AddTestCase (new InterFlowNetworkCodingBufferKeyTestCase);
+	AddTestCase (new InterFlowNetworkCodingBufferReencodingTestCase);
+}
+
+static InterFlowNetworkCodingBufferTestSuite interFlowNetworkCodingBufferTestSuite;
@@ -0,0 +1,153 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable.h"
+#include "ns3/inter-flow-network-coding-header.h"
+
+using namespace ns3;
+
+static InterFlowNetworkCodingHeader::AckInfo MakeAck (Ipv4Address destination, u_int16_t sourcePort, u_int16_t destinationPort,
+		u_int32_t seqNum, u_int32_t ackNum, u_int16_t window)
+{
+	TcpHeader tcpHeader;
+	tcpHeader.SetSourcePort (sourcePort);
+	tcpHeader.SetDestinationPort (destinationPort);
+	tcpHeader.SetSequenceNumber (SequenceNumber32 (seqNum));
+	tcpHeader.SetAckNumber (SequenceNumber32 (ackNum));
+	tcpHeader.SetWindowSize (window);
+	return InterFlowNetworkCodingHeader::AckInfo (destination, tcpHeader);
+}
+
+/**
+ * Embedded ACK codec (flow table + zigzag/varint deltas): round trip, negative deltas, extreme values and the length accounted
+ * on the fly by AddTcpAck/RemoveLastTcpAck
+ */
+class InterFlowNetworkCodingHeaderAckTestCase : public TestCase
+{
+public:
+	InterFlowNetworkCodingHeaderAckTestCase ();
+	virtual ~InterFlowNetworkCodingHeaderAckTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * Serialize the header, check its size and compare the ACKs retrieved from the wire with the original ones
+	 */
+	void CheckRoundTrip (const InterFlowNetworkCodingHeader &header);
+};
+
+InterFlowNetworkCodingHeaderAckTestCase::InterFlowNetworkCodingHeaderAckTestCase ()
+	: TestCase ("Inter-flow header embedded ACK codec")
+{
+}
+
+InterFlowNetworkCodingHeaderAckTestCase::~InterFlowNetworkCodingHeaderAckTestCase ()
+{
+}
+
+void InterFlowNetworkCodingHeaderAckTestCase::CheckRoundTrip (const InterFlowNetworkCodingHeader &header)
+{
+	Ptr<Packet> packet = Create<Packet> (0);
+	packet->AddHeader (header);
+	NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), header.GetSerializedSize (), "Wrong serialized size (" << header.GetTcpAcks ().size () << " ACKs)");
+
+	InterFlowNetworkCodingHeader received;
+	packet->RemoveHeader (received);
+	NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 0, "Bytes left after the header");
+	NS_TEST_ASSERT_MSG_EQ (received.GetSerializedSize (), header.GetSerializedSize (), "Different size of the received header");
+	NS_TEST_ASSERT_MSG_EQ (received.GetTcpAcks ().size (), header.GetTcpAcks ().size (), "Wrong number of ACKs");
+
+	for (u_int32_t i = 0; i < header.GetTcpAcks ().size (); i++)
+	{
+		const InterFlowNetworkCodingHeader::AckInfo &sent = header.GetTcpAcks ()[i];
+		const InterFlowNetworkCodingHeader::AckInfo &ack = received.GetTcpAcks ()[i];
+		NS_TEST_ASSERT_MSG_EQ (ack.destination, sent.destination, "Wrong destination (ACK " << i << ")");
+		NS_TEST_ASSERT_MSG_EQ (ack.tcpHeader.GetSourcePort (), sent.tcpHeader.GetSourcePort (), "Wrong source port (ACK " << i << ")");
+		NS_TEST_ASSERT_MSG_EQ (ack.tcpHeader.GetDestinationPort (), sent.tcpHeader.GetDestinationPort (), "Wrong destination port (ACK " << i << ")");
+		NS_TEST_ASSERT_MSG_EQ (ack.tcpHeader.GetSequenceNumber (), sent.tcpHeader.GetSequenceNumber (), "Wrong sequence number (ACK " << i << ")");
+		NS_TEST_ASSERT_MSG_EQ (ack.tcpHeader.GetAckNumber (), sent.tcpHeader.GetAckNumber (), "Wrong ACK number (ACK " << i << ")");
+		NS_TEST_ASSERT_MSG_EQ (ack.tcpHeader.GetWindowSize (), sent.tcpHeader.GetWindowSize (), "Wrong window (ACK " << i << ")");
+	}
+}
+
+void InterFlowNetworkCodingHeaderAckTestCase::DoRun (void)
+{
+	//Extreme values: the largest positive (2^31 - 1) and negative (-2^31) deltas take 5 bytes each, a 0xffff window 3 bytes
+	//4 (fixed) + 1 (number of flows) + 8 (flow) + 1 (index) + 5 + 5 + 3
+	InterFlowNetworkCodingHeader header;
+	header.AddTcpAck (MakeAck (Ipv4Address ("255.255.255.255"), 65535, 0, 0x7fffffff, 0x80000000, 0xffff));
+	NS_TEST_ASSERT_MSG_EQ (header.GetSerializedSize (), 27, "Wrong length of the extreme deltas");
+	CheckRoundTrip (header);
+
+	//Back to zero (negative deltas) and wrap-around of the sequence numbers
+	header.AddTcpAck (MakeAck (Ipv4Address ("255.255.255.255"), 65535, 0, 0, 0xffffffff, 0));
+	header.AddTcpAck (MakeAck (Ipv4Address ("255.255.255.255"), 65535, 0, 0xffffffff, 0, 1));
+	CheckRoundTrip (header);
+
+	//Small deltas around the varint boundaries (127/128, 16383/16384), interleaving two more flows
+	u_int32_t deltas [] = {0, 1, 63, 64, 127, 128, 8191, 8192, 16383, 16384};
+	u_int32_t seqNum = 1000;
+	u_int32_t ackNum = 2000;
+	for (u_int8_t i = 0; i < 10; i++)
+	{
+		seqNum += deltas [i];
+		ackNum -= deltas [i];
+		header.AddTcpAck (MakeAck (Ipv4Address ("10.0.0.1"), 49153, 9, seqNum, ackNum, 65535 - deltas [i]));
+		header.AddTcpAck (MakeAck (Ipv4Address ("10.0.0.2"), 49153, 9, ackNum, seqNum, deltas [i]));
+		CheckRoundTrip (header);
+	}
+
+	//Removing the last ACK accounts the length as if it had never been added
+	UniformVariable random;
+	InterFlowNetworkCodingHeader reference;
+	for (u_int32_t i = 0; i < 200; i++)
+	{
+		InterFlowNetworkCodingHeader::AckInfo ack = MakeAck (Ipv4Address (random.GetInteger (1, 4)), random.GetInteger (0, 1), 80,
+				(u_int32_t) random.GetValue (0, 4294967296.0), (u_int32_t) random.GetValue (0, 4294967296.0), random.GetInteger (0, 65535));
+
+		reference.AddTcpAck (ack);
+		header = reference;
+		header.AddTcpAck (MakeAck (Ipv4Address ("10.0.0.9"), 1, 1, 0xffffffff, 0xffffffff, 0xffff));
+		header.RemoveLastTcpAck ();
+		NS_TEST_ASSERT_MSG_EQ (header.GetSerializedSize (), reference.GetSerializedSize (), "Wrong length after removing an ACK");
+		CheckRoundTrip (header);
+	}
+
+	header.ClearTcpAcks ();
+	NS_TEST_ASSERT_MSG_EQ (header.GetSerializedSize (), 4, "ACKs left after clearing them");
+}
+
+class InterFlowNetworkCodingHeaderTestSuite : public TestSuite
+{
+public:
+	InterFlowNetworkCodingHeaderTestSuite ();
+};
+
+InterFlowNetworkCodingHeaderTestSuite::InterFlowNetworkCodingHeaderTestSuite ()
+	: TestSuite ("inter-flow-network-coding-header", UNIT)
+{
+	AddTestCase (new InterFlowNetworkCodingHeaderAckTestCase);
+}
+
+static InterFlowNetworkCodingHeaderTestSuite interFlowNetworkCodingHeaderTestSuite;
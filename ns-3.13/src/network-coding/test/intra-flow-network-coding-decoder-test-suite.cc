@@ -0,0 +1,396 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/test.h"
+#include "ns3/random-variable.h"
+#include "ns3/intra-flow-network-coding-decoder.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Rank of a set of vectors, by means of a plain (non-incremental) Gaussian elimination over GF(2^q), used as the reference of the decoder
+ */
+static u_int16_t ReferenceRank (const GaloisField &field, std::vector<std::vector<u_int8_t> > matrix, u_int16_t k)
+{
+	u_int16_t rank = 0;
+	for (u_int16_t column = 0; column < k && rank < matrix.size (); column++)
+	{
+		u_int32_t pivot = rank;
+		while (pivot < matrix.size () && !matrix [pivot][column])
+		{
+			pivot++;
+		}
+		if (pivot == matrix.size ())
+		{
+			continue;
+		}
+		matrix [pivot].swap (matrix [rank]);
+
+		u_int8_t inverse = field.Inv (matrix [rank][column]);
+		for (u_int32_t row = rank + 1; row < matrix.size (); row++)
+		{
+			u_int8_t c = field.Mul (matrix [row][column], inverse);
+			field.MultiplyAdd (&matrix [row][0], &matrix [rank][0], c, k);
+		}
+		rank++;
+	}
+	return rank;
+}
+
+/**
+ * Random coefficient vector over GF(2^q), whose non-null entries are restricted to the columns [0, support)
+ */
+static void RandomVector (UniformVariable &random, const GaloisField &field, u_int16_t k, u_int16_t support, std::vector<u_int8_t> &vector)
+{
+	vector.assign (k, 0);
+	for (u_int16_t i = 0; i < support; i++)
+	{
+		vector [i] = random.GetInteger (0, field.GetOrder () - 1);
+	}
+}
+
+/**
+ * Coded payload carried along with a coefficient vector: the combination of the source symbols starting at "first"
+ */
+static void Encode (const GaloisField &field, const std::vector<std::vector<u_int8_t> > &symbols, u_int32_t first,
+		const std::vector<u_int8_t> &vector, std::vector<u_int8_t> &payload)
+{
+	payload.assign (symbols [0].size (), 0);
+	for (u_int16_t i = 0; i < vector.size (); i++)
+	{
+		field.MultiplyAddRegion (&payload [0], &symbols [first + i][0], vector [i], payload.size ());
+	}
+}
+
+/**
+ * AddVector: innovative vs. dependent vectors (null, scaled and combinations of the received ones) and the rank, checked against
+ * a plain Gaussian elimination, for every q
+ */
+class IntraFlowNetworkCodingDecoderRankTestCase : public TestCase
+{
+public:
+	IntraFlowNetworkCodingDecoderRankTestCase ();
+	virtual ~IntraFlowNetworkCodingDecoderRankTestCase ();
+
+private:
+	virtual void DoRun (void);
+};
+
+IntraFlowNetworkCodingDecoderRankTestCase::IntraFlowNetworkCodingDecoderRankTestCase ()
+	: TestCase ("Intra-flow decoder innovative vectors and rank")
+{
+}
+
+IntraFlowNetworkCodingDecoderRankTestCase::~IntraFlowNetworkCodingDecoderRankTestCase ()
+{
+}
+
+void IntraFlowNetworkCodingDecoderRankTestCase::DoRun (void)
+{
+	UniformVariable random;
+	IntraFlowNetworkCodingDecoder decoder;
+	u_int16_t k [] = {1, 5, 16, 33, 64};
+
+	for (u_int8_t q = 1; q <= 8; q++)
+	{
+		GaloisField field (q);
+		for (u_int32_t i = 0; i < sizeof (k) / sizeof (k [0]); i++)
+		{
+			//The same decoder is reused for every fragment, as the protocol does
+			decoder.Reset (k [i], q);
+			std::vector<std::vector<u_int8_t> > received;
+			std::vector<u_int8_t> vector;
+
+			RandomVector (random, field, k [i], 0, vector);
+			NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (vector), false, "A null vector cannot be innovative (Q=" << (int) q << ")");
+
+			while (!decoder.IsFull ())
+			{
+				//Sparse vectors over a growing support, so that some of them are dependent on the previous ones
+				RandomVector (random, field, k [i], random.GetInteger (1, k [i]), vector);
+				received.push_back (vector);
+				u_int16_t rank = decoder.GetRank ();
+				bool innovative = decoder.AddVector (vector);
+
+				NS_TEST_ASSERT_MSG_EQ (decoder.GetRank (), ReferenceRank (field, received, k [i]),
+						"Wrong rank (Q=" << (int) q << ", K=" << k [i] << ")");
+				NS_TEST_ASSERT_MSG_EQ (innovative, (decoder.GetRank () == rank + 1),
+						"The innovative decision does not match the rank (Q=" << (int) q << ", K=" << k [i] << ")");
+
+				if (decoder.GetRank () > 1 && !decoder.IsFull ())
+				{
+					//Scaled version and combination of two of the received vectors
+					std::vector<u_int8_t> combination (vector);
+					u_int8_t c = random.GetInteger (1, field.GetOrder () - 1);
+					for (u_int16_t j = 0; j < k [i]; j++)
+					{
+						combination [j] = field.Mul (c, vector [j]);
+					}
+					NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (combination), false, "A scaled vector cannot be innovative (Q=" << (int) q << ")");
+
+					const std::vector<u_int8_t> &other = received [random.GetInteger (0, received.size () - 1)];
+					field.MultiplyAdd (&combination [0], &other [0], random.GetInteger (1, field.GetOrder () - 1), k [i]);
+					NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (combination), false, "A combination cannot be innovative (Q=" << (int) q << ")");
+				}
+			}
+
+			NS_TEST_ASSERT_MSG_EQ (decoder.GetRank (), k [i], "Wrong rank of a full matrix");
+			RandomVector (random, field, k [i], k [i], vector);
+			NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (vector), false, "Nothing is innovative for a full matrix");
+		}
+	}
+}
+
+/**
+ * Decoding round trip: coded payloads over every q, Solve, and the sliding window (GetDecodedPrefix and Shift) along a stream of
+ * source symbols
+ */
+class IntraFlowNetworkCodingDecoderRoundTripTestCase : public TestCase
+{
+public:
+	IntraFlowNetworkCodingDecoderRoundTripTestCase ();
+	virtual ~IntraFlowNetworkCodingDecoderRoundTripTestCase ();
+
+private:
+	virtual void DoRun (void);
+	/**
+	 * Feed the decoder with coded packets whose vectors are restricted to the columns [0, support), until its rank reaches "rank"
+	 * \param first Source symbol of the first column of the window
+	 */
+	void Receive (UniformVariable &random, const GaloisField &field, IntraFlowNetworkCodingDecoder &decoder,
+			const std::vector<std::vector<u_int8_t> > &symbols, u_int32_t first, u_int16_t support, u_int16_t rank);
+	/**
+	 * Check that the first "count" rows of the (solved) decoder hold the source symbols starting at "first"
+	 */
+	void CheckDecoded (const IntraFlowNetworkCodingDecoder &decoder, const std::vector<std::vector<u_int8_t> > &symbols,
+			u_int32_t first, u_int16_t count);
+};
+
+IntraFlowNetworkCodingDecoderRoundTripTestCase::IntraFlowNetworkCodingDecoderRoundTripTestCase ()
+	: TestCase ("Intra-flow decoder round trip (Solve, GetDecodedPrefix and Shift)")
+{
+}
+
+IntraFlowNetworkCodingDecoderRoundTripTestCase::~IntraFlowNetworkCodingDecoderRoundTripTestCase ()
+{
+}
+
+void IntraFlowNetworkCodingDecoderRoundTripTestCase::Receive (UniformVariable &random, const GaloisField &field,
+		IntraFlowNetworkCodingDecoder &decoder, const std::vector<std::vector<u_int8_t> > &symbols, u_int32_t first,
+		u_int16_t support, u_int16_t rank)
+{
+	std::vector<u_int8_t> vector;
+	std::vector<u_int8_t> payload;
+	u_int32_t packets = 0;
+
+	while (decoder.GetRank () < rank && packets < 100 * decoder.GetK ())
+	{
+		RandomVector (random, field, decoder.GetK (), support, vector);
+		Encode (field, symbols, first, vector, payload);
+		decoder.AddVector (vector, &payload [0], payload.size ());
+		packets++;
+	}
+	NS_TEST_ASSERT_MSG_EQ (decoder.GetRank (), rank, "The expected rank has not been reached (Q=" << (int) field.GetQ () << ")");
+}
+
+void IntraFlowNetworkCodingDecoderRoundTripTestCase::CheckDecoded (const IntraFlowNetworkCodingDecoder &decoder,
+		const std::vector<std::vector<u_int8_t> > &symbols, u_int32_t first, u_int16_t count)
+{
+	for (u_int16_t i = 0; i < count; i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ (decoder.HasPivot (i), true, "Missing row " << i);
+		NS_TEST_ASSERT_MSG_EQ ((decoder.GetPayload (i) == symbols [first + i]), true, "Wrong decoded symbol " << first + i
+				<< " (K=" << decoder.GetK () << ")");
+		for (u_int16_t j = 0; j < decoder.GetK (); j++)
+		{
+			NS_TEST_ASSERT_MSG_EQ ((int) decoder.GetRow (i) [j], (int) (i == j), "Row " << i << " is not a unit vector");
+		}
+	}
+}
+
+void IntraFlowNetworkCodingDecoderRoundTripTestCase::DoRun (void)
+{
+	UniformVariable random;
+	IntraFlowNetworkCodingDecoder decoder;
+	const u_int16_t k = 16;
+	const u_int16_t prefix = 5;
+
+	for (u_int8_t q = 1; q <= 8; q++)
+	{
+		GaloisField field (q);
+		//Unless q divides 8, the payloads are made of whole blocks of q bytes
+		u_int32_t size = field.GetRegionSize (random.GetInteger (1, 200));
+		std::vector<std::vector<u_int8_t> > symbols (2 * k, std::vector<u_int8_t> (size));
+		for (u_int32_t i = 0; i < symbols.size (); i++)
+		{
+			for (u_int32_t j = 0; j < size; j++)
+			{
+				symbols [i][j] = random.GetInteger (0, 255);
+			}
+		}
+
+		//Whole fragment
+		decoder.Reset (k, q);
+		Receive (random, field, decoder, symbols, 0, k, k);
+		decoder.Solve ();
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), k, "A full matrix should be completely decodable");
+		CheckDecoded (decoder, symbols, 0, k);
+
+		//Sliding window: the first symbols can be recovered before the matrix is full...
+		decoder.Reset (k, q);
+		Receive (random, field, decoder, symbols, 0, prefix, prefix);
+		decoder.Solve ();
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), prefix, "Wrong decodable prefix (Q=" << (int) q << ")");
+		CheckDecoded (decoder, symbols, 0, prefix);
+
+		//... but not the ones whose rows still depend on other columns
+		std::vector<u_int8_t> vector;
+		std::vector<u_int8_t> payload;
+		RandomVector (random, field, k, prefix, vector);
+		vector [prefix] = random.GetInteger (1, field.GetOrder () - 1);
+		vector [prefix + 1] = random.GetInteger (1, field.GetOrder () - 1);
+		Encode (field, symbols, 0, vector, payload);
+		NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (vector, &payload [0], payload.size ()), true, "New pivot beyond the prefix");
+		decoder.Solve ();
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), prefix, "Undecodable symbols within the prefix (Q=" << (int) q << ")");
+
+		//Slide the window beyond the decoded symbols: the pending row is kept, and the decoding goes on with symbols [prefix, prefix + K)
+		decoder.Shift (prefix);
+		NS_TEST_ASSERT_MSG_EQ (decoder.HasPivot (0), true, "The pending row should be kept after the shift (Q=" << (int) q << ")");
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetRank (), 1, "Wrong rank after the shift (Q=" << (int) q << ")");
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetK (), k, "The window size should not change");
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), 0, "Nothing should be decodable after the shift (Q=" << (int) q << ")");
+		for (u_int16_t i = 1; i < k; i++)
+		{
+			NS_TEST_ASSERT_MSG_EQ (decoder.HasPivot (i), false, "Unexpected row after the shift");
+		}
+		Receive (random, field, decoder, symbols, prefix, k, k);
+		decoder.Solve ();
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), k, "The shifted window should be completely decodable");
+		CheckDecoded (decoder, symbols, prefix, k);
+
+		//Dropping the whole window
+		decoder.Shift (k + 1);
+		NS_TEST_ASSERT_MSG_EQ (decoder.GetRank (), 0, "No row should be left");
+	}
+}
+
+/**
+ * Systematic phase: K-1 natives (unit vectors) and a single coded packet, which recovers the lost native. The natives are already
+ * solved, hence their rows and payloads must be left untouched by Solve
+ */
+class IntraFlowNetworkCodingDecoderLostNativeTestCase : public TestCase
+{
+public:
+	IntraFlowNetworkCodingDecoderLostNativeTestCase ();
+	virtual ~IntraFlowNetworkCodingDecoderLostNativeTestCase ();
+
+private:
+	virtual void DoRun (void);
+};
+
+IntraFlowNetworkCodingDecoderLostNativeTestCase::IntraFlowNetworkCodingDecoderLostNativeTestCase ()
+	: TestCase ("Intra-flow decoder recovering a lost native with a single coded packet")
+{
+}
+
+IntraFlowNetworkCodingDecoderLostNativeTestCase::~IntraFlowNetworkCodingDecoderLostNativeTestCase ()
+{
+}
+
+void IntraFlowNetworkCodingDecoderLostNativeTestCase::DoRun (void)
+{
+	UniformVariable random;
+	IntraFlowNetworkCodingDecoder decoder;
+	const u_int16_t k = 16;
+	u_int16_t lost [] = {0, 7, k - 1};
+
+	for (u_int8_t q = 1; q <= 8; q++)
+	{
+		GaloisField field (q);
+		u_int32_t size = field.GetRegionSize (random.GetInteger (1, 200));
+		std::vector<std::vector<u_int8_t> > symbols (k, std::vector<u_int8_t> (size));
+		for (u_int16_t i = 0; i < k; i++)
+		{
+			for (u_int32_t j = 0; j < size; j++)
+			{
+				symbols [i][j] = random.GetInteger (0, 255);
+			}
+		}
+
+		for (u_int32_t l = 0; l < sizeof (lost) / sizeof (lost [0]); l++)
+		{
+			std::vector<u_int8_t> vector;
+			std::vector<u_int8_t> payload;
+			decoder.Reset (k, q);
+
+			for (u_int16_t i = 0; i < k; i++)
+			{
+				if (i != lost [l])
+				{
+					vector.assign (k, 0);
+					vector [i] = 1;
+					NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (vector, &symbols [i][0], size), true, "Every native is innovative");
+				}
+			}
+			NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), lost [l], "The natives before the lost one are already decoded (Q="
+					<< (int) q << ")");
+
+			//A dense coded packet, which involves the lost native
+			RandomVector (random, field, k, k, vector);
+			vector [lost [l]] = random.GetInteger (1, field.GetOrder () - 1);
+			Encode (field, symbols, 0, vector, payload);
+			NS_TEST_ASSERT_MSG_EQ (decoder.AddVector (vector, &payload [0], payload.size ()), true, "The coded packet is innovative");
+			NS_TEST_ASSERT_MSG_EQ (decoder.IsFull (), true, "A single coded packet completes the matrix (Q=" << (int) q << ")");
+
+			decoder.Solve ();
+			NS_TEST_ASSERT_MSG_EQ (decoder.GetDecodedPrefix (), k, "The lost native has not been recovered (Q=" << (int) q << ")");
+			for (u_int16_t i = 0; i < k; i++)
+			{
+				NS_TEST_ASSERT_MSG_EQ ((decoder.GetPayload (i) == symbols [i]), true, "Wrong decoded symbol " << i << " (Q=" << (int) q
+						<< ", lost native " << lost [l] << ")");
+				for (u_int16_t j = 0; j < k; j++)
+				{
+					NS_TEST_ASSERT_MSG_EQ ((int) decoder.GetRow (i) [j], (int) (i == j), "Row " << i << " is not a unit vector");
+				}
+			}
+		}
+	}
+}
+
+class IntraFlowNetworkCodingDecoderTestSuite : public TestSuite
+{
+public:
+	IntraFlowNetworkCodingDecoderTestSuite ();
+};
+
+IntraFlowNetworkCodingDecoderTestSuite::IntraFlowNetworkCodingDecoderTestSuite ()
+	: TestSuite ("intra-flow-network-coding-decoder", UNIT)
+{
+	AddTestCase (new IntraFlowNetworkCodingDecoderRankTestCase);
+	AddTestCase (new IntraFlowNetworkCodingDecoderRoundTripTestCase);
+	AddTestCase (new IntraFlowNetworkCodingDecoderLostNativeTestCase);
+}
+
+static IntraFlowNetworkCodingDecoderTestSuite intraFlowNetworkCodingDecoderTestSuite;
@@ -1,7 +1,7 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
 // Include a header file from your module to test.
-#include "ns3/network-coding.h"
+#include "ns3/network-coding-module.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -11,25 +11,25 @@
 using namespace ns3;
 
 // This is an example TestCase.
-class Network-codingTestCase1 : public TestCase
+class NetworkCodingTestCase1 : public TestCase
 {
 public:
-  Network-codingTestCase1 ();
-  virtual ~Network-codingTestCase1 ();
+  NetworkCodingTestCase1 ();
+  virtual ~NetworkCodingTestCase1 ();
 
 private:
   virtual void DoRun (void);
 };
 
 // Add some help text to this case to describe what it is intended to test
-Network-codingTestCase1::Network-codingTestCase1 ()
-  : TestCase ("Network-coding test case (does nothing)")
+NetworkCodingTestCase1::NetworkCodingTestCase1 ()
+  : TestCase ("NetworkCoding test case (does nothing)")
 {
 }
 
 // This destructor does nothing but we include it as a reminder that
 // the test case should clean up after itself
-Network-codingTestCase1::~Network-codingTestCase1 ()
+NetworkCodingTestCase1::~NetworkCodingTestCase1 ()
 {
 }
 
@@ -38,7 +38,7 @@ Network-codingTestCase1::~Network-codingTestCase1 ()
 // TestCase must implement
 //
 void
-Network-codingTestCase1::DoRun (void)
+NetworkCodingTestCase1::DoRun (void)
 {
   // A wide variety of test macros are available in src/core/test.h
   NS_TEST_ASSERT_MSG_EQ (true, true, "true doesn't equal true for some reason");
@@ -50,18 +50,18 @@ Network-codingTestCase1::DoRun (void)
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
 //
-class Network-codingTestSuite : public TestSuite
+class NetworkCodingTestSuite : public TestSuite
 {
 public:
-  Network-codingTestSuite ();
+  NetworkCodingTestSuite ();
 };
 
-Network-codingTestSuite::Network-codingTestSuite ()
+NetworkCodingTestSuite::NetworkCodingTestSuite ()
   : TestSuite ("network-coding", UNIT)
 {
-  AddTestCase (new Network-codingTestCase1);
+  AddTestCase (new NetworkCodingTestCase1);
 }
 
 // Do not forget to allocate an instance of this TestSuite
-static Network-codingTestSuite network-codingTestSuite;
+static NetworkCodingTestSuite networkCodingTestSuite;
 
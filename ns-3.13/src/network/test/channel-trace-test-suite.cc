@@ -0,0 +1,206 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include <fstream>
+#include <vector>
+
+#include "ns3/test.h"
+#include "ns3/channel-trace.h"
+
+namespace ns3 {
+
+// ===========================================================================
+// Write a channel trace, map it back and check every sample, the cyclic
+// replay and the time index
+// ===========================================================================
+class ChannelTraceRoundTripTestCase : public TestCase
+{
+public:
+  ChannelTraceRoundTripTestCase ();
+  virtual ~ChannelTraceRoundTripTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+ChannelTraceRoundTripTestCase::ChannelTraceRoundTripTestCase ()
+  : TestCase ("Check that a channel trace is replayed as it was written")
+{
+}
+
+ChannelTraceRoundTripTestCase::~ChannelTraceRoundTripTestCase ()
+{
+}
+
+void
+ChannelTraceRoundTripTestCase::DoRun (void)
+{
+  // 13 samples, so that the last decision byte of each link is only partially used
+  const uint32_t nodes = 3;
+  const uint32_t samples = 13;
+  std::string fileName = CreateTempDirFilename ("channel-trace-round-trip.trace");
+
+  ChannelTraceWriter writer (nodes, samples, CHANNEL_TRACE_HMM, MicroSeconds (500));
+  for (uint32_t tx = 0; tx < nodes; tx++)
+    {
+      for (uint32_t rx = 0; rx < nodes; rx++)
+        {
+          for (uint32_t i = 0; i < samples; i++)
+            {
+              writer.SetSample (tx, rx, i, tx * 100.0 + rx * 10.0 + i * 0.5, (tx + rx + i) % 3 == 0);
+            }
+        }
+    }
+  // Overwriting a sample must clear its previous decision
+  writer.SetSample (2, 1, 0, 7.25, true);
+  writer.SetSample (2, 1, 0, 7.25, false);
+  NS_TEST_ASSERT_MSG_EQ (writer.Write (fileName), true, "Cannot write " << fileName);
+
+  ChannelTrace trace;
+  NS_TEST_ASSERT_MSG_EQ (trace.Open (fileName), true, "Cannot map " << fileName);
+  NS_TEST_EXPECT_MSG_EQ (trace.GetNNodes (), nodes, "Wrong number of nodes");
+  NS_TEST_EXPECT_MSG_EQ (trace.GetNSamples (), samples, "Wrong number of samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.GetFamily (), CHANNEL_TRACE_HMM, "Wrong family");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsTimeIndexed (), true, "The trace should be indexed by time");
+  NS_TEST_EXPECT_MSG_EQ (trace.Contains (2, 2), true, "Link 2 -> 2 should be within the trace");
+  NS_TEST_EXPECT_MSG_EQ (trace.Contains (3, 0), false, "Link 3 -> 0 should not be within the trace");
+
+  for (uint32_t tx = 0; tx < nodes; tx++)
+    {
+      for (uint32_t rx = 0; rx < nodes; rx++)
+        {
+          for (uint32_t i = 0; i < samples; i++)
+            {
+              bool corrupt = (tx + rx + i) % 3 == 0 && !(tx == 2 && rx == 1 && i == 0);
+              float value = (tx == 2 && rx == 1 && i == 0) ? 7.25 : tx * 100.0 + rx * 10.0 + i * 0.5;
+              NS_TEST_EXPECT_MSG_EQ (trace.IsCorrupt (tx, rx, i), corrupt, "Wrong decision " << tx << " -> " << rx << " (" << i << ")");
+              NS_TEST_EXPECT_MSG_EQ (trace.GetValue (tx, rx, i), value, "Wrong value " << tx << " -> " << rx << " (" << i << ")");
+              // The trace wraps around once its samples are exhausted
+              NS_TEST_EXPECT_MSG_EQ (trace.IsCorrupt (tx, rx, i + 4 * samples), corrupt, "Wrong cyclic decision");
+              NS_TEST_EXPECT_MSG_EQ (trace.GetValue (tx, rx, i + samples), value, "Wrong cyclic value");
+            }
+        }
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (trace.GetTimeIndex (MicroSeconds (499)), 0, "Wrong time index");
+  NS_TEST_EXPECT_MSG_EQ (trace.GetTimeIndex (MicroSeconds (500)), 1, "Wrong time index");
+  NS_TEST_EXPECT_MSG_EQ (trace.GetTimeIndex (MilliSeconds (7)), 14, "Wrong time index");
+
+  // The HMM decision filter (unicast TCP segments longer than 4 bytes and UDP datagrams) travels within the trace
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (6, 4, false), false, "TCP ACKs should not take samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (6, 5, false), true, "TCP segments should take samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (17, 0, false), true, "UDP datagrams should take samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (17, 1000, true), false, "Broadcast frames should not take samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (99, 1000, false), false, "Other protocols should not take samples");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsFrameSizeErrorProne (0), true, "HMM traces do not filter by frame size");
+
+  trace.Close ();
+  NS_TEST_EXPECT_MSG_EQ (trace.IsOpen (), false, "The trace should be closed");
+}
+
+// ===========================================================================
+// Corrupted files must be rejected instead of being mapped
+// ===========================================================================
+class ChannelTraceInvalidFileTestCase : public TestCase
+{
+public:
+  ChannelTraceInvalidFileTestCase ();
+  virtual ~ChannelTraceInvalidFileTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Copy the first bytes of a file into another one, overwriting the first byte if required
+   */
+  void Copy (std::string from, std::string to, uint32_t bytes, bool badMagic);
+};
+
+ChannelTraceInvalidFileTestCase::ChannelTraceInvalidFileTestCase ()
+  : TestCase ("Check that truncated or foreign files are not replayed")
+{
+}
+
+ChannelTraceInvalidFileTestCase::~ChannelTraceInvalidFileTestCase ()
+{
+}
+
+void
+ChannelTraceInvalidFileTestCase::Copy (std::string from, std::string to, uint32_t bytes, bool badMagic)
+{
+  std::ifstream in (from.c_str (), std::ios::in | std::ios::binary);
+  std::vector<char> data (bytes);
+  in.read (&data[0], bytes);
+  if (badMagic)
+    {
+      data[0] = 'X';
+    }
+  std::ofstream out (to.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write (&data[0], bytes);
+}
+
+void
+ChannelTraceInvalidFileTestCase::DoRun (void)
+{
+  const uint32_t nodes = 2;
+  const uint32_t samples = 20;
+  // Header + values + decisions
+  const uint32_t size = sizeof (ChannelTraceHeader) + nodes * nodes * samples * sizeof (float) + nodes * nodes * ((samples + 7) / 8);
+  std::string fileName = CreateTempDirFilename ("channel-trace-valid.trace");
+  std::string badFileName = CreateTempDirFilename ("channel-trace-invalid.trace");
+
+  ChannelTraceWriter writer (nodes, samples, CHANNEL_TRACE_MATRIX);
+  NS_TEST_ASSERT_MSG_EQ (writer.Write (fileName), true, "Cannot write " << fileName);
+
+  ChannelTrace trace;
+  NS_TEST_ASSERT_MSG_EQ (trace.Open (fileName), true, "Cannot map a valid trace");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsTimeIndexed (), false, "The trace should be indexed by frame");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsFrameSizeErrorProne (999), false, "Matrix traces only sample frames of 1000 bytes or more");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsErrorProne (6, 300, false), false, "Matrix traces only sample TCP segments longer than 300 bytes");
+
+  Copy (fileName, badFileName, size, true);
+  NS_TEST_EXPECT_MSG_EQ (trace.Open (badFileName), false, "A file with a wrong magic should be rejected");
+  NS_TEST_EXPECT_MSG_EQ (trace.IsOpen (), false, "A rejected file should not stay mapped");
+
+  Copy (fileName, badFileName, size - 1, false);
+  NS_TEST_EXPECT_MSG_EQ (trace.Open (badFileName), false, "A truncated file should be rejected");
+
+  Copy (fileName, badFileName, sizeof (ChannelTraceHeader) - 1, false);
+  NS_TEST_EXPECT_MSG_EQ (trace.Open (badFileName), false, "A file shorter than the header should be rejected");
+
+  NS_TEST_EXPECT_MSG_EQ (trace.Open (CreateTempDirFilename ("channel-trace-missing.trace")), false, "A missing file should be rejected");
+}
+
+class ChannelTraceTestSuite : public TestSuite
+{
+public:
+  ChannelTraceTestSuite ();
+};
+
+ChannelTraceTestSuite::ChannelTraceTestSuite ()
+  : TestSuite ("channel-trace", UNIT)
+{
+  AddTestCase (new ChannelTraceRoundTripTestCase);
+  AddTestCase (new ChannelTraceInvalidFileTestCase);
+}
+
+static ChannelTraceTestSuite channelTraceTestSuite;
+
+} // namespace ns3
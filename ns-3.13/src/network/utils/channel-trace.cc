@@ -0,0 +1,329 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include <fstream>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+#include "channel-trace.h"
+
+NS_LOG_COMPONENT_DEFINE ("ChannelTrace");
+
+namespace ns3 {
+
+static const char g_channelTraceMagic [8] = "NCCHTRC";
+static const u_int32_t g_channelTraceVersion = 2;
+
+//////////////////////////ChannelTraceWriter
+
+ChannelTraceWriter::ChannelTraceWriter (u_int32_t nodes, u_int32_t samples, ChannelTraceFamily family, Time slot) :
+		m_nodes (nodes),
+		m_samples (samples),
+		m_family (family),
+		m_slot (slot),
+		m_bytesPerLink ((samples + 7) / 8),
+		m_values ((size_t) nodes * nodes * samples, 0.0),
+		m_decisions ((size_t) nodes * nodes * ((samples + 7) / 8), 0)
+{
+	NS_LOG_FUNCTION (nodes << samples << family << slot);
+
+	//Decision filter of each family, so that the replay only samples the frames the corresponding error model decides upon
+	memset (&m_header, 0, sizeof (m_header));
+	switch (family)
+	{
+	case CHANNEL_TRACE_BEAR:			//BearErrorModel::DoCorrupt: data frames (broadcast included) with more than 4 bytes of payload (plus the 4-byte trailer)
+		m_header.minTcpPayload = 9;
+		m_header.minUdpPayload = 9;
+		m_header.minOtherPayload = 9;
+		m_header.broadcast = 1;
+		break;
+	case CHANNEL_TRACE_HMM:				//HiddenMarkovErrorModel::DoCorrupt: unicast TCP segments longer than 4 bytes and UDP datagrams
+		m_header.minTcpPayload = 5;
+		m_header.minUdpPayload = 0;
+		m_header.minOtherPayload = CHANNEL_TRACE_NEVER;
+		break;
+	case CHANNEL_TRACE_MATRIX:			//MatrixErrorModel::IsErrorProne plus the frame size filter of MatrixErrorModel::DoCorrupt
+		m_header.minFrameSize = 1000;
+		m_header.minTcpPayload = 301;
+		m_header.minUdpPayload = 0;
+		m_header.minOtherPayload = 0;
+		break;
+	default:
+		NS_FATAL_ERROR ("Unknown channel trace family " << family);
+	}
+}
+
+void ChannelTraceWriter::SetSample (u_int32_t tx, u_int32_t rx, u_int32_t index, float value, bool corrupt)
+{
+	NS_ASSERT (tx < m_nodes && rx < m_nodes && index < m_samples);
+	size_t link = (size_t) tx * m_nodes + rx;
+
+	m_values [link * m_samples + index] = value;
+	if (corrupt)
+	{
+		m_decisions [link * m_bytesPerLink + index / 8] |= (u_int8_t) (1 << (index % 8));
+	}
+	else
+	{
+		m_decisions [link * m_bytesPerLink + index / 8] &= (u_int8_t) ~(1 << (index % 8));
+	}
+}
+
+bool ChannelTraceWriter::Write (const std::string &fileName) const
+{
+	NS_LOG_FUNCTION (fileName);
+	ChannelTraceHeader header = m_header;
+	std::ofstream file (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		NS_LOG_ERROR ("Cannot create the channel trace file " << fileName);
+		return false;
+	}
+
+	memcpy (header.magic, g_channelTraceMagic, sizeof (header.magic));
+	header.version = g_channelTraceVersion;
+	header.family = m_family;
+	header.nodes = m_nodes;
+	header.samples = m_samples;
+	header.slot = m_slot.GetNanoSeconds ();
+	header.valuesOffset = sizeof (header);
+	header.decisionsOffset = header.valuesOffset + m_values.size () * sizeof (float);
+
+	file.write ((const char *) &header, sizeof (header));
+	if (m_values.size ())
+	{
+		file.write ((const char *) &m_values [0], m_values.size () * sizeof (float));
+	}
+	if (m_decisions.size ())
+	{
+		file.write ((const char *) &m_decisions [0], m_decisions.size ());
+	}
+
+	return file.good ();
+}
+
+//////////////////////////ChannelTrace
+
+ChannelTrace::ChannelTrace () :
+		m_map (0),
+		m_size (0),
+		m_header (0),
+		m_values (0),
+		m_decisions (0),
+		m_bytesPerLink (0)
+{
+}
+
+bool ChannelTrace::IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast) const
+{
+	if (broadcast && !m_header->broadcast)
+	{
+		return false;
+	}
+	switch (protocol)
+	{
+	case 6:			//TCP
+		return payload >= m_header->minTcpPayload;
+	case 17:		//UDP
+		return payload >= m_header->minUdpPayload;
+	default:
+		return m_header->minOtherPayload != CHANNEL_TRACE_NEVER && payload >= m_header->minOtherPayload;
+	}
+}
+
+ChannelTrace::~ChannelTrace ()
+{
+	Close ();
+}
+
+bool ChannelTrace::Open (const std::string &fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+	struct stat status;
+	int fd;
+	u_int64_t links;
+
+	Close ();
+
+	fd = open (fileName.c_str (), O_RDONLY);
+	if (fd < 0)
+	{
+		NS_LOG_ERROR ("Channel trace file " << fileName << " not found");
+		return false;
+	}
+	if (fstat (fd, &status) < 0 || (size_t) status.st_size < sizeof (ChannelTraceHeader))
+	{
+		close (fd);
+		return false;
+	}
+
+	m_map = mmap (0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (m_map == MAP_FAILED)
+	{
+		m_map = 0;
+		return false;
+	}
+	m_size = status.st_size;
+	m_header = (const ChannelTraceHeader *) m_map;
+
+	//Check that the file is consistent before serving any lookup
+	links = (u_int64_t) m_header->nodes * m_header->nodes;
+	m_bytesPerLink = (m_header->samples + 7) / 8;
+	if (memcmp (m_header->magic, g_channelTraceMagic, sizeof (g_channelTraceMagic)) || m_header->version != g_channelTraceVersion ||
+			!m_header->samples || m_header->slot < 0 ||
+			m_header->valuesOffset % sizeof (float) ||
+			m_header->valuesOffset + links * m_header->samples * sizeof (float) > m_size ||
+			m_header->decisionsOffset + links * m_bytesPerLink > m_size)
+	{
+		NS_LOG_ERROR ("Channel trace file " << fileName << " is not valid");
+		Close ();
+		return false;
+	}
+
+	m_values = (const float *) ((const u_int8_t *) m_map + m_header->valuesOffset);
+	m_decisions = (const u_int8_t *) m_map + m_header->decisionsOffset;
+
+	NS_LOG_INFO ("Channel trace " << fileName << ": family " << m_header->family << ", " << m_header->nodes << " nodes, " <<
+			m_header->samples << " samples per link" << (IsTimeIndexed () ? " (time-indexed)" : " (frame-indexed)"));
+	return true;
+}
+
+void ChannelTrace::Close ()
+{
+	if (m_map)
+	{
+		munmap (m_map, m_size);
+	}
+	m_map = 0;
+	m_size = 0;
+	m_header = 0;
+	m_values = 0;
+	m_decisions = 0;
+	m_bytesPerLink = 0;
+}
+
+//////////////////////////ChannelTraceErrorModel
+
+NS_OBJECT_ENSURE_REGISTERED (ChannelTraceErrorModel);
+
+TypeId
+ChannelTraceErrorModel::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ChannelTraceErrorModel")
+		.SetParent<MatrixErrorModel> ()
+		.AddConstructor<ChannelTraceErrorModel> ()
+		.AddAttribute ("FileName",
+			"Channel trace file to replay",
+			StringValue (""),
+			MakeStringAccessor (&ChannelTraceErrorModel::SetFileName),
+			MakeStringChecker ())
+	;
+	return tid;
+}
+
+ChannelTraceErrorModel::ChannelTraceErrorModel () :
+		m_currentValue (0.0)
+{
+	NS_LOG_FUNCTION (this);
+}
+
+ChannelTraceErrorModel::~ChannelTraceErrorModel ()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+void ChannelTraceErrorModel::SetFileName (std::string fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+	m_fileName = fileName;
+	m_trace.Close ();
+	m_frameIndex.Clear ();
+}
+
+void ChannelTraceErrorModel::OpenTrace ()
+{
+	if (!m_trace.IsOpen () && !m_fileName.empty ())
+	{
+		NS_ABORT_MSG_UNLESS (m_trace.Open (m_fileName), "Cannot replay the channel trace " << m_fileName);
+	}
+}
+
+bool ChannelTraceErrorModel::IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast)
+{
+	OpenTrace ();
+	return m_trace.IsOpen () && m_trace.IsErrorProne (protocol, payload, broadcast);
+}
+
+bool ChannelTraceErrorModel::DoCorrupt (Ptr<Packet> p)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	u_int32_t index;
+	bool corrupt;
+
+	OpenTrace ();
+
+	//Frames forced to be correct (see IsErrorProne) or below the frame size threshold of the trace do not take any sample
+	if (IsCorrect () || !m_trace.IsOpen () || !m_trace.IsFrameSizeErrorProne (p->GetSize ()))
+	{
+		return false;
+	}
+
+	if (!m_trace.Contains (GetTransmitter (), GetReceiver ()))
+	{
+		NS_LOG_LOGIC ("Link " << GetTransmitter () << " -> " << GetReceiver () << " not within the channel trace");
+		return false;
+	}
+
+	if (m_trace.IsTimeIndexed ())
+	{
+		index = m_trace.GetTimeIndex (Simulator::Now ());
+	}
+	else
+	{
+		index = m_frameIndex.Contains (GetTransmitter (), GetReceiver ()) ? m_frameIndex.Get (GetTransmitter (), GetReceiver ()) : 0;
+		m_frameIndex.Set (GetTransmitter (), GetReceiver (), index + 1);
+	}
+
+	corrupt = m_trace.IsCorrupt (GetTransmitter (), GetReceiver (), index);
+	m_currentValue = m_trace.GetValue (GetTransmitter (), GetReceiver (), index);
+
+	NS_LOG_INFO (Simulator::Now ().GetSeconds () << " " << GetTransmitter () << " -> " << GetReceiver () << " sample " << index <<
+			" (" << m_currentValue << "): " << (corrupt ? "CORRUPT" : "CORRECT"));
+	return corrupt;
+}
+
+void ChannelTraceErrorModel::DoReset ()
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	m_frameIndex.Clear ();
+}
+
+}	//End namespace ns3
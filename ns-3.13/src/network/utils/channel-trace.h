@@ -0,0 +1,262 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef CHANNEL_TRACE_H_
+#define CHANNEL_TRACE_H_
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "error-model.h"
+#include "link-state-table.h"
+
+namespace ns3 {
+
+/**
+ * Channel model the realizations of a trace have been generated from
+ */
+enum ChannelTraceFamily
+{
+	CHANNEL_TRACE_BEAR = 0,				//Value: SNR (dB)
+	CHANNEL_TRACE_HMM,					//Value: state of the Markov chain
+	CHANNEL_TRACE_MATRIX				//Value: FER of the link
+};
+
+/**
+ * Header of the binary channel trace file. It is followed by the values (one float per sample, links in row-major order, link
+ * (tx, rx) at tx * nodes + rx) and by the decisions (one bit per sample, set if the frame is corrupted, (samples + 7) / 8 bytes per link)
+ */
+struct ChannelTraceHeader
+{
+	char magic [8];						//"NCCHTRC" (null-terminated)
+	u_int32_t version;
+	u_int32_t family;					//ChannelTraceFamily
+	u_int32_t nodes;					//Number of nodes; there are nodes x nodes links
+	u_int32_t samples;					//Samples per link
+	int64_t slot;						//Duration of each sample (nanoseconds) if the trace is indexed by time; 0 if it is indexed by frame
+	u_int64_t valuesOffset;				//Offset (bytes) of the values, from the beginning of the file
+	u_int64_t decisionsOffset;			//Offset (bytes) of the decisions, from the beginning of the file
+	//Decision filter: frames which take a sample (the ones the generating model decides upon); the rest are always correct
+	u_int32_t minFrameSize;				//Minimum frame size (bytes, MAC header included)
+	u_int32_t minTcpPayload;			//Minimum TCP payload (bytes after the TCP header)
+	u_int32_t minUdpPayload;			//Minimum UDP payload (bytes after the UDP header)
+	u_int32_t minOtherPayload;			//Minimum payload of the rest of IP protocols (bytes after the IP header); CHANNEL_TRACE_NEVER if they are always correct
+	u_int32_t broadcast;				//1 if broadcast data frames take samples as well
+	u_int32_t reserved;
+};
+
+/**
+ * Payload threshold which no frame reaches (the frames of that protocol are always correct)
+ */
+static const u_int32_t CHANNEL_TRACE_NEVER = 0xffffffff;
+
+/**
+ * Builds a channel trace in memory and stores it into a file (see ChannelTraceHeader). The channel models fill it through their
+ * GenerateTrace methods
+ */
+class ChannelTraceWriter
+{
+public:
+	/**
+	 * \param nodes Number of nodes
+	 * \param samples Samples per link
+	 * \param family Channel model the realizations come from
+	 * \param slot Duration of each sample (time-indexed traces); zero if the trace is indexed by frame
+	 */
+	ChannelTraceWriter (u_int32_t nodes, u_int32_t samples, ChannelTraceFamily family, Time slot = Seconds (0.0));
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \param index Sample (frame or time slot) index
+	 * \param value Value of the channel (see ChannelTraceFamily)
+	 * \param corrupt True if a frame sent at that sample is corrupted
+	 */
+	void SetSample (u_int32_t tx, u_int32_t rx, u_int32_t index, float value, bool corrupt);
+
+	/**
+	 * \param fileName Name of the file to create
+	 * \returns False if the file could not be written
+	 */
+	bool Write (const std::string &fileName) const;
+
+	inline u_int32_t GetNNodes () const {return m_nodes;}
+	inline u_int32_t GetNSamples () const {return m_samples;}
+	inline ChannelTraceFamily GetFamily () const {return m_family;}
+	inline Time GetSlot () const {return m_slot;}
+
+	/**
+	 * Header of the trace (it holds the decision filter of the family, which mimics the frames its error model decides upon)
+	 */
+	inline const ChannelTraceHeader & GetHeader () const {return m_header;}
+
+private:
+	u_int32_t m_nodes;
+	u_int32_t m_samples;
+	ChannelTraceFamily m_family;
+	Time m_slot;
+	ChannelTraceHeader m_header;
+	u_int32_t m_bytesPerLink;				//Size of the decisions of a link
+
+	std::vector<float> m_values;
+	std::vector<u_int8_t> m_decisions;
+};
+
+/**
+ * Read-only access to a channel trace file, which is memory-mapped (the OS pages it in on demand), so every lookup is O(1)
+ */
+class ChannelTrace
+{
+public:
+	ChannelTrace ();
+	~ChannelTrace ();
+
+	/**
+	 * \param fileName Channel trace file
+	 * \returns False if the file could not be mapped or it is not a valid channel trace
+	 */
+	bool Open (const std::string &fileName);
+
+	/**
+	 * Unmap the file (if any)
+	 */
+	void Close ();
+
+	inline bool IsOpen () const {return m_map != 0;}
+	inline u_int32_t GetNNodes () const {return m_header->nodes;}
+	inline u_int32_t GetNSamples () const {return m_header->samples;}
+	inline ChannelTraceFamily GetFamily () const {return (ChannelTraceFamily) m_header->family;}
+	inline bool IsTimeIndexed () const {return m_header->slot > 0;}
+	inline const ChannelTraceHeader & GetHeader () const {return *m_header;}
+
+	/**
+	 * \param frameSize Size of the frame (MAC header included)
+	 * \returns True if a frame of that size might take a sample (see ChannelTraceHeader)
+	 */
+	inline bool IsFrameSizeErrorProne (u_int32_t frameSize) const {return frameSize >= m_header->minFrameSize;}
+
+	/**
+	 * \param protocol IP protocol number
+	 * \param payload Bytes after the transport (TCP/UDP) or IP (rest of protocols) header
+	 * \param broadcast True if the frame is sent to the broadcast address
+	 * \returns True if the frame takes a sample (see ChannelTraceHeader)
+	 */
+	bool IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast) const;
+
+	/**
+	 * \returns The sample index which corresponds to the given instant (time-indexed traces only)
+	 */
+	inline u_int32_t GetTimeIndex (Time time) const {return (u_int32_t) (time.GetNanoSeconds () / m_header->slot);}
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \returns True if the link is within the trace
+	 */
+	inline bool Contains (u_int32_t tx, u_int32_t rx) const {return tx < m_header->nodes && rx < m_header->nodes;}
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \param index Sample index (the trace is replayed cyclically if the index goes beyond its length)
+	 * \returns True if the frame is corrupted
+	 */
+	inline bool IsCorrupt (u_int32_t tx, u_int32_t rx, u_int32_t index) const
+	{
+		index %= m_header->samples;
+		return (m_decisions [(size_t) (tx * m_header->nodes + rx) * m_bytesPerLink + index / 8] >> (index % 8)) & 0x01;
+	}
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \param index Sample index (the trace is replayed cyclically if the index goes beyond its length)
+	 * \returns The value of the channel (see ChannelTraceFamily)
+	 */
+	inline float GetValue (u_int32_t tx, u_int32_t rx, u_int32_t index) const
+	{
+		return m_values [(size_t) (tx * m_header->nodes + rx) * m_header->samples + index % m_header->samples];
+	}
+
+private:
+	ChannelTrace (const ChannelTrace &);
+	ChannelTrace & operator = (const ChannelTrace &);
+
+	void *m_map;
+	size_t m_size;
+	const ChannelTraceHeader *m_header;
+	const float *m_values;
+	const u_int8_t *m_decisions;
+	u_int32_t m_bytesPerLink;
+};
+
+/**
+ * \ingroup errormodel
+ * \brief Error model which replays a pre-generated channel trace (see ChannelTraceWriter), so that different runs (i.e. with and without
+ * network coding) see exactly the same channel realization, regardless of the events order. It is driven by the YansWifiPhy as a
+ * MatrixErrorModel (transmitter, receiver and frames forced to be correct); each error-prone frame takes the next sample of its link
+ * (frame-indexed traces) or the sample of the current time slot (time-indexed traces). The error-prone frames are selected by the decision
+ * filter stored in the trace, i.e. the frames the generating model decides upon; the rest (i.e. the BEAR TCP ACK and broadcast/control
+ * decisions, which do not depend on the data frame samples) are replayed as correct
+ */
+class ChannelTraceErrorModel: public MatrixErrorModel
+{
+public:
+	static TypeId GetTypeId (void);
+
+	ChannelTraceErrorModel ();
+	virtual ~ChannelTraceErrorModel ();
+
+	/**
+	 * \param fileName Channel trace file to replay
+	 */
+	void SetFileName (std::string fileName);
+
+	/**
+	 * Apply the decision filter stored in the trace, so that the frames which take samples are the same ones the generating model decided upon
+	 */
+	virtual bool IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast);
+
+	/**
+	 * \returns The channel value of the last replayed sample
+	 */
+	inline double GetCurrentValue () const {return m_currentValue;}
+
+private:
+	virtual bool DoCorrupt (Ptr<Packet> p);
+	virtual void DoReset ();
+
+	/**
+	 * Map the trace file, if it is not mapped yet
+	 */
+	void OpenTrace ();
+
+	std::string m_fileName;
+	ChannelTrace m_trace;
+	LinkStateTable<u_int32_t> m_frameIndex;		//Next sample of each link (frame-indexed traces)
+	double m_currentValue;
+};
+
+}	//End namespace ns3
+
+#endif /* CHANNEL_TRACE_H_ */
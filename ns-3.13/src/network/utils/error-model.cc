@@ -24,6 +24,7 @@
 #include <math.h>
 
 #include "error-model.h"
+#include "channel-trace.h"   ////David/Ramón
 
 #include "ns3/packet.h"
 #include "ns3/assert.h"
@@ -403,17 +404,21 @@ MatrixErrorModel::SetFer (u_int16_t tx, u_int16_t rx, double fer)
 {
   NS_LOG_INFO ("MatrixPropagationLossErrorModel::SetFer | " << (int) tx  << " -> " << rx << " : FER = " << fer );
 
-  LinkPair p = std::make_pair (tx,rx);
-  std::map<LinkPair, double>::iterator i = m_ferMatrix.find (p);
-
-  if (i == m_ferMatrix.end ())
-      m_ferMatrix.insert (std::make_pair (p, fer));
-  else
-      i->second = fer;
+  m_ferMatrix.Set (tx, rx, fer);
 }
 
 
 
+bool MatrixErrorModel::IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast)
+{
+	if (broadcast)
+		return false;
+	//Data segments --> To be errored. We will consider data segments to those which has a payload length longer than 300 bytes
+	if (protocol == 6)
+		return payload > 300;
+	return true;
+}
+
 bool MatrixErrorModel::DoCorrupt (Ptr<Packet> p)
 {
 	NS_LOG_FUNCTION_NOARGS ();
@@ -426,9 +431,8 @@ bool MatrixErrorModel::DoCorrupt (Ptr<Packet> p)
 		return false;
 
 	//Look up the FER value into the matrix
-	std::map<LinkPair, double>::const_iterator i = m_ferMatrix.find (std::make_pair (m_transmitter, m_receiver));
-	if (i != m_ferMatrix.end ())
-		fer = i->second;
+	if (m_ferMatrix.Contains (m_transmitter, m_receiver))
+		fer = m_ferMatrix.Get (m_transmitter, m_receiver);
 	else
 		fer = m_default;
 
@@ -446,12 +450,32 @@ bool MatrixErrorModel::DoCorrupt (Ptr<Packet> p)
 }
 
 
+void MatrixErrorModel::GenerateTrace (ChannelTraceWriter &writer)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	u_int32_t tx, rx, i;
+	double fer;
+	UniformVariable random (0.0, 1.0);
+
+	for (tx = 0; tx < writer.GetNNodes (); tx++)
+	{
+		for (rx = 0; rx < writer.GetNNodes (); rx++)
+		{
+			fer = m_ferMatrix.Contains (tx, rx) ? m_ferMatrix.Get (tx, rx) : m_default;
+			for (i = 0; i < writer.GetNSamples (); i++)
+			{
+				//Same decision as DoCorrupt (the frame is correct if the random value is above the FER)
+				writer.SetSample (tx, rx, i, fer, !(random.GetValue () > fer));
+			}
+		}
+	}
+}
+
 void MatrixErrorModel::DoReset ()
 {
 	NS_LOG_FUNCTION_NOARGS();
 
-	if (m_ferMatrix.size())
-		m_ferMatrix.clear();
+	m_ferMatrix.Clear();
 }
 
 
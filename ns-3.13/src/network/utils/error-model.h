@@ -30,11 +30,13 @@
 #include "ns3/node.h"
 #include "ns3/simulator.h"
 #include "ns3/packet.h"
+#include "link-state-table.h"
 ////End David/Ramón
 
 namespace ns3 {
 
 class Packet;
+class ChannelTraceWriter;   ////David/Ramón
 
 /**
  * \ingroup network
@@ -344,6 +346,27 @@ public:
 	 */
 	inline void SetCorrect (bool flag) {m_isCorrect = flag;}
 
+	/**
+	 * \returns True if the current frame has been forced to be correct
+	 */
+	inline bool IsCorrect () const {return m_isCorrect;}
+
+	/**
+	 * Decide whether an IP data frame is error prone (otherwise, it is forced to be correct). Called by the YansWifiPhy
+	 * \param protocol IP protocol number
+	 * \param payload Bytes after the transport (TCP/UDP) or IP (rest of protocols) header
+	 * \param broadcast True if the frame is sent to the broadcast address
+	 * \returns By default, unicast frames which are not TCP ACKs (TCP segments up to 300 bytes)
+	 */
+	virtual bool IsErrorProne (u_int8_t protocol, u_int32_t payload, bool broadcast);
+
+	/**
+	 * Pre-generate the decisions of every link into a channel trace (one frame per sample), to be later replayed by the
+	 * ChannelTraceErrorModel
+	 * \param writer Channel trace to fill
+	 */
+	void GenerateTrace (ChannelTraceWriter &writer);
+
 
 
 private:
@@ -358,9 +381,8 @@ private:
 	u_int16_t m_transmitter;		//Node ID of the transmitter entity
 	bool m_isCorrect;				//Flag that forces a received frame to be correct
 
-	typedef std::pair< u_int16_t, u_int16_t > LinkPair;  //Key element: TX/RX tuple. Data: Corresponding FER value of the link
-	/// Fixed FER between pair of nodes
-	std::map<LinkPair, double> m_ferMatrix;
+	/// Fixed FER between pair of nodes, indexed by the TX/RX node IDs (links not set fall back to m_default)
+	LinkStateTable<double> m_ferMatrix;
 
 };
 
@@ -0,0 +1,97 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Eduardo Rodríguez Maza <eduardo.rodriguez@alumnos.unican.es>
+ * 		   David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "flow-key.h"
+
+namespace ns3 {
+
+FlowKey::FlowKey () :
+		sourcePort (0),
+		destinationPort (0),
+		protocol (0)
+{
+}
+
+FlowKey::FlowKey (Ipv4Address source, Ipv4Address destination, u_int16_t sourcePort, u_int16_t destinationPort, u_int8_t protocol) :
+		source (source),
+		destination (destination),
+		sourcePort (sourcePort),
+		destinationPort (destinationPort),
+		protocol (protocol)
+{
+}
+
+u_int32_t FlowKey::Hash () const
+{
+	u_int64_t addresses = ((u_int64_t) source.Get () << 32) | destination.Get ();
+	u_int64_t ports = ((u_int64_t) sourcePort << 32) | ((u_int64_t) destinationPort << 16) | protocol;
+
+	//Finalizer of the SplitMix64 generator, applied over the combination of both words
+	u_int64_t h = addresses * 0x9E3779B97F4A7C15ULL;
+	h ^= (h >> 32) ^ ports;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 29;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 32;
+
+	return (u_int32_t) h;
+}
+
+bool operator == (const FlowKey &a, const FlowKey &b)
+{
+	return a.source == b.source && a.destination == b.destination && a.sourcePort == b.sourcePort &&
+			a.destinationPort == b.destinationPort && a.protocol == b.protocol;
+}
+
+bool operator != (const FlowKey &a, const FlowKey &b)
+{
+	return !(a == b);
+}
+
+bool operator < (const FlowKey &a, const FlowKey &b)
+{
+	if (a.source != b.source)
+	{
+		return a.source < b.source;
+	}
+	if (a.destination != b.destination)
+	{
+		return a.destination < b.destination;
+	}
+	if (a.sourcePort != b.sourcePort)
+	{
+		return a.sourcePort < b.sourcePort;
+	}
+	if (a.destinationPort != b.destinationPort)
+	{
+		return a.destinationPort < b.destinationPort;
+	}
+	return a.protocol < b.protocol;
+}
+
+std::ostream & operator << (std::ostream &os, const FlowKey &key)
+{
+	os << key.source << ":" << key.sourcePort << " -> " << key.destination << ":" << key.destinationPort << " (" << (int) key.protocol << ")";
+	return os;
+}
+
+}	//End namespace ns3
@@ -0,0 +1,62 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Eduardo Rodríguez Maza <eduardo.rodriguez@alumnos.unican.es>
+ * 		   David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef FLOW_KEY_H_
+#define FLOW_KEY_H_
+
+#include <ns3/ipv4-address.h>
+#include <sys/types.h>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * Flow identifier: <IP source address, IP destination address, source port, destination port, protocol>. Unlike the 16-bit
+ * HashID, it can be compared as a whole, hence it is used as the key of the per-flow tables (see FlowTable), where two
+ * different flows must never share the same entry
+ */
+struct FlowKey
+{
+	FlowKey ();
+	FlowKey (Ipv4Address source, Ipv4Address destination, u_int16_t sourcePort, u_int16_t destinationPort, u_int8_t protocol = 0);
+
+	/**
+	 * Non-cryptographic hash of the whole tuple (multiply-xorshift mixing of two 64-bit words)
+	 * \returns 32-bit hash value
+	 */
+	u_int32_t Hash () const;
+
+	Ipv4Address source;
+	Ipv4Address destination;
+	u_int16_t sourcePort;
+	u_int16_t destinationPort;
+	u_int8_t protocol;
+};
+
+bool operator == (const FlowKey &a, const FlowKey &b);
+bool operator != (const FlowKey &a, const FlowKey &b);
+bool operator < (const FlowKey &a, const FlowKey &b);
+std::ostream & operator << (std::ostream &os, const FlowKey &key);
+
+}	//End namespace ns3
+
+#endif /* FLOW_KEY_H_ */
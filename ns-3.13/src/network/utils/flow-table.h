@@ -0,0 +1,253 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Eduardo Rodríguez Maza <eduardo.rodriguez@alumnos.unican.es>
+ * 		   David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef FLOW_TABLE_H_
+#define FLOW_TABLE_H_
+
+#include <sys/types.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "flow-key.h"
+
+namespace ns3 {
+
+/**
+ * Finalizer of the SplitMix64 generator, for the Hash () method of the keys: every bit of the value affects the lowest bits of
+ * the result, which are the ones that pick the slot
+ */
+inline u_int32_t FlowTableHash (u_int64_t value)
+{
+	u_int64_t h = value + 0x9E3779B97F4A7C15ULL;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return (u_int32_t) (h ^ (h >> 32));
+}
+
+/**
+ * Per-flow table, indexed by the whole FlowKey: open addressing with linear probing over a power-of-two number of slots
+ * (the load factor is kept below 1/2) and backward-shift deletion, so no tombstones are left behind. The flows are always
+ * told apart by comparing the complete key, the hash is only used to pick the first slot to probe.
+ * The interface mimics the subset of std::map used by the network coding entities (find/insert/erase/operator[] and
+ * forward iteration, with iterator->first/second); note that, as with any hash table, the insertions might invalidate the
+ * iterators (and so do the erasures), and the iteration order is not the key one. The stored elements are relocated through
+ * swap (never copied), so the iterators of node-based containers held by the table (i.e. std::list) remain valid.
+ * Any other key type can be used as long as it is default constructible and it provides operator== and a Hash () method
+ * returning a 32-bit value
+ */
+template <typename T, typename Key = FlowKey>
+class FlowTable
+{
+public:
+	typedef std::pair<Key, T> value_type;
+
+	class iterator
+	{
+	public:
+		iterator () : m_table (0), m_slot (0) {}
+		iterator (FlowTable *table, u_int32_t slot) : m_table (table), m_slot (slot) {Skip ();}
+
+		value_type & operator * () const {return m_table->m_slots [m_slot];}
+		value_type * operator -> () const {return &m_table->m_slots [m_slot];}
+		iterator & operator ++ () {m_slot++; Skip (); return *this;}
+		iterator operator ++ (int) {iterator old = *this; ++(*this); return old;}
+		bool operator == (const iterator &other) const {return m_slot == other.m_slot;}
+		bool operator != (const iterator &other) const {return m_slot != other.m_slot;}
+
+	private:
+		friend class FlowTable;
+		void Skip () {while (m_slot < m_table->m_used.size () && !m_table->m_used [m_slot]) m_slot++;}
+
+		FlowTable *m_table;
+		u_int32_t m_slot;
+	};
+
+	/**
+	 * \param capacity Initial number of slots (rounded up to a power of two)
+	 */
+	FlowTable (u_int32_t capacity = 16) : m_size (0)
+	{
+		u_int32_t slots = 4;
+		while (slots < capacity)
+		{
+			slots <<= 1;
+		}
+		Allocate (slots);
+	}
+
+	iterator begin () {return iterator (this, 0);}
+	iterator end () {return iterator (this, m_used.size ());}
+	u_int32_t size () const {return m_size;}
+	bool empty () const {return m_size == 0;}
+
+	iterator find (const Key &key)
+	{
+		bool found;
+		u_int32_t slot = Probe (key, key.Hash (), found);
+		return found ? iterator (this, slot) : end ();
+	}
+
+	std::pair<iterator, bool> insert (const value_type &value)
+	{
+		bool found;
+		u_int32_t hash = value.first.Hash ();
+		u_int32_t slot = Probe (value.first, hash, found);
+		if (found)
+		{
+			return std::make_pair (iterator (this, slot), false);
+		}
+
+		if (2 * (m_size + 1) > m_used.size ())
+		{
+			Grow ();
+			slot = Probe (value.first, hash, found);
+		}
+		m_slots [slot] = value;
+		m_hashes [slot] = hash;
+		m_used [slot] = true;
+		m_size++;
+		return std::make_pair (iterator (this, slot), true);
+	}
+
+	T & operator [] (const Key &key)
+	{
+		return insert (value_type (key, T ())).first->second;
+	}
+
+	u_int32_t erase (const Key &key)
+	{
+		iterator it = find (key);
+		if (it == end ())
+		{
+			return 0;
+		}
+		erase (it);
+		return 1;
+	}
+
+	void erase (iterator it)
+	{
+		u_int32_t mask = m_used.size () - 1;
+		u_int32_t hole = it.m_slot;
+		u_int32_t next = hole;
+
+		//Backward shift: pull back every entry of the cluster which would not be reachable from its home slot anymore
+		while (true)
+		{
+			next = (next + 1) & mask;
+			if (!m_used [next])
+			{
+				break;
+			}
+			u_int32_t home = m_hashes [next] & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				Move (m_slots [hole], m_slots [next]);
+				m_hashes [hole] = m_hashes [next];
+				hole = next;
+			}
+		}
+		m_slots [hole].second = T ();			//Release the stored element
+		m_used [hole] = false;
+		m_size--;
+	}
+
+	void clear ()
+	{
+		Allocate (m_used.size ());
+	}
+
+private:
+	static void Move (value_type &dst, value_type &src)
+	{
+		using std::swap;
+		dst.first = src.first;
+		swap (dst.second, src.second);
+	}
+
+	void Allocate (u_int32_t slots)
+	{
+		m_slots.assign (slots, value_type ());
+		m_hashes.assign (slots, 0);
+		m_used.assign (slots, false);
+		m_size = 0;
+	}
+
+	/**
+	 * \returns The slot which holds the key (found = true) or the empty one where it should be inserted (found = false)
+	 */
+	u_int32_t Probe (const Key &key, u_int32_t hash, bool &found) const
+	{
+		u_int32_t mask = m_used.size () - 1;
+		u_int32_t slot = hash & mask;
+		while (m_used [slot])
+		{
+			if (m_hashes [slot] == hash && m_slots [slot].first == key)
+			{
+				found = true;
+				return slot;
+			}
+			slot = (slot + 1) & mask;
+		}
+		found = false;
+		return slot;
+	}
+
+	void Grow ()
+	{
+		std::vector<value_type> slots;
+		std::vector<u_int32_t> hashes;
+		std::vector<bool> used;
+		slots.swap (m_slots);
+		hashes.swap (m_hashes);
+		used.swap (m_used);
+
+		Allocate (2 * used.size ());
+		u_int32_t mask = m_used.size () - 1;
+		for (u_int32_t i = 0; i < used.size (); i++)
+		{
+			if (used [i])
+			{
+				u_int32_t slot = hashes [i] & mask;
+				while (m_used [slot])
+				{
+					slot = (slot + 1) & mask;
+				}
+				Move (m_slots [slot], slots [i]);
+				m_hashes [slot] = hashes [i];
+				m_used [slot] = true;
+				m_size++;
+			}
+		}
+	}
+
+	std::vector<value_type> m_slots;
+	std::vector<u_int32_t> m_hashes;			//Cached hash of each slot (cheap comparisons and rehashing)
+	std::vector<bool> m_used;
+	u_int32_t m_size;
+};
+
+}	//End namespace ns3
+
+#endif /* FLOW_TABLE_H_ */
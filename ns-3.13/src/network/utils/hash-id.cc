@@ -21,26 +21,14 @@
  */
 
 #include "hash-id.h"
+#include "flow-key.h"
 
 
 u_int16_t HashID (ns3::Ipv4Address ipSrc, ns3::Ipv4Address ipDst, u_int16_t portSrc, u_int16_t portDst)
 {
-	unsigned char hashTemp[32];
-	unsigned char buffer [12], *ptr = buffer;
-	u_int32_t temp;
-	u_int16_t result;
-
-	temp = ipSrc.Get ();
-	memcpy (ptr + 0, (void *) &temp, 4);
-	temp = ipDst.Get ();
-	memcpy (ptr + 4, (void *) &temp, 4);
-	memcpy (ptr + 8, (void *) &portSrc, 2);
-	memcpy (ptr + 10, (void *) &portDst, 2);
-
-	MD5 ((unsigned char *) buffer, 12, hashTemp);
-	memcpy ((void *) &result, hashTemp, 2);
+	u_int32_t hash = ns3::FlowKey (ipSrc, ipDst, portSrc, portDst).Hash ();
 
-	return result;
+	return (u_int16_t) (hash ^ (hash >> 16));
 }
 
 u_int16_t HashID2 (ns3::Ipv4Address ipSrc, ns3::Ipv4Address ipDst, u_int16_t portSrc, u_int16_t portDst)
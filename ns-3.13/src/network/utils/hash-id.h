@@ -23,12 +23,13 @@
 #ifndef HASH_ID_H_
 #define HASH_ID_H_
 
-#include <openssl/md5.h> //Open SSL library --> Needed for hashing
 #include <ns3/ipv4-address.h>
 #include <string.h>
 
 /**
- * Hashing. The function will receive the EndPoints and will return the MD5 32-bit hash function, using the Open SSL library
+ * Hashing. The function will receive the EndPoints and will return a 16-bit digest of them (FlowKey::Hash, folded). Since
+ * different flows might share the same value, it must not be used to tell flows apart in the local tables (see FlowTable);
+ * it is kept for the identifiers which travel within the packets
  * \param ipSrc   Source IP address
  * \param ipDst   Destination IP address
  * \param portSrc Source port (TCP/UDP)
@@ -0,0 +1,143 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef LINK_STATE_TABLE_H_
+#define LINK_STATE_TABLE_H_
+
+#include <sys/types.h>
+#include <algorithm>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Dense N x N table holding the per-link state of the channel/error models (BEAR, HMM and Matrix), indexed by the
+ * (transmitter, receiver) node IDs. The links are stored contiguously (row-major, all the links of a transmitter together),
+ * so a lookup is a single multiplication and the states of the links sharing a transmitter lie on the same cache lines.
+ * Links which have not been set are held as default-constructed elements (see Contains). The room reserved for the nodes
+ * (capacity) is kept apart from their number, and it is doubled whenever it runs out, so that nodes added one by one
+ * only copy the table a logarithmic number of times
+ */
+template <typename T>
+class LinkStateTable
+{
+public:
+	LinkStateTable () : m_nodes (0), m_capacity (0) {}
+
+	/**
+	 * Start over the table, for the given number of nodes (all the links are reset)
+	 * \param nodes Number of nodes (the valid IDs will be [0, nodes))
+	 */
+	void Resize (u_int32_t nodes)
+	{
+		m_nodes = nodes;
+		m_capacity = nodes;
+		m_links.assign ((size_t) nodes * nodes, T ());
+		m_set.assign ((size_t) nodes * nodes, false);
+	}
+
+	/**
+	 * Store the state of a link (the table grows if any of the IDs is beyond its current size)
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \param state Link state
+	 */
+	void Set (u_int32_t tx, u_int32_t rx, const T &state)
+	{
+		if (tx >= m_nodes || rx >= m_nodes)
+		{
+			u_int32_t nodes = std::max (tx, rx) + 1;
+			if (nodes > m_capacity)
+			{
+				Grow (std::max (nodes, 2 * m_capacity));
+			}
+			m_nodes = nodes;
+		}
+		m_links [Index (tx, rx)] = state;
+		m_set [Index (tx, rx)] = true;
+	}
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \returns True if the state of the link has been set
+	 */
+	inline bool Contains (u_int32_t tx, u_int32_t rx) const
+	{
+		return tx < m_nodes && rx < m_nodes && m_set [Index (tx, rx)];
+	}
+
+	/**
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \returns The state of the link (which must be within the table, see Contains)
+	 */
+	inline T & Get (u_int32_t tx, u_int32_t rx) {return m_links [Index (tx, rx)];}
+	inline const T & Get (u_int32_t tx, u_int32_t rx) const {return m_links [Index (tx, rx)];}
+
+	/**
+	 * \returns The number of nodes of the table (i.e. one more than the highest ID set so far, or the one given to Resize)
+	 */
+	inline u_int32_t GetNNodes () const {return m_nodes;}
+
+	/**
+	 * Remove all the links
+	 */
+	void Clear ()
+	{
+		m_nodes = 0;
+		m_capacity = 0;
+		m_links.clear ();
+		m_set.clear ();
+	}
+
+private:
+	inline size_t Index (u_int32_t tx, u_int32_t rx) const {return (size_t) tx * m_capacity + rx;}
+
+	/**
+	 * Enlarge the room reserved for the nodes, keeping the links already stored (the number of nodes is not modified)
+	 */
+	void Grow (u_int32_t capacity)
+	{
+		std::vector<T> links ((size_t) capacity * capacity, T ());
+		std::vector<bool> set ((size_t) capacity * capacity, false);
+		for (u_int32_t tx = 0; tx < m_nodes; tx++)
+		{
+			for (u_int32_t rx = 0; rx < m_nodes; rx++)
+			{
+				links [(size_t) tx * capacity + rx] = m_links [Index (tx, rx)];
+				set [(size_t) tx * capacity + rx] = m_set [Index (tx, rx)];
+			}
+		}
+		m_links.swap (links);
+		m_set.swap (set);
+		m_capacity = capacity;
+	}
+
+	u_int32_t m_nodes;
+	u_int32_t m_capacity;				//Nodes the table has room for (stride of the rows)
+	std::vector<T> m_links;				//Link (tx, rx) at position tx * m_capacity + rx
+	std::vector<bool> m_set;			//Whether the corresponding link has been set
+};
+
+}	//End namespace ns3
+
+#endif /* LINK_STATE_TABLE_H_ */
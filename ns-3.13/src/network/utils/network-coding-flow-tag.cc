@@ -0,0 +1,93 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Eduardo Rodríguez Maza <eduardo.rodriguez@alumnos.unican.es>
+ * 		   David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "network-coding-flow-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (NetworkCodingFlowTag);
+
+TypeId
+NetworkCodingFlowTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NetworkCodingFlowTag")
+    .SetParent<Tag> ()
+    .AddConstructor<NetworkCodingFlowTag> ()
+  ;
+  return tid;
+}
+TypeId
+NetworkCodingFlowTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+uint32_t
+NetworkCodingFlowTag::GetSerializedSize (void) const
+{
+  return 13;
+}
+void
+NetworkCodingFlowTag::Serialize (TagBuffer buf) const
+{
+  buf.WriteU32 (m_flowId.source.Get ());
+  buf.WriteU32 (m_flowId.destination.Get ());
+  buf.WriteU16 (m_flowId.sourcePort);
+  buf.WriteU16 (m_flowId.destinationPort);
+  buf.WriteU8 (m_flowId.protocol);
+}
+void
+NetworkCodingFlowTag::Deserialize (TagBuffer buf)
+{
+  m_flowId.source.Set (buf.ReadU32 ());
+  m_flowId.destination.Set (buf.ReadU32 ());
+  m_flowId.sourcePort = buf.ReadU16 ();
+  m_flowId.destinationPort = buf.ReadU16 ();
+  m_flowId.protocol = buf.ReadU8 ();
+}
+void
+NetworkCodingFlowTag::Print (std::ostream &os) const
+{
+  os << "NetworkCodingFlowId=" << m_flowId;
+}
+NetworkCodingFlowTag::NetworkCodingFlowTag ()
+  : Tag ()
+{
+}
+
+NetworkCodingFlowTag::NetworkCodingFlowTag (const FlowKey &flowId)
+  : Tag (),
+    m_flowId (flowId)
+{
+}
+
+void
+NetworkCodingFlowTag::SetFlowId (const FlowKey &flowId)
+{
+  m_flowId = flowId;
+}
+const FlowKey &
+NetworkCodingFlowTag::GetFlowId (void) const
+{
+  return m_flowId;
+}
+
+} // namespace ns3
@@ -0,0 +1,55 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Eduardo Rodríguez Maza <eduardo.rodriguez@alumnos.unican.es>
+ * 		   David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef NETWORK_CODING_FLOW_TAG_H
+#define NETWORK_CODING_FLOW_TAG_H
+
+#include "ns3/tag.h"
+#include "flow-key.h"
+
+namespace ns3 {
+
+/**
+ * Packet tag attached by the intra-flow network coding protocol to its coded data packets. It carries the flow identifier
+ * (the whole FlowKey), so that the lower layers (i.e. WifiMacQueue::SelectiveFlush) can classify the packets without parsing the
+ * LLC/IP/coding headers
+ */
+class NetworkCodingFlowTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buf) const;
+  virtual void Deserialize (TagBuffer buf);
+  virtual void Print (std::ostream &os) const;
+  NetworkCodingFlowTag ();
+  NetworkCodingFlowTag (const FlowKey &flowId);
+  void SetFlowId (const FlowKey &flowId);
+  const FlowKey & GetFlowId (void) const;
+private:
+  FlowKey m_flowId;
+};
+
+} // namespace ns3
+
+#endif /* NETWORK_CODING_FLOW_TAG_H */
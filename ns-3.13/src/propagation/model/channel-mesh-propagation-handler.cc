@@ -42,3 +42,8 @@ ChannelMeshPropagationKey::ChannelMeshPropagationKey (Ptr<MobilityModel> tx, Ptr
 	m_rx = rxId;
 }
 
+u_int32_t ChannelMeshPropagationKey::GetNodeId (Ptr<MobilityModel> mobility)
+{
+	return mobility->GetObject<Node> ()->GetId ();
+}
+
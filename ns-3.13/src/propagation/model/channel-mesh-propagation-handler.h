@@ -59,6 +59,11 @@ public:
 	void SetRx (u_int32_t rx);
 	u_int32_t GetRx ();
 
+	/**
+	 * \param mobility Mobility model aggregated to a node
+	 * \returns The ID of the node which holds the mobility model (used to index the link state tables)
+	 */
+	static u_int32_t GetNodeId (Ptr<MobilityModel> mobility);
 
 //private:
 	u_int32_t m_tx;
@@ -27,6 +27,7 @@
 #include "ns3/boolean.h"
 #include "ns3/double.h"
 #include <math.h>
+#include <limits>
 
 NS_LOG_COMPONENT_DEFINE ("PropagationLossModel");
 
@@ -74,6 +75,64 @@ PropagationLossModel::CalcRxPower (double txPowerDbm,
   return self;
 }
 
+////David/Ramón
+double
+PropagationLossModel::CalcMaxRxPower (double txPowerDbm, double distance) const
+{
+  // The models only add/subtract losses (non-decreasing with the input power), hence the bound of the chain is the chain of bounds
+  double self = DoCalcMaxRxPower (txPowerDbm, distance);
+
+  if (m_next != 0)
+    {
+      self = m_next->CalcMaxRxPower (self, distance);
+    }
+  return self;
+}
+
+double
+PropagationLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
+  return std::numeric_limits<double>::infinity ();
+}
+
+void
+PropagationLossModel::CalcRxPowerBatch (double txPowerDbm,
+                                        Ptr<MobilityModel> a,
+                                        const std::vector<Ptr<MobilityModel> > &b,
+                                        std::vector<double> &rxPowerDbm) const
+{
+  rxPowerDbm.assign (b.size (), txPowerDbm);
+  CalcRxPowerBatch (a, b, rxPowerDbm);
+}
+
+void
+PropagationLossModel::CalcRxPowerBatch (Ptr<MobilityModel> a,
+                                        const std::vector<Ptr<MobilityModel> > &b,
+                                        std::vector<double> &rxPowerDbm) const
+{
+  NS_ASSERT (rxPowerDbm.size () == b.size ());
+  // Each model keeps its own random streams, hence processing the batch model by model (instead of receiver by receiver) does
+  // not change the outcome
+  DoCalcRxPowerBatch (a, b, rxPowerDbm);
+
+  if (m_next != 0)
+    {
+      m_next->CalcRxPowerBatch (a, b, rxPowerDbm);
+    }
+}
+
+void
+PropagationLossModel::DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                          const std::vector<Ptr<MobilityModel> > &b,
+                                          std::vector<double> &rxPowerDbm) const
+{
+  for (uint32_t i = 0; i < b.size (); i++)
+    {
+      rxPowerDbm[i] = DoCalcRxPower (rxPowerDbm[i], a, b[i]);
+    }
+}
+////End David/Ramón
+
 // ------------------------------------------------------------------------- //
 
 NS_OBJECT_ENSURE_REGISTERED (RandomPropagationLossModel);
@@ -228,7 +287,13 @@ FriisPropagationLossModel::DoCalcRxPower (double txPowerDbm,
    * L: system loss (unit-less)
    * lambda: wavelength (m)
    */
-  double distance = a->GetDistanceFrom (b);
+  return DoCalcMaxRxPower (txPowerDbm, a->GetDistanceFrom (b));
+}
+
+////David/Ramón --> The model is deterministic, hence the bound is the actual reception power
+double
+FriisPropagationLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
   if (distance <= m_minDistance)
     {
       return txPowerDbm;
@@ -466,7 +531,13 @@ LogDistancePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                                 Ptr<MobilityModel> a,
                                                 Ptr<MobilityModel> b) const
 {
-  double distance = a->GetDistanceFrom (b);
+  return DoCalcMaxRxPower (txPowerDbm, a->GetDistanceFrom (b));
+}
+
+////David/Ramón --> The model is deterministic, hence the bound is the actual reception power
+double
+LogDistancePropagationLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
   if (distance <= m_referenceDistance)
     {
       return txPowerDbm;
@@ -493,6 +564,25 @@ LogDistancePropagationLossModel::DoCalcRxPower (double txPowerDbm,
   return txPowerDbm + rxc;
 }
 
+////David/Ramón --> Only the distances depend on the receiver
+void
+LogDistancePropagationLossModel::DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                                     const std::vector<Ptr<MobilityModel> > &b,
+                                                     std::vector<double> &rxPowerDbm) const
+{
+  Vector position = a->GetPosition ();
+  double factor = 10 * m_exponent;
+
+  for (uint32_t i = 0; i < b.size (); i++)
+    {
+      double distance = CalculateDistance (position, b[i]->GetPosition ());
+      if (distance > m_referenceDistance)
+        {
+          rxPowerDbm[i] += -m_referenceLoss - factor * log10 (distance / m_referenceDistance);
+        }
+    }
+}
+
 // ------------------------------------------------------------------------- //
 
 NS_OBJECT_ENSURE_REGISTERED (ThreeLogDistancePropagationLossModel);
@@ -552,7 +642,13 @@ ThreeLogDistancePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                                      Ptr<MobilityModel> a,
                                                      Ptr<MobilityModel> b) const
 {
-  double distance = a->GetDistanceFrom (b);
+  return DoCalcMaxRxPower (txPowerDbm, a->GetDistanceFrom (b));
+}
+
+////David/Ramón --> The model is deterministic, hence the bound is the actual reception power
+double
+ThreeLogDistancePropagationLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
   NS_ASSERT (distance >= 0);
 
   // See doxygen comments for the formula and explanation
@@ -724,6 +820,13 @@ FixedRssLossModel::DoCalcRxPower (double txPowerDbm,
   return m_rss;
 }
 
+////David/Ramón
+double
+FixedRssLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
+  return m_rss;
+}
+
 // ------------------------------------------------------------------------- //
 
 NS_OBJECT_ENSURE_REGISTERED (MatrixPropagationLossModel);
@@ -842,9 +945,13 @@ RangePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                           Ptr<MobilityModel> a,
                                           Ptr<MobilityModel> b) const
 {
+  return DoCalcMaxRxPower (txPowerDbm, a->GetDistanceFrom (b));
+}
 
-  double distance = a->GetDistanceFrom (b);
-
+////David/Ramón --> The model is deterministic, hence the bound is the actual reception power
+double
+RangePropagationLossModel::DoCalcMaxRxPower (double txPowerDbm, double distance) const
+{
   ////David/Ramón --> Change the operation
 //  if (distance <= m_range)
 //    {
@@ -864,6 +971,20 @@ RangePropagationLossModel::DoCalcRxPower (double txPowerDbm,
 
 }
 
+////David/Ramón --> Only the distances depend on the receiver
+void
+RangePropagationLossModel::DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                               const std::vector<Ptr<MobilityModel> > &b,
+                                               std::vector<double> &rxPowerDbm) const
+{
+  Vector position = a->GetPosition ();
+
+  for (uint32_t i = 0; i < b.size (); i++)
+    {
+      rxPowerDbm[i] = DoCalcMaxRxPower (rxPowerDbm[i], CalculateDistance (position, b[i]->GetPosition ()));
+    }
+}
+
 /////David/Ramón
 ////////////////  SimplePropagationLossModel (authors: David Gómez Fernández / Ramón Agüero Calvo)   //////////////////
 NS_OBJECT_ENSURE_REGISTERED (SimplePropagationLossModel);
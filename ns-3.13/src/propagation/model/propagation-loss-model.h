@@ -28,6 +28,7 @@
 #include "ns3/object.h"
 #include "ns3/random-variable.h"
 #include <map>
+#include <vector>   ////David/Ramón
 
 namespace ns3 {
 
@@ -73,12 +74,59 @@ public:
   double CalcRxPower (double txPowerDbm,
                       Ptr<MobilityModel> a,
                       Ptr<MobilityModel> b) const;
+
+  ////David/Ramón
+  /**
+   * \param txPowerDbm current transmission power (in dBm)
+   * \param distance distance between the source and the destination (m)
+   * \returns an upper bound of the reception power that the whole chain of models might yield at that distance (in dBm), or
+   * +infinity if any of them cannot be bounded (i.e. random fading). It must not increase with the distance, and calling it
+   * must not have any side effect, since it is used to discard beforehand the receivers which cannot detect a frame
+   */
+  double CalcMaxRxPower (double txPowerDbm, double distance) const;
+
+  /**
+   * \brief Reception power of a single transmission at a set of receivers (i.e. a broadcast or overheard frame). It yields the
+   * same values as calling CalcRxPower for each receiver in turn, but every model of the chain processes the whole batch at once
+   * \param txPowerDbm current transmission power (in dBm)
+   * \param a the mobility model of the source
+   * \param b the mobility models of the destinations
+   * \param rxPowerDbm it will hold the reception power at each destination (in dBm)
+   */
+  void CalcRxPowerBatch (double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         const std::vector<Ptr<MobilityModel> > &b,
+                         std::vector<double> &rxPowerDbm) const;
+
+  /**
+   * \brief Same as above, but with a (possibly different) input power per destination, so that a model can apply an inner chain
+   * \param a the mobility model of the source
+   * \param b the mobility models of the destinations
+   * \param rxPowerDbm input power towards each destination; it will hold the reception power at each of them (in dBm)
+   */
+  void CalcRxPowerBatch (Ptr<MobilityModel> a,
+                         const std::vector<Ptr<MobilityModel> > &b,
+                         std::vector<double> &rxPowerDbm) const;
+  ////End David/Ramón
 private:
   PropagationLossModel (const PropagationLossModel &o);
   PropagationLossModel &operator = (const PropagationLossModel &o);
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const = 0;
+  ////David/Ramón
+  /**
+   * By default, the models cannot be bounded; the deterministic ones (which only depend on the distance) override it
+   */
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;
+  /**
+   * By default, the batch is processed through DoCalcRxPower (one receiver at a time); the models which keep per-link state or
+   * which can hoist the transmitter-side work override it. The powers are replaced in place
+   */
+  virtual void DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                   const std::vector<Ptr<MobilityModel> > &b,
+                                   std::vector<double> &rxPowerDbm) const;
+  ////End David/Ramón
 
   Ptr<PropagationLossModel> m_next;
 };
@@ -195,6 +243,7 @@ private:
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;   ////David/Ramón
   double DbmToW (double dbm) const;
   double DbmFromW (double w) const;
 
@@ -339,6 +388,10 @@ private:
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;   ////David/Ramón
+  virtual void DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                   const std::vector<Ptr<MobilityModel> > &b,
+                                   std::vector<double> &rxPowerDbm) const;   ////David/Ramón
   static Ptr<PropagationLossModel> CreateDefaultReference (void);
 
   double m_exponent;
@@ -401,6 +454,7 @@ private:
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;   ////David/Ramón
 
   double m_distance0;
   double m_distance1;
@@ -494,6 +548,7 @@ private:
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;   ////David/Ramón
   double m_rss;
 };
 
@@ -563,6 +618,10 @@ private:
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const;
+  virtual double DoCalcMaxRxPower (double txPowerDbm, double distance) const;   ////David/Ramón
+  virtual void DoCalcRxPowerBatch (Ptr<MobilityModel> a,
+                                   const std::vector<Ptr<MobilityModel> > &b,
+                                   std::vector<double> &rxPowerDbm) const;   ////David/Ramón
 private:
   double m_range;
 
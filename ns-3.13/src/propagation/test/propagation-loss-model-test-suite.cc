@@ -434,6 +434,61 @@ RangePropagationLossModelTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class BatchPropagationLossModelTestCase : public TestCase
+{
+public:
+  BatchPropagationLossModelTestCase ();
+  virtual ~BatchPropagationLossModelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BatchPropagationLossModelTestCase::BatchPropagationLossModelTestCase ()
+  : TestCase ("Check that CalcRxPowerBatch matches CalcRxPower along a chain of models")
+{
+}
+
+BatchPropagationLossModelTestCase::~BatchPropagationLossModelTestCase ()
+{
+}
+
+void
+BatchPropagationLossModelTestCase::DoRun (void)
+{
+  const uint32_t nReceivers = 5;
+  const double distances[nReceivers] = {0.5, 10.0, 25.0, 39.9, 80.0};
+
+  Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0.0, 0.0, 0.0));
+  std::vector<Ptr<MobilityModel> > b;
+  for (uint32_t i = 0; i < nReceivers; i++)
+    {
+      Ptr<MobilityModel> m = CreateObject<ConstantPositionMobilityModel> ();
+      m->SetPosition (Vector (distances[i], 0.0, 0.0));
+      b.push_back (m);
+    }
+
+  // LogDistance and Range override the batch evaluation, whereas Matrix falls back to the scalar one
+  Ptr<LogDistancePropagationLossModel> logDistance = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<MatrixPropagationLossModel> matrix = CreateObject<MatrixPropagationLossModel> ();
+  matrix->SetDefaultLoss (0);
+  matrix->SetLoss (a, b[1], 7.5, false);
+  Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel> ();
+  logDistance->SetNext (matrix);
+  matrix->SetNext (range);
+
+  std::vector<double> rxPowerDbm;
+  logDistance->CalcRxPowerBatch (16.0206, a, b, rxPowerDbm);
+  NS_TEST_ASSERT_MSG_EQ (rxPowerDbm.size (), nReceivers, "Wrong number of reception powers");
+  for (uint32_t i = 0; i < nReceivers; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (rxPowerDbm[i], logDistance->CalcRxPower (16.0206, a, b[i]),
+                             "Batch and scalar reception powers differ at " << distances[i] << " m");
+    }
+  Simulator::Destroy ();
+}
+
 class PropagationLossModelsTestSuite : public TestSuite
 {
 public:
@@ -448,6 +503,7 @@ PropagationLossModelsTestSuite::PropagationLossModelsTestSuite ()
   AddTestCase (new LogDistancePropagationLossModelTestCase);
   AddTestCase (new MatrixPropagationLossModelTestCase);
   AddTestCase (new RangePropagationLossModelTestCase);
+  AddTestCase (new BatchPropagationLossModelTestCase);
 }
 
 static PropagationLossModelsTestSuite propagationLossModelsTestSuite;
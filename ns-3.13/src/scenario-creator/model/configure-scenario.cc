@@ -61,6 +61,8 @@ ConfigureScenario::ConfigureScenario()
     m_propTracing = CreateObject<ProprietaryTracing > ();
     m_nodesNumber = 0;
     m_distance = 0.0;
+    m_traceSamples = 0;
+    m_traceSlot = Seconds (0.0);
 
     m_scriptedBufferConfiguration = false;
     m_scriptedAckBufferConfiguration = false;
@@ -203,6 +205,11 @@ bool ConfigureScenario::ParseConfigurationFile(string confFile)
     	m_simulationChannel = SIM_SIMPLE_MODEL;
     	m_propTracing->GetTraceInfo().channel = "SIMPLE";
     }
+    else if (!value.compare("TRACE"))
+    {
+    	m_simulationChannel = SIM_TRACE_MODEL;
+    	m_propTracing->GetTraceInfo().channel = "TRACE";
+    }
     else
     {
         NS_ABORT_MSG("Incorrect channel model. " << value << " Please fix the configuration file");
@@ -673,6 +680,10 @@ void ConfigureScenario::SetAttributes ()
 	assert (m_configurationFile->GetKeyValue("WIFI", "TX_NUMBER", value) >= 0);
 	Config::SetDefault ("ns3::WifiRemoteStationManager::MaxSlrc", UintegerValue(atoi(value.c_str()))); 						//Maximum number of transmission attempts
 	Config::SetDefault ("ns3::WifiNetDevice::Mtu", UintegerValue(1512));   //
+	if (m_configurationFile->GetKeyValue("WIFI", "SPATIAL_CULLING", value) >= 0)		//Optional (all the phys receive every frame by default)
+	{
+		Config::SetDefault ("ns3::YansWifiChannel::SpatialCulling", BooleanValue (bool (atoi(value.c_str()))));
+	}
 
 	//Network-level attributes
 	//Config::SetDefault ("ns3::Ipv4L3Protocol::DefaultTtl", UintegerValue (4));
@@ -714,6 +725,14 @@ void ConfigureScenario::SetAttributes ()
 			Config::SetDefault ("ns3::InterFlowNetworkCodingBuffer::CodingBufferTimeout",TimeValue(MilliSeconds(atoi(value.c_str()))));
 			assert (m_configurationFile->GetKeyValue("NETWORK_CODING", "MAX_CODED_PACKETS", value) >= 0);
 			Config::SetDefault ("ns3::InterFlowNetworkCodingBuffer::MaxCodedPackets", UintegerValue((u_int32_t) atoi(value.c_str())));
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "RECEPTION_REPORTS", value) >= 0)		//Optional (blind coding by default)
+			{
+				Config::SetDefault ("ns3::InterFlowNetworkCodingBuffer::ReceptionReports", BooleanValue (bool (atoi(value.c_str()))));
+			}
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "REENCODING", value) >= 0)		//Optional (coded packets are just forwarded by default)
+			{
+				Config::SetDefault ("ns3::InterFlowNetworkCodingProtocol::Reencoding", BooleanValue (bool (atoi(value.c_str()))));
+			}
 		}
 		else if (value == "IntraFlowNetworkCodingProtocol")
 		{
@@ -725,10 +744,26 @@ void ConfigureScenario::SetAttributes ()
 			Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::K",UintegerValue((u_int16_t) atoi(value.c_str())));
 			assert (m_configurationFile->GetKeyValue("NETWORK_CODING", "RECODING", value) >= 0);
 			Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::Recoding", BooleanValue (bool (atoi(value.c_str()))));
-			assert (m_configurationFile->GetKeyValue("NETWORK_CODING", "ITPP", value) >= 0);
-			Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::Itpp", BooleanValue (bool (atoi(value.c_str()))));
+			assert (m_configurationFile->GetKeyValue("NETWORK_CODING", "BIT_PACKED_GF2", value) >= 0);
+			Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::BitPackedGf2", BooleanValue (bool (atoi(value.c_str()))));
 			assert (m_configurationFile->GetKeyValue("NETWORK_CODING", "TIMEOUT", value) >= 0);
 			Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::BufferTimeout", TimeValue(MilliSeconds(atoi(value.c_str()))));
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "CODE_PAYLOAD", value) >= 0)		//Optional (coefficients-only by default)
+			{
+				Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::CodePayload", BooleanValue (bool (atoi(value.c_str()))));
+			}
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "SEEDED_VECTORS", value) >= 0)		//Optional (explicit vectors by default)
+			{
+				Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::SeededVectors", BooleanValue (bool (atoi(value.c_str()))));
+			}
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "SCHEME", value) >= 0)		//Optional (0: block coding, by default; 1: sliding window)
+			{
+				Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::Scheme", EnumValue (atoi(value.c_str())));
+			}
+			if (m_configurationFile->GetKeyValue("NETWORK_CODING", "SYSTEMATIC", value) >= 0)		//Optional (non-systematic by default)
+			{
+				Config::SetDefault ("ns3::IntraFlowNetworkCodingProtocol::Systematic", BooleanValue (bool (atoi(value.c_str()))));
+			}
 		}
 	}
 
@@ -862,6 +897,11 @@ void ConfigureScenario::SetWifiChannel ()
         		//Enable/disable the dynamic average delay
         		assert (m_configurationFile->GetKeyValue ("HMM", "DYNAMIC_AVERAGE_TIME", temp) >= 0);
         		hmmModel->SetDynamicAverageTime ((bool) atoi(temp.c_str()));
+        		//Lazy evolution of the chains (optional, disabled by default)
+        		if (m_configurationFile->GetKeyValue ("HMM", "LAZY_EVOLUTION", temp) >= 0)
+        		{
+        			hmmModel->SetAttribute ("LazyEvolution", BooleanValue ((bool) atoi(temp.c_str())));
+        		}
         	}
         	else if (temp == "FRAMES")
         	{
@@ -898,6 +938,15 @@ void ConfigureScenario::SetWifiChannel ()
             	NS_ABORT_MSG ("HMM operation " << temp << " not valid.Please fix");
             }
 
+            //Pre-generate the state timelines, if required (frame-based simulations do not need the time slot)
+            if (!m_traceFileName.empty ())
+            {
+            	ChannelTraceWriter writer (NodeList().GetNNodes (), m_traceSamples, CHANNEL_TRACE_HMM,
+            			hmmModel->GetMode () == HMM_TIME_BASED_SIMULATION ? m_traceSlot : Seconds (0.0));
+            	hmmModel->GenerateTrace (writer);
+            	WriteChannelTrace (writer);
+            }
+
             //Add both propagation and error models to the Wifi instance helpers
             channelHelper.AddPropagationLoss (hmmModel);
             phyHelper.SetErrorModel (hmmModel->GetErrorModel());
@@ -931,6 +980,14 @@ void ConfigureScenario::SetWifiChannel ()
             assert (m_configurationFile->GetKeyValue("BEAR", "FF_VARIANCE", temp) >= 0);
             bearModel->SetAttribute ("FastFadingVariance", DoubleValue(atof(temp.c_str())));
 
+            //Pre-generate the SNR series, if required (at the power the phys will transmit with)
+            if (!m_traceFileName.empty ())
+            {
+            	ChannelTraceWriter writer (NodeList().GetNNodes (), m_traceSamples, CHANNEL_TRACE_BEAR);
+            	bearModel->GenerateTrace (writer, GetWifiTxPowerDbm (), prop);
+            	WriteChannelTrace (writer);
+            }
+
             //Add both propagation and error models to the Wifi instance helpers
             channelHelper.AddPropagationLoss (bearModel);
             phyHelper.SetErrorModel (bearModel->GetErrorModel());
@@ -988,6 +1045,14 @@ void ConfigureScenario::SetWifiChannel ()
         		}
         	}
 
+        	//Pre-generate the FER decisions, if required
+        	if (!m_traceFileName.empty ())
+        	{
+        		ChannelTraceWriter writer (NodeList().GetNNodes (), m_traceSamples, CHANNEL_TRACE_MATRIX);
+        		error->GenerateTrace (writer);
+        		WriteChannelTrace (writer);
+        	}
+
         	phyHelper.SetErrorModel(error);
 
         	break;
@@ -997,6 +1062,18 @@ void ConfigureScenario::SetWifiChannel ()
         	//TO BE IMPLEMENTED
         	break;
         }
+        case SIM_TRACE_MODEL: //RangePropagationLossModel + ChannelTraceErrorModel (the trace is generated beforehand, e.g. by the generate-channel-trace script)
+        {
+        	string temp;
+        	Ptr<RangePropagationLossModel> prop = CreateObject<RangePropagationLossModel > ();
+        	channelHelper.AddPropagationLoss(prop);
+
+        	Ptr<ChannelTraceErrorModel> error = CreateObject<ChannelTraceErrorModel> ();
+        	assert (m_configurationFile->GetKeyValue ("TRACE", "FILE", temp) >= 0);
+        	error->SetAttribute ("FileName", StringValue (temp));
+        	phyHelper.SetErrorModel(error);
+        	break;
+        }
     }
 
     phyHelper.SetChannel(channelHelper.Create());
@@ -1037,6 +1114,26 @@ void ConfigureScenario::SetWifiChannel ()
 
 }
 
+double ConfigureScenario::GetWifiTxPowerDbm () const
+{
+	TypeId tid = YansWifiPhy::GetTypeId ();
+	struct TypeId::AttributeInformation power, gain;
+
+	NS_ABORT_UNLESS (tid.LookupAttributeByName ("TxPowerStart", &power) && tid.LookupAttributeByName ("TxGain", &gain));
+	return DynamicCast<const DoubleValue> (power.initialValue)->Get () + DynamicCast<const DoubleValue> (gain.initialValue)->Get ();
+}
+
+void ConfigureScenario::WriteChannelTrace (const ChannelTraceWriter &writer)
+{
+	NS_LOG_FUNCTION (this << m_traceFileName);
+
+	if (!writer.Write (m_traceFileName))
+	{
+		NS_ABORT_MSG ("Unable to write the channel trace " << m_traceFileName);
+	}
+	NS_LOG_INFO ("Channel trace " << m_traceFileName << " written: " << writer.GetNNodes () << " nodes, " << writer.GetNSamples () << " samples per link");
+}
+
 void ConfigureScenario::SetNetworkCodingLayer ()
 {
 	NS_LOG_FUNCTION_NOARGS();
@@ -1115,6 +1212,13 @@ void ConfigureScenario::SetNetworkCodingLayer ()
 			m_propTracing->GetTraceInfo().packetLength = m_propTracing->GetTraceInfo().packetLength -
 					9 - (u_int8_t) ceil ((double) (atoi (IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(0).initialValue->SerializeToString (MakeUintegerChecker<u_int8_t> ()).c_str()) *
 							atoi (IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(1).initialValue->SerializeToString (MakeUintegerChecker<u_int8_t> ()).c_str())/8.0));
+
+			//With the actual payload coding, each source symbol also carries the datagram length (2 bytes), and it might be padded up to a multiple of q bytes
+			if (IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(5).initialValue->SerializeToString (MakeBooleanChecker ()) == "true")
+			{
+				u_int8_t q = atoi (IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(0).initialValue->SerializeToString (MakeUintegerChecker<u_int8_t> ()).c_str());
+				m_propTracing->GetTraceInfo().packetLength -= 2 + ((8 % q) ? q - 1 : 0);
+			}
 		}
 
 		//Ensure that the overall number of packet is a multiple of K
@@ -42,6 +42,7 @@
 #include "ns3/error-model.h"
 #include "ns3/bear-propagation-loss-model.h"
 #include "ns3/hidden-markov-propagation-loss-model.h"
+#include "ns3/channel-trace.h"
 
 #include <fstream>
 #include <map>
@@ -70,7 +71,8 @@ enum SimulationChannelType_t {
 	SIM_HMM_MODEL,			//HiddenMarkovPropagationLossModel + HiddenMarkovErrorModel
 	SIM_BEAR_MODEL,			//BearPropagationLossModel + BearErrorModel
 	SIM_MANUAL_MODEL,		//Matrix configuration file + MatrixPropagationLossErrorModel
-	SIM_SIMPLE_MODEL		//SimplePropagationLossModel
+	SIM_SIMPLE_MODEL,		//SimplePropagationLossModel
+	SIM_TRACE_MODEL			//RangePropagationLossModel + ChannelTraceErrorModel (replay of a pre-generated channel trace)
 };
 
 enum RoutingProtocol_t {
@@ -171,6 +173,16 @@ public:
 	 * Process or BEAR wireless channel)
 	 */
 	void SetWifiChannel ();
+	/**
+	 * \brief Dump the channel realization (pre-generated by the BEAR, HMM or MANUAL models) into the channel trace file, if the generation is enabled
+	 * \param writer Channel trace already filled by the corresponding model
+	 */
+	void WriteChannelTrace (const ChannelTraceWriter &writer);
+	/**
+	 * \return The power (dBm) at which the YansWifiPhy instances will transmit (TxPowerStart plus TxGain, as configured by the attribute
+	 * system), so that the pre-generated channel traces see the same received power as the live simulation
+	 */
+	double GetWifiTxPowerDbm () const;
 	/**
 	 * \brief Configure all the stuff regarding the setup of the network coding layer, in case it is used.
 	 */
@@ -242,6 +254,18 @@ public:
 	 * \return A pointer to the ProprietaryTracing object
 	 */
 	inline Ptr<ProprietaryTracing> GetProprietaryTracing () {return m_propTracing;}
+	/**
+	 * Enable the generation of a channel trace (to be replayed afterwards with PROPAGATION_LOSS_MODEL=TRACE) when the channel is configured
+	 * \param fileName Output file (empty to disable the generation)
+	 * \param samples Number of samples per link (frames or time slots)
+	 * \param slot Duration of each sample for time-based HMM channels (zero for frame-indexed traces)
+	 */
+	inline void SetChannelTraceGeneration (std::string fileName, u_int32_t samples, Time slot)
+	{
+		m_traceFileName = fileName;
+		m_traceSamples = samples;
+		m_traceSlot = slot;
+	}
 
 
 //private:
@@ -273,6 +297,11 @@ public:
 	//Special variables
 	float m_distance;										  //Distance (in meters) between contiguous nodes (line topology)
 
+	//Channel trace generation (disabled if the file name is empty)
+	std::string m_traceFileName;
+	u_int32_t m_traceSamples;
+	Time m_traceSlot;
+
 	//Enumerates definition
 	DeploymentConfiguration_t m_deployment;					  //Configure how to deploy the nodes (file, code or random)
 	SimulationChannelType_t m_simulationChannel;			  //Set the type of channel to carry out the simulations (four possibilities)
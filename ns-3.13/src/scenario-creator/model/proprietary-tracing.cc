@@ -355,7 +355,7 @@ void ProprietaryTracing::InterFlowNetworkCodingLongTrace (Ptr<Packet> packet, u_
 		if (interHeader.GetEmbeddedAcks() && !packetCopy->GetSize() )
 		{
 			//In this case, we will print out the information relative to the first element found in the buffer
-			tcpHeader = interHeader.m_tcpAckVector[0].tcpHeader;
+			tcpHeader = interHeader.GetTcpAcks ()[0].tcpHeader;
 			tcpHeaderSize = 0;
 		}
 		else
@@ -536,8 +536,8 @@ void ProprietaryTracing::EnableIntraFlowNetworkCodingShortTraceFile ()
 		char headerLine [FILENAME_MAX];
 		m_intraFlowNetworkCodingShortFile.open (path.c_str (), fstream::out | fstream::ate);
 
-		sprintf (headerLine, "%6s %5s %8s %10s %5s %5s %14s %8s %8s %8s %8s %16s %16s %16s %16s %16s %16s",
-				"No.", "Node", "FER", "Pkt_len", "Q", "K", "Thput(Mbps)", "TX_app", "RX_app","TX_nc","Rx_nc","Avg_delay(ms)","Var_delay(ms^2)","Avg_Rank(ms)","Var_Rank(ms^2)","Avg_Inv(ms)","Var_Inv(ms^2)");
+		sprintf (headerLine, "%6s %5s %8s %10s %5s %5s %14s %8s %8s %8s %8s %16s %16s %16s %16s %16s %16s %12s",
+				"No.", "Node", "FER", "Pkt_len", "Q", "K", "Thput(Mbps)", "TX_app", "RX_app","TX_nc","Rx_nc","Avg_delay(ms)","Var_delay(ms^2)","Avg_Rank(ms)","Var_Rank(ms^2)","Avg_Inv(ms)","Var_Inv(ms^2)","Avg_hdr(B)");
 
 		m_intraFlowNetworkCodingShortFile << headerLine << endl;
 	}
@@ -580,7 +580,7 @@ void ProprietaryTracing::IntraFlowNetworkCodingLongTrace (Ptr<Packet> packet, u_
 void ProprietaryTracing::PrintIntraFlowNetworkCodingStatistics ()
 {
 	u_int8_t q = atoi(IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(0).initialValue->SerializeToString (MakeUintegerChecker<u_int8_t> ()).c_str());
-	string itpp = IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(3).initialValue->SerializeToString (MakeBooleanChecker ());
+	string bitPackedGf2 = IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(3).initialValue->SerializeToString (MakeBooleanChecker ());
 
 	for (u_int8_t i = 0; i < NetworkMonitor::Instance().GetNetworkCodingVectorSize(); i ++)
 	{
@@ -593,6 +593,7 @@ void ProprietaryTracing::PrintIntraFlowNetworkCodingStatistics ()
 		double varRank;
 		double avgInverse;
 		double varInverse;
+		double avgHeader;
 
 		//Get the delay vector
 		vector<double> delayVector;
@@ -610,13 +611,15 @@ void ProprietaryTracing::PrintIntraFlowNetworkCodingStatistics ()
 		temp.rankTime.size() ? varRank = GetVariance (temp.rankTime, avgRank) : varRank = 0.0;
 		temp.inverseTime.size() ? avgInverse = GetAverage (temp.inverseTime, temp.inverseTime.begin(), temp.inverseTime.end()) : avgInverse = 0.0;
 		temp.inverseTime.size() ? varInverse = GetVariance (temp.inverseTime, avgInverse) : varInverse = 0.0;
+		//Coding overhead per transmitted packet (it depends on whether the vectors are seeded or explicit)
+		temp.txNumber ? avgHeader = (double) temp.headerBytes / temp.txNumber : avgHeader = 0.0;
 
-		//Special case: Print a "0" in those cases where we are using the IT++ library
-		sprintf (line, "%6d %5d %8.2f %10d %5d %5d %14.6f %8d %8d %8d %8d %16.4f %16.2e %16.4f %16.2e %16.4f %16.2e",
+		//Special case: Print a "0" in those cases where we are using the bit-packed GF(2) matrix
+		sprintf (line, "%6d %5d %8.2f %10d %5d %5d %14.6f %8d %8d %8d %8d %16.4f %16.2e %16.4f %16.2e %16.4f %16.2e %12.2f",
 				m_traceInfo.run, i, m_traceInfo.fer, m_traceInfo.packetLength,
-				(itpp=="true" && q==1) ? 0 : q,   //Q
+				(bitPackedGf2=="true" && q==1) ? 0 : q,   //Q
 				atoi(IntraFlowNetworkCodingProtocol::GetTypeId().GetAttribute(1).initialValue->SerializeToString (MakeUintegerChecker<u_int8_t> ()).c_str()),   //K
-				thput, temp.downNumber, temp.upNumber, temp.txNumber, temp.rxNumber, avgDelay, varDelay, avgRank, varRank, avgInverse, varInverse);
+				thput, temp.downNumber, temp.upNumber, temp.txNumber, temp.rxNumber, avgDelay, varDelay, avgRank, varRank, avgInverse, varInverse, avgHeader);
 
 		m_intraFlowNetworkCodingShortFile << line << endl;
 	}
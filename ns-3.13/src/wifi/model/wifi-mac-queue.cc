@@ -24,12 +24,7 @@
 #include "ns3/uinteger.h"
 
 ////Eduardo/David/Ramón
-#include "ns3/wifi-mac-header.h"
-#include "ns3/llc-snap-header.h"
-#include "ns3/ipv4-header.h"
-#include "ns3/udp-header.h"
-#include "ns3/intra-flow-network-coding-header.h"
-#include "ns3/hash-id.h"
+#include "ns3/network-coding-flow-tag.h"
 ////End Eduardo/David/Ramón
 
 #include "wifi-mac-queue.h"
@@ -46,7 +41,8 @@ WifiMacQueue::Item::Item (Ptr<const Packet> packet,
                           Time tstamp)
   : packet (packet),
     hdr (hdr),
-    tstamp (tstamp)
+    tstamp (tstamp),
+    indexed (false)
 {
 }
 
@@ -104,62 +100,52 @@ WifiMacQueue::GetMaxDelay (void) const
 
 
 ////Eduardo/David/Ramón
-void WifiMacQueue::SelectiveFlush (u_int16_t hash)
+void WifiMacQueue::SelectiveFlush (const FlowKey &flowId)
 {
+	FlowIndexMap::iterator flow = m_flowIndex.find (flowId);
+	if (flow == m_flowIndex.end ())
+	{
+		return;
+	}
 
-	Ptr<Packet> copy;
-	PacketQueueI it = m_queue.begin ();
-	//for (it= m_queue.begin (); it != m_queue.end (); it++)
-	while(it!=m_queue.end ())
+	//Detach the whole per-flow index at once, and then erase its packets straight from the queue
+	FlowIndex positions;
+	positions.swap (flow->second);
+	m_flowIndex.erase (flow);
+
+	for (FlowIndex::iterator it = positions.begin (); it != positions.end (); it++)
 	{
-		copy=it->packet->Copy ();
-		LlcSnapHeader llcHeader;
-		Ipv4Header ipHeader;
-		IntraFlowNetworkCodingHeader ncHeader;
-		UdpHeader udpHeader;
-		copy->RemoveHeader (llcHeader);
-		switch (llcHeader.GetType ())
-		{
-		case 0x0806:            //ARP
-			break;
-		case 0x0800:            //IP packet
+		m_queue.erase (*it);
+		m_size--;
+	}
+}
+
+void WifiMacQueue::Index (PacketQueueI it)
+{
+	NetworkCodingFlowTag tag;
+	if (it->packet->PeekPacketTag (tag))
+	{
+		FlowIndex &index = m_flowIndex [tag.GetFlowId ()];
+		it->indexed = true;
+		it->flowId = tag.GetFlowId ();
+		//Keep the FIFO order within the flow, even for the packets inserted at the front
+		it->flowPosition = (it == m_queue.begin ()) ? index.insert (index.begin (), it) : index.insert (index.end (), it);
+	}
+}
+
+WifiMacQueue::PacketQueueI WifiMacQueue::Erase (PacketQueueI it)
+{
+	if (it->indexed)
+	{
+		FlowIndexMap::iterator flow = m_flowIndex.find (it->flowId);
+		flow->second.erase (it->flowPosition);
+		if (flow->second.empty ())
 		{
-			copy->RemoveHeader(ipHeader);
-			switch (ipHeader.GetProtocol ())
-			{
-			case 6:             //TCP
-				break;
-			case 17:            //UDP
-				break;
-			case 99:    //Network Coding --> Force the shortest frames to be correct
-				break;
-			case 100:	// MORE
-			{
-				copy->RemoveHeader (ncHeader);
-				u_int16_t chosenBuffer = HashID (ipHeader.GetSource (), ipHeader.GetDestination (), ncHeader.GetSourcePort (), ncHeader.GetDestinationPort ());
-				if (chosenBuffer==hash && ncHeader.GetTx ()==0)
-				{
-					PacketQueueI aux=it;
-					it++;
-					m_queue.erase (aux);
-					m_size--;
-					//it= m_queue.begin ();
-				}
-				else
-				{
-					it++;
-				}
-				break;
-			}
-			default:
-				break;
-			}
-		}
-		break;
-		default:
-			break;
+			m_flowIndex.erase (flow);
 		}
 	}
+	m_size--;
+	return m_queue.erase (it);
 }
 ////End Eduardo/David/Ramón
 
@@ -174,6 +160,7 @@ WifiMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
   Time now = Simulator::Now ();
   m_queue.push_back (Item (packet, hdr, now));
   m_size++;
+  Index (--m_queue.end ());
 }
 
 void
@@ -185,7 +172,6 @@ WifiMacQueue::Cleanup (void)
     }
 
   Time now = Simulator::Now ();
-  uint32_t n = 0;
   for (PacketQueueI i = m_queue.begin (); i != m_queue.end ();)
     {
       if (i->tstamp + m_maxDelay > now)
@@ -194,11 +180,9 @@ WifiMacQueue::Cleanup (void)
         }
       else
         {
-          i = m_queue.erase (i);
-          n++;
+          i = Erase (i);
         }
     }
-  m_size -= n;
 }
 
 Ptr<const Packet>
@@ -208,8 +192,7 @@ WifiMacQueue::Dequeue (WifiMacHeader *hdr)
   if (!m_queue.empty ())
     {
       Item i = m_queue.front ();
-      m_queue.pop_front ();
-      m_size--;
+      Erase (m_queue.begin ());
       *hdr = i.hdr;
       return i.packet;
     }
@@ -248,8 +231,7 @@ WifiMacQueue::DequeueByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
                 {
                   packet = it->packet;
                   *hdr = it->hdr;
-                  m_queue.erase (it);
-                  m_size--;
+                  Erase (it);
                   break;
                 }
             }
@@ -300,6 +282,7 @@ void
 WifiMacQueue::Flush (void)
 {
   m_queue.erase (m_queue.begin (), m_queue.end ());
+  m_flowIndex.clear ();
   m_size = 0;
 }
 
@@ -329,8 +312,7 @@ WifiMacQueue::Remove (Ptr<const Packet> packet)
     {
       if (it->packet == packet)
         {
-          m_queue.erase (it);
-          m_size--;
+          Erase (it);
           return true;
         }
     }
@@ -348,6 +330,7 @@ WifiMacQueue::PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr)
   Time now = Simulator::Now ();
   m_queue.push_front (Item (packet, hdr, now));
   m_size++;
+  Index (m_queue.begin ());
 }
 
 uint32_t
@@ -388,8 +371,7 @@ WifiMacQueue::DequeueFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
           *hdr = it->hdr;
           timestamp = it->tstamp;
           packet = it->packet;
-          m_queue.erase (it);
-          m_size--;
+          Erase (it);
           return packet;
         }
     }
@@ -27,6 +27,7 @@
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
 #include "ns3/object.h"
+#include "ns3/flow-table.h"
 #include "wifi-mac-header.h"
 
 namespace ns3 {
@@ -62,7 +63,13 @@ public:
   Time GetMaxDelay (void) const;
 
   ////Eduardo/David/Ramón
-   void SelectiveFlush (u_int16_t hash);
+  /**
+   * Remove every intra-flow coded data packet which belongs to the given flow. The packets are looked up through an index
+   * filled upon their insertion (from their NetworkCodingFlowTag), so the cost only depends on the number of packets of
+   * that very flow
+   * \param flowId Flow identifier
+   */
+   void SelectiveFlush (const FlowKey &flowId);
    ////End Eduardo/David/Ramón
 
   void Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr);
@@ -131,6 +138,21 @@ private:
   typedef std::list<struct Item>::reverse_iterator PacketQueueRI;
   typedef std::list<struct Item>::iterator PacketQueueI;
 
+  ////Eduardo/David/Ramón
+  typedef std::list<PacketQueueI> FlowIndex;                  //Positions (FIFO order) of the packets of a flow
+  typedef FlowTable<FlowIndex> FlowIndexMap;
+
+  /**
+   * Insert the entry into the per-flow index, if the packet carries a NetworkCodingFlowTag
+   */
+  void Index (PacketQueueI it);
+  /**
+   * Remove the entry from the queue (and from the per-flow index); every removal must go through here
+   * \returns The entry next to the erased one
+   */
+  PacketQueueI Erase (PacketQueueI it);
+  ////End Eduardo/David/Ramón
+
   void Cleanup (void);
   Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI);
 
@@ -142,9 +164,15 @@ private:
     Ptr<const Packet> packet;
     WifiMacHeader hdr;
     Time tstamp;
+    ////Eduardo/David/Ramón
+    bool indexed;
+    FlowKey flowId;
+    FlowIndex::iterator flowPosition;
+    ////End Eduardo/David/Ramón
   };
 
   PacketQueue m_queue;
+  FlowIndexMap m_flowIndex;
   WifiMacParameters *m_parameters;
   uint32_t m_size;
   uint32_t m_maxSize;
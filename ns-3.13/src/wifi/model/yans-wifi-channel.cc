@@ -29,6 +29,12 @@
 //#include "yans-wifi-phy.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/propagation-delay-model.h"
+////David/Ramón
+#include "ns3/boolean.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+////End David/Ramón
 
 NS_LOG_COMPONENT_DEFINE ("YansWifiChannel");
 
@@ -50,17 +56,36 @@ YansWifiChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&YansWifiChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    ////David/Ramón
+    .AddAttribute ("SpatialCulling",
+                   "Do not schedule the reception of the frames at the phys which cannot reach the energy detection (or CCA) threshold, "
+                   "according to the bound given by the propagation loss model (only deterministic models can be bounded). "
+                   "Note that those frames are not accounted as interference anymore, and that the delay model is not "
+                   "invoked for the skipped phys",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&YansWifiChannel::m_culling),
+                   MakeBooleanChecker ())
+    ////End David/Ramón
   ;
   return tid;
 }
 
 YansWifiChannel::YansWifiChannel ()
+  : m_culling (false),
+    m_gridValid (false),
+    m_hooked (0),
+    m_cellSize (1.0),
+    m_detectionThresholdDbm (0.0),
+    m_culledReceptions (0)
 {
 }
 YansWifiChannel::~YansWifiChannel ()
 {
   NS_LOG_FUNCTION_NOARGS ();
   m_phyList.clear ();
+  m_registry.clear ();
+  m_pending.clear ();
+  m_grid.clear ();
 }
 
 void
@@ -80,40 +105,61 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
-  uint32_t j = 0;
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+
+  ////David/Ramón
+  // Spatial culling: only visit the phys which might detect the frame (the candidates are sorted, hence the reception events are
+  // scheduled in the same order as if all the phys were visited)
+  bool culled = m_culling && GetCandidates (sender, txPowerDbm, m_candidates);
+  uint32_t nCandidates = culled ? m_candidates.size () : m_phyList.size ();
+
+  // The receivers are gathered first, so that the propagation loss of the whole transmission is computed with a single batch call
+  m_batchPhys.clear ();
+  m_batchMobility.clear ();
+  for (uint32_t k = 0; k < nCandidates; k++)
     {
-      if (sender != (*i))
+      uint32_t j = culled ? m_candidates[k] : k;
+      Ptr<YansWifiPhy> receiver = m_phyList[j];
+      // For now don't account for inter channel interference
+      if (sender != receiver && receiver->GetChannelNumber () == sender->GetChannelNumber ())
         {
-          // For now don't account for inter channel interference
-          if ((*i)->GetChannelNumber () != sender->GetChannelNumber ())
-            {
-              continue;
-            }
+          m_batchPhys.push_back (j);
+          m_batchMobility.push_back (receiver->GetMobility ()->GetObject<MobilityModel> ());
+        }
+    }
+  m_loss->CalcRxPowerBatch (txPowerDbm, senderMobility, m_batchMobility, m_batchRxPowerDbm);
+  if (culled)
+    {
+      // Only the receivers which would have been scheduled otherwise (same channel, but the sender) are accounted
+      m_culledReceptions += m_channelPhys[sender->GetChannelNumber ()] - 1 - m_batchPhys.size ();
+    }
+  ////End David/Ramón
 
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+  for (uint32_t k = 0; k < m_batchPhys.size (); k++)
+    {
+      uint32_t j = m_batchPhys[k];
+      Ptr<MobilityModel> receiverMobility = m_batchMobility[k];
+      Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+      double rxPowerDbm = m_batchRxPowerDbm[k];
 
-          NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
-                        "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
+      NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                    "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
 
-          Ptr<Packet> copy = packet->Copy ();
-          Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
-          uint32_t dstNode;
-          if (dstNetDevice == 0)
-            {
-              dstNode = 0xffffffff;
-            }
-          else
-            {
-              dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
-            }
-          Simulator::ScheduleWithContext (dstNode,
-                                          delay, &YansWifiChannel::Receive, this,
-                                          j, copy, rxPowerDbm, wifiMode, preamble);
+      Ptr<Packet> copy = packet->Copy ();
+      Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
+      uint32_t dstNode;
+      if (dstNetDevice == 0)
+        {
+          dstNode = 0xffffffff;
+        }
+      else
+        {
+          dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
         }
+      Simulator::ScheduleWithContext (dstNode,
+                                      delay, &YansWifiChannel::Receive, this,
+                                      j, copy, rxPowerDbm, wifiMode, preamble);
     }
+  m_batchMobility.clear ();   ////David/Ramón
 }
 
 void
@@ -137,7 +183,246 @@ YansWifiChannel::GetDevice (uint32_t i) const
 void
 YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
 {
+  ////David/Ramón
+  phy->SetChannelIndex (m_phyList.size ());
+  m_pending.push_back (m_phyList.size ());
+  if (phy->GetChannelNumber () >= m_channelPhys.size ())
+    {
+      m_channelPhys.resize (phy->GetChannelNumber () + 1, 0);
+    }
+  m_channelPhys[phy->GetChannelNumber ()]++;
+  m_gridValid = false;
+  ////End David/Ramón
   m_phyList.push_back (phy);
 }
 
+////David/Ramón
+YansWifiChannel::AddressKey::AddressKey (Mac48Address mac)
+  : address (0)
+{
+  uint8_t buffer[6];
+  mac.CopyTo (buffer);
+  for (uint8_t i = 0; i < 6; i++)
+    {
+      address = (address << 8) | buffer[i];
+    }
+}
+
+uint32_t
+YansWifiChannel::AddressKey::Hash () const
+{
+  // The allocated addresses only differ in the lowest bytes
+  return FlowTableHash (address);
+}
+
+bool
+YansWifiChannel::RegisterPending (void) const
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t kept = 0;
+  for (uint32_t k = 0; k < m_pending.size (); k++)
+    {
+      uint32_t i = m_pending[k];
+      Ptr<Object> device = m_phyList[i]->GetDevice ();
+      Ptr<NetDevice> netDevice = (device == 0) ? 0 : device->GetObject<NetDevice> ();
+      if (netDevice == 0 || netDevice->GetNode () == 0)
+        {
+          m_pending[kept++] = i;
+          continue;
+        }
+      Mac48Address address = Mac48Address::ConvertFrom (netDevice->GetAddress ());
+      if (address == Mac48Address ("00:00:00:00:00:00"))
+        {
+          m_pending[kept++] = i;
+          continue;
+        }
+      PhyIdentity identity;
+      identity.nodeId = netDevice->GetNode ()->GetId ();
+      identity.phyIndex = i;
+      m_registry[AddressKey (address)] = identity;
+    }
+  bool registered = (kept != m_pending.size ());
+  m_pending.resize (kept);
+  return registered;
+}
+
+bool
+YansWifiChannel::LookupPhy (Mac48Address address, PhyIdentity &identity) const
+{
+  AddressKey key (address);
+  FlowTable<PhyIdentity, AddressKey>::iterator it = m_registry.find (key);
+  if (it == m_registry.end ())
+    {
+      // Only the phys which have not been registered yet are checked
+      if (m_pending.empty () || !RegisterPending ())
+        {
+          return false;
+        }
+      it = m_registry.find (key);
+      if (it == m_registry.end ())
+        {
+          return false;
+        }
+    }
+  identity = it->second;
+  return true;
+}
+
+void
+YansWifiChannel::ChannelNumberChanged (uint16_t from, uint16_t to)
+{
+  NS_ASSERT (from < m_channelPhys.size () && m_channelPhys[from] > 0);
+  m_channelPhys[from]--;
+  if (to >= m_channelPhys.size ())
+    {
+      m_channelPhys.resize (to + 1, 0);
+    }
+  m_channelPhys[to]++;
+}
+
+void
+YansWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility) const
+{
+  m_gridValid = false;
+}
+
+YansWifiChannel::GridCell
+YansWifiChannel::GetCell (const Vector &position) const
+{
+  return GridCell ((int32_t) floor (position.x / m_cellSize), (int32_t) floor (position.y / m_cellSize));
+}
+
+double
+YansWifiChannel::GetCullingRange (double txPowerDbm) const
+{
+  std::map<double, double>::const_iterator it = m_cullingRanges.find (txPowerDbm);
+  if (it != m_cullingRanges.end ())
+    {
+      return it->second;
+    }
+
+  // The bound does not increase with the distance, so the range can be found by bisection (provided that it is not unbounded in practice)
+  double range = -1.0;
+  if (m_loss->CalcMaxRxPower (txPowerDbm, 1e6) < m_detectionThresholdDbm)
+    {
+      double low = 0.0;
+      double high = 1.0;
+      while (m_loss->CalcMaxRxPower (txPowerDbm, high) >= m_detectionThresholdDbm)
+        {
+          low = high;
+          high *= 2;
+        }
+      for (uint8_t i = 0; i < 64 && high - low > 1e-3; i++)
+        {
+          double middle = (low + high) / 2;
+          if (m_loss->CalcMaxRxPower (txPowerDbm, middle) >= m_detectionThresholdDbm)
+            {
+              low = middle;
+            }
+          else
+            {
+              high = middle;
+            }
+        }
+      range = high;
+    }
+
+  NS_LOG_DEBUG ("Culling range for " << txPowerDbm << " dBm: " << range << " m");
+  m_cullingRanges[txPowerDbm] = range;
+  return range;
+}
+
+void
+YansWifiChannel::BuildGrid (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // The mobility models are not set yet when the phys are added, hence they are connected here
+  for (; m_hooked < m_phyList.size (); m_hooked++)
+    {
+      m_phyList[m_hooked]->GetMobility ()->GetObject<MobilityModel> ()->TraceConnectWithoutContext ("CourseChange",
+          MakeCallback (&YansWifiChannel::CourseChanged, this));
+    }
+
+  double maxTxPowerDbm = -std::numeric_limits<double>::infinity ();
+  m_detectionThresholdDbm = std::numeric_limits<double>::infinity ();
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      // Frames above the CCA threshold (which might be lower than the energy detection one) also change the state of the phy
+      double thresholdDbm = std::min (m_phyList[i]->GetEdThreshold (), m_phyList[i]->GetCcaMode1Threshold ());
+      m_detectionThresholdDbm = std::min (m_detectionThresholdDbm, thresholdDbm - m_phyList[i]->GetRxGain ());
+      maxTxPowerDbm = std::max (maxTxPowerDbm, m_phyList[i]->GetTxPowerEnd () + m_phyList[i]->GetTxGain ());
+    }
+  m_cullingRanges.clear ();
+  m_cellSize = std::max (GetCullingRange (maxTxPowerDbm), 1.0);
+
+  m_grid.clear ();
+  m_movingPhys.clear ();
+  for (uint32_t i = 0; i < m_phyList.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[i]->GetMobility ()->GetObject<MobilityModel> ();
+      Vector velocity = mobility->GetVelocity ();
+      if (velocity.x != 0 || velocity.y != 0 || velocity.z != 0)
+        {
+          m_movingPhys.push_back (i);
+        }
+      else
+        {
+          m_grid[GetCell (mobility->GetPosition ())].push_back (i);
+        }
+    }
+  m_gridValid = true;
+}
+
+bool
+YansWifiChannel::GetCandidates (Ptr<YansWifiPhy> sender, double txPowerDbm, std::vector<uint32_t> &candidates) const
+{
+  if (!m_gridValid)
+    {
+      BuildGrid ();
+    }
+
+  double range = GetCullingRange (txPowerDbm);
+  if (range < 0)
+    {
+      return false;
+    }
+
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
+  GridCell center = GetCell (senderMobility->GetPosition ());
+  int32_t reach = (int32_t) ceil (range / m_cellSize);
+
+  candidates.clear ();
+  for (int32_t x = center.x - reach; x <= center.x + reach; x++)
+    {
+      for (int32_t y = center.y - reach; y <= center.y + reach; y++)
+        {
+          Grid::iterator cell = m_grid.find (GridCell (x, y));
+          if (cell == m_grid.end ())
+            {
+              continue;
+            }
+          for (uint32_t i = 0; i < cell->second.size (); i++)
+            {
+              Ptr<MobilityModel> mobility = m_phyList[cell->second[i]]->GetMobility ()->GetObject<MobilityModel> ();
+              if (m_loss->CalcMaxRxPower (txPowerDbm, senderMobility->GetDistanceFrom (mobility)) >= m_detectionThresholdDbm)
+                {
+                  candidates.push_back (cell->second[i]);
+                }
+            }
+        }
+    }
+  for (uint32_t i = 0; i < m_movingPhys.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[m_movingPhys[i]]->GetMobility ()->GetObject<MobilityModel> ();
+      if (m_loss->CalcMaxRxPower (txPowerDbm, senderMobility->GetDistanceFrom (mobility)) >= m_detectionThresholdDbm)
+        {
+          candidates.push_back (m_movingPhys[i]);
+        }
+    }
+  std::sort (candidates.begin (), candidates.end ());
+  return true;
+}
+////End David/Ramón
+
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define YANS_WIFI_CHANNEL_H
 
 #include <vector>
+#include <map>
 #include <stdint.h>
 #include "ns3/packet.h"
 #include "wifi-channel.h"
@@ -29,6 +30,9 @@
 
 ////David/Ramón
 #include "yans-wifi-phy.h"
+#include "ns3/mac48-address.h"
+#include "ns3/flow-table.h"
+#include "ns3/vector.h"
 ////End David/Ramón
 
 namespace ns3 {
@@ -37,6 +41,7 @@ class NetDevice;
 class PropagationLossModel;
 class PropagationDelayModel;
 class YansWifiPhy;
+class MobilityModel;
 
 /**
  * \brief A Yans wifi channel
@@ -90,9 +95,44 @@ public:
 
   ////David/Ramón
   /**
-   * In order to ease the node ID recognition, this method return a pointer to the vector that contains the list of instanced YansWifiPhy objects
+   * In order to ease the node ID recognition, this method return a reference to the vector that contains the list of instanced YansWifiPhy objects
    */
-  inline std::vector<Ptr<YansWifiPhy> > GetPhyList () {return m_phyList;}
+  inline const std::vector<Ptr<YansWifiPhy> > & GetPhyList () const {return m_phyList;}
+
+  /**
+   * Identity of a YansWifiPhy attached to the channel
+   */
+  struct PhyIdentity
+  {
+    PhyIdentity () : nodeId (0), phyIndex (0) {}
+    uint32_t nodeId;        // Id of the node which holds the device
+    uint32_t phyIndex;      // Position of the phy within the channel list (see YansWifiPhy::GetChannelIndex)
+  };
+
+  /**
+   * Constant-time identification of the transmitter of a frame (its Addr2), needed by the error models which depend on the
+   * tx/rx pair. The MAC addresses are not known yet when the phys attach to the channel, so every added phy is kept as pending
+   * until its device has an address; only the pending phys are checked upon a miss (none, once the scenario has been set up)
+   * \param address MAC address of the device
+   * \param identity Where the node and phy indexes are stored (only valid if true is returned)
+   * \returns true if the address belongs to a phy attached to the channel
+   */
+  bool LookupPhy (Mac48Address address, PhyIdentity &identity) const;
+
+  /**
+   * \returns The number of reception events which have not been scheduled by the spatial culling (see the SpatialCulling
+   * attribute), since the receivers could not have detected the frame
+   */
+  inline uint64_t GetNCulledReceptions (void) const {return m_culledReceptions;}
+
+  /**
+   * \param from Previous channel number of the phy
+   * \param to New channel number of the phy
+   *
+   * Keeps the number of phys per channel number (used to account the culled receptions). This method should not be invoked by
+   * normal users, it is invoked from YansWifiPhy::SetChannelNumber
+   */
+  void ChannelNumberChanged (uint16_t from, uint16_t to);
   ////End David/Ramón
 
 
@@ -108,6 +148,79 @@ private:
   PhyList m_phyList;
   Ptr<PropagationLossModel> m_loss;
   Ptr<PropagationDelayModel> m_delay;
+
+  ////David/Ramón
+  /**
+   * FlowTable key which holds a MAC address
+   */
+  struct AddressKey
+  {
+    AddressKey () : address (0) {}
+    AddressKey (Mac48Address mac);
+    uint32_t Hash () const;
+    bool operator == (const AddressKey &other) const {return address == other.address;}
+    uint64_t address;
+  };
+
+  /**
+   * Move the pending phys whose device already has an address into the registry
+   * \returns true if any phy was registered
+   */
+  bool RegisterPending (void) const;
+
+  mutable FlowTable<PhyIdentity, AddressKey> m_registry;    // MAC address --> Phy identity
+  mutable std::vector<uint32_t> m_pending;                  // Phys (channel indexes) whose address is not known yet
+
+  /**
+   * FlowTable key which holds the coordinates of a grid cell
+   */
+  struct GridCell
+  {
+    GridCell () : x (0), y (0) {}
+    GridCell (int32_t x, int32_t y) : x (x), y (y) {}
+    uint32_t Hash () const {return FlowTableHash (((uint64_t) (uint32_t) x << 32) | (uint32_t) y);}
+    bool operator == (const GridCell &other) const {return x == other.x && y == other.y;}
+    int32_t x;
+    int32_t y;
+  };
+  typedef FlowTable<std::vector<uint32_t>, GridCell> Grid;
+
+  /**
+   * Place the static phys into a uniform grid (the cell size is the culling range at the highest transmission power), whereas the
+   * moving ones are kept apart, since they are always checked
+   */
+  void BuildGrid (void) const;
+  void CourseChanged (Ptr<const MobilityModel> mobility) const;
+  /**
+   * \returns The distance beyond which a frame sent at txPowerDbm cannot reach the energy detection/CCA threshold of any phy, or a
+   * negative value if the propagation loss model cannot be bounded
+   */
+  double GetCullingRange (double txPowerDbm) const;
+  GridCell GetCell (const Vector &position) const;
+  /**
+   * \param sender Transmitter
+   * \param txPowerDbm Transmission power
+   * \param candidates Where the (sorted) indexes of the phys which might detect the frame are stored
+   * \returns false if the frame cannot be culled (all the phys must be considered)
+   */
+  bool GetCandidates (Ptr<YansWifiPhy> sender, double txPowerDbm, std::vector<uint32_t> &candidates) const;
+
+  bool m_culling;                                            // Spatial culling enabled
+  mutable bool m_gridValid;
+  mutable uint32_t m_hooked;                                 // Number of phys connected to the CourseChange trace source
+  mutable double m_cellSize;
+  mutable double m_detectionThresholdDbm;                    // Lowest energy detection/CCA threshold (regarding the rx gain)
+  mutable Grid m_grid;
+  mutable std::vector<uint32_t> m_movingPhys;
+  mutable std::map<double, double> m_cullingRanges;          // Tx power (dBm) --> Culling range (m)
+  mutable std::vector<uint32_t> m_candidates;
+  mutable uint64_t m_culledReceptions;
+  std::vector<uint32_t> m_channelPhys;                       // Channel number --> Number of phys
+  // Receivers of the current transmission (reused across calls), handed over to PropagationLossModel::CalcRxPowerBatch
+  mutable std::vector<uint32_t> m_batchPhys;
+  mutable std::vector<Ptr<MobilityModel> > m_batchMobility;
+  mutable std::vector<double> m_batchRxPowerDbm;
+  ////End David/Ramón
 };
 
 } // namespace ns3
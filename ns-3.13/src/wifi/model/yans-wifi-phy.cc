@@ -44,6 +44,7 @@
 #include "ns3/llc-snap-header.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"   ////David/Ramón
 #include "ns3/mobility-model.h"
 #include "ns3/bear-propagation-loss-model.h"
 #include "ns3/hidden-markov-propagation-loss-model.h"
@@ -151,7 +152,8 @@ YansWifiPhy::YansWifiPhy ()
     m_channelStartingFrequency (0),
 
     m_ranvar (0.0, 1.0),
-    m_errorModel (0)
+    m_errorModel (0),
+    m_channelIndex (0)
 
 {
   NS_LOG_FUNCTION (this);
@@ -368,6 +370,12 @@ YansWifiPhy::SetChannelNumber (uint16_t nch)
     {
       // this is not channel switch, this is initialization
       NS_LOG_DEBUG ("start at channel " << nch);
+      ////David/Ramón
+      if (m_channel != 0)
+        {
+          m_channel->ChannelNumberChanged (m_channelNumber, nch);
+        }
+      ////End David/Ramón
       m_channelNumber = nch;
       return;
     }
@@ -407,6 +415,12 @@ switchChannel:
    * state are added to the event list and are employed later to figure
    * out the state of the medium after the switching.
    */
+  ////David/Ramón
+  if (m_channel != 0)
+    {
+      m_channel->ChannelNumberChanged (m_channelNumber, nch);
+    }
+  ////End David/Ramón
   m_channelNumber = nch;
 }
 
@@ -829,16 +843,15 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 
 	////David/Ramón
 	//Packet receiver identification
-	int i;
 	u_int16_t txNodeId = 0;
 	u_int16_t rxNodeId = 0;
-	Ptr<YansWifiChannel> channel;
 
 	//Headers parsing
 	WifiMacHeader hdr;
 	LlcSnapHeader llcHdr;
 	Ipv4Header ipv4Hdr;
 	TcpHeader tcpHdr;
+	UdpHeader udpHdr;   ////David/Ramón
 	Ptr<Packet> pktCopy = packet->Copy();
 	////End David/Ramón
 
@@ -858,17 +871,9 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 
 	//Common task --> Get the transmitter and receiver nodes (Node Id)
 	//Identify the ID of the node that catches the frame in order to later trace it (As a wireless link will be characterized by the
-	//broadcast nature of the medium, every node is prone to overhear a particular frame; hence, we will search which YansWifiPhy
-	//instance is currently running to obtain the receiver entity
-	channel = DynamicCast<YansWifiChannel> (GetChannel());
-	for (i = 0; i < (int) channel->GetPhyList().size(); i++)
-	{
-		if (channel->GetPhyList()[i] == this)
-		{
-			rxNodeId = i;
-			break;		//Force the exit of the loop
-		}
-	}
+	//broadcast nature of the medium, every node is prone to overhear a particular frame; hence, we need to know which YansWifiPhy
+	//instance is currently running to obtain the receiver entity (its position within the channel list is kept since it was attached)
+	rxNodeId = m_channelIndex;
 
 	if (m_errorModel)
 	{
@@ -877,26 +882,20 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 			Ptr<HiddenMarkovErrorModel> hmmError = DynamicCast<HiddenMarkovErrorModel> (m_errorModel);
 			Ptr<MatrixErrorModel> matrixError = DynamicCast<MatrixErrorModel> (m_errorModel);
 
-			//Locate the transmitter: to do so, we have to look a node with the particular MAC address of the transmitter
+			//Locate the transmitter: to do so, we have to look for the node with the particular MAC address of the transmitter (the
+			//channel keeps a registry of the addresses of all the attached phys)
 			WifiMacHeader header;
 			packet->PeekHeader (header);
 
 			if (header.GetAddr2 () != Mac48Address ("00:00:00:00:00:00"))
 			{
-				for (u_int16_t j = 0; j < NodeList::GetNNodes(); j++)
+				YansWifiChannel::PhyIdentity transmitter;
+				if (m_channel->LookupPhy (header.GetAddr2 (), transmitter))
 				{
-					for (u_int16_t k = 0; k < NodeList::GetNode(j)->GetNDevices(); k++)
-					{
-						Mac48Address tx = tx.ConvertFrom(NodeList::GetNode(j)->GetDevice(k)->GetAddress());
-
-						if (tx == header.GetAddr2 ())		//If found the source node, no need to continue looping
-						{
-							txNodeId = j;
-							//DEBUG MESSAGE
-							NS_LOG_DEBUG (Simulator::Now().GetSeconds() << " :TX " << (int) txNodeId << " (" << header.GetAddr2 () << ") "
-									" -> RX " << (int) rxNodeId << " (" << header.GetAddr1 () << ")");
-						}
-					}
+					txNodeId = transmitter.nodeId;
+					//DEBUG MESSAGE
+					NS_LOG_DEBUG (Simulator::Now().GetSeconds() << " :TX " << (int) txNodeId << " (" << header.GetAddr2 () << ") "
+							" -> RX " << (int) rxNodeId << " (" << header.GetAddr1 () << ")");
 				}
 			}
 
@@ -936,12 +935,11 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 				Ptr<Packet> pktCopy2 = packet->Copy();
 				pktCopy2->RemoveHeader(hdr);
 				//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
-				if (hdr.IsData() && !hdr.GetAddr1().IsBroadcast())
+				if (hdr.IsData())
 				{
 					//We have split the packet decision into the following three conditions:
 					// - ARP frames --> Always correct
-					// - TCP ACK --> Always correct
-					// - Data frames --> Legacy HMM decision process
+					// - IP frames --> The error model decides whether they are error prone (by default, unicast data segments; TCP ACKs are always correct)
 					pktCopy2->RemoveHeader(llcHdr);
 
 					switch (llcHdr.GetType())
@@ -955,22 +953,19 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 						{
 						case 6:				//TCP
 							pktCopy2->RemoveHeader(tcpHdr);
-							//Data segments --> To be errored. We will consider data segments to those which has a payload length longer than 4 bytes
-							if (pktCopy2->GetSize() > 300)
-								matrixError->SetCorrect (false);
-							else
-								matrixError->SetCorrect (true);
 							break;
 						case 17:			//UDP
-							matrixError->SetCorrect (false);
+							pktCopy2->RemoveHeader(udpHdr);
 							break;
 						default:
-							NS_LOG_ERROR ("Protocol not implemented yet (IP) --> " << ipv4Hdr.GetProtocol());
 							break;
 						}
+						matrixError->SetCorrect (!matrixError->IsErrorProne (ipv4Hdr.GetProtocol(), pktCopy2->GetSize(), hdr.GetAddr1().IsBroadcast()));
 						break;
 						default:
 							NS_LOG_ERROR ("Protocol not implemented yet (LLC) --> " << llcHdr.GetType());
+							if (hdr.GetAddr1().IsBroadcast())
+								matrixError->SetCorrect (true);
 							break;
 					}
 				}
@@ -153,6 +153,15 @@ public:
 
   ////David/Ramón
   void SetPhyReceiveCallback (PhyRxCallback callback);
+
+  /**
+   * \param index Position of the phy within the list of the channel it is attached to (set by YansWifiChannel::Add)
+   */
+  inline void SetChannelIndex (uint32_t index) {m_channelIndex = index;}
+  /**
+   * \returns The position of the phy within the list of its channel, used to identify the receiver of the frames
+   */
+  inline uint32_t GetChannelIndex (void) const {return m_channelIndex;}
   ////David/Ramón
 
   virtual void SendPacket (Ptr<const Packet> packet, WifiMode mode, enum WifiPreamble preamble, uint8_t txPowerLevel);
@@ -257,6 +266,7 @@ private:
   Ptr<ErrorModel> m_errorModel;
   PhyRxCallback m_phyRxCallback;
   PhyRxErrorCallback m_phyRxErrorCallback;
+  uint32_t m_channelIndex;
   ////David/Ramón
 };
 